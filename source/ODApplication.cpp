@@ -21,15 +21,22 @@
 
 #include "ODApplication.h"
 
+#include "gamemap/PathfindingBenchmark.h"
+#include "gamemap/TurnProfiler.h"
+#include "network/MultiGameServer.h"
 #include "network/ODServer.h"
 #include "network/ODClient.h"
+#include "network/ReplayReader.h"
+#include "network/ReplayWriter.h"
 #include "network/ServerMode.h"
+#include "network/ServerNotification.h"
 #include "sound/MusicPlayer.h"
 #include "sound/SoundEffectsManager.h"
 #include "render/Gui.h"
 #include "render/ODFrameListener.h"
 #include "render/TextRenderer.h"
 #include "utils/ConfigManager.h"
+#include "utils/Helper.h"
 #include "utils/LogManager.h"
 #include "utils/LogSinkConsole.h"
 #include "utils/LogSinkFile.h"
@@ -56,11 +63,15 @@
 #endif /* OGRE_PLATFORM == OGRE_PLATFORM_WIN32 */
 #endif /* OD_USE_SFML_WINDOW */
 
+#include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 
+#include <algorithm>
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <thread>
+#include <vector>
 
 void ODApplication::startGame(boost::program_options::variables_map& options)
 {
@@ -72,12 +83,98 @@ void ODApplication::startGame(boost::program_options::variables_map& options)
     logMgr.addSink(std::unique_ptr<LogSink>(new LogSinkConsole()));
     logMgr.addSink(std::unique_ptr<LogSink>(new LogSinkFile(resMgr.getLogFile())));
 
-    if(resMgr.isServerMode())
+    if(!resMgr.getReplayToReindex().empty())
+        reindexReplay(resMgr.getReplayToReindex());
+    else if(!resMgr.getHeadlessLevel().empty())
+        startHeadless();
+    else if(!resMgr.getCommandLogVerifyFile().empty())
+        verifyCommandLog(resMgr.getCommandLogVerifyFile());
+    else if(!resMgr.getBenchmarkFile().empty())
+        startBenchmark(resMgr.getBenchmarkFile());
+    else if(!resMgr.getPathBenchmarkFile().empty())
+        startPathfindingBenchmark(resMgr.getPathBenchmarkFile());
+    else if(resMgr.isServerMode())
         startServer();
     else
         startClient();
 }
 
+void ODApplication::reindexReplay(const std::string& replayFile)
+{
+    boost::filesystem::path inputPath(replayFile);
+    boost::filesystem::path outputPath = inputPath;
+    outputPath.replace_extension();
+    outputPath += "_indexed" + inputPath.extension().string();
+
+    ReplayReader reader;
+    if(!reader.open(inputPath.string()))
+    {
+        OD_LOG_ERR("Could not read replay " + inputPath.string());
+        return;
+    }
+
+    // The messages are copied as they are. The older replays could be written in the new format but they
+    // could only be played by the version that recorded them anyway
+    if(reader.getVersion() != ReplayReader::VERSION)
+    {
+        OD_LOG_ERR("Replay " + inputPath.string() + " was recorded by an older version. It cannot be indexed");
+        return;
+    }
+
+    if(!reader.getIndex().empty())
+    {
+        OD_LOG_INF("Replay " + inputPath.string() + " is already indexed");
+        return;
+    }
+
+    OD_LOG_INF("Indexing replay " + inputPath.string() + " to " + outputPath.string());
+
+    ReplayWriter writer;
+    if(!writer.open(outputPath.string()))
+    {
+        OD_LOG_ERR("Could not create replay " + outputPath.string());
+        return;
+    }
+
+    // The turn of each packet is needed for the index. We look for the turnStarted messages
+    // (that can be sent alone or in a batch)
+    int64_t turn = -1;
+    uint32_t nbPackets = 0;
+    ODPacket packet;
+    std::vector<char> buffer;
+    int32_t timestamp;
+    while((timestamp = reader.readPacket(packet)) >= 0)
+    {
+        buffer.clear();
+        packet.writePacket(timestamp, buffer);
+        writer.write(timestamp, turn, buffer);
+        ++nbPackets;
+
+        ServerNotificationType type;
+        if(!(packet >> type))
+            continue;
+
+        if(type == ServerNotificationType::turnStarted)
+        {
+            packet >> turn;
+            continue;
+        }
+
+        if(type != ServerNotificationType::messageBatch)
+            continue;
+
+        ODPacket batchedPacket;
+        while(packet.extractPacket(batchedPacket))
+        {
+            if((batchedPacket >> type) && (type == ServerNotificationType::turnStarted))
+                batchedPacket >> turn;
+        }
+    }
+    writer.close();
+
+    OD_LOG_INF("Replay indexed: " + Helper::toString(nbPackets) + " packets, last turn=" + Helper::toString(turn));
+}
+
 void ODApplication::startServer()
 {
     ResourceManager& resMgr = ResourceManager::getSingleton();
@@ -90,6 +187,29 @@ void ODApplication::startServer()
 
     const std::string& creator = resMgr.getServerModeCreator();
 
+    if(resMgr.getServerModeNbGames() > 1)
+    {
+        uint32_t nbThreads = resMgr.getServerModeNbThreads();
+        if(nbThreads == 0)
+            nbThreads = std::max(1u, std::thread::hardware_concurrency());
+
+        int32_t port = resMgr.getForcedNetworkPort();
+        if(port == -1)
+            port = static_cast<int32_t>(configManager.getNetworkPort());
+
+        MultiGameServer multiGameServer;
+        if(!multiGameServer.start(creator, resMgr.getServerModeLevel(), !creator.empty(),
+            resMgr.getServerModeNbGames(), port, nbThreads))
+        {
+            OD_LOG_ERR("Could not start server !!!");
+            return;
+        }
+
+        multiGameServer.waitEnd();
+        OD_LOG_INF("Stopping server...");
+        return;
+    }
+
     ODServer server;
     if(!server.startServer(creator, resMgr.getServerModeLevel(), ServerMode::ModeGameMultiPlayer, !creator.empty()))
     {
@@ -107,6 +227,316 @@ void ODApplication::startServer()
     server.stopServer();
 }
 
+//! \brief Returns the value at the given percentile of the given sorted durations
+static double getPercentile(const std::vector<double>& sortedDurations, double percentile)
+{
+    if(sortedDurations.empty())
+        return 0.0;
+
+    size_t index = static_cast<size_t>(percentile * static_cast<double>(sortedDurations.size() - 1) / 100.0 + 0.5);
+    return sortedDurations[index];
+}
+
+void ODApplication::startHeadless()
+{
+    ResourceManager& resMgr = ResourceManager::getSingleton();
+
+    OD_LOG_INF("Initializing");
+
+    // The seed is fixed so that 2 runs of the same level can be compared
+    Random::initialize(resMgr.getHeadlessSeed());
+    ConfigManager configManager(resMgr.getConfigPath(), "", resMgr.getSoundPath());
+    OD_LOG_INF("Launching headless game");
+
+    HeadlessTurnStats stats;
+    {
+        ODServer server;
+        if(!server.runHeadless(resMgr.getHeadlessLevel(), resMgr.getHeadlessNbTurns(), resMgr.getHeadlessSeed(), stats))
+        {
+            OD_LOG_ERR("Could not run headless game !!!");
+            return;
+        }
+    }
+    const std::vector<uint64_t>& turnChecksums = stats.mTurnChecksums;
+
+    std::vector<double> sortedDurations = stats.mTurnDurationsMs;
+    std::sort(sortedDurations.begin(), sortedDurations.end());
+    double totalMs = 0.0;
+    for(double duration : sortedDurations)
+        totalMs += duration;
+
+    uint32_t nbTurns = static_cast<uint32_t>(sortedDurations.size());
+    OD_LOG_INF("Headless game played " + Helper::toString(nbTurns) + " turns in " + Helper::toString(totalMs) + "ms");
+    if(nbTurns > 0)
+    {
+        OD_LOG_INF("Turn durations (ms): avg=" + Helper::toString(totalMs / nbTurns)
+            + ", min=" + Helper::toString(sortedDurations.front())
+            + ", p50=" + Helper::toString(getPercentile(sortedDurations, 50.0))
+            + ", p95=" + Helper::toString(getPercentile(sortedDurations, 95.0))
+            + ", p99=" + Helper::toString(getPercentile(sortedDurations, 99.0))
+            + ", max=" + Helper::toString(sortedDurations.back()));
+        OD_LOG_INF("Headless game ended with " + Helper::toString(stats.mTurnNbCreatures.back()) + " creatures");
+    }
+
+    const std::string& checksumsFile = resMgr.getHeadlessChecksumsFile();
+    if(!checksumsFile.empty())
+    {
+        std::ofstream file(checksumsFile.c_str(), std::ios_base::out | std::ios_base::trunc);
+        if(!file.is_open())
+        {
+            OD_LOG_ERR("Could not write checksums file " + checksumsFile);
+        }
+        else
+        {
+            for(uint32_t turn = 0; turn < turnChecksums.size(); ++turn)
+                file << (turn + 1) << " " << turnChecksums[turn] << std::endl;
+        }
+    }
+
+    const std::string& verifyFile = resMgr.getHeadlessVerifyFile();
+    if(verifyFile.empty())
+        return;
+
+    std::ifstream file(verifyFile.c_str(), std::ios_base::in);
+    if(!file.is_open())
+    {
+        OD_LOG_ERR("Could not read checksums file " + verifyFile);
+        return;
+    }
+
+    // We compare the turns played by both games. The first divergent turn is reported
+    int64_t turn;
+    uint64_t checksum;
+    uint32_t nbTurnsChecked = 0;
+    while((nbTurnsChecked < turnChecksums.size()) && (file >> turn >> checksum))
+    {
+        if(checksum != turnChecksums[nbTurnsChecked])
+        {
+            OD_LOG_ERR("Headless game diverged at turn " + Helper::toString(turn));
+            return;
+        }
+        ++nbTurnsChecked;
+    }
+
+    OD_LOG_INF("Headless game is deterministic: " + Helper::toString(nbTurnsChecked) + " turns checked");
+}
+
+void ODApplication::verifyCommandLog(const std::string& logFile)
+{
+    ResourceManager& resMgr = ResourceManager::getSingleton();
+
+    OD_LOG_INF("Initializing");
+    ConfigManager configManager(resMgr.getConfigPath(), "", resMgr.getSoundPath());
+    OD_LOG_INF("Playing command log " + logFile);
+
+    HeadlessTurnStats stats;
+    int64_t desyncTurn;
+    {
+        ODServer server;
+        if(!server.runCommandLog(logFile, stats, desyncTurn))
+        {
+            OD_LOG_ERR("Could not play command log !!!");
+            return;
+        }
+    }
+
+    if(desyncTurn >= 0)
+    {
+        OD_LOG_ERR("Command log game desynced at turn " + Helper::toString(desyncTurn));
+        return;
+    }
+
+    OD_LOG_INF("Command log game is in sync: " + Helper::toString(static_cast<uint32_t>(stats.mTurnChecksums.size())) + " turns played");
+}
+
+//! \brief Levels played by the benchmarks, from a small skirmish map to the biggest multiplayer one
+static const std::vector<std::string> BENCHMARK_LEVELS = {
+    "skirmish/StoneKeep.level",
+    "multiplayer/TestBigMap.level",
+    "multiplayer/Angel.level"
+};
+
+//! \brief Writes the average, the percentiles and the max of the given durations as a json object
+static void writeDurationsJson(std::ostream& stream, std::vector<double> durations)
+{
+    std::sort(durations.begin(), durations.end());
+    double totalMs = 0.0;
+    for(double duration : durations)
+        totalMs += duration;
+
+    double avg = durations.empty() ? 0.0 : totalMs / static_cast<double>(durations.size());
+    double max = durations.empty() ? 0.0 : durations.back();
+    stream << "{ \"avg\": " << avg
+        << ", \"p50\": " << getPercentile(durations, 50.0)
+        << ", \"p95\": " << getPercentile(durations, 95.0)
+        << ", \"p99\": " << getPercentile(durations, 99.0)
+        << ", \"max\": " << max << " }";
+}
+
+void ODApplication::startBenchmark(const std::string& resultFile)
+{
+    ResourceManager& resMgr = ResourceManager::getSingleton();
+
+    OD_LOG_INF("Initializing");
+    ConfigManager configManager(resMgr.getConfigPath(), "", resMgr.getSoundPath());
+
+    std::ofstream file(resultFile.c_str(), std::ios_base::out | std::ios_base::trunc);
+    if(!file.is_open())
+    {
+        OD_LOG_ERR("Could not write benchmark file " + resultFile);
+        return;
+    }
+
+    uint32_t seed = resMgr.getHeadlessSeed();
+    int32_t nbTurns = resMgr.getHeadlessNbTurns();
+    file << "{" << std::endl;
+    file << "  \"seed\": " << seed << "," << std::endl;
+    file << "  \"turns\": " << nbTurns << "," << std::endl;
+    file << "  \"levels\": [";
+    bool isFirstLevel = true;
+    for(const std::string& level : BENCHMARK_LEVELS)
+    {
+        std::string levelPath = resMgr.getGameDataPath() + "levels/" + level;
+        if(!boost::filesystem::exists(levelPath))
+        {
+            OD_LOG_WRN("Benchmark level not found: " + levelPath);
+            continue;
+        }
+
+        OD_LOG_INF("Benchmarking level " + level);
+        // Each level is played with the same seed so that the runs can be compared
+        Random::initialize(seed);
+        HeadlessTurnStats stats;
+        {
+            ODServer server;
+            if(!server.runHeadless(levelPath, nbTurns, seed, stats))
+            {
+                OD_LOG_ERR("Could not run benchmark level " + level);
+                continue;
+            }
+        }
+
+        double totalMs = 0.0;
+        for(double duration : stats.mTurnDurationsMs)
+            totalMs += duration;
+
+        OD_LOG_INF("Level " + level + " played " + Helper::toString(static_cast<uint32_t>(stats.mTurnDurationsMs.size()))
+            + " turns in " + Helper::toString(totalMs) + "ms");
+
+        file << (isFirstLevel ? "" : ",") << std::endl;
+        isFirstLevel = false;
+        file << "    {" << std::endl;
+        file << "      \"level\": \"" << level << "\"," << std::endl;
+        file << "      \"turns\": " << stats.mTurnDurationsMs.size() << "," << std::endl;
+        file << "      \"totalMs\": " << totalMs << "," << std::endl;
+        file << "      \"turnMs\": ";
+        writeDurationsJson(file, stats.mTurnDurationsMs);
+        file << "," << std::endl;
+        file << "      \"phasesMs\": {";
+        for(uint32_t phase = 0; phase < stats.mPhaseTimesMs.size(); ++phase)
+        {
+            file << (phase == 0 ? "" : ",") << std::endl;
+            file << "        \"" << TurnProfiler::getPhaseName(static_cast<TurnPhase>(phase)) << "\": ";
+            writeDurationsJson(file, stats.mPhaseTimesMs[phase]);
+        }
+        file << std::endl << "      }" << std::endl;
+        file << "    }";
+    }
+    file << std::endl << "  ]" << std::endl;
+    file << "}" << std::endl;
+
+    OD_LOG_INF("Benchmark results saved in " + resultFile);
+}
+
+void ODApplication::startPathfindingBenchmark(const std::string& resultFile)
+{
+    ResourceManager& resMgr = ResourceManager::getSingleton();
+
+    OD_LOG_INF("Initializing");
+    ConfigManager configManager(resMgr.getConfigPath(), "", resMgr.getSoundPath());
+
+    // If a golden file is given, its queries are replayed. Otherwise, they are drawn with the seed
+    PathfindingBenchmark benchmark(resMgr.getHeadlessSeed());
+    const std::string& goldenFile = resMgr.getPathGoldenFile();
+    bool isGoldenLoaded = false;
+    if(!goldenFile.empty())
+    {
+        if(!benchmark.loadGolden(goldenFile))
+        {
+            OD_LOG_ERR("Could not read pathfinding golden file " + goldenFile
+                + ". It can be recorded with the pathfinding_golden target");
+            return;
+        }
+        isGoldenLoaded = true;
+    }
+
+    std::ofstream file(resultFile.c_str(), std::ios_base::out | std::ios_base::trunc);
+    if(!file.is_open())
+    {
+        OD_LOG_ERR("Could not write pathfinding benchmark file " + resultFile);
+        return;
+    }
+
+    for(const std::string& level : BENCHMARK_LEVELS)
+    {
+        std::string levelPath = resMgr.getGameDataPath() + "levels/" + level;
+        if(!boost::filesystem::exists(levelPath))
+        {
+            OD_LOG_WRN("Benchmark level not found: " + levelPath);
+            continue;
+        }
+
+        OD_LOG_INF("Benchmarking pathfinding on level " + level);
+        Random::initialize(benchmark.getSeed());
+        ODServer server;
+        if(!server.runPathfindingBenchmark(levelPath, level, benchmark))
+            OD_LOG_ERR("Could not run pathfinding benchmark on level " + level);
+    }
+
+    file << "{" << std::endl;
+    if(!isGoldenLoaded)
+        file << "  \"seed\": " << benchmark.getSeed() << "," << std::endl;
+    if(isGoldenLoaded)
+        file << "  \"goldenMismatches\": " << benchmark.getNbMismatches() << "," << std::endl;
+    file << "  \"levels\": [";
+    const std::vector<PathfindingBenchmark::LevelTimes>& levelTimes = benchmark.getLevelTimes();
+    for(uint32_t i = 0; i < levelTimes.size(); ++i)
+    {
+        const PathfindingBenchmark::LevelTimes& times = levelTimes[i];
+        file << (i == 0 ? "" : ",") << std::endl;
+        file << "    {" << std::endl;
+        file << "      \"level\": \"" << times.mLevelName << "\"";
+        for(uint32_t kind = 0; kind < static_cast<uint32_t>(PathQueryKind::nbKinds); ++kind)
+        {
+            file << "," << std::endl;
+            file << "      \"" << PathfindingBenchmark::getKindName(static_cast<PathQueryKind>(kind)) << "\": { ";
+            file << "\"queries\": " << times.mColdUs[kind].size() << ", \"coldUs\": ";
+            writeDurationsJson(file, times.mColdUs[kind]);
+            file << ", \"warmUs\": ";
+            writeDurationsJson(file, times.mWarmUs[kind]);
+            file << " }";
+        }
+        file << std::endl << "    }";
+    }
+    file << std::endl << "  ]" << std::endl;
+    file << "}" << std::endl;
+
+    OD_LOG_INF("Pathfinding benchmark results saved in " + resultFile);
+
+    if(isGoldenLoaded)
+    {
+        if(benchmark.getNbMismatches() > 0)
+            OD_LOG_ERR("Pathfinding differs from golden file " + goldenFile + " for "
+                + Helper::toString(benchmark.getNbMismatches()) + " queries");
+        else
+            OD_LOG_INF("Pathfinding gives the same results as golden file " + goldenFile);
+    }
+
+    const std::string& goldenSaveFile = resMgr.getPathGoldenSaveFile();
+    if(!goldenSaveFile.empty() && benchmark.saveGolden(goldenSaveFile))
+        OD_LOG_INF("Pathfinding golden file saved in " + goldenSaveFile);
+}
+
 void ODApplication::startClient()
 {
     ResourceManager& resMgr = ResourceManager::getSingleton();
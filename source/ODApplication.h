@@ -64,6 +64,22 @@ private:
     void startClient();
     //! \brief Server mode. Creates only the needed to launch a level. Note that this is to be used without gui
     void startServer();
+    //! \brief Indexes the given replay if it was not closed. The indexed replay is saved next to it. Only the
+    //! replays in the last format can be indexed. Note that this is to be used without gui
+    void reindexReplay(const std::string& replayFile);
+    //! \brief Headless mode. Plays a level with AI players as fast as possible and logs the turn durations.
+    //! Note that this is to be used without gui
+    void startHeadless();
+    //! \brief Plays again the game saved in the given command log and checks it gives the same checksums.
+    //! Note that this is to be used without gui
+    void verifyCommandLog(const std::string& logFile);
+    //! \brief Benchmark mode. Plays each benchmark level with AI players for a fixed number of turns and saves
+    //! the percentiles of the turn and phases durations in the given json file. Note that this is to be used without gui
+    void startBenchmark(const std::string& resultFile);
+    //! \brief Pathfinding benchmark mode. Loads each benchmark level, then times pathfinding queries on it and saves
+    //! their durations in the given json file. The queries are replayed from the golden file if one is given (and
+    //! their results compared with it) or drawn from the levels creatures otherwise. Note that this is to be used without gui
+    void startPathfindingBenchmark(const std::string& resultFile);
 };
 
 #endif // ODAPPLICATION_H
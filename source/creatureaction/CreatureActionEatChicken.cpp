@@ -83,7 +83,7 @@ bool CreatureActionEatChicken::handleEatChicken(Creature& creature, ChickenEntit
     if(dist > 1)
     {
         // We walk to the chicken
-        std::list<Tile*> pathToChicken = creature.getGameMap()->path(&creature, chickenTile);
+        std::vector<Tile*> pathToChicken = creature.getGameMap()->path(&creature, chickenTile);
         if(pathToChicken.empty())
         {
             OD_LOG_ERR("creature=" + creature.getName() + " posTile=" + Tile::displayAsString(myTile) + " empty path to chicken tile=" + Tile::displayAsString(chickenTile));
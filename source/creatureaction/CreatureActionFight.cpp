@@ -144,7 +144,11 @@ bool CreatureActionFight::handleFight(Creature& creature, GameEntity* entityAtta
             }
 
             // We need to move
-            std::list<Tile*> result = creature.getGameMap()->path(&creature, tilePosition);
+            // Many creatures may be attacking the same target. In this case, we follow the shared flow field
+            std::vector<Tile*> result;
+            if(!creature.getGameMap()->pathFromFlowField(&creature, tilePosition, result, 3))
+                result = creature.getGameMap()->path(&creature, tilePosition);
+
             if(result.empty())
             {
                 OD_LOG_ERR("name=" + creature.getName() + ", myTile=" + Tile::displayAsString(myTile) + ", dest=" + Tile::displayAsString(tilePosition));
@@ -181,7 +185,11 @@ bool CreatureActionFight::handleFight(Creature& creature, GameEntity* entityAtta
             }
 
             // We need to move to the entity
-            std::list<Tile*> result = creature.getGameMap()->path(&creature, tilePosition);
+            // Many creatures may be attacking the same target. In this case, we follow the shared flow field
+            std::vector<Tile*> result;
+            if(!creature.getGameMap()->pathFromFlowField(&creature, tilePosition, result, 3))
+                result = creature.getGameMap()->path(&creature, tilePosition);
+
             if(result.empty())
             {
                 OD_LOG_ERR("name" + creature.getName() + ", myTile=" + Tile::displayAsString(myTile) + ", dest=" + Tile::displayAsString(tilePosition));
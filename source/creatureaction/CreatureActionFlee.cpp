@@ -61,7 +61,7 @@ bool CreatureActionFlee::handleFlee(Creature& creature, int32_t nbTurns)
         // We can go to one dungeon temple
         Room* room = tempRooms[Random::Int(0, tempRooms.size() - 1)];
         Tile* tile = room->getCoveredTile(0);
-        std::list<Tile*> result = creature.getGameMap()->path(&creature, tile);
+        std::vector<Tile*> result = creature.getGameMap()->path(&creature, tile);
         // If we are not too near from the dungeon temple, we go there
         if(result.size() > 5)
         {
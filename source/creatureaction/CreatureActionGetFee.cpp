@@ -102,7 +102,7 @@ bool CreatureActionGetFee::handleGetFee(Creature& creature)
     }
 
     Tile* chosenTile = nullptr;
-    std::list<Tile*> tilePath = creature.getGameMap()->findBestPath(&creature, myTile,
+    std::vector<Tile*> tilePath = creature.getGameMap()->findBestPath(&creature, myTile,
         availableTreasuries, chosenTile);
 
     if(tilePath.empty() || (chosenTile == nullptr))
@@ -194,7 +194,7 @@ bool CreatureActionSearchJob::handleSearchJob(Creature& creature, bool forced)
             continue;
 
         Tile* chosenTile = nullptr;
-        std::list<Tile*> tilePath = creature.getGameMap()->findBestPath(&creature, myTile, rooms, chosenTile);
+        std::vector<Tile*> tilePath = creature.getGameMap()->findBestPath(&creature, myTile, rooms, chosenTile);
 
         if(tilePath.empty() || (chosenTile == nullptr))
             continue;
@@ -18,20 +18,39 @@
 #include "creatureaction/CreatureActionWalkToTile.h"
 
 #include "entities/Creature.h"
+#include "entities/Tile.h"
+#include "gamemap/GameMap.h"
+
+#include <OgreVector3.h>
 
 #include <functional>
 
 std::function<bool()> CreatureActionWalkToTile::action()
 {
     return std::bind(&CreatureActionWalkToTile::handleWalkToTile,
-        std::ref(mCreature));
+        std::ref(mCreature), mDestination);
 }
 
-bool CreatureActionWalkToTile::handleWalkToTile(Creature& creature)
+bool CreatureActionWalkToTile::handleWalkToTile(Creature& creature, Tile* destination)
 {
     if (creature.isMoving())
         return false;
 
+    // If we are walking a long route, we ask for the next leg
+    if((destination != nullptr) && (creature.getPositionTile() != destination))
+    {
+        // When the last leg is walked, the creature will be on the destination tile and the action will be popped
+        bool isComplete;
+        std::vector<Tile*> result = creature.getGameMap()->pathFirstLeg(&creature, destination, isComplete);
+        if(result.size() > 1)
+        {
+            std::vector<Ogre::Vector3> path;
+            creature.tileToVector3(result, path, true, 0.0);
+            creature.setWalkPath(EntityAnimation::walk_anim, EntityAnimation::idle_anim, true, true, path);
+            return false;
+        }
+    }
+
     creature.popAction();
     return true;
 }
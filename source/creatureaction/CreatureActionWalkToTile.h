@@ -20,11 +20,16 @@
 
 #include "creatureaction/CreatureAction.h"
 
+class Tile;
+
 class CreatureActionWalkToTile : public CreatureAction
 {
 public:
-    CreatureActionWalkToTile(Creature& creature) :
-        CreatureAction(creature)
+    //! \brief If destination is not nullptr, the creature is walking a long route leg by leg
+    //! and the next leg will be computed when the current walk path is over
+    CreatureActionWalkToTile(Creature& creature, Tile* destination = nullptr) :
+        CreatureAction(creature),
+        mDestination(destination)
     {}
 
     virtual ~CreatureActionWalkToTile()
@@ -35,7 +40,10 @@ public:
 
     std::function<bool()> action() override;
 
-    static bool handleWalkToTile(Creature& creature);
+    static bool handleWalkToTile(Creature& creature, Tile* destination);
+
+private:
+    Tile* mDestination;
 };
 
 #endif // CREATUREACTIONWALKTOTILE_H
@@ -437,7 +437,10 @@ bool Building::importFromStream(std::istream& is)
         }
 
         if(tileData->mHP > 0)
+        {
             tile->setSeat(getSeat());
+            getGameMap()->tileClaimChanged(tile);
+        }
     }
 
     return true;
@@ -97,6 +97,7 @@ static const Ogre::Real CANNON_MISSILE_HEIGHT = 0.3;
 
 const int32_t Creature::NB_TURNS_BEFORE_CHECKING_TASK = 15;
 const uint32_t Creature::NB_OVERLAY_HEALTH_VALUES = 8;
+const int64_t Creature::NB_TURNS_BETWEEN_UPDATE_KEYFRAMES = 50;
 
 enum CreatureMoodEnum
 {
@@ -117,6 +118,22 @@ enum CreatureMoodEnum
     MoodPrisonFiltersPrisonAllies = KoTemp | InJail
 };
 
+//! \brief Fields sent by Creature::exportUpdateValuesToPacket. Only the fields in the mask are written
+enum CreatureUpdateField
+{
+    Effects = 0x0001,
+    Level = 0x0002,
+    SeatId = 0x0004,
+    OverlayHealth = 0x0008,
+    Mood = 0x0010,
+    GroundSpeed = 0x0020,
+    WaterSpeed = 0x0040,
+    LavaSpeed = 0x0080,
+    SpeedModifier = 0x0100,
+    SeatPrison = 0x0200,
+    AllFields = 0x03FF
+};
+
 CreatureParticuleEffect::CreatureParticuleEffect(Creature& creature, const std::string& name, const std::string& script, uint32_t nbTurnsEffect,
         CreatureEffect* effect) :
     EntityParticleEffect(name, script, nbTurnsEffect),
@@ -693,26 +710,43 @@ void Creature::update(Ogre::Real timeSinceLastFrame)
 }
 
 void Creature::computeVisibleTiles()
+{
+    if(!needVisibleTilesUpdate())
+        return;
+
+    // Look at the surrounding area
+    updateTilesInSight();
+    commitVisibleTiles();
+}
+
+bool Creature::needVisibleTilesUpdate()
 {
     // dead Creatures do not give vision
     if (getHP() <= 0.0)
-        return;
+        return false;
 
     // KO Creatures do not give vision
     if (isKo())
-        return;
+        return false;
 
     // creatures in jail do not give vision
     if (mSeatPrison != nullptr)
-        return;
+        return false;
 
     if (!getIsOnMap())
-        return;
+        return false;
 
-    // Look at the surrounding area
-    updateTilesInSight();
-    for(Tile* tile : mVisibleTiles)
-        tile->notifyVision(getSeat());
+    Tile* posTile = getPositionTile();
+    if (posTile == nullptr)
+        return false;
+
+    // The tiles in sight only change if we moved or if a tile around started or stopped blocking vision
+    return getGameMap()->needVisionUpdate(this, getSeat(), posTile, static_cast<uint32_t>(mDefinition->getSightRadius()));
+}
+
+void Creature::commitVisibleTiles()
+{
+    getGameMap()->setVisionTiles(this, mVisibleTiles);
 }
 
 void Creature::setLevel(unsigned int level)
@@ -913,8 +947,8 @@ void Creature::doUpkeep()
         increaseHunger(mDefinition->getHungerGrowthPerTurn());
     }
 
-    mVisibleEnemyObjects         = getVisibleEnemyObjects();
-    mVisibleAlliedObjects        = getVisibleAlliedObjects();
+    getGameMap()->getVisibleForce(mVisibleTiles, getSeat(), true, mVisibleEnemyObjects);
+    getGameMap()->getVisibleForce(mVisibleTiles, getSeat(), false, mVisibleAlliedObjects);
     mReachableAlliedObjects      = getReachableAttackableObjects(mVisibleAlliedObjects);
 
     // Check if we should compute mood
@@ -1101,7 +1135,11 @@ bool Creature::handleIdleAction()
             uint32_t index = Random::Uint(0,reachableCallToWars.size()-1);
             Spell* callToWar = reachableCallToWars[index];
             Tile* callToWarTile = callToWar->getPositionTile();
-            std::list<Tile*> tempPath = getGameMap()->path(this, callToWarTile);
+            // Every creature of the seat is likely to go to the call to war so we try to use the shared flow field
+            std::vector<Tile*> tempPath;
+            if(!getGameMap()->pathFromFlowField(this, callToWarTile, tempPath))
+                tempPath = getGameMap()->path(this, callToWarTile);
+
             // If we are 5 tiles from the call to war, we don't go there
             if(tempPath.size() >= 5)
             {
@@ -1569,55 +1607,118 @@ void Creature::checkLevelUp()
 
 void Creature::exportToPacketForUpdate(ODPacket& os, const Seat* seat) const
 {
-    MovableGameEntity::exportToPacketForUpdate(os, seat);
+    UpdateValues values;
+    computeUpdateValues(seat, values);
+    exportUpdateValuesToPacket(os, seat, values, CreatureUpdateField::AllFields);
+}
 
-    int seatId = getSeat()->getId();
-    os << mLevel;
-    os << seatId;
-    os << mOverlayHealthValue;
+void Creature::computeUpdateValues(const Seat* seat, UpdateValues& values) const
+{
+    values.mLevel = mLevel;
+    values.mSeatId = getSeat()->getId();
+    values.mOverlayHealthValue = mOverlayHealthValue;
 
     // Only allied players should see creature mood (except some states)
-    uint32_t moodValue = 0;
+    values.mMoodValue = 0;
     if(seat->isAlliedSeat(getSeat()))
-        moodValue = mOverlayMoodValue;
+        values.mMoodValue = mOverlayMoodValue;
     else if(mSeatPrison != nullptr)
     {
         if(mSeatPrison->isAlliedSeat(seat))
-            moodValue = mOverlayMoodValue & CreatureMoodEnum::MoodPrisonFiltersPrisonAllies;
+            values.mMoodValue = mOverlayMoodValue & CreatureMoodEnum::MoodPrisonFiltersPrisonAllies;
         else
-            moodValue = mOverlayMoodValue & CreatureMoodEnum::MoodPrisonFiltersAllPlayers;
+            values.mMoodValue = mOverlayMoodValue & CreatureMoodEnum::MoodPrisonFiltersAllPlayers;
     }
 
-    os << moodValue;
-    os << mGroundSpeed;
-    os << mWaterSpeed;
-    os << mLavaSpeed;
-    os << mSpeedModifier;
+    // Speeds are only used to animate the creature on client side. Float precision is enough
+    values.mGroundSpeed = static_cast<float>(mGroundSpeed);
+    values.mWaterSpeed = static_cast<float>(mWaterSpeed);
+    values.mLavaSpeed = static_cast<float>(mLavaSpeed);
+    values.mSpeedModifier = static_cast<float>(mSpeedModifier);
 
-    int seatPrisonId = -1;
+    values.mSeatPrisonId = -1;
     if(mSeatPrison != nullptr)
-        seatPrisonId = mSeatPrison->getId();
+        values.mSeatPrisonId = mSeatPrison->getId();
+}
 
-    os << seatPrisonId;
+void Creature::exportUpdateValuesToPacket(ODPacket& os, const Seat* seat, const UpdateValues& values, uint16_t fields) const
+{
+    // Particle effects are not kept once sent. If there are some, we send them (the client ignores the ones it already has)
+    if(mEntityParticleEffects.empty())
+        fields &= ~CreatureUpdateField::Effects;
+    else
+        fields |= CreatureUpdateField::Effects;
+
+    os << fields;
+    if((fields & CreatureUpdateField::Effects) != 0)
+        MovableGameEntity::exportToPacketForUpdate(os, seat);
+    if((fields & CreatureUpdateField::Level) != 0)
+        os << values.mLevel;
+    if((fields & CreatureUpdateField::SeatId) != 0)
+        os << values.mSeatId;
+    if((fields & CreatureUpdateField::OverlayHealth) != 0)
+        os << values.mOverlayHealthValue;
+    if((fields & CreatureUpdateField::Mood) != 0)
+        os << values.mMoodValue;
+    if((fields & CreatureUpdateField::GroundSpeed) != 0)
+        os << values.mGroundSpeed;
+    if((fields & CreatureUpdateField::WaterSpeed) != 0)
+        os << values.mWaterSpeed;
+    if((fields & CreatureUpdateField::LavaSpeed) != 0)
+        os << values.mLavaSpeed;
+    if((fields & CreatureUpdateField::SpeedModifier) != 0)
+        os << values.mSpeedModifier;
+    if((fields & CreatureUpdateField::SeatPrison) != 0)
+        os << values.mSeatPrisonId;
 }
 
 void Creature::updateFromPacket(ODPacket& is)
 {
-    MovableGameEntity::updateFromPacket(is);
+    uint16_t fields;
+    OD_ASSERT_TRUE(is >> fields);
+    if((fields & CreatureUpdateField::Effects) != 0)
+        MovableGameEntity::updateFromPacket(is);
 
-    int seatId;
-    OD_ASSERT_TRUE(is >> mLevel);
-    OD_ASSERT_TRUE(is >> seatId);
-    OD_ASSERT_TRUE(is >> mOverlayHealthValue);
-    OD_ASSERT_TRUE(is >> mOverlayMoodValue);
-    OD_ASSERT_TRUE(is >> mGroundSpeed);
-    OD_ASSERT_TRUE(is >> mWaterSpeed);
-    OD_ASSERT_TRUE(is >> mLavaSpeed);
-    OD_ASSERT_TRUE(is >> mSpeedModifier);
+    if((fields & CreatureUpdateField::Level) != 0)
+    {
+        uint32_t level;
+        OD_ASSERT_TRUE(is >> level);
+        mLevel = level;
+    }
+
+    int32_t seatId = getSeat()->getId();
+    if((fields & CreatureUpdateField::SeatId) != 0)
+        OD_ASSERT_TRUE(is >> seatId);
+    if((fields & CreatureUpdateField::OverlayHealth) != 0)
+        OD_ASSERT_TRUE(is >> mOverlayHealthValue);
+    if((fields & CreatureUpdateField::Mood) != 0)
+        OD_ASSERT_TRUE(is >> mOverlayMoodValue);
+
+    float speed;
+    if((fields & CreatureUpdateField::GroundSpeed) != 0)
+    {
+        OD_ASSERT_TRUE(is >> speed);
+        mGroundSpeed = speed;
+    }
+    if((fields & CreatureUpdateField::WaterSpeed) != 0)
+    {
+        OD_ASSERT_TRUE(is >> speed);
+        mWaterSpeed = speed;
+    }
+    if((fields & CreatureUpdateField::LavaSpeed) != 0)
+    {
+        OD_ASSERT_TRUE(is >> speed);
+        mLavaSpeed = speed;
+    }
+    if((fields & CreatureUpdateField::SpeedModifier) != 0)
+    {
+        OD_ASSERT_TRUE(is >> speed);
+        mSpeedModifier = speed;
+    }
 
     // We do not scale the creature if it is picked up (because it is already not at its normal size). It will be
     // resized anyway when dropped
-    if(getIsOnMap())
+    if(((fields & CreatureUpdateField::Level) != 0) && getIsOnMap())
         RenderManager::getSingleton().rrScaleCreature(*this);
 
     if(getSeat()->getId() != seatId)
@@ -1633,6 +1734,9 @@ void Creature::updateFromPacket(ODPacket& is)
         }
     }
 
+    if((fields & CreatureUpdateField::SeatPrison) == 0)
+        return;
+
     OD_ASSERT_TRUE(is >> seatId);
     if(seatId == -1)
         mSeatPrison = nullptr;
@@ -1656,7 +1760,17 @@ void Creature::updateTilesInSight()
     mTilesWithinSightRadius = getGameMap()->circularRegion(posTile->getX(), posTile->getY(), mDefinition->getSightRadius());
 
     // Only the tiles the creature can "see".
-    mVisibleTiles = getGameMap()->visibleTiles(posTile->getX(), posTile->getY(), mDefinition->getSightRadius());
+    getGameMap()->visibleTiles(posTile->getX(), posTile->getY(), mDefinition->getSightRadius(), mVisibleTiles);
+}
+
+void Creature::updateTilesInSight(LineOfSight::Buffers& buffers)
+{
+    Tile* posTile = getPositionTile();
+    if (posTile == nullptr)
+        return;
+
+    mTilesWithinSightRadius = getGameMap()->circularRegion(posTile->getX(), posTile->getY(), mDefinition->getSightRadius());
+    getGameMap()->visibleTiles(posTile->getX(), posTile->getY(), mDefinition->getSightRadius(), mVisibleTiles, buffers);
 }
 
 std::vector<GameEntity*> Creature::getVisibleEnemyObjects()
@@ -2350,12 +2464,15 @@ bool Creature::setDestination(Tile* tile)
     if(posTile == nullptr)
         return false;
 
-    std::list<Tile*> result = getGameMap()->path(this, tile);
+    // If the destination is far away, we only get the path to the first leg. The next legs
+    // will be computed by the walk action when the creature reaches the end of the path
+    bool isComplete;
+    std::vector<Tile*> result = getGameMap()->pathFirstLeg(this, tile, isComplete);
 
     std::vector<Ogre::Vector3> path;
     tileToVector3(result, path, true, 0.0);
     setWalkPath(EntityAnimation::walk_anim, EntityAnimation::idle_anim, true, true, path);
-    pushAction(Utils::make_unique<CreatureActionWalkToTile>(*this));
+    pushAction(Utils::make_unique<CreatureActionWalkToTile>(*this, isComplete ? nullptr : tile));
     return true;
 }
 
@@ -2470,8 +2587,8 @@ void Creature::releaseCarriedEntity()
 
         ServerNotification* serverNotification = new ServerNotification(
             ServerNotificationType::releaseCarriedEntity, seat->getPlayer());
-        serverNotification->mPacket << getName() << carriedEntity->getObjectType();
-        serverNotification->mPacket << carriedEntity->getName();
+        exportIdToPacket(serverNotification->mPacket);
+        carriedEntity->exportIdToPacket(serverNotification->mPacket);
         serverNotification->mPacket << mPosition;
         ODServer::getSingleton().queueServerNotification(serverNotification);
     }
@@ -2530,6 +2647,9 @@ void Creature::slap()
 
 void Creature::fireAddEntity(Seat* seat, bool async)
 {
+    // The creature is fully exported. The next refresh will be a keyframe
+    removeSeatUpdateSnapshot(seat);
+
     if(async)
     {
         ServerNotification serverNotification(
@@ -2557,42 +2677,54 @@ void Creature::fireAddEntity(Seat* seat, bool async)
 
         serverNotification = new ServerNotification(
             ServerNotificationType::carryEntity, seat->getPlayer());
-        serverNotification->mPacket << getName() << mCarriedEntity->getObjectType();
-        serverNotification->mPacket << mCarriedEntity->getName();
+        exportIdToPacket(serverNotification->mPacket);
+        mCarriedEntity->exportIdToPacket(serverNotification->mPacket);
         ODServer::getSingleton().queueServerNotification(serverNotification);
     }
 }
 
 void Creature::fireRemoveEntity(Seat* seat)
 {
+    removeSeatUpdateSnapshot(seat);
+
     // If we are carrying an entity, we release it first, then we can remove it and us
     if(mCarriedEntity != nullptr)
     {
         ServerNotification* serverNotification = new ServerNotification(
             ServerNotificationType::releaseCarriedEntity, seat->getPlayer());
-        serverNotification->mPacket << getName() << mCarriedEntity->getObjectType();
-        serverNotification->mPacket << mCarriedEntity->getName();
+        exportIdToPacket(serverNotification->mPacket);
+        mCarriedEntity->exportIdToPacket(serverNotification->mPacket);
         serverNotification->mPacket << mPosition;
         ODServer::getSingleton().queueServerNotification(serverNotification);
 
         mCarriedEntity->removeSeatWithVision(seat);
     }
 
-    const std::string& name = getName();
     ServerNotification *serverNotification = new ServerNotification(
         ServerNotificationType::removeEntity, seat->getPlayer());
-    GameEntityType type = getObjectType();
-    serverNotification->mPacket << type;
-    serverNotification->mPacket << name;
+    exportIdToPacket(serverNotification->mPacket);
     ODServer::getSingleton().queueServerNotification(serverNotification);
 }
 
+void Creature::removeSeatUpdateSnapshot(const Seat* seat)
+{
+    for(std::vector<SeatUpdateSnapshot>::iterator it = mSeatUpdateSnapshots.begin(); it != mSeatUpdateSnapshots.end(); ++it)
+    {
+        if(it->mSeat != seat)
+            continue;
+
+        mSeatUpdateSnapshots.erase(it);
+        return;
+    }
+}
+
 void Creature::fireCreatureRefreshIfNeeded()
 {
     if(!mNeedFireRefresh)
         return;
 
     mNeedFireRefresh = false;
+    int64_t turn = getGameMap()->getTurnNumber();
     for(Seat* seat : mSeatsWithVisionNotified)
     {
         if(seat->getPlayer() == nullptr)
@@ -2600,14 +2732,68 @@ void Creature::fireCreatureRefreshIfNeeded()
         if(!seat->getPlayer()->getIsHuman())
             continue;
 
-        const std::string& name = getName();
+        UpdateValues values;
+        computeUpdateValues(seat, values);
+
+        // We only send the fields that changed since the last refresh sent to this seat. If there was none
+        // or if the last keyframe is too old, we send everything
+        SeatUpdateSnapshot* snapshot = nullptr;
+        for(SeatUpdateSnapshot& seatSnapshot : mSeatUpdateSnapshots)
+        {
+            if(seatSnapshot.mSeat != seat)
+                continue;
+
+            snapshot = &seatSnapshot;
+            break;
+        }
+
+        uint16_t fields = CreatureUpdateField::AllFields;
+        if(snapshot == nullptr)
+        {
+            SeatUpdateSnapshot seatSnapshot;
+            seatSnapshot.mSeat = seat;
+            seatSnapshot.mKeyframeTurn = turn;
+            mSeatUpdateSnapshots.push_back(seatSnapshot);
+            snapshot = &mSeatUpdateSnapshots.back();
+        }
+        else if(turn - snapshot->mKeyframeTurn >= NB_TURNS_BETWEEN_UPDATE_KEYFRAMES)
+        {
+            snapshot->mKeyframeTurn = turn;
+        }
+        else
+        {
+            const UpdateValues& sentValues = snapshot->mValues;
+            fields = 0;
+            if(values.mLevel != sentValues.mLevel)
+                fields |= CreatureUpdateField::Level;
+            if(values.mSeatId != sentValues.mSeatId)
+                fields |= CreatureUpdateField::SeatId;
+            if(values.mOverlayHealthValue != sentValues.mOverlayHealthValue)
+                fields |= CreatureUpdateField::OverlayHealth;
+            if(values.mMoodValue != sentValues.mMoodValue)
+                fields |= CreatureUpdateField::Mood;
+            if(values.mGroundSpeed != sentValues.mGroundSpeed)
+                fields |= CreatureUpdateField::GroundSpeed;
+            if(values.mWaterSpeed != sentValues.mWaterSpeed)
+                fields |= CreatureUpdateField::WaterSpeed;
+            if(values.mLavaSpeed != sentValues.mLavaSpeed)
+                fields |= CreatureUpdateField::LavaSpeed;
+            if(values.mSpeedModifier != sentValues.mSpeedModifier)
+                fields |= CreatureUpdateField::SpeedModifier;
+            if(values.mSeatPrisonId != sentValues.mSeatPrisonId)
+                fields |= CreatureUpdateField::SeatPrison;
+
+            if((fields == 0) && mEntityParticleEffects.empty())
+                continue;
+        }
+        snapshot->mValues = values;
+
         ServerNotification *serverNotification = new ServerNotification(
             ServerNotificationType::entitiesRefresh, seat->getPlayer());
         uint32_t nbCreature = 1;
         serverNotification->mPacket << nbCreature;
-        serverNotification->mPacket << GameEntityType::creature;
-        serverNotification->mPacket << name;
-        exportToPacketForUpdate(serverNotification->mPacket, seat);
+        exportIdToPacket(serverNotification->mPacket);
+        exportUpdateValuesToPacket(serverNotification->mPacket, seat, values, fields);
         ODServer::getSingleton().queueServerNotification(serverNotification);
     }
 }
@@ -3223,7 +3409,15 @@ void Creature::changeSeat(Seat* newSeat)
 {
     OD_LOG_INF("creature=" + getName() + " changes side from seatId=" + Helper::toString(getSeat()->getId()) + " to seatId=" + Helper::toString(newSeat->getId()));
     OD_ASSERT_TRUE_MSG(getSeat() != newSeat, "creature=" + getName() + ", seatId=" + Helper::toString(newSeat->getId()));
+    // The entity grid buckets the creatures by seat
+    Tile* posTile = getPositionTile();
+    if(getIsOnMap() && (posTile != nullptr))
+        getGameMap()->removeCreatureFromGrid(this, posTile);
+
     setSeat(newSeat);
+    if(getIsOnMap() && (posTile != nullptr))
+        getGameMap()->addCreatureToGrid(this, posTile);
+
     mMoodValue = CreatureMoodLevel::Neutral;
     mMoodPoints = 0;
     mWakefulness = 100;
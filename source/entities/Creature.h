@@ -22,6 +22,7 @@
 #define CREATURE_H
 
 #include "entities/MovableGameEntity.h"
+#include "gamemap/LineOfSight.h"
 
 #include <OgreVector2.h>
 #include <OgreVector3.h>
@@ -119,6 +120,9 @@ public:
 
     static const uint32_t NB_OVERLAY_HEALTH_VALUES;
 
+    //! \brief Every NB_TURNS_BETWEEN_UPDATE_KEYFRAMES turns, every field is sent when the creature is refreshed
+    static const int64_t NB_TURNS_BETWEEN_UPDATE_KEYFRAMES;
+
     virtual GameEntityType getObjectType() const;
 
     virtual void addToGameMap();
@@ -249,9 +253,16 @@ public:
      */
     void doUpkeep();
 
-    //! \brief Computes the visible tiles and tags them to know which are visible
+    //! \brief Gives vision on the visible tiles. They are only recomputed when needed
     void computeVisibleTiles();
 
+    /*! \brief computeVisibleTiles split in 3 steps so that the visible tiles of several creatures can be computed in
+     * parallel: needVisibleTilesUpdate returns true if the visible tiles should be recomputed. In this case,
+     * updateTilesInSight(buffers) should be called (it only reads the map) then commitVisibleTiles gives the vision
+     */
+    bool needVisibleTilesUpdate();
+    void commitVisibleTiles();
+
     virtual bool isAttackable(Tile* tile, Seat* seat) const;
 
     double getPhysicalDefense() const;
@@ -265,6 +276,10 @@ public:
     //! And the tiles the creature can "see" (removing the ones behind walls).
     void updateTilesInSight();
 
+    //! \brief Same as above with the given line of sight buffers. The tile distances of the gamemap should have been
+    //! built up to the sight radius. Can be called from several threads for different creatures
+    void updateTilesInSight(LineOfSight::Buffers& buffers);
+
     //! \brief Loops over the visibleTiles and adds all enemy creatures in each tile to a list which it returns.
     std::vector<GameEntity*> getVisibleEnemyObjects();
 
@@ -550,6 +565,8 @@ public:
 
     virtual void clientUpkeep() override;
 
+    //! \brief Exports every field that can be updated (keyframe). fireCreatureRefreshIfNeeded only sends the fields
+    //! that changed since the last update sent to each seat. Both are read by updateFromPacket
     virtual void exportToPacketForUpdate(ODPacket& os, const Seat* seat) const override;
     virtual void updateFromPacket(ODPacket& is) override;
 
@@ -611,6 +628,39 @@ private:
     void createMeshWeapons();
     void destroyMeshWeapons();
 
+    //! \brief Values sent to a seat by fireCreatureRefreshIfNeeded
+    struct UpdateValues
+    {
+        uint32_t mLevel;
+        int32_t mSeatId;
+        uint32_t mOverlayHealthValue;
+        uint32_t mMoodValue;
+        float mGroundSpeed;
+        float mWaterSpeed;
+        float mLavaSpeed;
+        float mSpeedModifier;
+        int32_t mSeatPrisonId;
+    };
+
+    //! \brief Last values sent to a seat that has vision on the creature. Used on server side to only send the fields
+    //! that changed
+    struct SeatUpdateSnapshot
+    {
+        const Seat* mSeat;
+        UpdateValues mValues;
+        //! \brief Turn where every field has been sent for the last time
+        int64_t mKeyframeTurn;
+    };
+
+    //! \brief Computes the values the given seat should see when the creature is refreshed
+    void computeUpdateValues(const Seat* seat, UpdateValues& values) const;
+
+    //! \brief Exports the given fields (bit mask of CreatureUpdateField) for updateFromPacket
+    void exportUpdateValuesToPacket(ODPacket& os, const Seat* seat, const UpdateValues& values, uint16_t fields) const;
+
+    //! \brief Forgets the values sent to the given seat. The next refresh sent to it will contain every field
+    void removeSeatUpdateSnapshot(const Seat* seat);
+
     //! \brief Constructor for sending creatures through network. It should not be used in game.
     Creature(GameMap* gameMap);
 
@@ -724,6 +774,9 @@ private:
     //! level or HP)
     bool                            mNeedFireRefresh;
 
+    //! \brief Used on server side. Last values sent to each seat that has vision on the creature
+    std::vector<SeatUpdateSnapshot> mSeatUpdateSnapshots;
+
     //! \brief Used on client side. When a creature is dropped, this cooldown will be set to a value > 0
     //! and decreased at each turn. Until it is > 0, the creature cannot be slapped. That's to avoid
     //! slapping creatures to death when dropping many.
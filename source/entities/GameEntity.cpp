@@ -80,6 +80,8 @@ EntityParticleEffect* EntityParticleEffect::importParticleEffectFromPacketIfNotI
     return effect;
 }
 
+const uint32_t GameEntity::NO_HANDLE = 0xFFFFFFFF;
+
 GameEntity::GameEntity(
           GameMap*        gameMap,
           std::string     name,
@@ -88,6 +90,7 @@ GameEntity::GameEntity(
           ) :
     mPosition          (Ogre::Vector3::ZERO),
     mName              (name),
+    mHandle            (NO_HANDLE),
     mMeshName          (meshName),
     mMeshExists        (false),
     mSeat              (seat),
@@ -361,6 +364,11 @@ void GameEntity::exportHeadersToPacket(ODPacket& os) const
     os << getObjectType();
 }
 
+void GameEntity::exportIdToPacket(ODPacket& os) const
+{
+    os << mHandle;
+}
+
 void GameEntity::exportToPacket(ODPacket& os, const Seat* seat) const
 {
     int seatId = -1;
@@ -369,6 +377,7 @@ void GameEntity::exportToPacket(ODPacket& os, const Seat* seat) const
 
     os << seatId;
     os << mName;
+    os << mHandle;
     os << mMeshName;
     os << mPosition;
 
@@ -386,6 +395,7 @@ void GameEntity::importFromPacket(ODPacket& is)
         mSeat = mGameMap->getSeatById(seatId);
 
     OD_ASSERT_TRUE(is >> mName);
+    OD_ASSERT_TRUE(is >> mHandle);
     OD_ASSERT_TRUE(is >> mMeshName);
     OD_ASSERT_TRUE(is >> mPosition);
 
@@ -162,6 +162,9 @@ class GameEntity
 
     virtual ~GameEntity() {}
 
+    //! \brief Handle of the entities not added to a GameMap
+    static const uint32_t NO_HANDLE;
+
     std::string getOgreNamePrefix() const;
 
     //! \brief Get the name of the object
@@ -172,6 +175,17 @@ class GameEntity
     inline const std::string& getMeshName() const
     { return mMeshName; }
 
+    //! \brief Get the handle identifying the entity in network messages. It is given
+    //! by the server GameMap when the entity is added and sent to the clients with the entity
+    inline uint32_t getHandle() const
+    { return mHandle; }
+
+    inline void setHandle(uint32_t handle)
+    { mHandle = handle; }
+
+    //! \brief Exports what identifies this entity in the messages sent to the clients: its handle
+    void exportIdToPacket(ODPacket& os) const;
+
     //! \brief Get the seat that the object belongs to
     inline Seat* getSeat() const
     { return mSeat; }
@@ -426,6 +440,8 @@ class GameEntity
     //! brief The name of the entity
     std::string mName;
 
+    uint32_t mHandle;
+
     //! \brief The name of the mesh
     std::string mMeshName;
 
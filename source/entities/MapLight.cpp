@@ -174,12 +174,9 @@ void MapLight::fireAddEntity(Seat* seat, bool async)
 
 void MapLight::fireRemoveEntity(Seat* seat)
 {
-    const std::string& name = getName();
     ServerNotification *serverNotification = new ServerNotification(
         ServerNotificationType::removeEntity, seat->getPlayer());
-    GameEntityType type = getObjectType();
-    serverNotification->mPacket << type;
-    serverNotification->mPacket << name;
+    exportIdToPacket(serverNotification->mPacket);
     ODServer::getSingleton().queueServerNotification(serverNotification);
 }
 
@@ -312,6 +309,7 @@ void MapLight::exportToPacket(ODPacket& os, const Seat* seat) const
 {
     const std::string& name = getName();
     os << name;
+    os << mHandle;
     os << mPosition.x << mPosition.y << mPosition.z;
     os << mDiffuseColor.r << mDiffuseColor.g << mDiffuseColor.b;
     os << mSpecularColor.r << mSpecularColor.g << mSpecularColor.b;
@@ -324,6 +322,7 @@ void MapLight::importFromPacket(ODPacket& is)
     std::string name;
     OD_ASSERT_TRUE(is >> name);
     setName(name);
+    OD_ASSERT_TRUE(is >> mHandle);
     OD_ASSERT_TRUE(is >> mPosition.x >> mPosition.y >> mPosition.z);
     OD_ASSERT_TRUE(is >> mDiffuseColor.r >> mDiffuseColor.g >> mDiffuseColor.b);
     OD_ASSERT_TRUE(is >> mSpecularColor.r >> mSpecularColor.g >> mSpecularColor.b);
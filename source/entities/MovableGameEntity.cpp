@@ -48,7 +48,7 @@ bool MovableGameEntity::isMoving()
     return !mWalkQueue.empty();
 }
 
-void MovableGameEntity::tileToVector3(const std::list<Tile*>& tiles, std::vector<Ogre::Vector3>& path,
+void MovableGameEntity::tileToVector3(const std::vector<Tile*>& tiles, std::vector<Ogre::Vector3>& path,
     bool skipFirst, Ogre::Real z)
 {
     for(Tile* tile : tiles)
@@ -98,11 +98,11 @@ void MovableGameEntity::setWalkPath(const std::string& walkAnim, const std::stri
         if(!seat->getPlayer()->getIsHuman())
             continue;
 
-        const std::string& name = getName();
         uint32_t nbDest = mWalkQueue.size();
         ServerNotification *serverNotification = new ServerNotification(
             ServerNotificationType::animatedObjectSetWalkPath, seat->getPlayer());
-        serverNotification->mPacket << name << walkAnim << endAnim << loopEndAnim << playIdleWhenAnimationEnds << nbDest;
+        exportIdToPacket(serverNotification->mPacket);
+        serverNotification->mPacket << walkAnim << endAnim << loopEndAnim << playIdleWhenAnimationEnds << nbDest;
         for(const Ogre::Vector3& v : mWalkQueue)
             serverNotification->mPacket << v;
 
@@ -122,12 +122,12 @@ void MovableGameEntity::clearDestinations(const std::string& animation, bool loo
         if(!seat->getPlayer()->getIsHuman())
             continue;
 
-        const std::string& name = getName();
         const std::string emptyString;
         uint32_t nbDest = 0;
         ServerNotification *serverNotification = new ServerNotification(
             ServerNotificationType::animatedObjectSetWalkPath, seat->getPlayer());
-        serverNotification->mPacket << name << emptyString << animation
+        exportIdToPacket(serverNotification->mPacket);
+        serverNotification->mPacket << emptyString << animation
             << loopAnim << playIdleWhenAnimationEnds << nbDest;
         ODServer::getSingleton().queueServerNotification(serverNotification);
     }
@@ -309,8 +309,8 @@ void MovableGameEntity::fireObjectAnimationState(const std::string& state, bool
 
         ServerNotification* serverNotification = new ServerNotification(
             ServerNotificationType::setObjectAnimationState, seat->getPlayer());
-        const std::string& name = getName();
-        serverNotification->mPacket << name << state << loop << playIdleWhenAnimationEnds;
+        exportIdToPacket(serverNotification->mPacket);
+        serverNotification->mPacket << state << loop << playIdleWhenAnimationEnds;
         if(direction != Ogre::Vector3::ZERO)
             serverNotification->mPacket << true << direction;
         else if(mWalkDirection != Ogre::Vector3::ZERO)
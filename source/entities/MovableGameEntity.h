@@ -62,7 +62,7 @@ public:
      *
      * If skipFirst is true, the first tile in the list will be skipped
      */
-    static void tileToVector3(const std::list<Tile*>& tiles, std::vector<Ogre::Vector3>& path, bool skipFirst, Ogre::Real z);
+    static void tileToVector3(const std::vector<Tile*>& tiles, std::vector<Ogre::Vector3>& path, bool skipFirst, Ogre::Real z);
 
     //! \brief Clears all future destinations from the walk queue, stops the object where it is, and sets its animation state.
     //! This is a server side function
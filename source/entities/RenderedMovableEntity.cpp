@@ -129,8 +129,8 @@ void RenderedMovableEntity::setMeshOpacity(float opacity)
 
             ServerNotification* serverNotification = new ServerNotification(
                 ServerNotificationType::setEntityOpacity, seat->getPlayer());
-            const std::string& name = getName();
-            serverNotification->mPacket << name << opacity;
+            exportIdToPacket(serverNotification->mPacket);
+            serverNotification->mPacket << opacity;
             ODServer::getSingleton().queueServerNotification(serverNotification);
         }
         return;
@@ -174,10 +174,7 @@ void RenderedMovableEntity::fireRemoveEntity(Seat* seat)
 {
     ServerNotification *serverNotification = new ServerNotification(
         ServerNotificationType::removeEntity, seat->getPlayer());
-    const std::string& name = getName();
-    GameEntityType type = getObjectType();
-    serverNotification->mPacket << type;
-    serverNotification->mPacket << name;
+    exportIdToPacket(serverNotification->mPacket);
     ODServer::getSingleton().queueServerNotification(serverNotification);
 }
 
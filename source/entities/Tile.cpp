@@ -24,6 +24,7 @@
 #include "entities/TreasuryObject.h"
 #include "game/Player.h"
 #include "game/Seat.h"
+#include "gamemap/CompiledLevel.h"
 #include "gamemap/GameMap.h"
 #include "network/ODPacket.h"
 #include "render/RenderManager.h"
@@ -651,15 +652,15 @@ void Tile::copyFloodFillToOtherSeats(Seat* seatToCopy)
         return;
     }
 
-    std::vector<uint32_t>& valuesToCopy = mFloodFillColor[seatToCopy->getTeamIndex()];
     for(uint32_t indexFloodFill = 0; indexFloodFill < mFloodFillColor.size(); ++indexFloodFill)
     {
         if(seatToCopy->getTeamIndex() == indexFloodFill)
             continue;
 
+        // Other teams do not share the merged colors so we copy the representatives
         std::vector<uint32_t>& values = mFloodFillColor[indexFloodFill];
         for(uint32_t intType = 0; intType < static_cast<uint32_t>(FloodFillType::nbValues); ++intType)
-            values[intType] = valuesToCopy[intType];
+            values[intType] = getFloodFillValue(seatToCopy, static_cast<FloodFillType>(intType));
 
     }
 }
@@ -737,6 +738,22 @@ void Tile::notifyVision(Seat* seat)
         notifyVision(alliedSeat);
 }
 
+void Tile::gainVision(Seat* seat)
+{
+    seat->notifyVisionOnTile(this);
+    mSeatsWithVision.push_back(seat);
+}
+
+void Tile::loseVision(Seat* seat)
+{
+    auto it = std::find(mSeatsWithVision.begin(), mSeatsWithVision.end(), seat);
+    if(it == mSeatsWithVision.end())
+        return;
+
+    seat->notifyVisionLostOnTile(this);
+    mSeatsWithVision.erase(it);
+}
+
 void Tile::setSeats(const std::vector<Seat*>& seats)
 {
     mTileChangedForSeats.clear();
@@ -871,7 +888,12 @@ uint32_t Tile::getFloodFillValue(Seat* seat, FloodFillType type) const
         return NO_FLOODFILL;
     }
 
-    return values.at(intType);
+    uint32_t value = values[intType];
+    if(value == NO_FLOODFILL)
+        return NO_FLOODFILL;
+
+    // Connected areas may have different colors. We return the color representing the area
+    return getGameMap()->getFloodFillRepresentative(seat->getTeamIndex(), value);
 }
 
 void Tile::setTeamsNumber(uint32_t nbTeams)
@@ -918,6 +940,8 @@ void Tile::setFullness(double f)
             // Do a flood fill to update the contiguous region touching the tile.
             for(Seat* seat : getGameMap()->getSeats())
                 getGameMap()->refreshFloodFill(seat, this);
+
+            getGameMap()->tilePassabilityChanged(this);
         }
     }
 }
@@ -971,7 +995,13 @@ void Tile::setCoveringBuilding(Building *building)
             seatChanged.second = true;
         }
     }
+    if(mCoveringBuilding != nullptr)
+        getGameMap()->removeBuildingTileFromGrid(this);
+
     mCoveringBuilding = building;
+    if(mCoveringBuilding != nullptr)
+        getGameMap()->addBuildingTileToGrid(this);
+
     mIsRoom = false;
     if(getCoveringRoom() != nullptr)
     {
@@ -999,7 +1029,11 @@ void Tile::setCoveringBuilding(Building *building)
         // Set the tile as claimed and of the team color of the building
         setSeat(mCoveringBuilding->getSeat());
         mClaimedPercentage = 1.0;
+        getGameMap()->tileClaimChanged(this);
     }
+
+    // Some buildings (like doors) can block vision
+    getGameMap()->tileVisionChanged(this);
 }
 
 bool Tile::isGroundClaimable(Seat* seat) const
@@ -1092,49 +1126,41 @@ void Tile::updateFromPacket(ODPacket& is)
 
 void Tile::loadFromLine(const std::string& line, Tile *t)
 {
-    std::vector<std::string> elems = Helper::split(line, '\t');
+    CompiledLevel::TileRecord record;
+    if(!CompiledLevel::readTileLine(line, record))
+    {
+        OD_LOG_ERR("Invalid tile line=" + line);
+        return;
+    }
 
-    int xLocation = Helper::toInt(elems[0]);
-    int yLocation = Helper::toInt(elems[1]);
+    loadFromValues(t, record.mX, record.mY, static_cast<TileType>(record.mType), record.mFullness, record.mSeatId);
+}
 
+void Tile::loadFromValues(Tile* t, int x, int y, TileType type, double fullness, int seatId)
+{
     std::stringstream tileName("");
     tileName << TILE_PREFIX;
-    tileName << xLocation;
+    tileName << x;
     tileName << "_";
-    tileName << yLocation;
+    tileName << y;
 
     t->setName(tileName.str());
-    t->mX = xLocation;
-    t->mY = yLocation;
+    t->mX = x;
+    t->mY = y;
     t->mPosition = Ogre::Vector3(static_cast<Ogre::Real>(t->mX), static_cast<Ogre::Real>(t->mY), 0.0f);
 
-    TileType tileType = static_cast<TileType>(Helper::toInt(elems[2]));
-    t->setType(tileType);
-
-    // If the tile type is lava or water, we ignore fullness
-    double fullness;
-    switch(tileType)
-    {
-        case TileType::water:
-        case TileType::lava:
-            fullness = 0.0;
-            break;
-
-        default:
-            fullness = Helper::toDouble(elems[3]);
-            break;
-    }
+    t->setType(type);
     t->setFullnessValue(fullness);
 
     bool shouldSetSeat = false;
     // We allow to set seat if the tile is dirt (full or not) or if it is gold (ground only)
-    if(elems.size() >= 5)
+    if(seatId != -1)
     {
-        if(tileType == TileType::dirt)
+        if(type == TileType::dirt)
         {
             shouldSetSeat = true;
         }
-        else if((tileType == TileType::gold) &&
+        else if((type == TileType::gold) &&
             (fullness == 0.0))
         {
             shouldSetSeat = true;
@@ -1147,12 +1173,12 @@ void Tile::loadFromLine(const std::string& line, Tile *t)
         return;
     }
 
-    int seatId = Helper::toInt(elems[4]);
     Seat* seat = t->getGameMap()->getSeatById(seatId);
     if(seat == nullptr)
         return;
     t->setSeat(seat);
     t->mClaimedPercentage = 1.0;
+    t->getGameMap()->tileClaimChanged(t);
 }
 
 void Tile::refreshMesh()
@@ -1195,6 +1221,9 @@ bool Tile::addEntity(GameEntity *entity)
     }
 
     mEntitiesInTile.push_back(entity);
+    if(entity->getObjectType() == GameEntityType::creature)
+        getGameMap()->addCreatureToGrid(static_cast<Creature*>(entity), this);
+
     if(!getGameMap()->isServerGameMap())
     {
         // On client side, we cull any movable entity that walks over a
@@ -1217,6 +1246,9 @@ void Tile::removeEntity(GameEntity *entity)
     }
 
     mEntitiesInTile.erase(it);
+    if(entity->getObjectType() == GameEntityType::creature)
+        getGameMap()->removeCreatureFromGrid(static_cast<Creature*>(entity), this);
+
     fireTileStateChanged();
 }
 
@@ -1257,6 +1289,9 @@ void Tile::claimForSeat(Seat* seat, double nDanceRate)
         }
     }
 
+    // A claimed tile stops being claimed as soon as an enemy starts claiming it
+    getGameMap()->tileClaimChanged(this);
+
     if ((getSeat() != nullptr) && (mClaimedPercentage >= 1.0) &&
         (getSeat()->isAlliedSeat(seat)))
     {
@@ -1273,6 +1308,7 @@ void Tile::claimTile(Seat* seat)
     // We need this because if we are a client, the tile may be from a non allied seat
     setSeat(seat);
     mClaimedPercentage = 1.0;
+    getGameMap()->tileClaimChanged(this);
 
     if(isFullTile())
         fireTileSound(TileSound::ClaimWall);
@@ -1308,6 +1344,7 @@ void Tile::unclaimTile()
 
     setSeat(nullptr);
     mClaimedPercentage = 0.0;
+    getGameMap()->tileClaimChanged(this);
 
     computeTileVisual();
     setDirtyForAllSeats();
@@ -1706,28 +1743,6 @@ bool Tile::checkCoveringTrapType(TrapType type) const
     return (coveringTrap->getType() == type);
 }
 
-void Tile::computeVisibleTiles()
-{
-    if(!getGameMap()->getIsFOWActivated())
-    {
-        // If the FOW is deactivated, we allow vision for every seat
-        for(Seat* seat : getGameMap()->getSeats())
-            notifyVision(seat);
-
-        return;
-    }
-
-    if(!isClaimed())
-        return;
-
-    // A claimed tile can see it self and its neighboors
-    notifyVision(getSeat());
-    for(Tile* tile : mNeighbors)
-    {
-        tile->notifyVision(getSeat());
-    }
-}
-
 void Tile::setDirtyForAllSeats()
 {
     if(!getIsOnServerMap())
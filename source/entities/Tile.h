@@ -330,6 +330,9 @@ public:
     //! \brief Loads the tile data from a level line.
     static void loadFromLine(const std::string& line, Tile *t);
 
+    //! \brief Loads the tile data from the values of a level line (see CompiledLevel::readTileLine)
+    static void loadFromValues(Tile* t, int x, int y, TileType type, double fullness, int seatId);
+
     /*! \brief This is a helper function which just converts the tile type enum into a string.
      *
      * This function is used primarily in forming the mesh names to load from disk
@@ -366,10 +369,12 @@ public:
     //! Fills the given vector with corresponding entities on this tile.
     void fillWithEntities(std::vector<GameEntity*>& entities, SelectionEntityWanted entityWanted, Player* player);
 
-    //! \brief Computes the visible tiles and tags them to know which are visible
-    void computeVisibleTiles();
     void clearVision();
+    //! \brief Gives vision on this tile to the given seat and its allies
     void notifyVision(Seat* seat);
+    //! \brief Called by the VisionManager when the given seat gains/loses vision on this tile
+    void gainVision(Seat* seat);
+    void loseVision(Seat* seat);
 
     void setSeats(const std::vector<Seat*>& seats);
     bool hasChangedForSeat(Seat* seat) const;
@@ -57,7 +57,7 @@ public:
     static bool update(Weapon* weapon, std::stringstream& defFile);
     //! \brief Writes the differences between def1 and def2 in the given file. Note that def1 can be null. In
     //! this case, every parameters in def2 will be written. def2 cannot be null.
-    static void writeWeaponDiff(const Weapon* def1, const Weapon* def2, std::ofstream& file);
+    static void writeWeaponDiff(const Weapon* def1, const Weapon* def2, std::ostream& file);
 
     inline const std::string getOgreNamePrefix() const
     { return "Weapon_"; }
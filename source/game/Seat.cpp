@@ -43,6 +43,7 @@
 #include "utils/LogManager.h"
 #include "utils/Random.h"
 
+#include <algorithm>
 #include <istream>
 #include <ostream>
 
@@ -225,24 +226,30 @@ void Seat::addAlliedSeat(Seat* seat)
     mAlliedSeats.push_back(seat);
 }
 
-void Seat::clearTilesWithVision()
+void Seat::restoreTilesVisionForced()
 {
-    if(mPlayer == nullptr)
-        return;
-    if(!mPlayer->getIsHuman())
-        return;
-
-    for(std::vector<TileStateNotified>& vec : mTilesStates)
+    for(Tile* tile : mTilesVisionForced)
     {
-        for(TileStateNotified& p : vec)
-        {
-            p.mVisionTurnLast = p.mVisionTurnCurrent;
-            p.mVisionTurnCurrent = false;
-        }
+        TileStateNotified& tileState = mTilesStates[tile->getX()][tile->getY()];
+        const std::vector<Seat*>& seatsWithVision = tile->getSeatsWithVision();
+        tileState.mVisionTurnLast = tileState.mVisionTurnCurrent;
+        tileState.mVisionTurnCurrent = (std::find(seatsWithVision.begin(), seatsWithVision.end(), this) != seatsWithVision.end());
+        mTilesVisionChanged.push_back(tile);
     }
+    mTilesVisionForced.clear();
 }
 
 void Seat::notifyVisionOnTile(Tile* tile)
+{
+    setVisionOnTile(tile, true);
+}
+
+void Seat::notifyVisionLostOnTile(Tile* tile)
+{
+    setVisionOnTile(tile, false);
+}
+
+void Seat::setVisionOnTile(Tile* tile, bool hasVision)
 {
     if(mPlayer == nullptr)
         return;
@@ -261,7 +268,11 @@ void Seat::notifyVisionOnTile(Tile* tile)
     }
 
     TileStateNotified& tileState = mTilesStates[tile->getX()][tile->getY()];
-    tileState.mVisionTurnCurrent = true;
+    if(tileState.mVisionTurnCurrent == hasVision)
+        return;
+
+    tileState.mVisionTurnCurrent = hasVision;
+    mTilesVisionChanged.push_back(tile);
 }
 
 void Seat::notifyTileClaimedByEnemy(Tile* tile)
@@ -288,6 +299,8 @@ void Seat::notifyTileClaimedByEnemy(Tile* tile)
     tileState.mSeatIdOwner = -1;
     tileState.mTileVisual = TileVisual::dirtGround;
     tileState.mVisionTurnCurrent = true;
+    mTilesVisionChanged.push_back(tile);
+    mTilesVisionForced.push_back(tile);
 }
 
 const std::string Seat::getFactionFromLine(const std::string& line)
@@ -481,6 +494,8 @@ void Seat::setMapSize(int x, int y)
         return;
 
     mTilesStates = std::vector<std::vector<TileStateNotified>>(x, std::vector<TileStateNotified>(y));
+    mTilesVisionChanged.clear();
+    mTilesVisionForced.clear();
     // By default, we know that rock (ground & full) will be set as rock full tiles,
     // gold (ground & full) will be set as gold full tiles,
     // other tiles will be set as dirt full tiles
@@ -760,29 +775,26 @@ void Seat::sendVisibleTiles()
         ServerNotificationType::refreshVisibleTiles, getPlayer());
     std::vector<Tile*> tilesVisionGained;
     std::vector<Tile*> tilesVisionLost;
-    // Tiles we gained vision
-    int xMax = static_cast<int>(mTilesStates.size());
-    for(int xxx = 0; xxx < xMax; ++xxx)
+    // We only check the tiles where vision changed since last time
+    for(Tile* tile : mTilesVisionChanged)
     {
-        int yMax = static_cast<int>(mTilesStates[xxx].size());
-        for(int yyy = 0; yyy < yMax; ++yyy)
-        {
-            if(mTilesStates[xxx][yyy].mVisionTurnCurrent == mTilesStates[xxx][yyy].mVisionTurnLast)
-                continue;
+        TileStateNotified& tileState = mTilesStates[tile->getX()][tile->getY()];
+        if(tileState.mVisionTurnCurrent == tileState.mVisionTurnLast)
+            continue;
 
-            Tile* tile = mGameMap->getTile(xxx, yyy);
-            if(mTilesStates[xxx][yyy].mVisionTurnCurrent)
-            {
-                // Vision gained
-                tilesVisionGained.push_back(tile);
-            }
-            else
-            {
-                // Vision lost
-                tilesVisionLost.push_back(tile);
-            }
+        tileState.mVisionTurnLast = tileState.mVisionTurnCurrent;
+        if(tileState.mVisionTurnCurrent)
+        {
+            // Vision gained
+            tilesVisionGained.push_back(tile);
+        }
+        else
+        {
+            // Vision lost
+            tilesVisionLost.push_back(tile);
         }
     }
+    mTilesVisionChanged.clear();
 
     // Notify tiles we gained vision
     nbTiles = tilesVisionGained.size();
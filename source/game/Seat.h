@@ -200,10 +200,15 @@ public:
     bool canOwnedCreatureUseRoomFrom(const Seat* seat) const;
     bool canBuildingBeDestroyedBy(const Seat* seat) const;
 
-    void clearTilesWithVision();
+    //! \brief Called when this seat gains/loses vision on the given tile
     void notifyVisionOnTile(Tile* tile);
+    void notifyVisionLostOnTile(Tile* tile);
     void notifyTileClaimedByEnemy(Tile* tile);
 
+    //! \brief The tiles claimed by an enemy are seen during one turn. This restores their real
+    //! vision. Should be called before updating vision
+    void restoreTilesVisionForced();
+
     //! \brief Returns true if this seat can see the given tile and false otherwise
     bool hasVisionOnTile(Tile* tile);
 
@@ -363,8 +368,18 @@ private:
 
     std::map<std::pair<int, int>, TileStateNotified> mTilesStateLoaded;
 
+    //! \brief Tiles where the vision may have changed since the last call to sendVisibleTiles. A tile
+    //! may appear more than once
+    std::vector<Tile*> mTilesVisionChanged;
+
+    //! \brief Tiles claimed by an enemy since the last call to restoreTilesVisionForced
+    std::vector<Tile*> mTilesVisionForced;
+
     std::vector<Tile*> mVisualDebugEntityTiles;
 
+    //! \brief Sets the vision state notified to the player for the given tile
+    void setVisionOnTile(Tile* tile, bool hasVision);
+
     //! \brief Index of the team in the gamemap (from 0 to N). Must be set when the seat is added to the gamemap
     //! and never changed after
     uint32_t mTeamIndex;
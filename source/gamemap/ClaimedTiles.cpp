@@ -0,0 +1,60 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/ClaimedTiles.h"
+
+const uint32_t ClaimedTiles::NO_SEAT = 0xFFFFFFFF;
+
+ClaimedTiles::ClaimedTiles() :
+    mMapSizeX(0),
+    mMapSizeY(0)
+{
+}
+
+void ClaimedTiles::clear()
+{
+    mMapSizeX = 0;
+    mMapSizeY = 0;
+    mSeatIndexes.clear();
+    mIsQueued.clear();
+    mQueuedTiles.clear();
+}
+
+void ClaimedTiles::reset(int mapSizeX, int mapSizeY)
+{
+    mMapSizeX = mapSizeX;
+    mMapSizeY = mapSizeY;
+    uint32_t nbTiles = static_cast<uint32_t>(mMapSizeX * mMapSizeY);
+    mSeatIndexes.assign(nbTiles, NO_SEAT);
+    mIsQueued.assign(nbTiles, true);
+    mQueuedTiles.resize(nbTiles);
+    for(uint32_t index = 0; index < nbTiles; ++index)
+        mQueuedTiles[index] = index;
+}
+
+void ClaimedTiles::tileChanged(int x, int y)
+{
+    if((x < 0) || (y < 0) || (x >= mMapSizeX) || (y >= mMapSizeY))
+        return;
+
+    uint32_t index = static_cast<uint32_t>(x * mMapSizeY + y);
+    if(mIsQueued[index])
+        return;
+
+    mIsQueued[index] = true;
+    mQueuedTiles.push_back(index);
+}
@@ -0,0 +1,92 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CLAIMEDTILES_H
+#define CLAIMEDTILES_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/*! \brief Keeps the seat each tile gives vision to because it is claimed.
+ *
+ * Instead of checking every tile each turn, the tiles that may have been claimed or lost are queued
+ * (see tileChanged) and only them are checked by process. Each tile is queued at most once. After reset,
+ * every tile is queued so that the first process finds the tiles claimed when the level was loaded.
+ */
+class ClaimedTiles
+{
+public:
+    //! \brief Seat index of tiles that are not claimed
+    static const uint32_t NO_SEAT;
+
+    ClaimedTiles();
+
+    //! \brief Forgets the claimed tiles and the queued ones
+    void clear();
+
+    //! \brief Considers every tile of a map with the given size as not claimed and queues them all
+    void reset(int mapSizeX, int mapSizeY);
+
+    //! \brief Should be called when the given tile may have been claimed or lost. Ignored before reset
+    void tileChanged(int x, int y);
+
+    //! \brief Returns the number of tiles that will be checked by the next process
+    uint32_t getNbQueuedTiles() const
+    { return static_cast<uint32_t>(mQueuedTiles.size()); }
+
+    //! \brief Returns the seat index the given tile gives vision to since the last process
+    uint32_t getSeatIndex(int x, int y) const
+    { return mSeatIndexes[x * mMapSizeY + y]; }
+
+    /*! \brief Checks the queued tiles (in the same order as a scan of the map). seatIndex(x, y) should return
+     * the seat index the tile gives vision to now (NO_SEAT if it is not claimed). For the tiles where it
+     * changed, claimChanged(x, y, oldSeatIndex, newSeatIndex) is called
+     */
+    template<typename SeatIndexFunc, typename ClaimChangedFunc>
+    void process(SeatIndexFunc seatIndex, ClaimChangedFunc claimChanged)
+    {
+        std::sort(mQueuedTiles.begin(), mQueuedTiles.end());
+        for(uint32_t index : mQueuedTiles)
+        {
+            mIsQueued[index] = false;
+            int x = static_cast<int>(index) / mMapSizeY;
+            int y = static_cast<int>(index) % mMapSizeY;
+            uint32_t newSeatIndex = seatIndex(x, y);
+            uint32_t oldSeatIndex = mSeatIndexes[index];
+            if(newSeatIndex == oldSeatIndex)
+                continue;
+
+            mSeatIndexes[index] = newSeatIndex;
+            claimChanged(x, y, oldSeatIndex, newSeatIndex);
+        }
+        mQueuedTiles.clear();
+    }
+
+private:
+    int mMapSizeX;
+    int mMapSizeY;
+
+    //! \brief Seat index each tile gives vision to (x * mapSizeY + y)
+    std::vector<uint32_t> mSeatIndexes;
+
+    //! \brief true if the tile is in mQueuedTiles (x * mapSizeY + y)
+    std::vector<bool> mIsQueued;
+    std::vector<uint32_t> mQueuedTiles;
+};
+
+#endif // CLAIMEDTILES_H
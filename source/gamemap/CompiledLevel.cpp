@@ -0,0 +1,378 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/CompiledLevel.h"
+
+#include "entities/Tile.h"
+#include "utils/Helper.h"
+#include "utils/LogManager.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+const uint32_t CompiledLevel::FORMAT_VERSION = 1;
+
+//! \brief "ODLC" read as a native integer. A file compiled on a computer with another endianness will not match
+static const uint32_t COMPILED_LEVEL_MAGIC = 0x434C444F;
+static const std::string COMPILED_LEVEL_EXTENSION = ".clevel";
+
+//! \brief The compiled file is this header followed by the level text (padded to 8 bytes) and the tile records
+struct CompiledLevelHeader
+{
+    uint32_t mMagic;
+    uint32_t mFormatVersion;
+    uint64_t mSourceHash;
+    uint64_t mSourceSize;
+    uint32_t mTextSize;
+    uint32_t mNbTiles;
+};
+
+static_assert(sizeof(CompiledLevelHeader) % 8 == 0, "The tile records should be aligned");
+static_assert(sizeof(CompiledLevel::TileRecord) == 24, "The tile records should not be padded");
+
+//! \brief Whitespaces skipped by operator>> when the level is read
+static const char* LEVEL_WHITESPACES = " \t\r\v\f";
+
+static uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+static uint32_t countValues(const std::string& text)
+{
+    std::stringstream ss(text);
+    std::string value;
+    uint32_t nbValues = 0;
+    while(ss >> value)
+        ++nbValues;
+
+    return nbValues;
+}
+
+static uint64_t hashContent(const char* data, uint64_t size)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for(uint64_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+CompiledLevel::CompiledLevel() :
+    mText(nullptr),
+    mTextSize(0),
+    mTiles(nullptr),
+    mNbTiles(0)
+{
+}
+
+CompiledLevel::~CompiledLevel()
+{
+}
+
+bool CompiledLevel::load(const std::string& fileName, const std::string& cachePath)
+{
+    // We map the level file to compute its hash. The mapping is released before mapping the cached file
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    std::string levelPrefix;
+    std::string cacheFileName;
+    try
+    {
+        boost::interprocess::file_mapping sourceMapping(fileName.c_str(), boost::interprocess::read_only);
+        boost::interprocess::mapped_region sourceRegion(sourceMapping, boost::interprocess::read_only);
+        const char* source = static_cast<const char*>(sourceRegion.get_address());
+        sourceSize = sourceRegion.get_size();
+        sourceHash = hashContent(source, sourceSize);
+
+        if(!cachePath.empty())
+        {
+            std::stringstream ss;
+            ss << std::hex << std::setw(16) << std::setfill('0') << hashContent(fileName.data(), fileName.size());
+            ss << "-";
+            levelPrefix = ss.str();
+            ss << std::setw(16) << sourceHash << COMPILED_LEVEL_EXTENSION;
+            cacheFileName = cachePath + ss.str();
+            if(loadCachedFile(cacheFileName, sourceHash, sourceSize))
+                return true;
+        }
+
+        compile(source, sourceSize, sourceHash);
+    }
+    catch(const boost::interprocess::interprocess_exception& e)
+    {
+        OD_LOG_WRN("Could not read file=" + fileName + ", error=" + e.what());
+        return false;
+    }
+
+    if(!setData(mBuffer.data(), mBuffer.size(), sourceHash, sourceSize))
+    {
+        OD_LOG_ERR("Invalid compiled level for file=" + fileName);
+        return false;
+    }
+
+    if(cacheFileName.empty())
+        return true;
+
+    // We write a temporary file and rename it so that a process loading the same level never reads
+    // a partially written file
+    boost::system::error_code ec;
+    boost::filesystem::path tmpPath = boost::filesystem::unique_path(cachePath + "%%%%-%%%%-%%%%-%%%%.tmp", ec);
+    if(ec)
+        return true;
+
+    std::ofstream cacheFile(tmpPath.string().c_str(), std::ios::out | std::ios::binary);
+    cacheFile.write(mBuffer.data(), static_cast<std::streamsize>(mBuffer.size()));
+    cacheFile.close();
+    if(cacheFile.good())
+        boost::filesystem::rename(tmpPath, cacheFileName, ec);
+
+    if(!cacheFile.good() || ec)
+    {
+        OD_LOG_WRN("Could not save compiled level=" + cacheFileName);
+        boost::filesystem::remove(tmpPath, ec);
+        return true;
+    }
+
+    removeOutdatedFiles(cachePath, levelPrefix, cacheFileName);
+    return true;
+}
+
+bool CompiledLevel::readTileLine(const std::string& line, TileRecord& record)
+{
+    std::vector<std::string> elems = Helper::split(line, '\t');
+    if(elems.size() < 3)
+        return false;
+
+    record.mX = Helper::toInt(elems[0]);
+    record.mY = Helper::toInt(elems[1]);
+    record.mType = Helper::toInt(elems[2]);
+
+    // If the tile type is lava or water, we ignore fullness
+    switch(static_cast<TileType>(record.mType))
+    {
+        case TileType::water:
+        case TileType::lava:
+            record.mFullness = 0.0;
+            break;
+
+        default:
+            if(elems.size() < 4)
+                return false;
+            record.mFullness = Helper::toDouble(elems[3]);
+            break;
+    }
+
+    record.mSeatId = (elems.size() >= 5) ? Helper::toInt(elems[4]) : -1;
+    return true;
+}
+
+void CompiledLevel::removeOutdatedFiles(const std::string& cachePath, const std::string& levelPrefix,
+    const std::string& keptFileName)
+{
+    boost::system::error_code ec;
+    boost::filesystem::directory_iterator it(cachePath, ec);
+    if(ec)
+        return;
+
+    boost::filesystem::path keptPath(keptFileName);
+    std::vector<boost::filesystem::path> outdatedFiles;
+    for(; it != boost::filesystem::directory_iterator(); it.increment(ec))
+    {
+        if(ec)
+            break;
+
+        const boost::filesystem::path& path = it->path();
+        if(path.filename() == keptPath.filename())
+            continue;
+
+        if(path.extension().string() != COMPILED_LEVEL_EXTENSION)
+            continue;
+
+        if(path.filename().string().compare(0, levelPrefix.size(), levelPrefix) != 0)
+            continue;
+
+        outdatedFiles.push_back(path);
+    }
+
+    // A file still mapped by another process may not be removable. It will be removed next time
+    for(const boost::filesystem::path& path : outdatedFiles)
+    {
+        if(boost::filesystem::remove(path, ec))
+            OD_LOG_INF("Removed outdated compiled level=" + path.string());
+    }
+}
+
+bool CompiledLevel::loadCachedFile(const std::string& cacheFileName, uint64_t sourceHash, uint64_t sourceSize)
+{
+    boost::system::error_code ec;
+    if(!boost::filesystem::exists(cacheFileName, ec))
+        return false;
+
+    try
+    {
+        boost::interprocess::file_mapping mapping(cacheFileName.c_str(), boost::interprocess::read_only);
+        boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+        if(!setData(static_cast<const char*>(region.get_address()), region.get_size(), sourceHash, sourceSize))
+        {
+            OD_LOG_INF("Outdated compiled level=" + cacheFileName);
+            return false;
+        }
+
+        // The region keeps the same address when swapped
+        mRegion.reset(new boost::interprocess::mapped_region);
+        mRegion->swap(region);
+        return true;
+    }
+    catch(const boost::interprocess::interprocess_exception& e)
+    {
+        OD_LOG_WRN("Could not read compiled level=" + cacheFileName + ", error=" + e.what());
+        return false;
+    }
+}
+
+void CompiledLevel::compile(const char* source, uint64_t sourceSize, uint64_t sourceHash)
+{
+    enum class Section
+    {
+        beforeTiles,
+        tilesSize,
+        tiles,
+        afterTiles
+    };
+
+    // The comments are stripped like Helper::readFileWithoutComments does. The tile lines are replaced by records.
+    // Note that the map size is kept in the text. If a tile line cannot be compiled, it is kept too (and the
+    // following ones) so that the level reader handles it like it would handle the level file
+    std::string text;
+    text.reserve(static_cast<size_t>(sourceSize));
+    std::vector<TileRecord> tiles;
+    Section section = Section::beforeTiles;
+    uint32_t nbSizeValues = 0;
+    uint64_t pos = 0;
+    while(pos < sourceSize)
+    {
+        const char* lineStart = source + pos;
+        size_t remaining = static_cast<size_t>(sourceSize - pos);
+        const char* lineEnd = static_cast<const char*>(std::memchr(lineStart, '\n', remaining));
+        size_t lineLength = (lineEnd != nullptr) ? static_cast<size_t>(lineEnd - lineStart) : remaining;
+        pos += lineLength + 1;
+
+        std::string line(lineStart, lineLength);
+        line = line.substr(0, line.find('#'));
+
+        size_t firstChar = line.find_first_not_of(LEVEL_WHITESPACES);
+        std::string content = (firstChar != std::string::npos) ? line.substr(firstChar) : std::string();
+        switch(section)
+        {
+            case Section::beforeTiles:
+            {
+                if(content.compare(0, 7, "[Tiles]") != 0)
+                    break;
+
+                // The map size may follow on the same line
+                nbSizeValues = countValues(content.substr(7));
+                section = (nbSizeValues >= 2) ? Section::tiles : Section::tilesSize;
+                break;
+            }
+            case Section::tilesSize:
+            {
+                nbSizeValues += countValues(content);
+                if(nbSizeValues >= 2)
+                    section = Section::tiles;
+                break;
+            }
+            case Section::tiles:
+            {
+                if(content.empty())
+                    continue;
+
+                if(content.compare(0, 8, "[/Tiles]") == 0)
+                {
+                    section = Section::afterTiles;
+                    break;
+                }
+
+                TileRecord record;
+                if(!readTileLine(content, record))
+                {
+                    section = Section::afterTiles;
+                    break;
+                }
+
+                tiles.push_back(record);
+                continue;
+            }
+            case Section::afterTiles:
+            default:
+                break;
+        }
+
+        text += line;
+        text += '\n';
+    }
+
+    CompiledLevelHeader header;
+    header.mMagic = COMPILED_LEVEL_MAGIC;
+    header.mFormatVersion = FORMAT_VERSION;
+    header.mSourceHash = sourceHash;
+    header.mSourceSize = sourceSize;
+    header.mTextSize = static_cast<uint32_t>(text.size());
+    header.mNbTiles = static_cast<uint32_t>(tiles.size());
+
+    uint64_t tilesOffset = alignOffset(sizeof(CompiledLevelHeader) + text.size());
+    mBuffer.assign(static_cast<size_t>(tilesOffset + tiles.size() * sizeof(TileRecord)), 0);
+    std::memcpy(mBuffer.data(), &header, sizeof(header));
+    std::memcpy(mBuffer.data() + sizeof(header), text.data(), text.size());
+    if(!tiles.empty())
+        std::memcpy(mBuffer.data() + tilesOffset, tiles.data(), tiles.size() * sizeof(TileRecord));
+}
+
+bool CompiledLevel::setData(const char* data, uint64_t size, uint64_t sourceHash, uint64_t sourceSize)
+{
+    if(size < sizeof(CompiledLevelHeader))
+        return false;
+
+    CompiledLevelHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if((header.mMagic != COMPILED_LEVEL_MAGIC) ||
+       (header.mFormatVersion != FORMAT_VERSION) ||
+       (header.mSourceHash != sourceHash) ||
+       (header.mSourceSize != sourceSize))
+    {
+        return false;
+    }
+
+    uint64_t tilesOffset = alignOffset(sizeof(CompiledLevelHeader) + header.mTextSize);
+    if(tilesOffset + static_cast<uint64_t>(header.mNbTiles) * sizeof(TileRecord) > size)
+        return false;
+
+    mText = data + sizeof(CompiledLevelHeader);
+    mTextSize = header.mTextSize;
+    mTiles = reinterpret_cast<const TileRecord*>(data + tilesOffset);
+    mNbTiles = header.mNbTiles;
+    return true;
+}
@@ -0,0 +1,115 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMPILEDLEVEL_H
+#define COMPILEDLEVEL_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace boost
+{
+namespace interprocess
+{
+class mapped_region;
+}
+}
+
+/*! \brief Binary version of a level file.
+ *
+ * Most of the time spent loading a level goes to parsing the tile lines. When a level is loaded for the first
+ * time, it is compiled: the tiles are stored as fixed size records and the other sections are kept as text
+ * (without the comments) since they are small. The compiled level is saved in the level cache folder under the
+ * hash of the level file name and the hash of its content, so it is used as long as the level file does not change.
+ * When a level is compiled again, the files compiled from its former contents are removed. The cached file is
+ * mapped in memory and the tile records are read in place.
+ */
+class CompiledLevel
+{
+public:
+    //! \brief Values of a tile line of the level (see readTileLine)
+    struct TileRecord
+    {
+        int32_t mX;
+        int32_t mY;
+        int32_t mType;
+        //! \brief -1 if the line does not give any seat
+        int32_t mSeatId;
+        double mFullness;
+    };
+
+    //! \brief Version of the compiled files. Should be increased each time their format (or the way the level
+    //! files are compiled) changes so that the cached files are compiled again
+    static const uint32_t FORMAT_VERSION;
+
+    CompiledLevel();
+    ~CompiledLevel();
+
+    /*! \brief Loads the compiled version of the given level file. If there is no compiled version in cachePath,
+     * the level is compiled and saved there (if cachePath is empty, the level is compiled without being cached).
+     * Returns false if the level file cannot be read
+     */
+    bool load(const std::string& fileName, const std::string& cachePath);
+
+    //! \brief Reads the values of a level tile line. mSeatId is set to -1 if the line does not give any seat.
+    //! Returns false if the line is not a valid tile line
+    static bool readTileLine(const std::string& line, TileRecord& record);
+
+    //! \brief The level without comments. The [Tiles] section only gives the map size: the tiles are given
+    //! by getTiles
+    const char* getText() const
+    { return mText; }
+
+    uint32_t getTextSize() const
+    { return mTextSize; }
+
+    const TileRecord* getTiles() const
+    { return mTiles; }
+
+    uint32_t getNbTiles() const
+    { return mNbTiles; }
+
+private:
+    //! \brief The cached file when it could be mapped
+    std::unique_ptr<boost::interprocess::mapped_region> mRegion;
+    //! \brief The compiled level when it has just been compiled
+    std::vector<char> mBuffer;
+
+    const char* mText;
+    uint32_t mTextSize;
+    const TileRecord* mTiles;
+    uint32_t mNbTiles;
+
+    //! \brief Maps the given cached file. Returns false if it is missing or if it was not compiled from a
+    //! level with the given hash and size
+    bool loadCachedFile(const std::string& cacheFileName, uint64_t sourceHash, uint64_t sourceSize);
+
+    //! \brief Removes the files in cachePath compiled from the level with the given name hash, except keptFileName.
+    //! They were compiled from former contents of the level and will not be used anymore
+    static void removeOutdatedFiles(const std::string& cachePath, const std::string& levelPrefix,
+        const std::string& keptFileName);
+
+    //! \brief Compiles the given level content into mBuffer
+    void compile(const char* source, uint64_t sourceSize, uint64_t sourceHash);
+
+    //! \brief Sets the pointers to the sections of the given compiled data. Returns false if it is not valid
+    bool setData(const char* data, uint64_t size, uint64_t sourceHash, uint64_t sourceSize);
+};
+
+#endif // COMPILEDLEVEL_H
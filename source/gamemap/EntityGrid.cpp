@@ -0,0 +1,275 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/EntityGrid.h"
+
+#include "entities/Building.h"
+#include "entities/Creature.h"
+#include "entities/Tile.h"
+#include "game/Seat.h"
+#include "gamemap/GameMap.h"
+#include "utils/LogManager.h"
+
+#include <algorithm>
+
+const int EntityGrid::CELL_SIZE = 8;
+
+EntityGrid::EntityGrid(GameMap& gameMap) :
+    mGameMap(gameMap),
+    mMapSizeX(0),
+    mMapSizeY(0),
+    mNbCellsX(0),
+    mNbCellsY(0)
+{
+}
+
+void EntityGrid::clear()
+{
+    mMapSizeX = 0;
+    mMapSizeY = 0;
+    mNbCellsX = 0;
+    mNbCellsY = 0;
+    mCells.clear();
+    mSearchedTiles.clear();
+    mBuildingsFound.clear();
+}
+
+void EntityGrid::addCreature(Creature* creature, Tile* tile)
+{
+    Cell* cell = getCell(tile);
+    if(cell == nullptr)
+        return;
+
+    CreatureEntry entry = { creature, tile };
+    getBucket(*cell, creature->getSeat()).mCreatures.push_back(entry);
+}
+
+void EntityGrid::removeCreature(Creature* creature, Tile* tile)
+{
+    Cell* cell = getCell(tile);
+    if(cell == nullptr)
+        return;
+
+    // The creature may have changed seat since it has been added. We look in every bucket
+    for(SeatBucket& bucket : cell->mBuckets)
+    {
+        for(CreatureEntry& entry : bucket.mCreatures)
+        {
+            if(entry.mCreature != creature)
+                continue;
+
+            entry = bucket.mCreatures.back();
+            bucket.mCreatures.pop_back();
+            return;
+        }
+    }
+}
+
+void EntityGrid::addBuildingTile(Tile* tile)
+{
+    Building* building = tile->getCoveringBuilding();
+    if(building == nullptr)
+    {
+        OD_LOG_ERR("tile=" + Tile::displayAsString(tile));
+        return;
+    }
+
+    Cell* cell = getCell(tile);
+    if(cell == nullptr)
+        return;
+
+    getBucket(*cell, building->getSeat()).mBuildingTiles.push_back(tile);
+}
+
+void EntityGrid::removeBuildingTile(Tile* tile)
+{
+    Cell* cell = getCell(tile);
+    if(cell == nullptr)
+        return;
+
+    for(SeatBucket& bucket : cell->mBuckets)
+    {
+        std::vector<Tile*>::iterator it = std::find(bucket.mBuildingTiles.begin(), bucket.mBuildingTiles.end(), tile);
+        if(it == bucket.mBuildingTiles.end())
+            continue;
+
+        *it = bucket.mBuildingTiles.back();
+        bucket.mBuildingTiles.pop_back();
+        return;
+    }
+}
+
+void EntityGrid::getEntities(const std::vector<Tile*>& tiles, Seat* seat, bool enemies, bool withBuildings,
+    std::vector<GameEntity*>& entities)
+{
+    entities.clear();
+    if(tiles.empty() || !checkMapSize())
+        return;
+
+    // We mark the searched tiles and compute the cells they overlap
+    mSearchedTiles.start(mMapSizeX, mMapSizeY);
+    int minX = mMapSizeX;
+    int minY = mMapSizeY;
+    int maxX = -1;
+    int maxY = -1;
+    for(uint32_t order = 0; order < tiles.size(); ++order)
+    {
+        Tile* tile = tiles[order];
+        if(tile == nullptr)
+        {
+            OD_LOG_ERR("unexpected null tile");
+            continue;
+        }
+
+        mSearchedTiles.add(tile->getX(), tile->getY(), order);
+        minX = std::min(minX, tile->getX());
+        minY = std::min(minY, tile->getY());
+        maxX = std::max(maxX, tile->getX());
+        maxY = std::max(maxY, tile->getY());
+    }
+
+    // We look for the searched tiles having entities of the wanted seats
+    for(int cellX = minX / CELL_SIZE; cellX <= maxX / CELL_SIZE; ++cellX)
+    {
+        for(int cellY = minY / CELL_SIZE; cellY <= maxY / CELL_SIZE; ++cellY)
+        {
+            for(SeatBucket& bucket : mCells[cellX * mNbCellsY + cellY].mBuckets)
+            {
+                if(bucket.mSeat == nullptr)
+                    continue;
+
+                if(seat->isAlliedSeat(bucket.mSeat) == enemies)
+                    continue;
+
+                for(const CreatureEntry& entry : bucket.mCreatures)
+                {
+                    Tile* tile = entry.mTile;
+                    if(mSearchedTiles.isSearched(tile->getX(), tile->getY()))
+                        mSearchedTiles.found(tile->getX(), tile->getY());
+                }
+
+                if(!withBuildings)
+                    continue;
+
+                for(Tile* tile : bucket.mBuildingTiles)
+                {
+                    if(mSearchedTiles.isSearched(tile->getX(), tile->getY()))
+                        mSearchedTiles.found(tile->getX(), tile->getY());
+                }
+            }
+        }
+    }
+
+    // The entities are read from the tiles found in the order of the searched tiles
+    mBuildingsFound.clear();
+    for(uint32_t order : mSearchedTiles.getFoundOrders())
+    {
+        Tile* tile = tiles[order];
+        for(GameEntity* entity : tile->getEntitiesInTile())
+        {
+            if(entity->getObjectType() != GameEntityType::creature)
+                continue;
+
+            if(entity->getSeat() == nullptr)
+                continue;
+
+            if(seat->isAlliedSeat(entity->getSeat()) == enemies)
+                continue;
+
+            Creature* creature = static_cast<Creature*>(entity);
+            if(!creature->isAlive())
+                continue;
+
+            if(enemies && !creature->isAttackable(tile, seat))
+                continue;
+
+            entities.push_back(creature);
+        }
+
+        if(!withBuildings)
+            continue;
+
+        Building* building = tile->getCoveringBuilding();
+        if(building == nullptr)
+            continue;
+
+        if(building->getSeat() == nullptr)
+            continue;
+
+        if(seat->isAlliedSeat(building->getSeat()) == enemies)
+            continue;
+
+        if(enemies && !building->isAttackable(tile, seat))
+            continue;
+
+        // There are few buildings around. We can afford a linear search
+        if(std::find(mBuildingsFound.begin(), mBuildingsFound.end(), building) != mBuildingsFound.end())
+            continue;
+
+        mBuildingsFound.push_back(building);
+        entities.push_back(building);
+    }
+}
+
+bool EntityGrid::checkMapSize()
+{
+    if((mMapSizeX == mGameMap.getMapSizeX()) &&
+       (mMapSizeY == mGameMap.getMapSizeY()))
+    {
+        return !mCells.empty();
+    }
+
+    clear();
+    mMapSizeX = mGameMap.getMapSizeX();
+    mMapSizeY = mGameMap.getMapSizeY();
+    if((mMapSizeX <= 0) || (mMapSizeY <= 0))
+        return false;
+
+    mNbCellsX = (mMapSizeX + CELL_SIZE - 1) / CELL_SIZE;
+    mNbCellsY = (mMapSizeY + CELL_SIZE - 1) / CELL_SIZE;
+    mCells.resize(mNbCellsX * mNbCellsY);
+    return true;
+}
+
+EntityGrid::Cell* EntityGrid::getCell(Tile* tile)
+{
+    if(!checkMapSize())
+        return nullptr;
+
+    if((tile->getX() < 0) || (tile->getX() >= mMapSizeX) ||
+       (tile->getY() < 0) || (tile->getY() >= mMapSizeY))
+    {
+        OD_LOG_ERR("tile=" + Tile::displayAsString(tile));
+        return nullptr;
+    }
+
+    return &mCells[(tile->getX() / CELL_SIZE) * mNbCellsY + tile->getY() / CELL_SIZE];
+}
+
+EntityGrid::SeatBucket& EntityGrid::getBucket(Cell& cell, Seat* seat)
+{
+    for(SeatBucket& bucket : cell.mBuckets)
+    {
+        if(bucket.mSeat == seat)
+            return bucket;
+    }
+
+    SeatBucket bucket;
+    bucket.mSeat = seat;
+    cell.mBuckets.push_back(bucket);
+    return cell.mBuckets.back();
+}
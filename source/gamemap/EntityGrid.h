@@ -0,0 +1,125 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENTITYGRID_H
+#define ENTITYGRID_H
+
+#include "gamemap/SearchedTiles.h"
+
+#include <cstdint>
+#include <vector>
+
+class Building;
+class Creature;
+class GameEntity;
+class GameMap;
+class Seat;
+class Tile;
+
+/*! \brief Coarse spatial grid used to find the creatures and buildings on a set of tiles.
+ *
+ * The map is split in cells of CELL_SIZE x CELL_SIZE tiles. In each cell, the creatures
+ * and the tiles covered by a building are bucketed by seat. Searching the enemies (or allies)
+ * on some tiles only goes through the buckets of the relevant seats in the cells overlapping
+ * the tiles. Thus, the allied creatures crowding around a creature do not slow down the search
+ * for its enemies.
+ *
+ * The grid is kept up to date by the tiles when creatures enter/leave them and when buildings
+ * cover/uncover them. Dead creatures are kept (they are still on their tile) and filtered
+ * when searching.
+ *
+ * The grid only tells which of the searched tiles have entities of the wanted seats. The entities are then
+ * read from these tiles in the order of the searched tiles, like a scan of every tile would return them:
+ * the creatures choosing their target from the result are not affected by the grid layout.
+ * A search uses scratch buffers kept in the grid. Thus, getEntities is not reentrant and should not be
+ * called from several threads at the same time.
+ */
+class EntityGrid
+{
+public:
+    //! \brief Size (in tiles) of the side of a cell
+    static const int CELL_SIZE;
+
+    EntityGrid(GameMap& gameMap);
+
+    //! \brief Forgets every entity. Should be called when the map is cleared
+    void clear();
+
+    //! \brief The given creature has entered/left the given tile
+    void addCreature(Creature* creature, Tile* tile);
+    void removeCreature(Creature* creature, Tile* tile);
+
+    //! \brief The given tile is now covered/not covered anymore by a building
+    void addBuildingTile(Tile* tile);
+    void removeBuildingTile(Tile* tile);
+
+    /*! \brief Fills entities (cleared before) with the alive creatures standing on the given tiles that are
+     * allied with the given seat (or not allied if enemies is true). If withBuildings is true, the buildings
+     * covering at least one of the given tiles are added once. When searching enemies, only the creatures
+     * and buildings attackable by the given seat are returned.
+     * The entities are sorted like the given tiles. On each tile, the creatures come in the order of
+     * Tile::getEntitiesInTile followed by the building (if not already added).
+     */
+    void getEntities(const std::vector<Tile*>& tiles, Seat* seat, bool enemies, bool withBuildings,
+        std::vector<GameEntity*>& entities);
+
+private:
+    struct CreatureEntry
+    {
+        Creature* mCreature;
+        Tile* mTile;
+    };
+
+    struct SeatBucket
+    {
+        Seat* mSeat;
+        std::vector<CreatureEntry> mCreatures;
+        std::vector<Tile*> mBuildingTiles;
+    };
+
+    struct Cell
+    {
+        std::vector<SeatBucket> mBuckets;
+    };
+
+    GameMap& mGameMap;
+
+    int mMapSizeX;
+    int mMapSizeY;
+    int mNbCellsX;
+    int mNbCellsY;
+
+    //! \brief Cells of the grid (cellX * mNbCellsY + cellY)
+    std::vector<Cell> mCells;
+
+    //! \brief Tiles searched by getEntities and the ones having entities of the wanted seats
+    SearchedTiles mSearchedTiles;
+
+    //! \brief Buildings already returned by the current search
+    std::vector<Building*> mBuildingsFound;
+
+    //! \brief Resizes the grid if the map size changed. Returns false if the map is empty
+    bool checkMapSize();
+
+    //! \brief Returns the cell containing the given tile. nullptr if the tile is not within the grid
+    Cell* getCell(Tile* tile);
+
+    //! \brief Returns the bucket of the given seat in the given cell. It is created if needed
+    SeatBucket& getBucket(Cell& cell, Seat* seat);
+};
+
+#endif // ENTITYGRID_H
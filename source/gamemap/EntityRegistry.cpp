@@ -0,0 +1,202 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/EntityRegistry.h"
+
+#include "entities/GameEntityType.h"
+
+const uint32_t EntityRegistry::NO_ID = 0xFFFFFFFF;
+
+//! \brief Value of a slot where an entity has been removed. Searches go on after such a slot
+static const uint32_t REMOVED_ID = 0xFFFFFFFE;
+static const uint32_t MIN_INDEX_SIZE = 16;
+
+void EntityRegistry::clear()
+{
+    mEntries.clear();
+    mFreeIds.clear();
+    mIndexes.clear();
+}
+
+uint32_t EntityRegistry::add(GameEntityType type, const std::string& name, GameEntity* entity)
+{
+    uint32_t intType = static_cast<uint32_t>(type);
+    if(intType >= mIndexes.size())
+    {
+        Index index = { std::vector<uint32_t>(), 0, 0 };
+        mIndexes.resize(intType + 1, index);
+    }
+
+    Index& index = mIndexes[intType];
+    // We keep the table at most half full (removed entities included). When rebuilding it,
+    // we make it big enough to be a quarter full
+    if((index.mNbSlotsUsed + 1) * 2 > index.mSlots.size())
+    {
+        uint32_t size = MIN_INDEX_SIZE;
+        while(size < (index.mNbEntities + 1) * 4)
+            size *= 2;
+
+        rehash(index, size);
+    }
+
+    uint32_t id;
+    if(mFreeIds.empty())
+    {
+        id = static_cast<uint32_t>(mEntries.size());
+        mEntries.emplace_back();
+    }
+    else
+    {
+        id = mFreeIds.back();
+        mFreeIds.pop_back();
+    }
+
+    Entry& entry = mEntries[id];
+    entry.mEntity = entity;
+    entry.mName = name;
+    entry.mHash = hashName(name);
+
+    uint32_t mask = static_cast<uint32_t>(index.mSlots.size()) - 1;
+    uint32_t slot = entry.mHash & mask;
+    while((index.mSlots[slot] != NO_ID) && (index.mSlots[slot] != REMOVED_ID))
+        slot = (slot + 1) & mask;
+
+    if(index.mSlots[slot] == NO_ID)
+        ++index.mNbSlotsUsed;
+
+    index.mSlots[slot] = id;
+    ++index.mNbEntities;
+    return id;
+}
+
+bool EntityRegistry::remove(GameEntityType type, const std::string& name, GameEntity* entity)
+{
+    uint32_t intType = static_cast<uint32_t>(type);
+    if(intType >= mIndexes.size())
+        return false;
+
+    Index& index = mIndexes[intType];
+    if(index.mSlots.empty())
+        return false;
+
+    uint32_t mask = static_cast<uint32_t>(index.mSlots.size()) - 1;
+    uint32_t slot = hashName(name) & mask;
+    while(index.mSlots[slot] != NO_ID)
+    {
+        uint32_t id = index.mSlots[slot];
+        if((id != REMOVED_ID) && (mEntries[id].mEntity == entity))
+        {
+            index.mSlots[slot] = REMOVED_ID;
+            --index.mNbEntities;
+            mEntries[id].mEntity = nullptr;
+            mEntries[id].mName.clear();
+            mFreeIds.push_back(id);
+            return true;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    return false;
+}
+
+uint32_t EntityRegistry::getId(GameEntityType type, const std::string& name) const
+{
+    uint32_t intType = static_cast<uint32_t>(type);
+    if(intType >= mIndexes.size())
+        return NO_ID;
+
+    const Index& index = mIndexes[intType];
+    uint32_t slot = findSlot(index, hashName(name), name);
+    if(slot == NO_ID)
+        return NO_ID;
+
+    return index.mSlots[slot];
+}
+
+GameEntity* EntityRegistry::find(GameEntityType type, const std::string& name) const
+{
+    uint32_t id = getId(type, name);
+    if(id == NO_ID)
+        return nullptr;
+
+    return mEntries[id].mEntity;
+}
+
+GameEntity* EntityRegistry::getEntity(uint32_t id) const
+{
+    if(id >= mEntries.size())
+        return nullptr;
+
+    return mEntries[id].mEntity;
+}
+
+uint32_t EntityRegistry::hashName(const std::string& name)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for(char c : name)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t EntityRegistry::findSlot(const Index& index, uint32_t hash, const std::string& name) const
+{
+    if(index.mSlots.empty())
+        return NO_ID;
+
+    uint32_t mask = static_cast<uint32_t>(index.mSlots.size()) - 1;
+    uint32_t slot = hash & mask;
+    while(index.mSlots[slot] != NO_ID)
+    {
+        uint32_t id = index.mSlots[slot];
+        if(id != REMOVED_ID)
+        {
+            const Entry& entry = mEntries[id];
+            if((entry.mHash == hash) && (entry.mName == name))
+                return slot;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    return NO_ID;
+}
+
+void EntityRegistry::rehash(Index& index, uint32_t size)
+{
+    std::vector<uint32_t> oldSlots(size, NO_ID);
+    oldSlots.swap(index.mSlots);
+    index.mNbSlotsUsed = 0;
+
+    uint32_t mask = size - 1;
+    for(uint32_t id : oldSlots)
+    {
+        if((id == NO_ID) || (id == REMOVED_ID))
+            continue;
+
+        uint32_t slot = mEntries[id].mHash & mask;
+        while(index.mSlots[slot] != NO_ID)
+            slot = (slot + 1) & mask;
+
+        index.mSlots[slot] = id;
+        ++index.mNbSlotsUsed;
+    }
+}
@@ -0,0 +1,95 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENTITYREGISTRY_H
+#define ENTITYREGISTRY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class GameEntity;
+
+enum class GameEntityType;
+
+/*! \brief Index of the entities on a GameMap by type and name.
+ *
+ * Each registered entity gets a compact numeric id (ids of removed entities are reused).
+ * For each GameEntityType, an open addressing hash table (linear probing) maps the entity
+ * names to their id. Adding, removing and finding an entity are done in constant time.
+ *
+ * The registry keeps the name given when an entity is added. The entity should be removed with the same name.
+ * The entities themselves are never accessed.
+ */
+class EntityRegistry
+{
+public:
+    //! \brief Id returned when an entity is not registered
+    static const uint32_t NO_ID;
+
+    //! \brief Forgets every registered entity
+    void clear();
+
+    //! \brief Registers the entity under the given type and name and returns its id
+    uint32_t add(GameEntityType type, const std::string& name, GameEntity* entity);
+
+    //! \brief Removes the given entity. Returns false if it was not registered under the given type and name
+    bool remove(GameEntityType type, const std::string& name, GameEntity* entity);
+
+    //! \brief Returns the id of the entity with the given type and name. NO_ID if there is none
+    uint32_t getId(GameEntityType type, const std::string& name) const;
+
+    //! \brief Returns the entity with the given type and name. nullptr if there is none
+    GameEntity* find(GameEntityType type, const std::string& name) const;
+
+    //! \brief Returns the entity with the given id. nullptr if there is none
+    GameEntity* getEntity(uint32_t id) const;
+
+private:
+    struct Entry
+    {
+        GameEntity* mEntity;
+        std::string mName;
+        uint32_t mHash;
+    };
+
+    struct Index
+    {
+        //! \brief Ids of the entities. The size is always a power of 2
+        std::vector<uint32_t> mSlots;
+        //! \brief Number of slots used by an entity or a removed entity
+        uint32_t mNbSlotsUsed;
+        uint32_t mNbEntities;
+    };
+
+    //! \brief Registered entities indexed by id
+    std::vector<Entry> mEntries;
+    std::vector<uint32_t> mFreeIds;
+
+    //! \brief Hash tables indexed by GameEntityType
+    std::vector<Index> mIndexes;
+
+    static uint32_t hashName(const std::string& name);
+
+    //! \brief Returns the slot containing the entity with the given name. NO_ID if there is none
+    uint32_t findSlot(const Index& index, uint32_t hash, const std::string& name) const;
+
+    //! \brief Rebuilds the table with the given size. Removed entities are dropped
+    void rehash(Index& index, uint32_t size);
+};
+
+#endif // ENTITYREGISTRY_H
@@ -0,0 +1,98 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/FloodFillIndex.h"
+
+void FloodFillIndex::clear()
+{
+    mParents.clear();
+    mRanks.clear();
+}
+
+uint32_t FloodFillIndex::find(uint32_t teamIndex, uint32_t color) const
+{
+    if(teamIndex >= mParents.size())
+        return color;
+
+    const std::vector<uint32_t>& parents = mParents[teamIndex];
+    if(color >= parents.size())
+        return color;
+
+    while(parents[color] != color)
+        color = parents[color];
+
+    return color;
+}
+
+uint32_t FloodFillIndex::findAndCompress(uint32_t teamIndex, uint32_t color)
+{
+    if(teamIndex >= mParents.size())
+        return color;
+
+    std::vector<uint32_t>& parents = mParents[teamIndex];
+    if(color >= parents.size())
+        return color;
+
+    // Path halving: each visited color is linked to its grand parent
+    while(parents[color] != color)
+    {
+        uint32_t& parent = parents[color];
+        parent = parents[parent];
+        color = parent;
+    }
+
+    return color;
+}
+
+uint32_t FloodFillIndex::merge(uint32_t teamIndex, uint32_t color1, uint32_t color2)
+{
+    uint32_t root1 = findAndCompress(teamIndex, color1);
+    uint32_t root2 = findAndCompress(teamIndex, color2);
+    if(root1 == root2)
+        return root1;
+
+    if(teamIndex >= mParents.size())
+    {
+        mParents.resize(teamIndex + 1);
+        mRanks.resize(teamIndex + 1);
+    }
+
+    std::vector<uint32_t>& parents = mParents[teamIndex];
+    std::vector<uint8_t>& ranks = mRanks[teamIndex];
+    uint32_t maxRoot = (root1 > root2 ? root1 : root2);
+    if(maxRoot >= parents.size())
+    {
+        uint32_t oldSize = static_cast<uint32_t>(parents.size());
+        parents.resize(maxRoot + 1);
+        ranks.resize(maxRoot + 1, 0);
+        for(uint32_t color = oldSize; color <= maxRoot; ++color)
+            parents[color] = color;
+    }
+
+    // Union by rank: the smallest tree is linked to the other one
+    if(ranks[root1] < ranks[root2])
+    {
+        parents[root1] = root2;
+        return root2;
+    }
+
+    parents[root2] = root1;
+    if(ranks[root1] == ranks[root2])
+        ++ranks[root1];
+
+    return root1;
+}
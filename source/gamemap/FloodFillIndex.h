@@ -0,0 +1,66 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLOODFILLINDEX_H
+#define FLOODFILLINDEX_H
+
+#include <cstdint>
+#include <vector>
+
+/*! \brief Union-find over the floodfill colors of each team.
+ *
+ * Each tile stores a floodfill color per team and floodfill type. When 2 areas get
+ * connected (a tile is dug, a door is unlocked, a bridge is built), instead of replacing
+ * the color of every tile of one area, the 2 colors are merged here. The real floodfill
+ * value of a tile is then the representative of its color.
+ *
+ * Colors are given by GameMap::nextUniqueFloodFillValue so a color is only used by one floodfill
+ * type. Thus, we only need one array per team, indexed by color. Colors that have never
+ * been merged are not stored and are their own representative.
+ *
+ * Note that areas can still be split (a door is locked) by giving a new color to the
+ * tiles of one side.
+ *
+ * find does not modify the index so that the floodfill values can be read from const code and from
+ * several threads. The paths are only compressed by merge. Since the trees are merged by rank, their
+ * height stays logarithmic anyway.
+ */
+class FloodFillIndex
+{
+public:
+    //! \brief Forgets every merge
+    void clear();
+
+    //! \brief Returns the representative of the given color for the given team
+    uint32_t find(uint32_t teamIndex, uint32_t color) const;
+
+    //! \brief Merges the areas with the given colors for the given team. Returns the representative
+    //! of the merged area
+    uint32_t merge(uint32_t teamIndex, uint32_t color1, uint32_t color2);
+
+private:
+    //! \brief Returns the representative of the given color and links the visited colors to their grand parent
+    uint32_t findAndCompress(uint32_t teamIndex, uint32_t color);
+
+    //! \brief Parent color of each color, indexed by team index and by color
+    std::vector<std::vector<uint32_t>> mParents;
+
+    //! \brief Upper bound of the tree height of each representative, indexed like mParents
+    std::vector<std::vector<uint8_t>> mRanks;
+};
+
+#endif // FLOODFILLINDEX_H
@@ -0,0 +1,205 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLOWFIELDBUILDER_H
+#define FLOWFIELDBUILDER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/*! \brief Computes the distance maps used by FlowFieldManager and reads paths from them.
+ *
+ * The steps and their costs are the same as in GameMap::path: the 4 adjacent tiles then the 4 diagonal ones, a
+ * diagonal tile being only reachable if the 2 tiles adjacent to both tiles are passable. The cost of a step
+ * depends on the tile it starts from. The map is given through functors so that the same code is used for any
+ * creature.
+ */
+class FlowFieldBuilder
+{
+public:
+    //! \brief Cost of the tiles that cannot reach the destination
+    static const float NO_DISTANCE;
+
+    /*! \brief Fills distances (x * mapSizeY + y) with the walking cost from each tile to the destination with a
+     * Dijkstra sweep. isPassable(x, y) tells whether a tile of the map can be walked and is called at most once per
+     * tile. stepCost(x, y, nbSteps) gives the cost of a step from the tile x, y to a neighbor nbSteps away (1 for
+     * adjacent tiles, 2 for diagonal ones)
+     */
+    template<typename PassableFunc, typename StepCostFunc>
+    void build(int mapSizeX, int mapSizeY, int destinationX, int destinationY, PassableFunc isPassable,
+        StepCostFunc stepCost, std::vector<float>& distances)
+    {
+        distances.assign(static_cast<uint32_t>(mapSizeX * mapSizeY), NO_DISTANCE);
+        mPassable.assign(static_cast<uint32_t>(mapSizeX * mapSizeY), PASSABILITY_UNKNOWN);
+        auto isPassableCached = [&](int x, int y)
+        {
+            uint8_t& passability = mPassable[x * mapSizeY + y];
+            if(passability == PASSABILITY_UNKNOWN)
+                passability = isPassable(x, y) ? PASSABILITY_PASSABLE : PASSABILITY_BLOCKED;
+
+            return passability == PASSABILITY_PASSABLE;
+        };
+
+        // Since we go backward from the destination, the step from a neighbor to the current tile is weighted
+        // with the neighbor
+        std::greater<std::pair<float, int32_t>> compare;
+        int32_t destinationIndex = destinationX * mapSizeY + destinationY;
+        mHeap.clear();
+        distances[destinationIndex] = 0.0f;
+        mHeap.push_back(std::make_pair(0.0f, destinationIndex));
+        while(!mHeap.empty())
+        {
+            std::pop_heap(mHeap.begin(), mHeap.end(), compare);
+            float distance = mHeap.back().first;
+            int32_t index = mHeap.back().second;
+            mHeap.pop_back();
+            if(distance > distances[index])
+                continue;
+
+            int x = index / mapSizeY;
+            int y = index % mapSizeY;
+            bool areTilesPassable[4] = {false, false, false, false};
+            for(unsigned int i = 0; i < 8; ++i)
+            {
+                // The 2 tiles adjacent to both the current tile and a diagonal neighbor are the same from both tiles
+                if((i >= 4) && (!areTilesPassable[NEIGHBOR_DIFFS[i][0] < 0 ? 0 : 1] ||
+                    !areTilesPassable[NEIGHBOR_DIFFS[i][1] < 0 ? 2 : 3]))
+                {
+                    continue;
+                }
+
+                int neighborX = x + NEIGHBOR_DIFFS[i][0];
+                int neighborY = y + NEIGHBOR_DIFFS[i][1];
+                if((neighborX < 0) || (neighborY < 0) || (neighborX >= mapSizeX) || (neighborY >= mapSizeY))
+                    continue;
+
+                if(!isPassableCached(neighborX, neighborY))
+                    continue;
+
+                if(i < 4)
+                    areTilesPassable[i] = true;
+
+                float neighborDistance = distance + stepCost(neighborX, neighborY, (i < 4) ? 1 : 2);
+                int32_t neighborIndex = neighborX * mapSizeY + neighborY;
+                if(neighborDistance >= distances[neighborIndex])
+                    continue;
+
+                distances[neighborIndex] = neighborDistance;
+                mHeap.push_back(std::make_pair(neighborDistance, neighborIndex));
+                std::push_heap(mHeap.begin(), mHeap.end(), compare);
+            }
+        }
+    }
+
+    /*! \brief Fills path with the tiles (x * mapSizeY + y) to walk from start to destination (both included) by going,
+     * at each step, to the neighbor GameMap::path would have gone through: the one with the lowest cost to the
+     * destination once the step is added. canGoThrough(x, y) and stepCost are used like in GameMap::path. If maxLength
+     * is not 0, the path is cut after maxLength tiles.
+     * \returns false if start cannot reach the destination according to distances (or if they are outdated)
+     */
+    template<typename PassableFunc, typename StepCostFunc>
+    static bool readPath(int mapSizeX, int mapSizeY, const std::vector<float>& distances, int startX, int startY,
+        int destinationX, int destinationY, PassableFunc canGoThrough, StepCostFunc stepCost, uint32_t maxLength,
+        std::vector<int32_t>& path)
+    {
+        path.clear();
+        int x = startX;
+        int y = startY;
+        float distance = distances[x * mapSizeY + y];
+        if(distance == NO_DISTANCE)
+            return false;
+
+        path.push_back(x * mapSizeY + y);
+        while((x != destinationX) || (y != destinationY))
+        {
+            if((maxLength > 0) && (path.size() >= maxLength))
+                break;
+
+            bool areTilesPassable[4] = {false, false, false, false};
+            int32_t bestNeighbor = -1;
+            float bestDistance = NO_DISTANCE;
+            for(unsigned int i = 0; i < 8; ++i)
+            {
+                if((i >= 4) && (!areTilesPassable[NEIGHBOR_DIFFS[i][0] < 0 ? 0 : 1] ||
+                    !areTilesPassable[NEIGHBOR_DIFFS[i][1] < 0 ? 2 : 3]))
+                {
+                    continue;
+                }
+
+                int neighborX = x + NEIGHBOR_DIFFS[i][0];
+                int neighborY = y + NEIGHBOR_DIFFS[i][1];
+                if((neighborX < 0) || (neighborY < 0) || (neighborX >= mapSizeX) || (neighborY >= mapSizeY))
+                    continue;
+
+                if(!canGoThrough(neighborX, neighborY))
+                    continue;
+
+                if(i < 4)
+                    areTilesPassable[i] = true;
+
+                // Steps have a positive cost so the tiles closer to the destination are the only ones to consider
+                int32_t neighborIndex = neighborX * mapSizeY + neighborY;
+                float neighborDistance = distances[neighborIndex];
+                if(neighborDistance >= distance)
+                    continue;
+
+                neighborDistance += stepCost(x, y, (i < 4) ? 1 : 2);
+                if(neighborDistance >= bestDistance)
+                    continue;
+
+                bestNeighbor = neighborIndex;
+                bestDistance = neighborDistance;
+            }
+
+            if(bestNeighbor < 0)
+            {
+                path.clear();
+                return false;
+            }
+
+            x = bestNeighbor / mapSizeY;
+            y = bestNeighbor % mapSizeY;
+            distance = distances[bestNeighbor];
+            path.push_back(bestNeighbor);
+        }
+
+        return true;
+    }
+
+private:
+    //! \brief The 4 adjacent tiles then the 4 diagonal ones, in the order of GameMap::path
+    static const int NEIGHBOR_DIFFS[8][2];
+
+    //! \brief Values of the passability scratch buffer
+    enum Passability : uint8_t
+    {
+        PASSABILITY_UNKNOWN,
+        PASSABILITY_BLOCKED,
+        PASSABILITY_PASSABLE
+    };
+
+    //! \brief Scratch heap (cost, tile index) used while building a field
+    std::vector<std::pair<float, int32_t>> mHeap;
+
+    //! \brief Scratch buffer telling which tiles can be walked while building a field
+    std::vector<uint8_t> mPassable;
+};
+
+#endif // FLOWFIELDBUILDER_H
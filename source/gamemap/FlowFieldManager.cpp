@@ -0,0 +1,213 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/FlowFieldManager.h"
+
+#include "entities/Creature.h"
+#include "entities/Tile.h"
+#include "game/Seat.h"
+#include "gamemap/GameMap.h"
+
+#include <algorithm>
+
+const uint32_t FlowFieldManager::HOT_DESTINATION_REQUESTS = 2;
+const uint32_t FlowFieldManager::MAX_FIELDS = 8;
+
+bool FlowFieldManager::SpeedProfile::operator==(const SpeedProfile& other) const
+{
+    return (mGroundSpeed == other.mGroundSpeed) &&
+        (mWaterSpeed == other.mWaterSpeed) &&
+        (mLavaSpeed == other.mLavaSpeed);
+}
+
+FlowFieldManager::FlowFieldManager(GameMap& gameMap) :
+    mGameMap(gameMap),
+    mRequestsTurn(-1)
+{
+}
+
+void FlowFieldManager::clear()
+{
+    mFields.clear();
+}
+
+void FlowFieldManager::tilePassabilityChanged(int x, int y)
+{
+    // A field is only changed if the tile is in its region or if the tile can now be walked from its region. In
+    // both cases, the tile or one of its neighbors is in the region. A diagonal step can also be enabled by the
+    // tile but both tiles of that step are neighbors of the tile
+    int mapSizeX = mGameMap.getMapSizeX();
+    int mapSizeY = mGameMap.getMapSizeY();
+    mFields.erase(std::remove_if(mFields.begin(), mFields.end(),
+        [x, y, mapSizeX, mapSizeY](const FlowField& field)
+        {
+            for(int xx = x - 1; xx <= x + 1; ++xx)
+            {
+                for(int yy = y - 1; yy <= y + 1; ++yy)
+                {
+                    if((xx < 0) || (yy < 0) || (xx >= mapSizeX) || (yy >= mapSizeY))
+                        continue;
+
+                    if(field.mDistances[xx * mapSizeY + yy] != FlowFieldBuilder::NO_DISTANCE)
+                        return true;
+                }
+            }
+            return false;
+        }), mFields.end());
+}
+
+bool FlowFieldManager::getPath(const Creature* creature, FloodFillType type, Tile* start, Tile* destination,
+        std::vector<Tile*>& path, uint32_t maxLength)
+{
+    path.clear();
+    Seat* seat = creature->getSeat();
+    if(destination->getFloodFillValue(seat, type) == Tile::NO_FLOODFILL)
+        return false;
+
+    int mapSizeY = mGameMap.getMapSizeY();
+    int32_t destinationIndex = destination->getX() * mapSizeY + destination->getY();
+    int teamIndex = seat->getTeamIndex();
+    SpeedProfile speeds = { creature->getMoveSpeedGround(), creature->getMoveSpeedWater(), creature->getMoveSpeedLava() };
+    FlowField* field = findField(destinationIndex, teamIndex, type, speeds);
+    if(field == nullptr)
+    {
+        if(!addRequest(destinationIndex, teamIndex, type, speeds))
+            return false;
+
+        field = &buildField(creature, type, speeds, destination);
+    }
+
+    field->mLastUsedTurn = mGameMap.getTurnNumber();
+
+    // If the start tile is not in the field (for example, a creature standing on a door
+    // that has just been locked), we let the caller search the path
+    if(!FlowFieldBuilder::readPath(mGameMap.getMapSizeX(), mapSizeY, field->mDistances, start->getX(), start->getY(),
+        destination->getX(), destination->getY(),
+        [this, creature](int x, int y)
+        {
+            Tile* tile = mGameMap.getTile(x, y);
+            return (tile != nullptr) && creature->canGoThroughTile(tile);
+        },
+        [this, creature](int x, int y, int nbSteps) { return getStepCost(creature, mGameMap.getTile(x, y), nbSteps); },
+        maxLength, mPathTiles))
+    {
+        return false;
+    }
+
+    for(int32_t tileIndex : mPathTiles)
+        path.push_back(mGameMap.getTile(tileIndex / mapSizeY, tileIndex % mapSizeY));
+
+    return true;
+}
+
+FlowFieldManager::FlowField* FlowFieldManager::findField(int32_t destination, int teamIndex, FloodFillType type,
+        const SpeedProfile& speeds)
+{
+    for(FlowField& field : mFields)
+    {
+        if((field.mDestination == destination) &&
+           (field.mTeamIndex == teamIndex) &&
+           (field.mType == type) &&
+           (field.mSpeeds == speeds))
+        {
+            return &field;
+        }
+    }
+
+    return nullptr;
+}
+
+bool FlowFieldManager::addRequest(int32_t destination, int teamIndex, FloodFillType type, const SpeedProfile& speeds)
+{
+    int64_t turn = mGameMap.getTurnNumber();
+    if(mRequestsTurn != turn)
+    {
+        mRequestsTurn = turn;
+        mRequests.clear();
+    }
+
+    for(Request& request : mRequests)
+    {
+        if((request.mDestination != destination) ||
+           (request.mTeamIndex != teamIndex) ||
+           (request.mType != type) ||
+           !(request.mSpeeds == speeds))
+        {
+            continue;
+        }
+
+        ++request.mNbRequests;
+        return request.mNbRequests >= HOT_DESTINATION_REQUESTS;
+    }
+
+    Request request = { destination, teamIndex, type, speeds, 1 };
+    mRequests.push_back(request);
+    return request.mNbRequests >= HOT_DESTINATION_REQUESTS;
+}
+
+FlowFieldManager::FlowField& FlowFieldManager::buildField(const Creature* creature, FloodFillType type,
+        const SpeedProfile& speeds, Tile* destination)
+{
+    int mapSizeX = mGameMap.getMapSizeX();
+    int mapSizeY = mGameMap.getMapSizeY();
+
+    // We replace the field that has not been used for the longest time
+    FlowField* field;
+    if(mFields.size() < MAX_FIELDS)
+    {
+        mFields.emplace_back();
+        field = &mFields.back();
+    }
+    else
+    {
+        field = &mFields.front();
+        for(FlowField& f : mFields)
+        {
+            if(f.mLastUsedTurn < field->mLastUsedTurn)
+                field = &f;
+        }
+    }
+
+    Seat* seat = creature->getSeat();
+    field->mDestination = destination->getX() * mapSizeY + destination->getY();
+    field->mTeamIndex = seat->getTeamIndex();
+    field->mType = type;
+    field->mSpeeds = speeds;
+    field->mLastUsedTurn = mGameMap.getTurnNumber();
+
+    // A tile is in the region of the field if the creature can go through it and it has the same floodfill
+    // value as the destination
+    uint32_t floodFill = destination->getFloodFillValue(seat, type);
+    mBuilder.build(mapSizeX, mapSizeY, destination->getX(), destination->getY(),
+        [this, creature, seat, type, floodFill](int x, int y)
+        {
+            Tile* tile = mGameMap.getTile(x, y);
+            return (tile != nullptr) && (tile->getFloodFillValue(seat, type) == floodFill) &&
+                creature->canGoThroughTile(tile);
+        },
+        [this, creature](int x, int y, int nbSteps) { return getStepCost(creature, mGameMap.getTile(x, y), nbSteps); },
+        field->mDistances);
+
+    return *field;
+}
+
+float FlowFieldManager::getStepCost(const Creature* creature, Tile* from, int nbSteps)
+{
+    // GameMap::path weights a step with the manhattan distance divided by the speed on the tile it starts from
+    double speed = (from->getFullness() == 0) ? creature->getMoveSpeed(from) : creature->getMoveSpeedGround();
+    return static_cast<float>(static_cast<double>(nbSteps) / speed);
+}
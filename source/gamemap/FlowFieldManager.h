@@ -0,0 +1,128 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLOWFIELDMANAGER_H
+#define FLOWFIELDMANAGER_H
+
+#include "gamemap/FlowFieldBuilder.h"
+
+#include <cstdint>
+#include <vector>
+
+class Creature;
+class GameMap;
+class Tile;
+
+enum class FloodFillType;
+
+/*! \brief Shared distance maps used when many creatures walk to the same tile.
+ *
+ * A flow field stores, for each tile, the walking cost to a destination tile, with the same step costs and
+ * diagonal rules as GameMap::path. Step costs depend on the creature speeds on ground, water and lava so a
+ * field is built for a destination, a team, a floodfill type and a speed profile. It is built with a single
+ * Dijkstra sweep from the destination (see FlowFieldBuilder) and any creature of the team with the same speeds can
+ * then follow the decreasing costs from its own tile.
+ *
+ * Building a field costs a full map sweep. Thus, a field is only built for a destination
+ * that has been asked at least HOT_DESTINATION_REQUESTS times during the same turn. For
+ * other destinations, getPath returns false and the caller should use GameMap::path.
+ *
+ * Fields are kept between turns. When the passability of a tile changes (see GameMap::tilePassabilityChanged),
+ * only the fields whose region (the tiles that can reach the destination) contains or touches the tile are dropped.
+ */
+class FlowFieldManager
+{
+public:
+    //! \brief Number of requests for the same destination during a turn before a field is built
+    static const uint32_t HOT_DESTINATION_REQUESTS;
+    //! \brief Maximum number of fields kept at the same time
+    static const uint32_t MAX_FIELDS;
+
+    FlowFieldManager(GameMap& gameMap);
+
+    //! \brief Forgets every field. Should be called when the floodfill of the whole map is computed again
+    void clear();
+
+    //! \brief Forgets the fields that may be changed because the passability of the given tile changed
+    void tilePassabilityChanged(int x, int y);
+
+    /*! \brief Fills path with the tiles to walk from start to destination (both included) for the given creature
+     * and floodfill type. If maxLength is not 0, the path is cut after maxLength tiles.
+     * \returns true if the path could be read from a field. If false is returned, the caller should
+     * compute the path itself
+     */
+    bool getPath(const Creature* creature, FloodFillType type, Tile* start, Tile* destination, std::vector<Tile*>& path,
+        uint32_t maxLength = 0);
+
+private:
+    //! \brief Creatures with the same speeds share the same fields
+    struct SpeedProfile
+    {
+        double mGroundSpeed;
+        double mWaterSpeed;
+        double mLavaSpeed;
+
+        bool operator==(const SpeedProfile& other) const;
+    };
+
+    struct FlowField
+    {
+        int32_t mDestination;
+        int mTeamIndex;
+        FloodFillType mType;
+        SpeedProfile mSpeeds;
+        //! \brief Last turn the field has been used. Used to replace the oldest field when MAX_FIELDS is reached
+        int64_t mLastUsedTurn;
+        //! \brief Walking cost to the destination for each tile (x * mapSizeY + y)
+        std::vector<float> mDistances;
+    };
+
+    struct Request
+    {
+        int32_t mDestination;
+        int mTeamIndex;
+        FloodFillType mType;
+        SpeedProfile mSpeeds;
+        uint32_t mNbRequests;
+    };
+
+    GameMap& mGameMap;
+
+    std::vector<FlowField> mFields;
+
+    //! \brief Destinations asked during mRequestsTurn that do not have a field yet
+    std::vector<Request> mRequests;
+    int64_t mRequestsTurn;
+
+    FlowFieldBuilder mBuilder;
+
+    //! \brief Scratch buffer receiving the tiles of the path read from a field
+    std::vector<int32_t> mPathTiles;
+
+    //! \brief Returns the field for the given destination if it exists, nullptr otherwise
+    FlowField* findField(int32_t destination, int teamIndex, FloodFillType type, const SpeedProfile& speeds);
+
+    //! \brief Counts the request and returns true if the destination became hot
+    bool addRequest(int32_t destination, int teamIndex, FloodFillType type, const SpeedProfile& speeds);
+
+    FlowField& buildField(const Creature* creature, FloodFillType type, const SpeedProfile& speeds, Tile* destination);
+
+    //! \brief Cost of a step from the given tile to a neighbor tile, as computed by GameMap::path
+    static float getStepCost(const Creature* creature, Tile* from, int nbSteps);
+};
+
+#endif // FLOWFIELDMANAGER_H
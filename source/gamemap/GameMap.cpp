@@ -59,6 +59,7 @@
 #include "utils/ConfigManager.h"
 #include "utils/Helper.h"
 #include "utils/LogManager.h"
+#include "utils/Random.h"
 #include "utils/ResourceManager.h"
 
 #include <OgreTimer.h>
@@ -67,88 +68,30 @@
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
+#include <ctime>
 #include <iostream>
+#include <random>
 #include <sstream>
 #include <string>
 
 const std::string DEFAULT_NICK = "You";
 
-using namespace std;
-
-/*! \brief A helper class for the A* search in the GameMap::path function.
-*
-* This class stores the requisite information about a tile which is placed in
-* the search queue for the A-star, or A*, algorithm which is used to
-* calculate paths in the path function.
-*
-* The A* description can be found here:
-* http://en.wikipedia.org/wiki/A*_search_algorithm
-*/
-class AstarEntry
-{
-public:
-    AstarEntry() :
-        tile    (nullptr),
-        parent  (nullptr),
-        g       (0.0),
-        h       (0.0)
-    {}
-
-    AstarEntry(Tile* tile, int x1, int y1, int x2, int y2) :
-        mHasBeenProcessed (false),
-        tile    (tile),
-        parent  (nullptr),
-        g       (0.0),
-        h       (0.0)
-    {
-        h = computeHeuristic(x1, y1, x2, y2);
-    }
-
-    static double computeHeuristic(const int& x1, const int& y1, const int& x2, const int& y2)
-    {
-        return fabs(static_cast<double>(x2 - x1)) + fabs(static_cast<double>(y2 - y1));
-    }
-
-    void setHeuristic(const int& x1, const int& y1, const int& x2, const int& y2)
-    {
-        h = fabs(static_cast<double>(x2 - x1)) + fabs(static_cast<double>(y2 - y1));
-    }
-
-    inline double fCost() const
-    { return g + h; }
-
-    inline Tile* getTile() const
-    { return tile; }
-
-    inline bool getHasBeenProcessed() const
-    { return mHasBeenProcessed; }
-
-    inline void setHasBeenProcessed()
-    { mHasBeenProcessed = true; }
-
-    inline void setTile(Tile* newTile)
-    { tile = newTile; }
-
-    inline AstarEntry* getParent() const
-    { return parent; }
-
-    inline void setParent(AstarEntry* newParent)
-    { parent = newParent; }
-
-    inline const double& getG() const
-    { return g; }
-
-    inline void setG(const double& newG)
-    { g = newG; }
-
-private:
-    bool        mHasBeenProcessed;
-    Tile*       tile;
-    AstarEntry* parent;
-    double      g;
-    double      h;
+//! \brief Types of the entities stored in mRenderedMovableEntities
+static const GameEntityType RENDERED_MOVABLE_ENTITY_TYPES[] =
+{
+    GameEntityType::buildingObject,
+    GameEntityType::chickenEntity,
+    GameEntityType::craftedTrap,
+    GameEntityType::missileObject,
+    GameEntityType::persistentObject,
+    GameEntityType::smallSpiderEntity,
+    GameEntityType::trapEntity,
+    GameEntityType::treasuryObject,
+    GameEntityType::skillEntity,
+    GameEntityType::giftBoxEntity
 };
 
+using namespace std;
 
 GameMap::GameMap(bool isServerGameMap) :
         TileContainer(isServerGameMap ? 15 : 0),
@@ -161,10 +104,19 @@ GameMap::GameMap(bool isServerGameMap) :
         mFloodFillEnabled(false),
         mIsFOWActivated(true),
         mNumCallsTo_path(0),
+        mPathfindingHierarchy(*this),
+        mFlowFieldManager(*this),
+        mVisionManager(*this),
+        mEntityGrid(*this),
+        mNbWorkerThreads(ThreadPool::getDefaultNbThreads()),
         mAiManager(*this),
         mTileSet(nullptr)
 {
     resetUniqueNumbers();
+
+    // The seed is only fixed when the game should be replayed (see setRandomSeed)
+    std::random_device randomDevice;
+    mRandom.setSeed((static_cast<uint64_t>(randomDevice()) << 32) ^ static_cast<uint64_t>(std::time(nullptr)));
 }
 
 GameMap::~GameMap()
@@ -285,6 +237,10 @@ void GameMap::clearAll()
     resetUniqueNumbers();
     mIsFOWActivated = true;
     mTimePayDay = 0;
+    mEntityRegistry.clear();
+    mEntitiesByHandle.clear();
+    mVisionManager.clear();
+    mEntityGrid.clear();
 
     // We check if the different vectors are empty
     if(!mActiveObjects.empty())
@@ -401,6 +357,7 @@ void GameMap::resetUniqueNumbers()
     mUniqueNumberTrap = 0;
     mUniqueNumberMapLight = 0;
     mUniqueFloodFillValue = 0;
+    mFloodFillIndex.clear();
 }
 
 void GameMap::addClassDescription(const CreatureDefinition *c)
@@ -473,7 +430,7 @@ uint32_t GameMap::numWeapons()
     return mWeapons.size();
 }
 
-void GameMap::saveLevelEquipments(std::ofstream& levelFile)
+void GameMap::saveLevelEquipments(std::ostream& levelFile)
 {
     for (std::pair<const Weapon*,Weapon*>& def : mWeapons)
     {
@@ -490,6 +447,7 @@ void GameMap::addCreature(Creature *cc)
         + ", seatId=" + (cc->getSeat() != nullptr ? Helper::toString(cc->getSeat()->getId()) : std::string("null")));
 
     mCreatures.push_back(cc);
+    registerEntity(GameEntityType::creature, cc);
 }
 
 void GameMap::removeCreature(Creature *c)
@@ -504,6 +462,7 @@ void GameMap::removeCreature(Creature *c)
     }
 
     mCreatures.erase(it);
+    unregisterEntity(GameEntityType::creature, c);
 }
 
 void GameMap::queueEntityForDeletion(GameEntity *ge)
@@ -819,13 +778,20 @@ void GameMap::removeAnimatedObject(MovableGameEntity *a)
 
 MovableGameEntity* GameMap::getAnimatedObject(const std::string& name) const
 {
-    for (MovableGameEntity* mge : mAnimatedObjects)
-    {
-        if (mge->getName().compare(name) == 0)
-            return mge;
-    }
+    // Animated objects are the creatures, rendered movable entities, spells and map lights
+    Creature* creature = getCreature(name);
+    if(creature != nullptr)
+        return creature;
 
-    return nullptr;
+    RenderedMovableEntity* renderedMovableEntity = getRenderedMovableEntity(name);
+    if(renderedMovableEntity != nullptr)
+        return renderedMovableEntity;
+
+    Spell* spell = getSpell(name);
+    if(spell != nullptr)
+        return spell;
+
+    return getMapLight(name);
 }
 
 void GameMap::addRenderedMovableEntity(RenderedMovableEntity *obj)
@@ -833,6 +799,7 @@ void GameMap::addRenderedMovableEntity(RenderedMovableEntity *obj)
     OD_LOG_INF(serverStr() + "Adding rendered object " + obj->getName()
         + ",MeshName=" + obj->getMeshName());
     mRenderedMovableEntities.push_back(obj);
+    registerEntity(obj->getObjectType(), obj);
 }
 
 void GameMap::removeRenderedMovableEntity(RenderedMovableEntity *obj)
@@ -847,14 +814,17 @@ void GameMap::removeRenderedMovableEntity(RenderedMovableEntity *obj)
     }
 
     mRenderedMovableEntities.erase(it);
+    unregisterEntity(obj->getObjectType(), obj);
 }
 
-RenderedMovableEntity* GameMap::getRenderedMovableEntity(const std::string& name)
+RenderedMovableEntity* GameMap::getRenderedMovableEntity(const std::string& name) const
 {
-    for(RenderedMovableEntity* renderedMovableEntity : mRenderedMovableEntities)
+    // Rendered movable entities are registered by their real type
+    for(GameEntityType type : RENDERED_MOVABLE_ENTITY_TYPES)
     {
-        if(name.compare(renderedMovableEntity->getName()) == 0)
-            return renderedMovableEntity;
+        GameEntity* entity = mEntityRegistry.find(type, name);
+        if(entity != nullptr)
+            return static_cast<RenderedMovableEntity*>(entity);
     }
     return nullptr;
 }
@@ -889,7 +859,7 @@ unsigned int GameMap::numClassDescriptions()
     return mClassDescriptions.size();
 }
 
-void GameMap::saveLevelClassDescriptions(std::ofstream& levelFile)
+void GameMap::saveLevelClassDescriptions(std::ostream& levelFile)
 {
     for (std::pair<const CreatureDefinition*,CreatureDefinition*>& def : mClassDescriptions)
     {
@@ -1064,12 +1034,7 @@ void GameMap::destroyAllEntities()
 
 Creature* GameMap::getCreature(const std::string& cName) const
 {
-    for (Creature* creature : mCreatures)
-    {
-        if (creature->getName().compare(cName) == 0)
-            return creature;
-    }
-    return nullptr;
+    return static_cast<Creature*>(mEntityRegistry.find(GameEntityType::creature, cName));
 }
 
 void GameMap::doTurn(double timeSinceLastTurn)
@@ -1079,6 +1044,7 @@ void GameMap::doTurn(double timeSinceLastTurn)
 
     uint32_t miscUpkeepTime = doMiscUpkeep(timeSinceLastTurn);
 
+    mTurnProfiler.startPhase(TurnPhase::playerUpkeep);
     for (Seat* seat : mSeats)
     {
         if(seat->getPlayer() == nullptr)
@@ -1102,6 +1068,8 @@ unsigned long int GameMap::doMiscUpkeep(double timeSinceLastTurn)
     Ogre::Timer stopwatch;
     unsigned long int timeTaken;
 
+    mTurnProfiler.startPhase(TurnPhase::payDay);
+
     // We check if it is pay day
     mTimePayDay += timeSinceLastTurn;
     if((mTimePayDay >= ConfigManager::getSingleton().getTimePayDay()))
@@ -1144,6 +1112,8 @@ unsigned long int GameMap::doMiscUpkeep(double timeSinceLastTurn)
         }
     }
 
+    mTurnProfiler.startPhase(TurnPhase::goals);
+
     // Loop over all the filled seats in the game and check all the unfinished goals for each seat.
     // Add any seats with no remaining goals to the winningSeats vector.
     for (Seat* seat : mSeats)
@@ -1184,31 +1154,47 @@ unsigned long int GameMap::doMiscUpkeep(double timeSinceLastTurn)
             ++(tempSeat->mNumCreaturesFighters);
     }
 
-    // At each upkeep, we re-compute tiles with vision
+    mTurnProfiler.startPhase(TurnPhase::visionClear);
     for (Seat* seat : mSeats)
-        seat->clearTilesWithVision();
+        seat->restoreTilesVisionForced();
 
-    for (int jj = 0; jj < getMapSizeY(); ++jj)
-    {
-        for (int ii = 0; ii < getMapSizeX(); ++ii)
-        {
-            getTile(ii,jj)->clearVision();
-        }
-    }
+    mTurnProfiler.startPhase(TurnPhase::visionRecompute);
 
-    // Compute vision. We need to compute every seats including AI because
-    // a human can be allied with an AI and they would share vision
-    for (int jj = 0; jj < getMapSizeY(); ++jj)
+    // Update vision. We need to compute every seats including AI because
+    // a human can be allied with an AI and they would share vision. Only the
+    // creatures and spells that moved or that are near a tile that changed
+    // recompute their visible tiles
+    mVisionManager.beginUpdate();
+
+    // The visible tiles only depend on the map. We check serially which creatures need them, compute
+    // them in parallel and then give the vision serially in the creatures order so that the result is
+    // the same as if each creature computed its visible tiles in turn
+    mCreaturesVisionUpdate.clear();
+    int maxSightRadius = 0;
+    for (Creature* creature : mCreatures)
     {
-        for (int ii = 0; ii < getMapSizeX(); ++ii)
-        {
-            getTile(ii,jj)->computeVisibleTiles();
-        }
+        if(!creature->needVisibleTilesUpdate())
+            continue;
+
+        mCreaturesVisionUpdate.push_back(creature);
+        maxSightRadius = std::max(maxSightRadius, creature->getDefinition()->getSightRadius());
     }
 
-    for (Creature* creature : mCreatures)
+    if(!mCreaturesVisionUpdate.empty())
     {
-        creature->computeVisibleTiles();
+        buildTileDistance(maxSightRadius);
+        if(mThreadPool == nullptr)
+            mThreadPool.reset(new ThreadPool(mNbWorkerThreads));
+
+        mLineOfSightBuffers.resize(mThreadPool->getNbWorkers());
+        mThreadPool->parallelFor(static_cast<uint32_t>(mCreaturesVisionUpdate.size()),
+            [this](uint32_t workerIndex, uint32_t index)
+            {
+                mCreaturesVisionUpdate[index]->updateTilesInSight(mLineOfSightBuffers[workerIndex]);
+            });
+
+        for (Creature* creature : mCreaturesVisionUpdate)
+            creature->commitVisibleTiles();
     }
 
     for (Spell* spell : mSpells)
@@ -1216,6 +1202,8 @@ unsigned long int GameMap::doMiscUpkeep(double timeSinceLastTurn)
         spell->computeVisibleTiles();
     }
 
+    mVisionManager.endUpdate();
+
     for (Seat* seat : mSeats)
     {
         if(!seat->getIsDebuggingVision())
@@ -1225,18 +1213,33 @@ unsigned long int GameMap::doMiscUpkeep(double timeSinceLastTurn)
     }
 
     // We send to each seat the list of tiles he has vision on
+    mTurnProfiler.startPhase(TurnPhase::sendVisibleTiles);
     for (Seat* seat : mSeats)
         seat->sendVisibleTiles();
 
     // Carry out the upkeep round of all the active objects in the game.
     // Here, we work on a copy of the active objects list because they might
     // try to remove themselves which would break the iterator
+    // Each entity draws its random numbers from its own substream so that they do not depend on
+    // the order in which the entities are processed
+    // TODO: only the vision above is computed in parallel. The upkeep itself stays serial until the
+    // creature actions are split into a read-only decide phase (target, job and path searches) and a
+    // commit phase applying the changes in this order. Today, the actions change the tiles, rooms,
+    // seats and entity lists while other creatures read them, and send the server notifications
+    // directly
+    mTurnProfiler.startPhase(TurnPhase::entities);
     std::vector<GameEntity*> activeObjects = mActiveObjects;
     for(GameEntity* ge : activeObjects)
+    {
+        RandomGenerator entityRandom = mRandom.derive(mTurnNumber, ge->getHandle());
+        Random::ScopedThreadGenerator scopedRandom(entityRandom);
+        TurnProfiler::ScopedEntityUpkeep scopedUpkeep(mTurnProfiler, ge->getObjectType());
         ge->doUpkeep();
+    }
 
     // Carry out the upkeep round for each seat. This means recomputing how much gold is
     // available in their treasuries, how much mana they gain/lose during this turn, etc.
+    mTurnProfiler.startPhase(TurnPhase::seats);
     for (Seat* seat : mSeats)
     {
         if(seat->getPlayer() == nullptr)
@@ -1334,11 +1337,11 @@ void GameMap::playerIsFighting(Player* player, Tile* tile)
     }
 }
 
-std::list<Tile*> GameMap::findBestPath(const Creature* creature, Tile* tileStart, const std::vector<Tile*> possibleDests,
+std::vector<Tile*> GameMap::findBestPath(const Creature* creature, Tile* tileStart, const std::vector<Tile*> possibleDests,
     Tile*& chosenTile)
 {
     chosenTile = nullptr;
-    std::list<Tile*> returnList;
+    std::vector<Tile*> returnList;
     if(possibleDests.empty())
         return returnList;
 
@@ -1370,7 +1373,7 @@ std::list<Tile*> GameMap::findBestPath(const Creature* creature, Tile* tileStart
         if(walkableDist < (dist * magic))
             continue;
 
-        std::list<Tile*> pathTmp = path(tileStart, tile, creature, creature->getSeat(), false);
+        std::vector<Tile*> pathTmp = path(tileStart, tile, creature, creature->getSeat(), false);
         if(pathTmp.size() < returnList.size())
         {
             // The path is shorter
@@ -1381,17 +1384,8 @@ std::list<Tile*> GameMap::findBestPath(const Creature* creature, Tile* tileStart
     return returnList;
 }
 
-bool GameMap::pathExists(const Creature* creature, Tile* tileStart, Tile* tileEnd)
+FloodFillType GameMap::getFloodFillType(const Creature* creature)
 {
-    // If floodfill is not enabled, we cannot check if the path exists so we return true
-    if(!mFloodFillEnabled)
-        return true;
-
-    // We check if the tile we are heading to is walkable. We don't do the same for the start tile because it might
-    //not be the case if a creature is on a door tile while it is closed
-    if(creature == nullptr)
-        return false;
-
     FloodFillType floodFill = FloodFillType::ground;
     if((creature->getMoveSpeedGround() > 0.0) &&
         (creature->getMoveSpeedWater() > 0.0) &&
@@ -1410,6 +1404,22 @@ bool GameMap::pathExists(const Creature* creature, Tile* tileStart, Tile* tileEn
         floodFill = FloodFillType::groundLava;
     }
 
+    return floodFill;
+}
+
+bool GameMap::pathExists(const Creature* creature, Tile* tileStart, Tile* tileEnd)
+{
+    // If floodfill is not enabled, we cannot check if the path exists so we return true
+    if(!mFloodFillEnabled)
+        return true;
+
+    // We check if the tile we are heading to is walkable. We don't do the same for the start tile because it might
+    //not be the case if a creature is on a door tile while it is closed
+    if(creature == nullptr)
+        return false;
+
+    FloodFillType floodFill = getFloodFillType(creature);
+
     if(creature->getDefinition()->isWorker())
     {
         // Workers can go on a tile if and only if the path is open for any creature. If it is closed, that
@@ -1432,10 +1442,10 @@ bool GameMap::pathExists(const Creature* creature, Tile* tileStart, Tile* tileEn
     }
 }
 
-std::list<Tile*> GameMap::path(int x1, int y1, int x2, int y2, const Creature* creature, Seat* seat, bool throughDiggableTiles)
+std::vector<Tile*> GameMap::path(int x1, int y1, int x2, int y2, const Creature* creature, Seat* seat, bool throughDiggableTiles)
 {
     ++mNumCallsTo_path;
-    std::list<Tile*> returnList;
+    std::vector<Tile*> returnList;
 
     // If the start tile was not found return an empty path
     Tile* start = getTile(x1, y1);
@@ -1454,37 +1464,28 @@ std::list<Tile*> GameMap::path(int x1, int y1, int x2, int y2, const Creature* c
     if (!throughDiggableTiles && !pathExists(creature, start, destination))
         return returnList;
 
-    AstarEntry *currentEntry = new AstarEntry(start, x1, y1, x2, y2);
-    AstarEntry neighbor;
-
-    std::vector<AstarEntry*> openList;
-    openList.push_back(currentEntry);
+    mPathfindingContext.resize(getMapSizeX(), getMapSizeY());
+    mPathfindingContext.start(mPathfindingContext.toNode(x1, y1), Pathfinding::manhattanDistance(x1, y1, x2, y2));
 
-    // This list will contain the processed and the to process entries
-    // allowing to quickly know if a tile has been processed or not
-    std::vector<std::vector<AstarEntry*>> processList(getMapSizeX(), std::vector<AstarEntry*>(getMapSizeY(), nullptr));
-    processList[currentEntry->getTile()->getX()][currentEntry->getTile()->getY()] = currentEntry;
-    AstarEntry* destinationEntry = nullptr;
+    int32_t destinationNode = PathfindingContext::NO_NODE;
     while (true)
     {
-        // if the openList is empty we failed to find a path
-        if (openList.empty())
+        // if the open list is empty we failed to find a path
+        int32_t currentNode = mPathfindingContext.popBest();
+        if (currentNode == PathfindingContext::NO_NODE)
             break;
 
-        // openList being sorted, the last element is the smallest
-        auto smallestAstar = openList.rbegin();
-        openList.pop_back();
-
-        currentEntry = *smallestAstar;
-        currentEntry->setHasBeenProcessed();
+        Tile* currentTile = getTile(mPathfindingContext.toX(currentNode), mPathfindingContext.toY(currentNode));
 
         // We found the path, break out of the search loop
-        if (currentEntry->getTile() == destination)
+        if (currentTile == destination)
         {
-            destinationEntry = currentEntry;
+            destinationNode = currentNode;
             break;
         }
 
+        int currentX = currentTile->getX();
+        int currentY = currentTile->getY();
         // Check the tiles surrounding the current square
         bool areTilesPassable[4] = {false, false, false, false};
         // Note : to disable diagonals, process tiles from 0 to 3. To allow them, process tiles from 0 to 7
@@ -1495,34 +1496,34 @@ std::list<Tile*> GameMap::path(int x1, int y1, int x2, int y2, const Creature* c
             {
                 // We process the 4 adjacent tiles
                 case 0:
-                    neighborTile = getTile(currentEntry->getTile()->getX() - 1, currentEntry->getTile()->getY());
+                    neighborTile = getTile(currentX - 1, currentY);
                     break;
                 case 1:
-                    neighborTile = getTile(currentEntry->getTile()->getX() + 1, currentEntry->getTile()->getY());
+                    neighborTile = getTile(currentX + 1, currentY);
                     break;
                 case 2:
-                    neighborTile = getTile(currentEntry->getTile()->getX(), currentEntry->getTile()->getY() - 1);
+                    neighborTile = getTile(currentX, currentY - 1);
                     break;
                 case 3:
-                    neighborTile = getTile(currentEntry->getTile()->getX(), currentEntry->getTile()->getY() + 1);
+                    neighborTile = getTile(currentX, currentY + 1);
                     break;
                 // We process the 4 diagonal tiles. We only process a diagonal tile if the 2 tiles adjacent to the original one are
                 // passable.
                 case 4:
                     if(areTilesPassable[0] && areTilesPassable[2])
-                        neighborTile = getTile(currentEntry->getTile()->getX() - 1, currentEntry->getTile()->getY() - 1);
+                        neighborTile = getTile(currentX - 1, currentY - 1);
                     break;
                 case 5:
                     if(areTilesPassable[0] && areTilesPassable[3])
-                        neighborTile = getTile(currentEntry->getTile()->getX() - 1, currentEntry->getTile()->getY() + 1);
+                        neighborTile = getTile(currentX - 1, currentY + 1);
                     break;
                 case 6:
                     if(areTilesPassable[1] && areTilesPassable[2])
-                        neighborTile = getTile(currentEntry->getTile()->getX() + 1, currentEntry->getTile()->getY() - 1);
+                        neighborTile = getTile(currentX + 1, currentY - 1);
                     break;
                 case 7:
                     if(areTilesPassable[1] && areTilesPassable[3])
-                        neighborTile = getTile(currentEntry->getTile()->getX() + 1, currentEntry->getTile()->getY() + 1);
+                        neighborTile = getTile(currentX + 1, currentY + 1);
                     break;
                 default:
                     break;
@@ -1530,121 +1531,65 @@ std::list<Tile*> GameMap::path(int x1, int y1, int x2, int y2, const Creature* c
             if(neighborTile == nullptr)
                 continue;
 
-            neighbor.setTile(neighborTile);
-
             bool processNeighbor = false;
             // We process the tile if the creature can go through. But if it is the first tile that is
             // not passable, we also process it. That happens if a door is closed
-            if((creature->canGoThroughTile(neighbor.getTile())) ||
-               (neighbor.getTile() == start))
+            if((creature->canGoThroughTile(neighborTile)) ||
+               (neighborTile == start))
             {
                 processNeighbor = true;
                 // We set passability for the 4 adjacent tiles only
                 if(i < 4)
                     areTilesPassable[i] = true;
              }
-            else if(throughDiggableTiles && neighbor.getTile()->isDiggable(seat))
+            else if(throughDiggableTiles && neighborTile->isDiggable(seat))
                 processNeighbor = true;
 
             if (!processNeighbor)
                 continue;
 
             // See if the neighbor has already been processed
-            AstarEntry* neighborEntry = processList[neighbor.getTile()->getX()][neighbor.getTile()->getY()];
-            if ((neighborEntry != nullptr) && (neighborEntry->getHasBeenProcessed()))
+            int32_t neighborNode = mPathfindingContext.toNode(neighborTile->getX(), neighborTile->getY());
+            if (mPathfindingContext.isProcessed(neighborNode))
                 continue;
 
-            // If the neighbor is not in the open list
-            if (neighborEntry == nullptr)
-            {
-                double weightToParent = AstarEntry::computeHeuristic(neighbor.getTile()->getX(), neighbor.getTile()->getY(),
-                    currentEntry->getTile()->getX(), currentEntry->getTile()->getY());
+            double weightToParent = Pathfinding::manhattanDistance(neighborTile->getX(), neighborTile->getY(),
+                currentX, currentY);
 
-                if(currentEntry->getTile()->getFullness() == 0)
-                    weightToParent /= creature->getMoveSpeed(currentEntry->getTile());
-                else
-                    weightToParent /= creature->getMoveSpeedGround();
-                neighbor.setG(currentEntry->getG() + weightToParent);
+            if(currentTile->getFullness() == 0)
+                weightToParent /= creature->getMoveSpeed(currentTile);
+            else
+                weightToParent /= creature->getMoveSpeedGround();
 
-                // Use the manhattan distance for the heuristic
-                neighbor.setHeuristic(neighbor.getTile()->getX(), neighbor.getTile()->getY(), x2, y2);
-                neighbor.setParent(currentEntry);
+            double g = mPathfindingContext.getG(currentNode) + weightToParent;
 
-                AstarEntry* entry = new AstarEntry(neighbor);
-                auto itr = openList.begin();
-                while((itr != openList.end()) &&
-                      ((*itr)->fCost() > entry->fCost()))
-                {
-                    ++itr;
-                }
-
-                openList.insert(itr, entry);
-                processList[neighbor.getTile()->getX()][neighbor.getTile()->getY()] = entry;
+            // If the neighbor is not in the open list
+            if (!mPathfindingContext.isVisited(neighborNode))
+            {
+                // Use the manhattan distance for the heuristic
+                mPathfindingContext.open(neighborNode, currentNode, g,
+                    Pathfinding::manhattanDistance(neighborTile->getX(), neighborTile->getY(), x2, y2));
             }
-            else
+            else if (g < mPathfindingContext.getG(neighborNode))
             {
                 // If this path to the given neighbor tile is a shorter path than the
                 // one already given, make this the new parent.
-                double weightToParent = AstarEntry::computeHeuristic(neighbor.getTile()->getX(), neighbor.getTile()->getY(),
-                    currentEntry->getTile()->getX(), currentEntry->getTile()->getY());
-
-                if(currentEntry->getTile()->getFullness() == 0)
-                    weightToParent /= creature->getMoveSpeed(currentEntry->getTile());
-                else
-                    weightToParent /= creature->getMoveSpeedGround();
-
-                if (currentEntry->getG() + weightToParent < neighborEntry->getG())
-                {
-                    neighborEntry->setG(currentEntry->getG() + weightToParent);
-                    neighborEntry->setParent(currentEntry);
-
-                    // The cost changed. We need to re-order openList
-                    auto itr = std::find(openList.begin(), openList.end(), neighborEntry);
-                    if(itr == openList.end())
-                    {
-                        OD_LOG_ERR("Unexpected entry not found tileStart=" + Tile::displayAsString(start)
-                            + ", tileDest=" + Tile::displayAsString(destination)
-                            + ", tile=" + Tile::displayAsString(neighborEntry->getTile()));
-                    }
-                    else
-                    {
-                        itr = openList.erase(itr);
-                        // We look for the new location
-                        while((itr != openList.end()) &&
-                              ((*itr)->fCost() > neighborEntry->fCost()))
-                        {
-                            ++itr;
-                        }
-
-                        openList.insert(itr, neighborEntry);
-                    }
-                }
+                mPathfindingContext.relax(neighborNode, currentNode, g);
             }
         }
     }
 
-    if (destinationEntry != nullptr)
-    {
-        // Follow the parent chain back the the starting tile
-        AstarEntry* curEntry = destinationEntry;
-        do
-        {
-            if (curEntry->getTile() != nullptr)
-            {
-                returnList.push_front(curEntry->getTile());
-                curEntry = curEntry->getParent();
-            }
+    if (destinationNode == PathfindingContext::NO_NODE)
+        return returnList;
 
-        } while (curEntry != nullptr);
-    }
+    // Follow the parent chain back the the starting tile
+    uint32_t nbTiles = 0;
+    for(int32_t node = destinationNode; node != PathfindingContext::NO_NODE; node = mPathfindingContext.getParent(node))
+        ++nbTiles;
 
-    // Clean up the memory we allocated by deleting the astarEntries.  Note that
-    // processList contains all the created entries so it is enough to clean it.
-    for (std::vector<AstarEntry*>& column : processList)
-    {
-        for (AstarEntry* entry : column)
-            delete entry;
-    }
+    returnList.resize(nbTiles);
+    for(int32_t node = destinationNode; node != PathfindingContext::NO_NODE; node = mPathfindingContext.getParent(node))
+        returnList[--nbTiles] = getTile(mPathfindingContext.toX(node), mPathfindingContext.toY(node));
 
     return returnList;
 }
@@ -1705,67 +1650,19 @@ Player* GameMap::getPlayerBySeat(Seat* seat) const
 std::vector<GameEntity*> GameMap::getVisibleForce(const std::vector<Tile*>& visibleTiles, Seat* seat, bool enemyForce)
 {
     std::vector<GameEntity*> returnList;
-
-    // Loop over the visible tiles
-    for (Tile* tile : visibleTiles)
-    {
-        if(tile == nullptr)
-        {
-            OD_LOG_ERR("unexpected null tile");
-            continue;
-        }
-
-        if(enemyForce)
-        {
-            tile->fillWithEntities(returnList, SelectionEntityWanted::creatureAliveEnemyAttackable, seat->getPlayer());
-            Building* building = tile->getCoveringBuilding();
-            if((building != nullptr) &&
-               (!building->getSeat()->isAlliedSeat(seat)) &&
-               (building->isAttackable(tile, seat)) &&
-               (std::find(returnList.begin(), returnList.end(), building) == returnList.end()))
-            {
-                returnList.push_back(building);
-            }
-        }
-        else
-        {
-            tile->fillWithEntities(returnList, SelectionEntityWanted::creatureAliveAllied, seat->getPlayer());
-            Building* building = tile->getCoveringBuilding();
-            if((building != nullptr) &&
-               (building->getSeat()->isAlliedSeat(seat)) &&
-               (std::find(returnList.begin(), returnList.end(), building) == returnList.end()))
-            {
-                returnList.push_back(building);
-            }
-        }
-    }
-
+    getVisibleForce(visibleTiles, seat, enemyForce, returnList);
     return returnList;
 }
 
+void GameMap::getVisibleForce(const std::vector<Tile*>& visibleTiles, Seat* seat, bool enemyForce, std::vector<GameEntity*>& entities)
+{
+    mEntityGrid.getEntities(visibleTiles, seat, enemyForce, true, entities);
+}
+
 std::vector<GameEntity*> GameMap::getVisibleCreatures(const std::vector<Tile*>& visibleTiles, Seat* seat, bool enemyCreatures)
 {
     std::vector<GameEntity*> returnList;
-
-    // Loop over the visible tiles
-    for (Tile* tile : visibleTiles)
-    {
-        if(tile == nullptr)
-        {
-            OD_LOG_ERR("unexpected null tile");
-            continue;
-        }
-
-        if(enemyCreatures)
-        {
-            tile->fillWithEntities(returnList, SelectionEntityWanted::creatureAliveEnemyAttackable, seat->getPlayer());
-        }
-        else
-        {
-            tile->fillWithEntities(returnList, SelectionEntityWanted::creatureAliveAllied, seat->getPlayer());
-        }
-    }
-
+    mEntityGrid.getEntities(visibleTiles, seat, enemyCreatures, false, returnList);
     return returnList;
 }
 
@@ -1812,6 +1709,7 @@ void GameMap::addRoom(Room *r)
     }
 
     mRooms.push_back(r);
+    registerEntity(GameEntityType::room, r);
 }
 
 void GameMap::removeRoom(Room *r)
@@ -1827,6 +1725,7 @@ void GameMap::removeRoom(Room *r)
     }
 
     mRooms.erase(it);
+    unregisterEntity(GameEntityType::room, r);
 }
 
 std::vector<Room*> GameMap::getRoomsByType(RoomType type) const
@@ -1932,24 +1831,12 @@ std::vector<Building*> GameMap::getReachableBuildingsPerSeat(Seat* seat,
 
 Room* GameMap::getRoomByName(const std::string& name)
 {
-    for (Room* room : mRooms)
-    {
-        if(room->getName().compare(name) == 0)
-            return room;
-    }
-
-    return nullptr;
+    return static_cast<Room*>(mEntityRegistry.find(GameEntityType::room, name));
 }
 
 Trap* GameMap::getTrapByName(const std::string& name)
 {
-    for (Trap* trap : mTraps)
-    {
-        if(trap->getName().compare(name) == 0)
-            return trap;
-    }
-
-    return nullptr;
+    return static_cast<Trap*>(mEntityRegistry.find(GameEntityType::trap, name));
 }
 
 void GameMap::clearTraps()
@@ -1972,6 +1859,7 @@ void GameMap::addTrap(Trap *trap)
         + Helper::toString(nbTiles) + ", seatId=" + Helper::toString(trap->getSeat()->getId()));
 
     mTraps.push_back(trap);
+    registerEntity(GameEntityType::trap, trap);
 }
 
 void GameMap::removeTrap(Trap *t)
@@ -1985,6 +1873,7 @@ void GameMap::removeTrap(Trap *t)
     }
 
     mTraps.erase(it);
+    unregisterEntity(GameEntityType::trap, t);
 }
 
 bool GameMap::withdrawFromTreasuries(int gold, Seat* seat)
@@ -2026,6 +1915,7 @@ void GameMap::addMapLight(MapLight *m)
 {
     OD_LOG_INF(serverStr() + "Adding MapLight " + m->getName());
     mMapLights.push_back(m);
+    registerEntity(GameEntityType::mapLight, m);
 }
 
 void GameMap::removeMapLight(MapLight *m)
@@ -2040,17 +1930,12 @@ void GameMap::removeMapLight(MapLight *m)
     }
 
     mMapLights.erase(it);
+    unregisterEntity(GameEntityType::mapLight, m);
 }
 
 MapLight* GameMap::getMapLight(const std::string& name) const
 {
-    for (MapLight* mapLight : mMapLights)
-    {
-        if (mapLight->getName() == name)
-            return mapLight;
-    }
-
-    return nullptr;
+    return static_cast<MapLight*>(mEntityRegistry.find(GameEntityType::mapLight, name));
 }
 
 void GameMap::clearSeats()
@@ -2203,17 +2088,9 @@ bool GameMap::doFloodFill(Seat* seat, Tile* tile)
 
 void GameMap::replaceFloodFill(Seat* seat, FloodFillType floodFillType, uint32_t colorOld, uint32_t colorNew)
 {
-    for (int jj = 0; jj < getMapSizeY(); ++jj)
-    {
-        for (int ii = 0; ii < getMapSizeX(); ++ii)
-        {
-            Tile* tile = getTile(ii,jj);
-            if(tile->getFloodFillValue(seat, floodFillType) != colorOld)
-                continue;
-
-            tile->replaceFloodFill(seat, floodFillType, colorNew);
-        }
-    }
+    // We do not change the tiles colored with colorOld. Both colors are merged and tiles will
+    // get the same representative
+    mFloodFillIndex.merge(seat->getTeamIndex(), colorOld, colorNew);
 }
 
 void GameMap::refreshFloodFill(Seat* seat, Tile* tile)
@@ -2285,12 +2162,15 @@ void GameMap::enableFloodFill()
             getTile(ii,jj)->resetFloodFill();
         }
     }
+    mFloodFillIndex.clear();
 
     // The algorithm used to find a path is efficient when the path exists but not if it doesn't.
     // To improve path finding, we tag the contiguous tiles to know if a path exists between 2 tiles or not.
     // Because creatures can go through ground, water or lava, we process all of theses.
     // Note : when a tile is digged, floodfill will have to be refreshed.
     mFloodFillEnabled = true;
+    mPathfindingHierarchy.clear();
+    mFlowFieldManager.clear();
 
     // To optimize floodfilling, we start by tagging the dirt tiles with fullness = 0
     // because they are walkable for most creatures. When we will have tagged all
@@ -2441,31 +2321,151 @@ void GameMap::enableFloodFill()
     }
 }
 
-std::list<Tile*> GameMap::path(Creature *c1, Creature *c2, const Creature* creature, Seat* seat, bool throughDiggableTiles)
+std::vector<Tile*> GameMap::path(Creature *c1, Creature *c2, const Creature* creature, Seat* seat, bool throughDiggableTiles)
 {
     return path(c1->getPositionTile()->getX(), c1->getPositionTile()->getY(),
                 c2->getPositionTile()->getX(), c2->getPositionTile()->getY(), creature, seat, throughDiggableTiles);
 }
 
-std::list<Tile*> GameMap::path(Tile *t1, Tile *t2, const Creature* creature, Seat* seat, bool throughDiggableTiles)
+std::vector<Tile*> GameMap::path(Tile *t1, Tile *t2, const Creature* creature, Seat* seat, bool throughDiggableTiles)
 {
     return path(t1->getX(), t1->getY(), t2->getX(), t2->getY(), creature, seat, throughDiggableTiles);
 }
 
-std::list<Tile*> GameMap::path(const Creature* creature, Tile* destination, bool throughDiggableTiles)
+std::vector<Tile*> GameMap::path(const Creature* creature, Tile* destination, bool throughDiggableTiles)
 {
     if (destination == nullptr)
-        return std::list<Tile*>();
+        return std::vector<Tile*>();
 
     Tile* positionTile = creature->getPositionTile();
     if (positionTile == nullptr)
-        return std::list<Tile*>();
+        return std::vector<Tile*>();
 
     return path(positionTile->getX(), positionTile->getY(),
                 destination->getX(), destination->getY(),
                 creature, creature->getSeat(), throughDiggableTiles);
 }
 
+std::vector<Tile*> GameMap::pathFirstLeg(const Creature* creature, Tile* destination, bool& isComplete)
+{
+    isComplete = true;
+    if (destination == nullptr)
+        return std::vector<Tile*>();
+
+    Tile* positionTile = creature->getPositionTile();
+    if (positionTile == nullptr)
+        return std::vector<Tile*>();
+
+    // If many creatures are going to the same tile, we use the shared flow field
+    std::vector<Tile*> returnList;
+    if(pathFromFlowField(creature, destination, returnList))
+        return returnList;
+
+    // For long routes, we search the route on the sector graph and only compute the path
+    // up to the first leg tile
+    if (mIsServerGameMap &&
+        mFloodFillEnabled &&
+        (Pathfinding::manhattanDistance(positionTile->getX(), positionTile->getY(),
+            destination->getX(), destination->getY()) >= PathfindingHierarchy::MIN_DISTANCE) &&
+        pathExists(creature, positionTile, destination))
+    {
+        Seat* seat = creature->getSeat();
+        int legX;
+        int legY;
+        mPathfindingHierarchy.resize(getMapSizeX(), getMapSizeY());
+        Tile* legTile = nullptr;
+        if(mPathfindingHierarchy.findFirstLegTile(seat, seat->getTeamIndex(), getFloodFillType(creature),
+            positionTile->getX(), positionTile->getY(), destination->getX(), destination->getY(), legX, legY))
+        {
+            legTile = getTile(legX, legY);
+        }
+        if((legTile != nullptr) && (legTile != destination))
+        {
+            returnList = path(positionTile, legTile, creature, creature->getSeat(), false);
+            if(!returnList.empty())
+            {
+                isComplete = false;
+                return returnList;
+            }
+        }
+    }
+
+    return path(positionTile->getX(), positionTile->getY(),
+                destination->getX(), destination->getY(),
+                creature, creature->getSeat(), false);
+}
+
+bool GameMap::pathFromFlowField(const Creature* creature, Tile* destination, std::vector<Tile*>& result, uint32_t maxLength)
+{
+    if(!mIsServerGameMap || !mFloodFillEnabled || (destination == nullptr))
+        return false;
+
+    Tile* positionTile = creature->getPositionTile();
+    if(positionTile == nullptr)
+        return false;
+
+    if(!pathExists(creature, positionTile, destination))
+        return false;
+
+    return mFlowFieldManager.getPath(creature, getFloodFillType(creature), positionTile,
+        destination, result, maxLength);
+}
+
+void GameMap::tilePassabilityChanged(Tile* tile)
+{
+    mPathfindingHierarchy.invalidateTile(tile->getX(), tile->getY());
+    mFlowFieldManager.tilePassabilityChanged(tile->getX(), tile->getY());
+    tileVisionChanged(tile);
+}
+
+void GameMap::tileVisionChanged(Tile* tile)
+{
+    // Vision is only computed on server side
+    if(!isServerGameMap())
+        return;
+
+    mVisionManager.tileVisionChanged(tile);
+}
+
+void GameMap::tileClaimChanged(Tile* tile)
+{
+    // Vision is only computed on server side
+    if(!isServerGameMap())
+        return;
+
+    mVisionManager.tileClaimChanged(tile);
+}
+
+void GameMap::addCreatureToGrid(Creature* creature, Tile* tile)
+{
+    mEntityGrid.addCreature(creature, tile);
+}
+
+void GameMap::removeCreatureFromGrid(Creature* creature, Tile* tile)
+{
+    mEntityGrid.removeCreature(creature, tile);
+}
+
+void GameMap::addBuildingTileToGrid(Tile* tile)
+{
+    mEntityGrid.addBuildingTile(tile);
+}
+
+void GameMap::removeBuildingTileFromGrid(Tile* tile)
+{
+    mEntityGrid.removeBuildingTile(tile);
+}
+
+bool GameMap::needVisionUpdate(const GameEntity* source, Seat* seat, Tile* positionTile, uint32_t radius)
+{
+    return mVisionManager.needSourceUpdate(source, seat, positionTile, radius);
+}
+
+void GameMap::setVisionTiles(const GameEntity* source, const std::vector<Tile*>& tiles)
+{
+    mVisionManager.setSourceTiles(source, tiles);
+}
+
 void GameMap::processDeletionQueues()
 {
     for(GameEntity* entity : mEntitiesToDelete)
@@ -2668,6 +2668,60 @@ std::string GameMap::nextUniqueNameMapLight()
     return ret;
 }
 
+void GameMap::registerEntity(GameEntityType type, GameEntity* entity)
+{
+    uint32_t id = mEntityRegistry.add(type, entity->getName(), entity);
+
+    // On server side, the registry id is used as the handle sent to the clients. On client side, we
+    // keep the handle received from the server
+    if(isServerGameMap())
+    {
+        entity->setHandle(id);
+        return;
+    }
+
+    uint32_t handle = entity->getHandle();
+    if(handle == GameEntity::NO_HANDLE)
+        return;
+
+    if(handle >= mEntitiesByHandle.size())
+        mEntitiesByHandle.resize(handle + 1, nullptr);
+
+    mEntitiesByHandle[handle] = entity;
+}
+
+void GameMap::unregisterEntity(GameEntityType type, GameEntity* entity)
+{
+    mEntityRegistry.remove(type, entity->getName(), entity);
+
+    if(isServerGameMap())
+        return;
+
+    uint32_t handle = entity->getHandle();
+    if((handle < mEntitiesByHandle.size()) && (mEntitiesByHandle[handle] == entity))
+        mEntitiesByHandle[handle] = nullptr;
+}
+
+uint32_t GameMap::getFloodFillValue(int x, int y, Seat* seat, FloodFillType type) const
+{
+    Tile* tile = getTile(x, y);
+    if(tile == nullptr)
+        return Tile::NO_FLOODFILL;
+
+    return tile->getFloodFillValue(seat, type);
+}
+
+GameEntity* GameMap::getEntityFromHandle(uint32_t handle) const
+{
+    if(isServerGameMap())
+        return mEntityRegistry.getEntity(handle);
+
+    if(handle >= mEntitiesByHandle.size())
+        return nullptr;
+
+    return mEntitiesByHandle[handle];
+}
+
 GameEntity* GameMap::getEntityFromTypeAndName(GameEntityType entityType,
     const std::string& entityName)
 {
@@ -2686,7 +2740,7 @@ GameEntity* GameMap::getEntityFromTypeAndName(GameEntityType entityType,
         case GameEntityType::treasuryObject:
         case GameEntityType::skillEntity:
         case GameEntityType::giftBoxEntity:
-            return getRenderedMovableEntity(entityName);
+            return mEntityRegistry.find(entityType, entityName);
 
         case GameEntityType::spell:
             return getSpell(entityName);
@@ -2826,11 +2880,62 @@ void GameMap::fireRefreshEntities()
     }
 }
 
+//! \brief Adds the given value to a FNV-1a checksum
+static void hashChecksumValue(uint64_t& checksum, int64_t value)
+{
+    for(uint32_t i = 0; i < sizeof(value); ++i)
+    {
+        checksum ^= static_cast<uint64_t>(value >> (i * 8)) & 0xFF;
+        checksum *= 1099511628211ULL;
+    }
+}
+
+uint64_t GameMap::computeStateChecksum() const
+{
+    // Floating point values are rounded so that the checksum only depends on the game state
+    // and not on the last bits of the computations
+    uint64_t checksum = 14695981039346656037ULL;
+    hashChecksumValue(checksum, mTurnNumber);
+
+    for(Seat* seat : mSeats)
+    {
+        hashChecksumValue(checksum, seat->getId());
+        hashChecksumValue(checksum, seat->getGold());
+        hashChecksumValue(checksum, static_cast<int64_t>(std::round(seat->getMana())));
+        hashChecksumValue(checksum, seat->getNumClaimedTiles());
+    }
+
+    for(int xx = 0; xx < getMapSizeX(); ++xx)
+    {
+        for(int yy = 0; yy < getMapSizeY(); ++yy)
+        {
+            Tile* tile = getTile(xx, yy);
+            hashChecksumValue(checksum, static_cast<int64_t>(tile->getType()));
+            hashChecksumValue(checksum, static_cast<int64_t>(std::round(tile->getFullness())));
+            hashChecksumValue(checksum, (tile->getSeat() == nullptr) ? -1 : tile->getSeat()->getId());
+        }
+    }
+
+    for(Creature* creature : mCreatures)
+    {
+        const Ogre::Vector3& position = creature->getPosition();
+        hashChecksumValue(checksum, creature->getHandle());
+        hashChecksumValue(checksum, static_cast<int64_t>(std::round(position.x * 100.0)));
+        hashChecksumValue(checksum, static_cast<int64_t>(std::round(position.y * 100.0)));
+        hashChecksumValue(checksum, static_cast<int64_t>(std::round(creature->getHP())));
+    }
+
+    hashChecksumValue(checksum, static_cast<int64_t>(mRooms.size()));
+    hashChecksumValue(checksum, static_cast<int64_t>(mTraps.size()));
+    return checksum;
+}
+
 void GameMap::addSpell(Spell *spell)
 {
     OD_LOG_INF(serverStr() + "Adding spell " + spell->getName()
         + ",MeshName=" + spell->getMeshName());
     mSpells.push_back(spell);
+    registerEntity(GameEntityType::spell, spell);
 }
 
 void GameMap::removeSpell(Spell *spell)
@@ -2845,16 +2950,12 @@ void GameMap::removeSpell(Spell *spell)
     }
 
     mSpells.erase(it);
+    unregisterEntity(GameEntityType::spell, spell);
 }
 
 Spell* GameMap::getSpell(const std::string& name) const
 {
-    for(Spell* spell : mSpells)
-    {
-        if(name.compare(spell->getName()) == 0)
-            return spell;
-    }
-    return nullptr;
+    return static_cast<Spell*>(mEntityRegistry.find(GameEntityType::spell, name));
 }
 
 void GameMap::clearSpells()
@@ -3058,6 +3159,8 @@ void GameMap::clientUpKeep(int64_t turnNumber)
 
 void GameMap::doorLock(Tile* tileDoor, Seat* seat, bool locked)
 {
+    tilePassabilityChanged(tileDoor);
+
     if(!locked)
     {
         // When a door is unlocked, we check all its neighboors to find a floodfill value for each possible
@@ -18,7 +18,17 @@
 #ifndef GAMEMAP_H
 #define GAMEMAP_H
 
+#include "gamemap/EntityGrid.h"
+#include "gamemap/EntityRegistry.h"
+#include "gamemap/FloodFillIndex.h"
+#include "gamemap/FlowFieldManager.h"
+#include "gamemap/PathfindingContext.h"
+#include "gamemap/PathfindingHierarchy.h"
 #include "gamemap/TileContainer.h"
+#include "gamemap/TurnProfiler.h"
+#include "gamemap/VisionManager.h"
+#include "utils/RandomGenerator.h"
+#include "utils/ThreadPool.h"
 
 #include "ai/AIManager.h"
 
@@ -94,7 +104,7 @@ enum class SelectionEntityWanted
  * sortest path between two tiles" or "what creatures are in some particular
  * tile".
  */
-class GameMap : public TileContainer
+class GameMap : public TileContainer, private PathfindingHierarchy::FloodFillSource
 {
 
 friend class RenderManager;
@@ -203,14 +213,14 @@ public:
     //! \brief Returns the total number of class descriptions stored in this game map.
     unsigned int numClassDescriptions();
 
-    void saveLevelClassDescriptions(std::ofstream& levelFile);
+    void saveLevelClassDescriptions(std::ostream& levelFile);
 
     void addWeapon(const Weapon* weapon);
     const Weapon* getWeapon(int index);
     const Weapon* getWeapon(const std::string& name);
     Weapon* getWeaponForTuning(const std::string& name);
     uint32_t numWeapons();
-    void saveLevelEquipments(std::ofstream& levelFile);
+    void saveLevelEquipments(std::ostream& levelFile);
 
     //! \brief Calls the deleteYourself() method on each of the rooms in the game map as well as clearing the vector of stored rooms.
     void clearRooms();
@@ -343,17 +353,20 @@ public:
 
     void doPlayerAITurn(double timeSinceLastTurn);
 
+    //! \brief Returns the floodfill type matching the tiles the given creature can walk on.
+    static FloodFillType getFloodFillType(const Creature* creature);
+
     //! \brief Tells whether a path exists between two tiles for the given creature.
     bool pathExists(const Creature* creature, Tile* tileStart, Tile* tileEnd);
 
     /*! \brief Calculates the walkable path between tileStart and one of the possibleDests. This function
      * will choose the closest tile in possibleDests and return the path between tileStart and it.
      * If a path is found, it is returned and chosenTile is set to the chosen tile. If no path is found,
-     * an empty list will be returned and chosenTile will be set to nullptr
+     * an empty vector will be returned and chosenTile will be set to nullptr
      * Note that this function will use some magic numbers to avoid computing paths that are likely to be
      * further
      */
-    std::list<Tile*> findBestPath(const Creature* creature, Tile* tileStart, const std::vector<Tile*> possibleDests,
+    std::vector<Tile*> findBestPath(const Creature* creature, Tile* tileStart, const std::vector<Tile*> possibleDests,
         Tile*& chosenTile);
 
     /*! \brief Calculates the walkable path between tiles (x1, y1) and (x2, y2).
@@ -367,18 +380,60 @@ public:
      * if the creature can go through the 4 tiles.
      * \param seat The seat is used when searching a diggable path to know
      * what tile actually diggable for the given team.
+     * The search itself does not allocate memory: it reuses mPathfindingContext.
      */
-    std::list<Tile*> path(int x1, int y1, int x2, int y2, const Creature* creature, Seat* seat, bool throughDiggableTiles = false);
-    std::list<Tile*> path(Creature *c1, Creature *c2, const Creature* creature, Seat* seat, bool throughDiggableTiles = false);
-    std::list<Tile*> path(Tile *t1, Tile *t2, const Creature* creature, Seat* seat, bool throughDiggableTiles = false);
+    std::vector<Tile*> path(int x1, int y1, int x2, int y2, const Creature* creature, Seat* seat, bool throughDiggableTiles = false);
+    std::vector<Tile*> path(Creature *c1, Creature *c2, const Creature* creature, Seat* seat, bool throughDiggableTiles = false);
+    std::vector<Tile*> path(Tile *t1, Tile *t2, const Creature* creature, Seat* seat, bool throughDiggableTiles = false);
     //! \note Returns a path for the given creature to the given destination.
-    std::list<Tile*> path(const Creature* creature, Tile* destination, bool throughDiggableTiles = false);
+    std::vector<Tile*> path(const Creature* creature, Tile* destination, bool throughDiggableTiles = false);
+
+    /*! \brief Returns a path for the given creature towards the given destination. If the destination is far
+     * away, the route is searched on the sector graph and only the path to the first leg is computed. In this
+     * case, isComplete is set to false and the next leg should be asked when the creature reaches the end of the path.
+     */
+    std::vector<Tile*> pathFirstLeg(const Creature* creature, Tile* destination, bool& isComplete);
+
+    /*! \brief Reads the path for the given creature to the given destination from the shared flow fields.
+     * Flow fields are only built for destinations many creatures are walking to. If maxLength is not 0,
+     * the path is cut after maxLength tiles.
+     * \returns true if the path could be read. Otherwise, path should be used
+     */
+    bool pathFromFlowField(const Creature* creature, Tile* destination, std::vector<Tile*>& result, uint32_t maxLength = 0);
+
+    //! \brief Should be called when creatures may not be able to go through the given tile the way they could
+    //! before (digging, claiming, doors, bridges)
+    void tilePassabilityChanged(Tile* tile);
+
+    //! \brief Should be called when the given tile may start or stop blocking vision. The vision
+    //! sources around will be recomputed during next turn
+    void tileVisionChanged(Tile* tile);
+
+    //! \brief Should be called when the given tile may have been claimed or lost (seat or claimed percentage
+    //! changed). The vision it gives will be updated during next turn
+    void tileClaimChanged(Tile* tile);
+
+    /*! \brief Used during the vision update by the vision sources (creatures, spells) on the server GameMap. Returns
+     * true if the tiles the source gives vision on should be recomputed and given with setVisionTiles
+     */
+    bool needVisionUpdate(const GameEntity* source, Seat* seat, Tile* positionTile, uint32_t radius);
+    void setVisionTiles(const GameEntity* source, const std::vector<Tile*>& tiles);
+
+    //! \brief Called by the tiles to keep the entity grid up to date when a creature enters/leaves them or
+    //! when a building starts/stops covering them
+    void addCreatureToGrid(Creature* creature, Tile* tile);
+    void removeCreatureFromGrid(Creature* creature, Tile* tile);
+    void addBuildingTileToGrid(Tile* tile);
+    void removeBuildingTileFromGrid(Tile* tile);
 
-    //! \brief Loops over the visibleTiles and returns any creature/room/trap in those tiles allied with the given seat
+    //! \brief Returns any creature/room/trap in the visibleTiles allied with the given seat
     //! (or if enemyForce is true, is not allied)
     std::vector<GameEntity*> getVisibleForce(const std::vector<Tile*>& visibleTiles, Seat* seat, bool enemyForce);
 
-    //! \brief Loops over the visibleTiles and returns any creature in those tiles allied with the given seat.
+    //! \brief Same as above but fills the given vector (cleared before)
+    void getVisibleForce(const std::vector<Tile*>& visibleTiles, Seat* seat, bool enemyForce, std::vector<GameEntity*>& entities);
+
+    //! \brief Returns any creature in the visibleTiles allied with the given seat.
     //! (or if enemyCreatures is true, is not allied)
     std::vector<GameEntity*> getVisibleCreatures(const std::vector<Tile*>& visibleTiles, Seat* seat, bool enemyCreatures);
 
@@ -390,6 +445,7 @@ public:
     //! already know that no path exists.
     bool doFloodFill(Seat* seat, Tile* tile);
     void refreshFloodFill(Seat* seat, Tile* tile);
+    //! \brief Connects the areas colored with colorOld and colorNew for the given seat
     void replaceFloodFill(Seat* seat, FloodFillType floodFillType, uint32_t colorOld, uint32_t colorNew);
 
     //! \brief Temporarily disables the flood fill computations on this game map.
@@ -428,6 +484,28 @@ public:
     inline bool isServerGameMap() const
     { return mIsServerGameMap; }
 
+    //! \brief Restarts the random numbers of this game map from the given seed. 2 games started with the
+    //! same seed and receiving the same orders give the same result
+    inline void setRandomSeed(uint64_t seed)
+    { mRandom.setSeed(seed); }
+
+    //! \brief Generator the Random functions should use while this game map is processed
+    inline RandomGenerator& getRandom()
+    { return mRandom; }
+
+    //! \brief Measures the phases of the server turns
+    inline TurnProfiler& getTurnProfiler()
+    { return mTurnProfiler; }
+
+    //! \brief Sets how many threads are used (in addition to the calling one) to process the turn in parallel.
+    //! By default, every core is used. Should be called before the first turn
+    inline void setNbWorkerThreads(uint32_t nbWorkerThreads)
+    { mNbWorkerThreads = nbWorkerThreads; }
+
+    //! \brief Computes a checksum of the game state (seats resources, tiles, creatures positions and HP, ...).
+    //! Two simulations of the same game should give the same checksum at each turn
+    uint64_t computeStateChecksum() const;
+
     inline bool getGamePaused() const
     { return mIsPaused; }
 
@@ -467,13 +545,21 @@ public:
     inline uint32_t nextUniqueFloodFillValue()
     { return ++mUniqueFloodFillValue; }
 
+    //! \brief Returns the representative of the given floodfill color for the given team. Two tiles
+    //! are connected if their colors have the same representative
+    inline uint32_t getFloodFillRepresentative(uint32_t teamIndex, uint32_t color) const
+    { return mFloodFillIndex.find(teamIndex, color); }
+
     void addRenderedMovableEntity(RenderedMovableEntity *obj);
     void removeRenderedMovableEntity(RenderedMovableEntity *obj);
-    RenderedMovableEntity* getRenderedMovableEntity(const std::string& name);
+    RenderedMovableEntity* getRenderedMovableEntity(const std::string& name) const;
     void clearRenderedMovableEntities();
     GameEntity* getEntityFromTypeAndName(GameEntityType entityType,
         const std::string& entityName);
 
+    //! \brief Returns the entity with the given handle (see GameEntity::getHandle). nullptr if there is none
+    GameEntity* getEntityFromHandle(uint32_t handle) const;
+
     //! brief Functions to add/remove/get Spells
     inline const std::vector<Spell*>& getSpells() const
     { return mSpells; }
@@ -553,6 +639,11 @@ private:
     //! \brief The current server turn number.
     int64_t mTurnNumber;
 
+    //! \brief Random numbers of this game map. The active objects use a substream derived from it
+    RandomGenerator mRandom;
+
+    TurnProfiler mTurnProfiler;
+
     //! \brief Unique numbers to ensure names are unique
     int mUniqueNumberCreature;
     int mUniqueNumberMissileObj;
@@ -562,6 +653,9 @@ private:
     int mUniqueNumberMapLight;
     uint32_t mUniqueFloodFillValue;
 
+    //! \brief Connected floodfill colors
+    FloodFillIndex mFloodFillIndex;
+
     //! \brief When paused, the GameMap is not updated.
     bool mIsPaused;
 
@@ -588,6 +682,12 @@ private:
     //Mutable to allow locking in const functions.
     std::vector<MovableGameEntity*> mAnimatedObjects;
 
+    //! \brief Creatures, rooms, traps, spells, map lights and rendered movable entities indexed by type and name
+    EntityRegistry mEntityRegistry;
+
+    //! \brief On client side, entities indexed by the handle given by the server
+    std::vector<GameEntity*> mEntitiesByHandle;
+
     //! \brief Map Entities
     std::vector<Room*> mRooms;
     std::vector<Trap*> mTraps;
@@ -618,6 +718,34 @@ private:
     //! \brief Debug member used to know how many call to pathfinding has been made within the same turn.
     unsigned int mNumCallsTo_path;
 
+    //! \brief Nodes and open list reused by each call to path
+    PathfindingContext mPathfindingContext;
+
+    //! \brief Sector graph used to split long routes in legs
+    PathfindingHierarchy mPathfindingHierarchy;
+
+    //! \brief Distance maps shared by the creatures walking to the same tile
+    FlowFieldManager mFlowFieldManager;
+
+    //! \brief Tiles each seat has vision on
+    VisionManager mVisionManager;
+
+    //! \brief Creatures and buildings bucketed by area and seat
+    EntityGrid mEntityGrid;
+
+    //! \brief Number of threads mThreadPool will create
+    uint32_t mNbWorkerThreads;
+
+    //! \brief Workers used to process in parallel the parts of the turn that only read the map. Created on
+    //! server side when first needed
+    std::unique_ptr<ThreadPool> mThreadPool;
+
+    //! \brief Line of sight buffers for each worker of mThreadPool
+    std::vector<LineOfSight::Buffers> mLineOfSightBuffers;
+
+    //! \brief Creatures whose visible tiles are recomputed during the current turn
+    std::vector<Creature*> mCreaturesVisionUpdate;
+
     std::vector<RenderedMovableEntity*> mRenderedMovableEntities;
 
     std::vector<Spell*> mSpells;
@@ -637,6 +765,13 @@ private:
 
     //! \brief Resets the unique numbers
     void resetUniqueNumbers();
+
+    //! \brief Adds/removes the entity to/from mEntityRegistry and gives/forgets its handle
+    void registerEntity(GameEntityType type, GameEntity* entity);
+    void unregisterEntity(GameEntityType type, GameEntity* entity);
+
+    //! \brief Floodfill values used by mPathfindingHierarchy
+    uint32_t getFloodFillValue(int x, int y, Seat* seat, FloodFillType type) const override;
 };
 
 #endif // GAMEMAP_H
@@ -0,0 +1,34 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/LevelSnapshot.h"
+
+void LevelSnapshot::writeToStream(std::ostream& os) const
+{
+    os << mBeforeTiles;
+    // Same format as Tile::exportToStream. The tile type is written as an unsigned integer like operator<<(TileType)
+    for(const CompiledLevel::TileRecord& record : mTiles)
+    {
+        os << record.mX << "\t" << record.mY << "\t";
+        os << static_cast<uint32_t>(record.mType) << "\t" << record.mFullness;
+        if(record.mSeatId != -1)
+            os << "\t" << record.mSeatId;
+
+        os << "\n";
+    }
+    os << mAfterTiles;
+}
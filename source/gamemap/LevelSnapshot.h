@@ -0,0 +1,46 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LEVELSNAPSHOT_H
+#define LEVELSNAPSHOT_H
+
+#include "gamemap/CompiledLevel.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*! \brief State of a game map as it would be written to a level file.
+ *
+ * Taking a snapshot formats the entities (there are few of them) and only copies the tile values, which are
+ * most of the level. The snapshot does not reference the game map so it can be written from another thread
+ * while the game goes on.
+ */
+struct LevelSnapshot
+{
+    //! \brief The level text before the tile lines
+    std::string mBeforeTiles;
+    //! \brief The saved tiles. They are formatted like Tile::exportToStream when written
+    std::vector<CompiledLevel::TileRecord> mTiles;
+    //! \brief The level text after the tile lines
+    std::string mAfterTiles;
+
+    //! \brief Writes the level text. Gives the same bytes as if the tiles were exported by Tile::exportToStream
+    void writeToStream(std::ostream& os) const;
+};
+
+#endif // LEVELSNAPSHOT_H
@@ -0,0 +1,244 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/LineOfSight.h"
+
+static bool sortByDistSquared(const LineOfSight::Cell& cell1, const LineOfSight::Cell& cell2)
+{
+    return cell1.mDistSquared < cell2.mDistSquared;
+}
+
+static void addHiddenCell(std::vector<LineOfSight::HiddenCell>& hiddenCells, uint32_t index, double value)
+{
+    LineOfSight::HiddenCell hiddenCell = { index, value };
+    hiddenCells.push_back(hiddenCell);
+}
+
+//! \brief Computes how much the given cell hides the cell with the given index when it blocks vision
+static void computeHiddenCell(const LineOfSight::Cell& hidingCell, double coefNorth, double coefSouth,
+    const LineOfSight::Cell& cell, uint32_t index, std::vector<LineOfSight::HiddenCell>& hiddenNorth,
+    std::vector<LineOfSight::HiddenCell>& hiddenSouth)
+{
+    // A cell can only hide cells behind (x > cell.x and y > cell.y)
+    if(cell.mDiffX < hidingCell.mDiffX)
+        return;
+    if(cell.mDiffY < hidingCell.mDiffY)
+        return;
+
+    // We don't want a cell to hide itself
+    if((cell.mDiffX == hidingCell.mDiffX) &&
+       (cell.mDiffY == hidingCell.mDiffY))
+    {
+        return;
+    }
+
+    double xTileDeb = static_cast<double>(cell.mDiffX) - 0.5;
+    double xTileEnd = xTileDeb + 1.0;
+    double yTileDeb = static_cast<double>(cell.mDiffY) - 0.5;
+    double yTileEnd = yTileDeb + 1.0;
+
+    if(hidingCell.mType == LineOfSight::CellType::horizontal)
+    {
+        // For horizontal cells, we hide following cells (x > cell.x). But we process
+        // north cells normally
+        if(cell.mType == LineOfSight::CellType::horizontal)
+        {
+            addHiddenCell(hiddenSouth, index, 1.0);
+            return;
+        }
+
+        double yHideDebNorth = coefNorth * xTileDeb;
+        double yHideEndNorth = coefNorth * xTileEnd;
+
+        // If the cell is over the North ray, it is not hidden
+        if(yHideEndNorth <= yTileDeb)
+            return;
+
+        // We check which part of the cell is hidden
+        if((yHideDebNorth >= yTileDeb) &&
+           (yHideEndNorth <= yTileEnd))
+        {
+            // The ray hits the left side of the cell and the right side.
+            // The south part is partially hidden
+            double hiddenArea = (yHideEndNorth - yHideDebNorth) / 2.0;
+            hiddenArea += yHideDebNorth - yTileDeb;
+            addHiddenCell(hiddenSouth, index, hiddenArea);
+        }
+        else if((yHideDebNorth < yTileDeb) &&
+                (yHideEndNorth > yTileDeb))
+        {
+            // The ray hits the bottom side of the cell but hits the right side. We compute
+            // the south visible part
+            double xHit = yTileDeb / coefNorth;
+            double hiddenArea = (yHideEndNorth - yTileDeb) * (xTileEnd - xHit) / 2.0;
+            addHiddenCell(hiddenSouth, index, hiddenArea);
+        }
+        else if((yHideDebNorth < yTileEnd) &&
+                (yHideEndNorth > yTileEnd))
+        {
+            // The ray hits the left side of the cell but is over the right side. We compute
+            // the hidden part on north.
+            double xHit = yTileEnd / coefNorth;
+            double visibleArea = (yTileEnd - yHideDebNorth) * (xHit - xTileDeb) / 2.0;
+            addHiddenCell(hiddenSouth, index, 1.0 - visibleArea);
+        }
+        else
+        {
+            // The entire cell is hidden
+            addHiddenCell(hiddenSouth, index, 1.0);
+        }
+
+        return;
+    }
+
+    // We check if the current cell is hidden by the cell. To consider that the
+    // cell is hidden by the south, as we know the angle will be between 0 and 45 degrees,
+    // we consider that the cell has to be hit by the ray passing through the hiding cell
+    // on the left side of the cell (otherwise, the hidden part will be too small).
+    double yHideDebSouth = coefSouth * xTileDeb;
+    double yHideEndSouth = coefSouth * xTileEnd;
+    double yHideDebNorth = coefNorth * xTileDeb;
+    double yHideEndNorth = coefNorth * xTileEnd;
+    // We check if at least a part of the cell is hidden
+    if((yHideDebSouth >= yTileEnd) ||
+       (yHideEndNorth <= yTileDeb))
+    {
+        return;
+    }
+
+    // At least a part of this cell is hidden
+    if((yHideDebSouth >= yTileDeb) &&
+       (yHideEndSouth <= yTileEnd))
+    {
+        // The ray hits the left side of the cell and the right side.
+        // The south part is partially hidden
+        // The visible part is composed from a square between the cell inferior part and
+        // the triangle made by the ray
+        double visibleArea = (yHideEndSouth - yHideDebSouth) / 2.0;
+        visibleArea += yHideDebSouth - yTileDeb;
+        addHiddenCell(hiddenNorth, index, 1.0 - visibleArea);
+    }
+    else if((yHideDebSouth < yTileDeb) &&
+            (yHideEndSouth > yTileDeb))
+    {
+        // The ray hits the bottom side of the cell but hits the right side. We compute
+        // the south visible part
+        double xHit = yTileDeb / coefSouth;
+        double visibleArea = (yHideEndSouth - yTileDeb) * (xTileEnd - xHit) / 2.0;
+        addHiddenCell(hiddenNorth, index, 1.0 - visibleArea);
+    }
+    else if((yHideDebSouth < yTileEnd) &&
+            (yHideEndSouth > yTileEnd))
+    {
+        // The ray hits the left side of the cell but is over the right side. We compute
+        // the hidden part on north.
+        double xHit = yTileEnd / coefSouth;
+        double hiddenArea = (yTileEnd - yHideDebSouth) * (xHit - xTileDeb) / 2.0;
+        addHiddenCell(hiddenNorth, index, hiddenArea);
+    }
+    else if((yHideDebNorth >= yTileDeb) &&
+       (yHideEndNorth <= yTileEnd))
+    {
+        double hiddenArea = (yHideEndNorth - yHideDebNorth) / 2.0;
+        hiddenArea += yHideDebNorth - yTileDeb;
+        addHiddenCell(hiddenSouth, index, hiddenArea);
+    }
+    else if((yHideDebNorth < yTileDeb) &&
+            (yHideEndNorth > yTileDeb))
+    {
+        // The ray hits the bottom side of the cell but hits the right side. We compute
+        // the south visible part
+        double xHit = yTileDeb / coefNorth;
+        double hiddenArea = (yHideEndNorth - yTileDeb) * (xTileEnd - xHit) / 2.0;
+        addHiddenCell(hiddenSouth, index, hiddenArea);
+    }
+    else if((yHideDebNorth < yTileEnd) &&
+            (yHideEndNorth > yTileEnd))
+    {
+        // The ray hits the left side of the cell but is over the right side. We compute
+        // the hidden part on north.
+        double xHit = yTileEnd / coefNorth;
+        double visibleArea = (yTileEnd - yHideDebNorth) * (xHit - xTileDeb) / 2.0;
+        addHiddenCell(hiddenSouth, index, 1.0 - visibleArea);
+    }
+    else
+    {
+        // The entire cell is hidden
+        addHiddenCell(hiddenSouth, index, 1.0);
+    }
+}
+
+LineOfSight::LineOfSight() :
+    mRadiusComputed(-1)
+{
+}
+
+void LineOfSight::build(int radius)
+{
+    if(mRadiusComputed >= radius)
+        return;
+
+    // We compute the cells of the first octant and sort them by distance. The cells
+    // of the other octants will be deduced by symmetry
+    mCells.clear();
+    for(int y = 0; y <= radius; ++y)
+    {
+        for(int x = y; x <= radius; ++x)
+        {
+            CellType type;
+            if(y == 0)
+                type = CellType::horizontal;
+            else if(x == y)
+                type = CellType::diagonal;
+            else
+                type = CellType::other;
+
+            Cell cell = { x, y, type, x * x + y * y, 0, 0, 0, 0 };
+            mCells.push_back(cell);
+        }
+    }
+
+    std::sort(mCells.begin(), mCells.end(), sortByDistSquared);
+
+    // Now, we compute how each cell hides the other ones when it blocks vision
+    mHiddenCells.clear();
+    std::vector<HiddenCell> hiddenNorth;
+    std::vector<HiddenCell> hiddenSouth;
+    for(Cell& hidingCell : mCells)
+    {
+        hiddenNorth.clear();
+        hiddenSouth.clear();
+
+        // We don't process the center
+        if((hidingCell.mDiffX != 0) || (hidingCell.mDiffY != 0))
+        {
+            double coefNorth = (static_cast<double>(hidingCell.mDiffY) + 0.5) / (static_cast<double>(hidingCell.mDiffX) - 0.5);
+            double coefSouth = (static_cast<double>(hidingCell.mDiffY) - 0.5) / (static_cast<double>(hidingCell.mDiffX) + 0.5);
+            for(uint32_t index = 0; index < mCells.size(); ++index)
+                computeHiddenCell(hidingCell, coefNorth, coefSouth, mCells[index], index, hiddenNorth, hiddenSouth);
+        }
+
+        hidingCell.mNorthBegin = static_cast<uint32_t>(mHiddenCells.size());
+        mHiddenCells.insert(mHiddenCells.end(), hiddenNorth.begin(), hiddenNorth.end());
+        hidingCell.mNorthEnd = static_cast<uint32_t>(mHiddenCells.size());
+        hidingCell.mSouthBegin = hidingCell.mNorthEnd;
+        mHiddenCells.insert(mHiddenCells.end(), hiddenSouth.begin(), hiddenSouth.end());
+        hidingCell.mSouthEnd = static_cast<uint32_t>(mHiddenCells.size());
+    }
+
+    mRadiusComputed = radius;
+}
@@ -0,0 +1,233 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LINEOFSIGHT_H
+#define LINEOFSIGHT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/*! \brief Computes the cells visible from a cell within a given radius.
+ *
+ * The cells around the center are split in 8 octants that are the same up to a symmetry. For the
+ * first octant (0 <= diffY <= diffX), we precompute once the cells sorted by distance and, for each
+ * of them, how much of the cells behind it is hidden when it blocks vision (on the north and on the
+ * south side of the ray). A cell is visible if less than half of it is hidden.
+ *
+ * Computing the visible cells then only needs to look up the precomputed table. The scratch buffers
+ * are kept between calls so that no memory is allocated once the biggest radius has been used.
+ * To compute from several threads, each thread should use its own Buffers once the table is built.
+ */
+class LineOfSight
+{
+public:
+    enum class CellState
+    {
+        outside,
+        transparent,
+        opaque
+    };
+
+    enum class CellType
+    {
+        horizontal,
+        diagonal,
+        other
+    };
+
+    struct HiddenCell
+    {
+        //! \brief Index of the hidden cell in the table
+        uint32_t mIndex;
+        //! \brief Part of the cell hidden (between 0 and 1)
+        double mValue;
+    };
+
+    struct Cell
+    {
+        int mDiffX;
+        int mDiffY;
+        CellType mType;
+        int mDistSquared;
+        //! \brief Cells hidden by this one in mHiddenCells: [mNorthBegin, mNorthEnd[ and [mSouthBegin, mSouthEnd[.
+        //! They are sorted by index
+        uint32_t mNorthBegin;
+        uint32_t mNorthEnd;
+        uint32_t mSouthBegin;
+        uint32_t mSouthEnd;
+    };
+
+    LineOfSight();
+
+    //! \brief Precomputes the table up to the given radius. Does nothing if it is already computed
+    void build(int radius);
+
+    //! \brief Cells of the first octant sorted by distance
+    inline const std::vector<Cell>& getCells() const
+    { return mCells; }
+
+    inline const std::vector<HiddenCell>& getHiddenCells() const
+    { return mHiddenCells; }
+
+    //! \brief Returns the offset of the cell with the given index in the given octant (from 0 to 7)
+    inline static void getOctantOffset(const Cell& cell, uint32_t octant, int& diffX, int& diffY)
+    {
+        switch(octant)
+        {
+            case 0: diffX = cell.mDiffX;  diffY = cell.mDiffY;  break;
+            case 1: diffX = cell.mDiffY;  diffY = -cell.mDiffX; break;
+            case 2: diffX = -cell.mDiffX; diffY = -cell.mDiffY; break;
+            case 3: diffX = -cell.mDiffY; diffY = cell.mDiffX;  break;
+            case 4: diffX = cell.mDiffY;  diffY = cell.mDiffX;  break;
+            case 5: diffX = cell.mDiffX;  diffY = -cell.mDiffY; break;
+            case 6: diffX = -cell.mDiffY; diffY = -cell.mDiffX; break;
+            case 7:
+            default: diffX = -cell.mDiffX; diffY = cell.mDiffY; break;
+        }
+    }
+
+    //! \brief Scratch buffers used by compute (indexed by octant * nbCells + cell index)
+    struct Buffers
+    {
+        std::vector<CellState> mStates;
+        std::vector<double> mHiddenNorth;
+        std::vector<double> mHiddenSouth;
+    };
+
+    /*! \brief Computes the cells visible from the center within radius.
+     * cellState(diffX, diffY) should return the CellState of the cell at the given offset from the center.
+     * visible(diffX, diffY) is called for each visible cell, from the closest to the furthest. Cells outside
+     * the map are never visible and do not block vision.
+     */
+    template<typename CellStateFunc, typename VisibleFunc>
+    void compute(int radius, CellStateFunc cellState, VisibleFunc visible)
+    {
+        build(radius);
+        compute(radius, mBuffers, cellState, visible);
+    }
+
+    /*! \brief Same as above with the given scratch buffers. The table should have been built up to radius. As
+     * this version does not modify the table, it can be called from several threads with different buffers
+     */
+    template<typename CellStateFunc, typename VisibleFunc>
+    void compute(int radius, Buffers& buffers, CellStateFunc cellState, VisibleFunc visible) const
+    {
+        if((radius < 0) || (radius > mRadiusComputed))
+            return;
+
+        // The cells are sorted by distance. We only use the ones within radius
+        int radiusSquared = radius * radius;
+        uint32_t nbCells = 0;
+        while((nbCells < mCells.size()) && (mCells[nbCells].mDistSquared <= radiusSquared))
+            ++nbCells;
+
+        std::vector<CellState>& states = buffers.mStates;
+        std::vector<double>& hiddenNorthValues = buffers.mHiddenNorth;
+        std::vector<double>& hiddenSouthValues = buffers.mHiddenSouth;
+        uint32_t size = nbCells * 8;
+        if(states.size() < size)
+        {
+            states.resize(size);
+            hiddenNorthValues.resize(size);
+            hiddenSouthValues.resize(size);
+        }
+        std::fill(hiddenNorthValues.begin(), hiddenNorthValues.begin() + size, 0.0);
+        std::fill(hiddenSouthValues.begin(), hiddenSouthValues.begin() + size, 0.0);
+
+        // We read the state of every cell and apply the hiding of the opaque ones
+        for(uint32_t octant = 0; octant < 8; ++octant)
+        {
+            uint32_t offset = octant * nbCells;
+            for(uint32_t i = 0; i < nbCells; ++i)
+            {
+                int diffX;
+                int diffY;
+                getOctantOffset(mCells[i], octant, diffX, diffY);
+                CellState state = cellState(diffX, diffY);
+                states[offset + i] = state;
+                if(state != CellState::opaque)
+                    continue;
+
+                const Cell& cell = mCells[i];
+                for(uint32_t h = cell.mNorthBegin; h < cell.mNorthEnd; ++h)
+                {
+                    const HiddenCell& hidden = mHiddenCells[h];
+                    if(hidden.mIndex >= nbCells)
+                        break;
+
+                    double& value = hiddenNorthValues[offset + hidden.mIndex];
+                    value = std::max(value, hidden.mValue);
+                }
+                for(uint32_t h = cell.mSouthBegin; h < cell.mSouthEnd; ++h)
+                {
+                    const HiddenCell& hidden = mHiddenCells[h];
+                    if(hidden.mIndex >= nbCells)
+                        break;
+
+                    double& value = hiddenSouthValues[offset + hidden.mIndex];
+                    value = std::max(value, hidden.mValue);
+                }
+            }
+        }
+
+        // Horizontal cells are common to 2 octants. We only process them in the 4 first ones. Diagonal
+        // cells are also common to 2 octants (k and k + 4) but with the north and south sides swapped
+        for(uint32_t i = 0; i < nbCells; ++i)
+        {
+            const Cell& cell = mCells[i];
+            uint32_t nbOctants = (cell.mType == CellType::other ? 8 : 4);
+            if(cell.mDistSquared == 0)
+                nbOctants = 1;
+
+            for(uint32_t octant = 0; octant < nbOctants; ++octant)
+            {
+                uint32_t index = octant * nbCells + i;
+                if(states[index] == CellState::outside)
+                    continue;
+
+                double hiddenNorth = hiddenNorthValues[index];
+                double hiddenSouth = hiddenSouthValues[index];
+                if(cell.mType == CellType::diagonal)
+                {
+                    uint32_t index2 = (octant + 4) * nbCells + i;
+                    hiddenNorth = std::max(hiddenNorth, hiddenSouthValues[index2]);
+                    hiddenSouth = std::max(hiddenSouth, hiddenNorthValues[index2]);
+                }
+
+                if(hiddenNorth + hiddenSouth > 0.5)
+                    continue;
+
+                int diffX;
+                int diffY;
+                getOctantOffset(cell, octant, diffX, diffY);
+                visible(diffX, diffY);
+            }
+        }
+    }
+
+private:
+    int mRadiusComputed;
+
+    std::vector<Cell> mCells;
+    std::vector<HiddenCell> mHiddenCells;
+
+    //! \brief Buffers used by compute when none are given
+    Buffers mBuffers;
+};
+
+#endif // LINEOFSIGHT_H
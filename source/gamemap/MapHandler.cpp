@@ -18,6 +18,7 @@
 #include "gamemap/MapHandler.h"
 
 #include "creaturemood/CreatureMoodManager.h"
+#include "gamemap/CompiledLevel.h"
 #include "gamemap/GameMap.h"
 #include "game/Seat.h"
 #include "goals/Goal.h"
@@ -55,10 +56,13 @@ namespace MapHandler {
 
 bool readGameMapFromFile(const std::string& fileName, GameMap& gameMap)
 {
-    std::stringstream levelFile;
-    if(!Helper::readFileWithoutComments(fileName, levelFile))
+    // The compiled level gives the level text without the tiles and the tile values ready to be used
+    CompiledLevel compiledLevel;
+    if(!compiledLevel.load(fileName, ResourceManager::getSingleton().getLevelCachePath()))
         return false;
 
+    std::stringstream levelFile(std::string(compiledLevel.getText(), compiledLevel.getTextSize()));
+
     std::string nextParam;
     // Read in the version number from the level file
     levelFile >> nextParam;
@@ -214,6 +218,20 @@ bool readGameMapFromFile(const std::string& fileName, GameMap& gameMap)
     // Read in the map tiles from disk
     gameMap.disableFloodFill();
 
+    const CompiledLevel::TileRecord* tileRecords = compiledLevel.getTiles();
+    for(uint32_t i = 0; i < compiledLevel.getNbTiles(); ++i)
+    {
+        const CompiledLevel::TileRecord& record = tileRecords[i];
+        Tile* tile = new Tile(&gameMap, true);
+
+        Tile::loadFromValues(tile, record.mX, record.mY, static_cast<TileType>(record.mType),
+            record.mFullness, record.mSeatId);
+        tile->computeTileVisual();
+
+        gameMap.addTile(tile);
+    }
+
+    // The tiles that could not be compiled (if any) are still in the text
     while (true)
     {
         if(!levelFile.good())
@@ -552,13 +570,17 @@ bool readGameEntity(GameMap& gameMap, const std::string& item, GameEntityType ty
 
 bool writeGameMapToFile(const std::string& fileName, GameMap& gameMap)
 {
-    std::ofstream levelFile(fileName.c_str(), std::ifstream::out);
+    LevelSnapshot snapshot;
+    takeLevelSnapshot(gameMap, snapshot);
+    return writeLevelSnapshotToFile(fileName, snapshot);
+}
 
-    // This is better than checking for .bad(), as it checks every error flags.
-    if (!levelFile.good()) {
-        OD_LOG_WRN("Couldn't open file for writing: " + fileName);
-        return false;
-    }
+void takeLevelSnapshot(GameMap& gameMap, LevelSnapshot& snapshot)
+{
+    snapshot.mTiles.clear();
+
+    // The sections before the tiles
+    std::stringstream levelFile;
 
     // Write the identifier string and the version number
     levelFile << ODApplication::VERSIONSTRING
@@ -624,10 +646,20 @@ bool writeGameMapToFile(const std::string& fileName, GameMap& gameMap)
             if (!tile->isClaimed() && tile->getType() == TileType::dirt && tile->getFullness() >= 100.0)
                 continue;
 
-            Tile::exportToStream(tile, levelFile);
-            levelFile << std::endl;
+            // The tiles are only formatted when the snapshot is written
+            CompiledLevel::TileRecord record;
+            record.mX = tile->getX();
+            record.mY = tile->getY();
+            record.mType = static_cast<int32_t>(tile->getType());
+            record.mSeatId = (tile->getSeat() != nullptr) ? tile->getSeat()->getId() : -1;
+            record.mFullness = tile->getFullness();
+            snapshot.mTiles.push_back(record);
         }
     }
+    snapshot.mBeforeTiles = levelFile.str();
+
+    // The sections after the tiles
+    levelFile.str("");
     levelFile << "[/Tiles]" << std::endl;
 
     std::vector<Room*> rooms = gameMap.getRooms();
@@ -778,6 +810,20 @@ bool writeGameMapToFile(const std::string& fileName, GameMap& gameMap)
         levelFile << std::endl;
     }
     levelFile << "[/Chickens]" << std::endl;
+    snapshot.mAfterTiles = levelFile.str();
+}
+
+bool writeLevelSnapshotToFile(const std::string& fileName, const LevelSnapshot& snapshot)
+{
+    std::ofstream levelFile(fileName.c_str(), std::ifstream::out);
+
+    // This is better than checking for .bad(), as it checks every error flags.
+    if (!levelFile.good()) {
+        OD_LOG_WRN("Couldn't open file for writing: " + fileName);
+        return false;
+    }
+
+    snapshot.writeToStream(levelFile);
 
     if (!levelFile.good()) {
         OD_LOG_WRN("Unexpected failure on file: " + fileName);
@@ -19,6 +19,8 @@
 #ifndef MAPHANDLER_H
 #define MAPHANDLER_H
 
+#include "gamemap/LevelSnapshot.h"
+
 #include <string>
 
 class GameMap;
@@ -44,6 +46,13 @@ namespace MapHandler
 
     bool writeGameMapToFile(const std::string& fileName, GameMap& gameMap);
 
+    //! \brief Captures the state of the given game map. Should be called from the thread processing the map,
+    //! between 2 turns
+    void takeLevelSnapshot(GameMap& gameMap, LevelSnapshot& snapshot);
+
+    //! \brief Writes the given snapshot as a level file. Can be called from any thread
+    bool writeLevelSnapshotToFile(const std::string& fileName, const LevelSnapshot& snapshot);
+
     bool readGameEntity(GameMap& gameMap, const std::string& item, GameEntityType type, std::stringstream& levelFile);
 
     bool loadEquipments(const std::string& fileName, GameMap& gameMap);
@@ -42,6 +42,13 @@ namespace Pathfinding
     {
         return squaredDistance(ent1.getX(), ent2.getX(), ent1.getY(), ent2.getY());
     }
+
+    //! \brief Returns the manhattan distance between the 2 given positions. Used as
+    //! A* heuristic and cost between 2 neighbor tiles
+    inline double manhattanDistance(int x1, int y1, int x2, int y2)
+    {
+        return std::fabs(static_cast<double>(x2 - x1)) + std::fabs(static_cast<double>(y2 - y1));
+    }
 }
 
 #endif // PATHFINDING_H
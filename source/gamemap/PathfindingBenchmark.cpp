@@ -0,0 +1,408 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/PathfindingBenchmark.h"
+
+#include "entities/Creature.h"
+#include "entities/CreatureDefinition.h"
+#include "entities/Tile.h"
+#include "game/Seat.h"
+#include "gamemap/GameMap.h"
+#include "gamemap/Pathfinding.h"
+#include "utils/ConfigManager.h"
+#include "utils/Helper.h"
+#include "utils/LogManager.h"
+#include "utils/RandomGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+const uint32_t PathfindingBenchmark::NB_QUERIES_PER_LEVEL = 2000;
+
+static const std::string GOLDEN_HEADER = "# OpenDungeons pathfinding golden queries";
+
+//! \brief Should be bigger than the last level cache of the CPU
+static const uint32_t CACHE_FLUSH_SIZE = 32 * 1024 * 1024;
+
+//! \brief Number of mismatches logged. The others are only counted
+static const uint32_t NB_MISMATCHES_LOGGED = 10;
+
+//! \brief Adds the given value to a FNV-1a hash
+static void hashValue(uint64_t& hash, int64_t value)
+{
+    for(uint32_t i = 0; i < sizeof(value); ++i)
+    {
+        hash ^= static_cast<uint64_t>(value >> (i * 8)) & 0xFF;
+        hash *= 1099511628211ULL;
+    }
+}
+
+PathfindingBenchmark::PathfindingBenchmark(uint64_t seed) :
+    mSeed(seed),
+    mNbMismatches(0)
+{
+}
+
+PathfindingBenchmark::~PathfindingBenchmark()
+{
+}
+
+bool PathfindingBenchmark::loadGolden(const std::string& fileName)
+{
+    std::ifstream file(fileName.c_str(), std::ios_base::in);
+    if(!file.is_open())
+        return false;
+
+    std::string line;
+    if(!std::getline(file, line) || (line != GOLDEN_HEADER))
+    {
+        OD_LOG_ERR("Not a pathfinding golden file: " + fileName);
+        return false;
+    }
+
+    mGolden.clear();
+    while(std::getline(file, line))
+    {
+        if(line.empty() || (line[0] == '#'))
+            continue;
+
+        std::stringstream ss(line);
+        std::string levelName;
+        std::string kindName;
+        GoldenEntry entry;
+        Query& query = entry.mQuery;
+        QueryResult& result = entry.mResult;
+        if(!(ss >> levelName >> kindName >> query.mCreatureDefinition >> query.mSeatId >> query.mCreatureLevel
+            >> query.mStartX >> query.mStartY >> query.mGoalX >> query.mGoalY >> query.mThroughDiggableTiles
+            >> result.mFound >> result.mNbTiles >> result.mCost >> result.mTilesHash))
+        {
+            OD_LOG_ERR("Invalid query in pathfinding golden file " + fileName + ": " + line);
+            mGolden.clear();
+            return false;
+        }
+
+        query.mKind = PathQueryKind::nbKinds;
+        for(uint32_t kind = 0; kind < static_cast<uint32_t>(PathQueryKind::nbKinds); ++kind)
+        {
+            if(kindName == getKindName(static_cast<PathQueryKind>(kind)))
+                query.mKind = static_cast<PathQueryKind>(kind);
+        }
+        if(query.mKind == PathQueryKind::nbKinds)
+        {
+            OD_LOG_ERR("Invalid query kind in pathfinding golden file " + fileName + ": " + line);
+            mGolden.clear();
+            return false;
+        }
+
+        mGolden[levelName].push_back(entry);
+    }
+
+    return true;
+}
+
+bool PathfindingBenchmark::saveGolden(const std::string& fileName) const
+{
+    std::ofstream file(fileName.c_str(), std::ios_base::out | std::ios_base::trunc);
+    if(!file.is_open())
+    {
+        OD_LOG_ERR("Could not write pathfinding golden file " + fileName);
+        return false;
+    }
+
+    // The costs are saved with every digit so that they can be compared after being read
+    file.precision(17);
+    file << GOLDEN_HEADER << std::endl;
+    file << "# level kind creatureDefinition seatId creatureLevel startX startY goalX goalY throughDiggableTiles"
+        << " found nbTiles cost tilesHash" << std::endl;
+    for(const std::pair<const std::string, std::vector<GoldenEntry>>& level : mRecorded)
+    {
+        for(const GoldenEntry& entry : level.second)
+        {
+            const Query& query = entry.mQuery;
+            const QueryResult& result = entry.mResult;
+            file << level.first << " " << getKindName(query.mKind) << " " << query.mCreatureDefinition
+                << " " << query.mSeatId << " " << query.mCreatureLevel
+                << " " << query.mStartX << " " << query.mStartY << " " << query.mGoalX << " " << query.mGoalY
+                << " " << query.mThroughDiggableTiles << " " << result.mFound << " " << result.mNbTiles
+                << " " << result.mCost << " " << result.mTilesHash << std::endl;
+        }
+    }
+
+    return true;
+}
+
+void PathfindingBenchmark::runLevel(const std::string& levelName, GameMap& gameMap)
+{
+    std::vector<Query> queries;
+    const std::vector<GoldenEntry>* golden = nullptr;
+    if(hasGolden())
+    {
+        auto itGolden = mGolden.find(levelName);
+        if(itGolden == mGolden.end())
+        {
+            OD_LOG_ERR("The pathfinding golden file does not have the queries of level " + levelName);
+            ++mNbMismatches;
+            return;
+        }
+
+        golden = &itGolden->second;
+        for(const GoldenEntry& entry : *golden)
+            queries.push_back(entry.mQuery);
+    }
+    else
+    {
+        drawQueries(levelName, gameMap, queries);
+        if(queries.empty())
+        {
+            OD_LOG_WRN("No creature to draw pathfinding queries from on level " + levelName);
+            return;
+        }
+    }
+
+    mLevelTimes.push_back(LevelTimes());
+    LevelTimes& times = mLevelTimes.back();
+    times.mLevelName = levelName;
+    std::vector<GoldenEntry>& recorded = mRecorded[levelName];
+    recorded.clear();
+    mProbeCreatures.clear();
+    for(uint32_t index = 0; index < queries.size(); ++index)
+    {
+        const Query& query = queries[index];
+        const Creature* creature = getProbeCreature(gameMap, query);
+        Tile* start = gameMap.getTile(query.mStartX, query.mStartY);
+        Tile* goal = gameMap.getTile(query.mGoalX, query.mGoalY);
+        if((creature == nullptr) || (start == nullptr) || (goal == nullptr))
+        {
+            OD_LOG_ERR("Pathfinding query " + Helper::toString(index) + " does not match level " + levelName);
+            ++mNbMismatches;
+            continue;
+        }
+
+        uint32_t kind = static_cast<uint32_t>(query.mKind);
+
+        // The cold query runs after the caches were flushed. The warm one runs the same query again just after
+        flushCaches();
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        QueryResult result = runQuery(gameMap, creature, query);
+        std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+        times.mColdUs[kind].push_back(std::chrono::duration<double, std::micro>(endTime - startTime).count());
+
+        startTime = std::chrono::steady_clock::now();
+        runQuery(gameMap, creature, query);
+        endTime = std::chrono::steady_clock::now();
+        times.mWarmUs[kind].push_back(std::chrono::duration<double, std::micro>(endTime - startTime).count());
+
+        if((golden != nullptr) && !isSameResult(result, (*golden)[index].mResult))
+        {
+            ++mNbMismatches;
+            if(mNbMismatches <= NB_MISMATCHES_LOGGED)
+                logMismatch(levelName, index, query, result, (*golden)[index].mResult);
+        }
+
+        GoldenEntry entry;
+        entry.mQuery = query;
+        entry.mResult = result;
+        recorded.push_back(entry);
+    }
+
+    // The probe creatures are bound to the map of this level
+    mProbeCreatures.clear();
+}
+
+void PathfindingBenchmark::drawQueries(const std::string& levelName, GameMap& gameMap, std::vector<Query>& queries) const
+{
+    std::vector<Creature*> creatures;
+    for(Creature* creature : gameMap.getCreatures())
+    {
+        if(!creature->isAlive() || (creature->getPositionTile() == nullptr) || (creature->getSeat() == nullptr))
+            continue;
+
+        creatures.push_back(creature);
+    }
+
+    std::vector<Tile*> floorTiles;
+    std::vector<Tile*> wallTiles;
+    for(int xx = 0; xx < gameMap.getMapSizeX(); ++xx)
+    {
+        for(int yy = 0; yy < gameMap.getMapSizeY(); ++yy)
+        {
+            Tile* tile = gameMap.getTile(xx, yy);
+            if(tile->getFullness() == 0.0)
+                floorTiles.push_back(tile);
+            else
+                wallTiles.push_back(tile);
+        }
+    }
+
+    if(creatures.empty() || floorTiles.empty() || wallTiles.empty())
+        return;
+
+    // Each level has its own stream so that its queries do not depend on the other levels
+    uint64_t levelHash = 14695981039346656037ULL;
+    for(char c : levelName)
+        hashValue(levelHash, c);
+    RandomGenerator random = RandomGenerator(mSeed).derive(0, levelHash);
+
+    queries.reserve(NB_QUERIES_PER_LEVEL);
+    for(uint32_t i = 0; i < NB_QUERIES_PER_LEVEL; ++i)
+    {
+        const Creature* creature = creatures[random.next() % creatures.size()];
+        Tile* start = creature->getPositionTile();
+        Tile* goal;
+        Query query;
+        query.mCreatureDefinition = creature->getDefinition()->getClassName();
+        query.mSeatId = creature->getSeat()->getId();
+        query.mCreatureLevel = creature->getLevel();
+        uint64_t kind = random.next() % 4;
+        if((kind == 0) && creature->getDefinition()->isWorker())
+        {
+            // Like BaseAI::digWayToTile, the search goes from the tile to reach to the worker
+            query.mKind = PathQueryKind::dig;
+            goal = start;
+            start = wallTiles[random.next() % wallTiles.size()];
+        }
+        else
+        {
+            query.mKind = (kind == 1) ? PathQueryKind::exists : PathQueryKind::walk;
+            goal = floorTiles[random.next() % floorTiles.size()];
+        }
+        query.mThroughDiggableTiles = (query.mKind == PathQueryKind::dig);
+        query.mStartX = start->getX();
+        query.mStartY = start->getY();
+        query.mGoalX = goal->getX();
+        query.mGoalY = goal->getY();
+        queries.push_back(query);
+    }
+}
+
+const Creature* PathfindingBenchmark::getProbeCreature(GameMap& gameMap, const Query& query)
+{
+    for(const std::unique_ptr<Creature>& creature : mProbeCreatures)
+    {
+        if((creature->getDefinition()->getClassName() == query.mCreatureDefinition) &&
+           (creature->getSeat()->getId() == query.mSeatId) &&
+           (creature->getLevel() == query.mCreatureLevel))
+        {
+            return creature.get();
+        }
+    }
+
+    const CreatureDefinition* definition = ConfigManager::getSingleton().getCreatureDefinition(query.mCreatureDefinition);
+    Seat* seat = gameMap.getSeatById(query.mSeatId);
+    if((definition == nullptr) || (seat == nullptr))
+        return nullptr;
+
+    // The creature is not added to the map. Only its move speeds and its seat are used by the pathfinding
+    Creature* creature = new Creature(&gameMap, definition, seat);
+    if(query.mCreatureLevel > 1)
+        creature->setLevel(query.mCreatureLevel);
+
+    mProbeCreatures.emplace_back(creature);
+    return creature;
+}
+
+PathfindingBenchmark::QueryResult PathfindingBenchmark::runQuery(GameMap& gameMap, const Creature* creature,
+    const Query& query) const
+{
+    QueryResult result;
+    result.mNbTiles = 0;
+    result.mCost = 0.0;
+    result.mTilesHash = 14695981039346656037ULL;
+
+    Tile* start = gameMap.getTile(query.mStartX, query.mStartY);
+    Tile* goal = gameMap.getTile(query.mGoalX, query.mGoalY);
+    if(query.mKind == PathQueryKind::exists)
+    {
+        result.mFound = gameMap.pathExists(creature, start, goal);
+        return result;
+    }
+
+    std::vector<Tile*> path = gameMap.path(start, goal, creature, creature->getSeat(), query.mThroughDiggableTiles);
+    result.mFound = !path.empty();
+    result.mNbTiles = static_cast<uint32_t>(path.size());
+
+    // The cost is computed like GameMap::path does
+    Tile* previous = nullptr;
+    for(Tile* tile : path)
+    {
+        hashValue(result.mTilesHash, tile->getX());
+        hashValue(result.mTilesHash, tile->getY());
+        if(previous != nullptr)
+        {
+            double weight = Pathfinding::manhattanDistance(tile->getX(), tile->getY(), previous->getX(), previous->getY());
+            if(previous->getFullness() == 0)
+                weight /= creature->getMoveSpeed(previous);
+            else
+                weight /= creature->getMoveSpeedGround();
+
+            result.mCost += weight;
+        }
+        previous = tile;
+    }
+
+    return result;
+}
+
+void PathfindingBenchmark::flushCaches()
+{
+    if(mCacheFlushBuffer.empty())
+        mCacheFlushBuffer.resize(CACHE_FLUSH_SIZE);
+
+    // Writing one byte per cache line is enough to evict it
+    for(uint32_t i = 0; i < CACHE_FLUSH_SIZE; i += 64)
+        ++mCacheFlushBuffer[i];
+}
+
+bool PathfindingBenchmark::isSameResult(const QueryResult& result, const QueryResult& golden) const
+{
+    // The costs may only differ by rounding errors if the additions are done in another order
+    double costTolerance = 1e-9 * std::max(1.0, std::fabs(golden.mCost));
+    return (result.mFound == golden.mFound) &&
+        (result.mNbTiles == golden.mNbTiles) &&
+        (std::fabs(result.mCost - golden.mCost) <= costTolerance) &&
+        (result.mTilesHash == golden.mTilesHash);
+}
+
+void PathfindingBenchmark::logMismatch(const std::string& levelName, uint32_t index, const Query& query,
+    const QueryResult& result, const QueryResult& expected) const
+{
+    OD_LOG_ERR("Pathfinding query " + Helper::toString(index) + " of level " + levelName + " ("
+        + getKindName(query.mKind) + " " + query.mCreatureDefinition + " seatId=" + Helper::toString(query.mSeatId)
+        + " from " + Helper::toString(query.mStartX) + "," + Helper::toString(query.mStartY)
+        + " to " + Helper::toString(query.mGoalX) + "," + Helper::toString(query.mGoalY)
+        + ") gives found=" + (result.mFound ? "true" : "false") + ", nbTiles=" + Helper::toString(result.mNbTiles)
+        + ", cost=" + Helper::toString(result.mCost) + " instead of found=" + (expected.mFound ? "true" : "false")
+        + ", nbTiles=" + Helper::toString(expected.mNbTiles) + ", cost=" + Helper::toString(expected.mCost));
+}
+
+const char* PathfindingBenchmark::getKindName(PathQueryKind kind)
+{
+    switch(kind)
+    {
+        case PathQueryKind::walk:
+            return "walk";
+        case PathQueryKind::dig:
+            return "dig";
+        case PathQueryKind::exists:
+            return "exists";
+        default:
+            return "unknown";
+    }
+}
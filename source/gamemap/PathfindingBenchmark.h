@@ -0,0 +1,160 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATHFINDINGBENCHMARK_H
+#define PATHFINDINGBENCHMARK_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Creature;
+class GameMap;
+class Tile;
+
+//! \brief Kinds of pathfinding queries measured by the benchmark
+enum class PathQueryKind
+{
+    //! \brief GameMap::path through the tiles the creature can go through
+    walk,
+    //! \brief GameMap::path through diggable tiles, like BaseAI::digWayToTile does
+    dig,
+    //! \brief GameMap::pathExists
+    exists,
+    nbKinds
+};
+
+/*! \brief Checks and times GameMap::path and GameMap::pathExists on a fixed corpus of queries.
+ *
+ * The queries are run on the levels as loaded, before any turn is played, so that the map does not depend on the
+ * pathfinder being checked. Each query is fully described by the golden file: the kind, the creature definition,
+ * seat and level giving the tiles the creature can go through, the start and goal tiles and whether the path can go
+ * through diggable tiles. When a golden file is loaded, its queries are replayed and their results (path found,
+ * length, cost and tiles hash) are compared with the recorded ones. Otherwise, the queries are drawn from the
+ * creatures of the level: a creature goes from its tile to a random floor tile, and workers also search a way to a
+ * random wall through diggable tiles (like the AI does when it wants to reach gold).
+ * Each query is timed cold (with the CPU caches flushed before) and warm (after the same query was just done).
+ */
+class PathfindingBenchmark
+{
+public:
+    //! \brief Durations of the queries of a level, in microseconds, indexed by PathQueryKind
+    struct LevelTimes
+    {
+        std::string mLevelName;
+        std::array<std::vector<double>, static_cast<uint32_t>(PathQueryKind::nbKinds)> mColdUs;
+        std::array<std::vector<double>, static_cast<uint32_t>(PathQueryKind::nbKinds)> mWarmUs;
+    };
+
+    //! \brief Number of queries drawn on each level when there is no golden file
+    static const uint32_t NB_QUERIES_PER_LEVEL;
+
+    //! \brief The queries are drawn with the given seed when there is no golden file
+    explicit PathfindingBenchmark(uint64_t seed);
+    ~PathfindingBenchmark();
+
+    inline uint64_t getSeed() const
+    { return mSeed; }
+
+    /*! \brief Loads the queries and results recorded in the given golden file. The queries of the next levels will
+     * be the recorded ones and their results will be compared with them. Returns false if the file cannot be read
+     */
+    bool loadGolden(const std::string& fileName);
+
+    inline bool hasGolden() const
+    { return !mGolden.empty(); }
+
+    //! \brief Saves the queries and results of the levels run in the given golden file
+    bool saveGolden(const std::string& fileName) const;
+
+    //! \brief Runs the queries of the given level on the given map, checks their results and times them
+    void runLevel(const std::string& levelName, GameMap& gameMap);
+
+    //! \brief Number of queries whose result differs from the golden file
+    inline uint32_t getNbMismatches() const
+    { return mNbMismatches; }
+
+    inline const std::vector<LevelTimes>& getLevelTimes() const
+    { return mLevelTimes; }
+
+    static const char* getKindName(PathQueryKind kind);
+
+private:
+    //! \brief Everything needed to run a query again on the level
+    struct Query
+    {
+        PathQueryKind mKind;
+        //! \brief The tiles the creature can go through depend on its definition, its seat and its level
+        std::string mCreatureDefinition;
+        int mSeatId;
+        unsigned int mCreatureLevel;
+        int mStartX;
+        int mStartY;
+        int mGoalX;
+        int mGoalY;
+        bool mThroughDiggableTiles;
+    };
+
+    //! \brief What is checked for each query
+    struct QueryResult
+    {
+        //! \brief For path queries, true if a path was found. For exists queries, the returned value
+        bool mFound;
+        uint32_t mNbTiles;
+        double mCost;
+        uint64_t mTilesHash;
+    };
+
+    struct GoldenEntry
+    {
+        Query mQuery;
+        QueryResult mResult;
+    };
+
+    uint64_t mSeed;
+    uint32_t mNbMismatches;
+    //! \brief Queries and results of each level, in the order of the queries
+    std::map<std::string, std::vector<GoldenEntry>> mGolden;
+    std::map<std::string, std::vector<GoldenEntry>> mRecorded;
+    std::vector<LevelTimes> mLevelTimes;
+
+    //! \brief Creatures that are not on the map, built for the queries of the current level
+    std::vector<std::unique_ptr<Creature>> mProbeCreatures;
+
+    //! \brief Used to evict the CPU caches before the cold queries
+    std::vector<uint8_t> mCacheFlushBuffer;
+
+    void drawQueries(const std::string& levelName, GameMap& gameMap, std::vector<Query>& queries) const;
+
+    //! \brief Returns a creature going through the tiles like the query one, or nullptr if the query
+    //! does not match the level
+    const Creature* getProbeCreature(GameMap& gameMap, const Query& query);
+
+    QueryResult runQuery(GameMap& gameMap, const Creature* creature, const Query& query) const;
+
+    void flushCaches();
+
+    bool isSameResult(const QueryResult& result, const QueryResult& golden) const;
+
+    void logMismatch(const std::string& levelName, uint32_t index, const Query& query,
+        const QueryResult& result, const QueryResult& expected) const;
+};
+
+#endif // PATHFINDINGBENCHMARK_H
@@ -0,0 +1,148 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/PathfindingContext.h"
+
+PathfindingContext::PathfindingContext() :
+    mSizeX(0),
+    mSizeY(0),
+    mGeneration(0),
+    mSequence(0)
+{
+}
+
+void PathfindingContext::resize(int sizeX, int sizeY)
+{
+    if((sizeX == mSizeX) && (sizeY == mSizeY))
+        return;
+
+    mSizeX = sizeX;
+    mSizeY = sizeY;
+    mGeneration = 0;
+    Node node = { 0, NO_NODE, NO_NODE, 0, 0.0, 0.0, 0.0 };
+    mNodes.assign(static_cast<uint32_t>(sizeX * sizeY), node);
+    mOpenList.clear();
+    mOpenList.reserve(static_cast<uint32_t>(sizeX * sizeY));
+}
+
+void PathfindingContext::start(int32_t node, double h)
+{
+    ++mGeneration;
+    // If the generation wraps, we cannot know anymore which nodes are stale so we reset them
+    if(mGeneration == 0)
+    {
+        for(Node& n : mNodes)
+            n.mGeneration = 0;
+
+        mGeneration = 1;
+    }
+
+    mSequence = 0;
+    mOpenList.clear();
+    open(node, NO_NODE, 0.0, h);
+}
+
+int32_t PathfindingContext::popBest()
+{
+    if(mOpenList.empty())
+        return NO_NODE;
+
+    int32_t best = mOpenList.front();
+    int32_t last = mOpenList.back();
+    mOpenList.pop_back();
+    if(!mOpenList.empty())
+    {
+        mOpenList.front() = last;
+        mNodes[last].mHeapIndex = 0;
+        siftDown(0);
+    }
+
+    mNodes[best].mHeapIndex = NO_NODE;
+    return best;
+}
+
+void PathfindingContext::open(int32_t node, int32_t parent, double g, double h)
+{
+    Node& n = mNodes[node];
+    n.mGeneration = mGeneration;
+    n.mParent = parent;
+    n.mG = g;
+    n.mH = h;
+    n.mF = g + h;
+    n.mSequence = mSequence++;
+    n.mHeapIndex = static_cast<int32_t>(mOpenList.size());
+    mOpenList.push_back(node);
+    siftUp(n.mHeapIndex);
+}
+
+void PathfindingContext::relax(int32_t node, int32_t parent, double g)
+{
+    Node& n = mNodes[node];
+    double f = g + n.mH;
+    n.mParent = parent;
+    n.mG = g;
+    // If the rounded fCost did not change, the node keeps its place between the nodes with the same cost
+    if(f == n.mF)
+        return;
+
+    n.mF = f;
+    n.mSequence = mSequence++;
+    siftUp(n.mHeapIndex);
+}
+
+void PathfindingContext::siftUp(int32_t heapIndex)
+{
+    int32_t node = mOpenList[heapIndex];
+    while(heapIndex > 0)
+    {
+        int32_t parentIndex = (heapIndex - 1) / 2;
+        int32_t parentNode = mOpenList[parentIndex];
+        if(!isBefore(node, parentNode))
+            break;
+
+        mOpenList[heapIndex] = parentNode;
+        mNodes[parentNode].mHeapIndex = heapIndex;
+        heapIndex = parentIndex;
+    }
+    mOpenList[heapIndex] = node;
+    mNodes[node].mHeapIndex = heapIndex;
+}
+
+void PathfindingContext::siftDown(int32_t heapIndex)
+{
+    int32_t size = static_cast<int32_t>(mOpenList.size());
+    int32_t node = mOpenList[heapIndex];
+    while(true)
+    {
+        int32_t childIndex = 2 * heapIndex + 1;
+        if(childIndex >= size)
+            break;
+
+        if((childIndex + 1 < size) && isBefore(mOpenList[childIndex + 1], mOpenList[childIndex]))
+            ++childIndex;
+
+        int32_t childNode = mOpenList[childIndex];
+        if(!isBefore(childNode, node))
+            break;
+
+        mOpenList[heapIndex] = childNode;
+        mNodes[childNode].mHeapIndex = heapIndex;
+        heapIndex = childIndex;
+    }
+    mOpenList[heapIndex] = node;
+    mNodes[node].mHeapIndex = heapIndex;
+}
@@ -0,0 +1,120 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATHFINDINGCONTEXT_H
+#define PATHFINDINGCONTEXT_H
+
+#include <cstdint>
+#include <vector>
+
+/*! \brief Reusable storage for the A* search done in GameMap::path.
+ *
+ * Nodes are stored in a flat array indexed by tile (x * sizeY + y). Instead of
+ * clearing the array before each search, every node is stamped with the generation
+ * of the search that last touched it. Starting a new search only increments the
+ * current generation, which makes the steady state allocation free.
+ *
+ * The open list is a binary heap of node indexes ordered by fCost. To give the exact
+ * same paths as the sorted list used before, ties are broken by insertion order: each
+ * time a node is opened or its cost is lowered, it gets a new sequence number and,
+ * between 2 nodes with the same fCost, the one with the lowest sequence is popped first.
+ *
+ * The A* description can be found here:
+ * http://en.wikipedia.org/wiki/A*_search_algorithm
+ */
+class PathfindingContext
+{
+public:
+    static const int32_t NO_NODE = -1;
+
+    PathfindingContext();
+
+    //! \brief Makes sure the context can handle a map of the given size. Does nothing
+    //! if the size did not change.
+    void resize(int sizeX, int sizeY);
+
+    //! \brief Starts a new search from the given node.
+    void start(int32_t node, double h);
+
+    //! \brief Returns the node with the lowest fCost from the open list and marks it as processed.
+    //! Returns NO_NODE if the open list is empty.
+    int32_t popBest();
+
+    //! \brief Returns true if the node has been reached during the current search (processed or in the open list)
+    inline bool isVisited(int32_t node) const
+    { return mNodes[node].mGeneration == mGeneration; }
+
+    //! \brief Returns true if the node has been popped from the open list during the current search
+    inline bool isProcessed(int32_t node) const
+    { return isVisited(node) && mNodes[node].mHeapIndex == NO_NODE; }
+
+    //! \brief Adds a node not visited yet to the open list.
+    void open(int32_t node, int32_t parent, double g, double h);
+
+    //! \brief Sets a lower cost to a node in the open list.
+    void relax(int32_t node, int32_t parent, double g);
+
+    inline double getG(int32_t node) const
+    { return mNodes[node].mG; }
+
+    inline int32_t getParent(int32_t node) const
+    { return mNodes[node].mParent; }
+
+    inline int32_t toNode(int x, int y) const
+    { return x * mSizeY + y; }
+
+    inline int toX(int32_t node) const
+    { return node / mSizeY; }
+
+    inline int toY(int32_t node) const
+    { return node % mSizeY; }
+
+private:
+    struct Node
+    {
+        uint32_t mGeneration;
+        int32_t mParent;
+        int32_t mHeapIndex;
+        uint32_t mSequence;
+        double mG;
+        double mH;
+        double mF;
+    };
+
+    int mSizeX;
+    int mSizeY;
+    uint32_t mGeneration;
+    uint32_t mSequence;
+    std::vector<Node> mNodes;
+    std::vector<int32_t> mOpenList;
+
+    //! \brief Returns true if node1 should be processed before node2
+    inline bool isBefore(int32_t node1, int32_t node2) const
+    {
+        const Node& n1 = mNodes[node1];
+        const Node& n2 = mNodes[node2];
+        if(n1.mF != n2.mF)
+            return n1.mF < n2.mF;
+
+        return n1.mSequence < n2.mSequence;
+    }
+
+    void siftUp(int32_t heapIndex);
+    void siftDown(int32_t heapIndex);
+};
+
+#endif // PATHFINDINGCONTEXT_H
@@ -0,0 +1,375 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/PathfindingHierarchy.h"
+
+#include "entities/Tile.h"
+#include "gamemap/Pathfinding.h"
+
+#include <algorithm>
+
+const int PathfindingHierarchy::SECTOR_SIZE = 16;
+const int PathfindingHierarchy::MIN_DISTANCE = 48;
+const uint16_t PathfindingHierarchy::NO_DISTANCE = 0xFFFF;
+
+// A sector side can have at most SECTOR_SIZE / 2 entrances (contiguous runs are separated
+// by at least one tile). The 2 last nodes of each sector are used for the start and
+// destination tiles of the search
+static const int32_t MAX_ENTRANCES_PER_SECTOR = 4 * 8;
+static const int32_t NODE_START = MAX_ENTRANCES_PER_SECTOR;
+static const int32_t NODE_DESTINATION = MAX_ENTRANCES_PER_SECTOR + 1;
+static const int32_t NODES_PER_SECTOR = MAX_ENTRANCES_PER_SECTOR + 2;
+
+//! \brief Floodfill value of the tiles that cannot be walked (see FloodFillSource)
+static const uint32_t NO_FLOODFILL = 0;
+
+PathfindingHierarchy::PathfindingHierarchy(const FloodFillSource& floodFillSource) :
+    mFloodFillSource(floodFillSource),
+    mMapSizeX(0),
+    mMapSizeY(0),
+    mNbSectorsX(0),
+    mNbSectorsY(0)
+{
+}
+
+void PathfindingHierarchy::resize(int mapSizeX, int mapSizeY)
+{
+    if((mapSizeX == mMapSizeX) && (mapSizeY == mMapSizeY))
+        return;
+
+    mMapSizeX = mapSizeX;
+    mMapSizeY = mapSizeY;
+    mNbSectorsX = (mMapSizeX + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    mNbSectorsY = (mMapSizeY + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    mLayers.clear();
+    mContext.resize(mNbSectorsX * mNbSectorsY, NODES_PER_SECTOR);
+    mSectorDistances.assign(SECTOR_SIZE * SECTOR_SIZE, NO_DISTANCE);
+}
+
+void PathfindingHierarchy::clear()
+{
+    mLayers.clear();
+}
+
+void PathfindingHierarchy::invalidateTile(int x, int y)
+{
+    if(mLayers.empty())
+        return;
+
+    // The tile may be an entrance for the sectors around
+    const int diffs[5][2] = { {0, 0}, {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+    for(const int* diff : diffs)
+    {
+        int32_t sectorIndex = getSectorIndex(x + diff[0], y + diff[1]);
+        if(sectorIndex < 0)
+            continue;
+
+        for(Layer& layer : mLayers)
+        {
+            if(static_cast<uint32_t>(sectorIndex) >= layer.mSectors.size())
+                continue;
+
+            layer.mSectors[sectorIndex].mIsDirty = true;
+        }
+    }
+}
+
+bool PathfindingHierarchy::findFirstLegTile(Seat* seat, uint32_t teamIndex, FloodFillType type, int startX, int startY,
+    int destinationX, int destinationY, int& legX, int& legY)
+{
+    int32_t startSector = getSectorIndex(startX, startY);
+    int32_t destinationSector = getSectorIndex(destinationX, destinationY);
+    if((startSector < 0) || (destinationSector < 0) || (startSector == destinationSector))
+        return false;
+
+    Layer& layer = getLayer(seat, teamIndex, type);
+
+    // We compute the distance between the start/destination tiles and the entrances of their sector
+    Sector& sectorStart = getSector(layer, startSector);
+    computeSectorDistances(layer, startSector, toTileIndex(startX, startY));
+    mStartDistances.clear();
+    for(const Entrance& entrance : sectorStart.mEntrances)
+        mStartDistances.push_back(getSectorDistance(startSector, entrance.mTile));
+
+    Sector& sectorDestination = getSector(layer, destinationSector);
+    computeSectorDistances(layer, destinationSector, toTileIndex(destinationX, destinationY));
+    mDestinationDistances.clear();
+    for(const Entrance& entrance : sectorDestination.mEntrances)
+        mDestinationDistances.push_back(getSectorDistance(destinationSector, entrance.mTile));
+
+    auto processNeighbor = [&](int32_t node, int32_t parent, double g, int32_t tileIndex)
+    {
+        if(mContext.isProcessed(node))
+            return;
+
+        if(!mContext.isVisited(node))
+        {
+            mContext.open(node, parent, g, Pathfinding::manhattanDistance(toTileX(tileIndex), toTileY(tileIndex),
+                destinationX, destinationY));
+        }
+        else if(g < mContext.getG(node))
+            mContext.relax(node, parent, g);
+    };
+
+    int32_t destinationNode = mContext.toNode(destinationSector, NODE_DESTINATION);
+    mContext.start(mContext.toNode(startSector, NODE_START), Pathfinding::manhattanDistance(startX, startY,
+        destinationX, destinationY));
+    while(true)
+    {
+        int32_t currentNode = mContext.popBest();
+        if(currentNode == PathfindingContext::NO_NODE)
+            return false;
+
+        if(currentNode == destinationNode)
+            break;
+
+        int32_t sectorIndex = mContext.toX(currentNode);
+        int32_t entranceIndex = mContext.toY(currentNode);
+        double g = mContext.getG(currentNode);
+        if(entranceIndex == NODE_START)
+        {
+            for(uint32_t i = 0; i < sectorStart.mEntrances.size(); ++i)
+            {
+                if(mStartDistances[i] == NO_DISTANCE)
+                    continue;
+
+                processNeighbor(mContext.toNode(startSector, i), currentNode, g + mStartDistances[i],
+                    sectorStart.mEntrances[i].mTile);
+            }
+            continue;
+        }
+
+        Sector& sector = layer.mSectors[sectorIndex];
+        uint32_t nbEntrances = sector.mEntrances.size();
+        for(uint32_t i = 0; i < nbEntrances; ++i)
+        {
+            uint16_t dist = sector.mDistances[entranceIndex * nbEntrances + i];
+            if(dist == NO_DISTANCE)
+                continue;
+
+            processNeighbor(mContext.toNode(sectorIndex, i), currentNode, g + dist, sector.mEntrances[i].mTile);
+        }
+
+        if((sectorIndex == destinationSector) &&
+           (mDestinationDistances[entranceIndex] != NO_DISTANCE))
+        {
+            processNeighbor(destinationNode, currentNode, g + mDestinationDistances[entranceIndex],
+                toTileIndex(destinationX, destinationY));
+        }
+
+        // We cross the border to the facing entrance
+        const Entrance& entrance = sector.mEntrances[entranceIndex];
+        Sector& partnerSector = getSector(layer, entrance.mPartnerSector);
+        for(uint32_t i = 0; i < partnerSector.mEntrances.size(); ++i)
+        {
+            const Entrance& partner = partnerSector.mEntrances[i];
+            if((partner.mTile != entrance.mPartnerTile) ||
+               (partner.mPartnerTile != entrance.mTile))
+            {
+                continue;
+            }
+
+            processNeighbor(mContext.toNode(entrance.mPartnerSector, i), currentNode, g + 1.0, partner.mTile);
+            break;
+        }
+    }
+
+    // We follow the route back to the start (excluding the start and destination nodes)
+    mRoute.clear();
+    for(int32_t node = mContext.getParent(destinationNode); node != PathfindingContext::NO_NODE; node = mContext.getParent(node))
+    {
+        if(mContext.toY(node) == NODE_START)
+            break;
+
+        int32_t sectorIndex = mContext.toX(node);
+        mRoute.push_back(layer.mSectors[sectorIndex].mEntrances[mContext.toY(node)].mTile);
+    }
+
+    if(mRoute.empty())
+        return false;
+
+    // mRoute is ordered from destination to start
+    int32_t legTile = mRoute.front();
+    for(auto it = mRoute.rbegin(); it != mRoute.rend(); ++it)
+    {
+        if(Pathfinding::manhattanDistance(startX, startY, toTileX(*it), toTileY(*it)) >= SECTOR_SIZE)
+        {
+            legTile = *it;
+            break;
+        }
+    }
+
+    legX = toTileX(legTile);
+    legY = toTileY(legTile);
+    return true;
+}
+
+PathfindingHierarchy::Layer& PathfindingHierarchy::getLayer(Seat* seat, uint32_t teamIndex, FloodFillType type)
+{
+    uint32_t nbTypes = static_cast<uint32_t>(FloodFillType::nbValues);
+    uint32_t index = teamIndex * nbTypes + static_cast<uint32_t>(type);
+    if(index >= mLayers.size())
+        mLayers.resize(index + 1);
+
+    Layer& layer = mLayers[index];
+    if(layer.mSectors.empty())
+    {
+        layer.mSeat = seat;
+        layer.mType = type;
+        Sector sector;
+        sector.mIsDirty = true;
+        layer.mSectors.assign(mNbSectorsX * mNbSectorsY, sector);
+    }
+
+    return layer;
+}
+
+bool PathfindingHierarchy::isLinked(const Layer& layer, int x1, int y1, int x2, int y2) const
+{
+    uint32_t floodFill = mFloodFillSource.getFloodFillValue(x1, y1, layer.mSeat, layer.mType);
+    if(floodFill == NO_FLOODFILL)
+        return false;
+
+    return floodFill == mFloodFillSource.getFloodFillValue(x2, y2, layer.mSeat, layer.mType);
+}
+
+PathfindingHierarchy::Sector& PathfindingHierarchy::getSector(Layer& layer, int32_t sectorIndex)
+{
+    Sector& sector = layer.mSectors[sectorIndex];
+    if(!sector.mIsDirty)
+        return sector;
+
+    int sectorX = sectorIndex / mNbSectorsY;
+    int sectorY = sectorIndex % mNbSectorsY;
+    int xStart = sectorX * SECTOR_SIZE;
+    int yStart = sectorY * SECTOR_SIZE;
+    int xEnd = std::min(xStart + SECTOR_SIZE, mMapSizeX);
+    int yEnd = std::min(yStart + SECTOR_SIZE, mMapSizeY);
+
+    // The borders are processed in the same direction from both sides so that facing sectors place
+    // their entrances on the same tiles
+    sector.mEntrances.clear();
+    if(sectorX > 0)
+        addEntrances(layer, sector, sectorIndex - mNbSectorsY, xStart, yStart, 0, 1, -1, 0, yEnd - yStart);
+    if(sectorX < mNbSectorsX - 1)
+        addEntrances(layer, sector, sectorIndex + mNbSectorsY, xEnd - 1, yStart, 0, 1, 1, 0, yEnd - yStart);
+    if(sectorY > 0)
+        addEntrances(layer, sector, sectorIndex - 1, xStart, yStart, 1, 0, 0, -1, xEnd - xStart);
+    if(sectorY < mNbSectorsY - 1)
+        addEntrances(layer, sector, sectorIndex + 1, xStart, yEnd - 1, 1, 0, 0, 1, xEnd - xStart);
+
+    uint32_t nbEntrances = sector.mEntrances.size();
+    sector.mDistances.assign(nbEntrances * nbEntrances, NO_DISTANCE);
+    for(uint32_t i = 0; i < nbEntrances; ++i)
+    {
+        computeSectorDistances(layer, sectorIndex, sector.mEntrances[i].mTile);
+        for(uint32_t j = 0; j < nbEntrances; ++j)
+            sector.mDistances[i * nbEntrances + j] = getSectorDistance(sectorIndex, sector.mEntrances[j].mTile);
+    }
+
+    sector.mIsDirty = false;
+    return sector;
+}
+
+void PathfindingHierarchy::addEntrances(Layer& layer, Sector& sector, int32_t neighborSector, int xStart, int yStart,
+    int diffX, int diffY, int neighborDiffX, int neighborDiffY, int length)
+{
+    int runStart = -1;
+    for(int i = 0; i <= length; ++i)
+    {
+        // The neighbor sector exists so the facing tiles are on the map
+        bool isLinkedTile = (i < length) && isLinked(layer, xStart + i * diffX, yStart + i * diffY,
+            xStart + i * diffX + neighborDiffX, yStart + i * diffY + neighborDiffY);
+
+        if(isLinkedTile)
+        {
+            if(runStart < 0)
+                runStart = i;
+
+            continue;
+        }
+
+        if(runStart < 0)
+            continue;
+
+        // We place the entrance in the middle of the run
+        int middle = (runStart + i - 1) / 2;
+        int x = xStart + middle * diffX;
+        int y = yStart + middle * diffY;
+        Entrance entrance;
+        entrance.mTile = toTileIndex(x, y);
+        entrance.mPartnerTile = toTileIndex(x + neighborDiffX, y + neighborDiffY);
+        entrance.mPartnerSector = neighborSector;
+        sector.mEntrances.push_back(entrance);
+        runStart = -1;
+    }
+}
+
+void PathfindingHierarchy::computeSectorDistances(const Layer& layer, int32_t sectorIndex, int32_t startTile)
+{
+    int xStart = (sectorIndex / mNbSectorsY) * SECTOR_SIZE;
+    int yStart = (sectorIndex % mNbSectorsY) * SECTOR_SIZE;
+    int xEnd = std::min(xStart + SECTOR_SIZE, mMapSizeX);
+    int yEnd = std::min(yStart + SECTOR_SIZE, mMapSizeY);
+
+    std::fill(mSectorDistances.begin(), mSectorDistances.end(), NO_DISTANCE);
+    mSectorQueue.clear();
+    mSectorDistances[(toTileX(startTile) - xStart) * SECTOR_SIZE + toTileY(startTile) - yStart] = 0;
+    mSectorQueue.push_back(startTile);
+
+    // Diagonal moves cost the same as 2 adjacent moves in GameMap::path so a breadth first
+    // search on the 4 adjacent tiles gives the walking distance
+    const int diffs[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+    for(uint32_t index = 0; index < mSectorQueue.size(); ++index)
+    {
+        int tileX = toTileX(mSectorQueue[index]);
+        int tileY = toTileY(mSectorQueue[index]);
+        uint16_t dist = mSectorDistances[(tileX - xStart) * SECTOR_SIZE + tileY - yStart];
+        for(const int* diff : diffs)
+        {
+            int x = tileX + diff[0];
+            int y = tileY + diff[1];
+            if((x < xStart) || (x >= xEnd) || (y < yStart) || (y >= yEnd))
+                continue;
+
+            uint16_t& neighborDist = mSectorDistances[(x - xStart) * SECTOR_SIZE + y - yStart];
+            if(neighborDist != NO_DISTANCE)
+                continue;
+
+            if(!isLinked(layer, tileX, tileY, x, y))
+                continue;
+
+            neighborDist = dist + 1;
+            mSectorQueue.push_back(toTileIndex(x, y));
+        }
+    }
+}
+
+uint16_t PathfindingHierarchy::getSectorDistance(int32_t sectorIndex, int32_t tileIndex) const
+{
+    int xStart = (sectorIndex / mNbSectorsY) * SECTOR_SIZE;
+    int yStart = (sectorIndex % mNbSectorsY) * SECTOR_SIZE;
+    return mSectorDistances[(toTileX(tileIndex) - xStart) * SECTOR_SIZE + toTileY(tileIndex) - yStart];
+}
+
+int32_t PathfindingHierarchy::getSectorIndex(int x, int y) const
+{
+    if((x < 0) || (y < 0) || (x >= mMapSizeX) || (y >= mMapSizeY))
+        return -1;
+
+    return (x / SECTOR_SIZE) * mNbSectorsY + (y / SECTOR_SIZE);
+}
@@ -0,0 +1,162 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATHFINDINGHIERARCHY_H
+#define PATHFINDINGHIERARCHY_H
+
+#include "gamemap/PathfindingContext.h"
+
+#include <cstdint>
+#include <vector>
+
+class Seat;
+
+enum class FloodFillType;
+
+/*! \brief Hierarchical pathfinding (HPA*) used to find long routes without searching the whole map.
+ *
+ * The map is split in square sectors. For each team and floodfill type, entrances are placed
+ * on the sector borders where 2 tiles with the same floodfill value face each other (one entrance
+ * in the middle of each contiguous run). Within a sector, the walking distance between its entrances
+ * is precomputed. A long route is then searched on this small graph and only the first leg is refined
+ * by the real A* in GameMap::path.
+ *
+ * The graph of a team/floodfill type is built lazily, sector by sector, the first time a search goes
+ * through it. When the passability of a tile changes (digging, claiming, doors, bridges),
+ * invalidateTile should be called and the sectors around the tile will be rebuilt when needed.
+ *
+ * The distances are computed for a creature walking at speed 1. Thus, the route is an approximation
+ * that may not be the fastest one for a given creature.
+ */
+class PathfindingHierarchy
+{
+public:
+    //! \brief Gives the floodfill values the sector graph is built from (implemented by GameMap)
+    class FloodFillSource
+    {
+    public:
+        virtual ~FloodFillSource()
+        {}
+
+        //! \brief Returns the floodfill value of the given tile for the given seat. 2 adjacent tiles with the
+        //! same value are linked. 0 (like Tile::NO_FLOODFILL) if the tile cannot be walked
+        virtual uint32_t getFloodFillValue(int x, int y, Seat* seat, FloodFillType type) const = 0;
+    };
+
+    //! \brief Size (in tiles) of a sector side
+    static const int SECTOR_SIZE;
+    //! \brief Minimum manhattan distance between 2 tiles to use the hierarchy instead of a direct A*
+    static const int MIN_DISTANCE;
+
+    PathfindingHierarchy(const FloodFillSource& floodFillSource);
+
+    //! \brief Sets the map size. Forgets every built sector if it changed
+    void resize(int mapSizeX, int mapSizeY);
+
+    //! \brief Forgets every built sector. Should be called when the whole floodfill is recomputed
+    void clear();
+
+    //! \brief Marks the sectors that may depend on the given tile as dirty
+    void invalidateTile(int x, int y);
+
+    /*! \brief Searches a route between the start and destination tiles on the sector graph for the given seat and
+     * floodfill type. teamIndex is the team of the seat: the seats of the same team share their graph.
+     * \returns true if a route is found. In this case, legX/legY are set to the first tile on the route that is at
+     * least SECTOR_SIZE tiles away from start (or the last entrance before destination if the route is shorter)
+     */
+    bool findFirstLegTile(Seat* seat, uint32_t teamIndex, FloodFillType type, int startX, int startY,
+        int destinationX, int destinationY, int& legX, int& legY);
+
+private:
+    //! \brief Distance used when a tile cannot be reached
+    static const uint16_t NO_DISTANCE;
+
+    //! \brief Entrance on the border of a sector. The partner tile is the tile facing it in the neighbor sector
+    struct Entrance
+    {
+        int32_t mTile;
+        int32_t mPartnerTile;
+        int32_t mPartnerSector;
+    };
+
+    struct Sector
+    {
+        bool mIsDirty;
+        std::vector<Entrance> mEntrances;
+        //! \brief Walking distance between each entrance (mEntrances.size() * mEntrances.size())
+        std::vector<uint16_t> mDistances;
+    };
+
+    //! \brief Sector graph for one team and one floodfill type
+    struct Layer
+    {
+        Seat* mSeat;
+        FloodFillType mType;
+        std::vector<Sector> mSectors;
+    };
+
+    const FloodFillSource& mFloodFillSource;
+
+    int mMapSizeX;
+    int mMapSizeY;
+    int mNbSectorsX;
+    int mNbSectorsY;
+
+    //! \brief Layers indexed by team index and floodfill type. Layers not used yet are empty
+    std::vector<Layer> mLayers;
+
+    //! \brief A* nodes on the sector graph. The node index is sector * NODES_PER_SECTOR + entrance
+    PathfindingContext mContext;
+
+    //! \brief Scratch buffers used while walking within a sector
+    std::vector<uint16_t> mSectorDistances;
+    std::vector<int32_t> mSectorQueue;
+    std::vector<uint16_t> mStartDistances;
+    std::vector<uint16_t> mDestinationDistances;
+    std::vector<int32_t> mRoute;
+
+    Layer& getLayer(Seat* seat, uint32_t teamIndex, FloodFillType type);
+
+    //! \brief Returns true if a creature can walk from the tile x1, y1 to the adjacent tile x2, y2 according
+    //! to the layer. Both tiles should be on the map
+    bool isLinked(const Layer& layer, int x1, int y1, int x2, int y2) const;
+
+    //! \brief Rebuilds the given sector if it is dirty
+    Sector& getSector(Layer& layer, int32_t sectorIndex);
+
+    void addEntrances(Layer& layer, Sector& sector, int32_t neighborSector, int xStart, int yStart,
+        int diffX, int diffY, int neighborDiffX, int neighborDiffY, int length);
+
+    //! \brief Fills mSectorDistances with the walking distance from the given tile to each tile of its sector
+    void computeSectorDistances(const Layer& layer, int32_t sectorIndex, int32_t startTile);
+
+    //! \brief Returns the distance computed by the last call to computeSectorDistances
+    uint16_t getSectorDistance(int32_t sectorIndex, int32_t tileIndex) const;
+
+    int32_t getSectorIndex(int x, int y) const;
+
+    inline int32_t toTileIndex(int x, int y) const
+    { return x * mMapSizeY + y; }
+
+    inline int toTileX(int32_t tileIndex) const
+    { return tileIndex / mMapSizeY; }
+
+    inline int toTileY(int32_t tileIndex) const
+    { return tileIndex % mMapSizeY; }
+};
+
+#endif // PATHFINDINGHIERARCHY_H
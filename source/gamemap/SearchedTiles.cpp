@@ -0,0 +1,88 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/SearchedTiles.h"
+
+#include <algorithm>
+
+SearchedTiles::SearchedTiles() :
+    mMapSizeX(0),
+    mMapSizeY(0),
+    mCurrentStamp(0)
+{
+}
+
+void SearchedTiles::clear()
+{
+    mMapSizeX = 0;
+    mMapSizeY = 0;
+    mStamps.clear();
+    mFoundStamps.clear();
+    mOrders.clear();
+    mCurrentStamp = 0;
+    mFoundOrders.clear();
+}
+
+void SearchedTiles::start(int mapSizeX, int mapSizeY)
+{
+    if((mMapSizeX != mapSizeX) || (mMapSizeY != mapSizeY))
+    {
+        mMapSizeX = mapSizeX;
+        mMapSizeY = mapSizeY;
+        uint32_t nbTiles = static_cast<uint32_t>(mMapSizeX * mMapSizeY);
+        mStamps.assign(nbTiles, 0);
+        mFoundStamps.assign(nbTiles, 0);
+        mOrders.assign(nbTiles, 0);
+        mCurrentStamp = 0;
+    }
+
+    ++mCurrentStamp;
+    if(mCurrentStamp == 0)
+    {
+        std::fill(mStamps.begin(), mStamps.end(), 0);
+        std::fill(mFoundStamps.begin(), mFoundStamps.end(), 0);
+        mCurrentStamp = 1;
+    }
+    mFoundOrders.clear();
+}
+
+bool SearchedTiles::add(int x, int y, uint32_t order)
+{
+    uint32_t index = static_cast<uint32_t>(x * mMapSizeY + y);
+    if(mStamps[index] == mCurrentStamp)
+        return false;
+
+    mStamps[index] = mCurrentStamp;
+    mOrders[index] = order;
+    return true;
+}
+
+void SearchedTiles::found(int x, int y)
+{
+    uint32_t index = static_cast<uint32_t>(x * mMapSizeY + y);
+    if(mFoundStamps[index] == mCurrentStamp)
+        return;
+
+    mFoundStamps[index] = mCurrentStamp;
+    mFoundOrders.push_back(mOrders[index]);
+}
+
+const std::vector<uint32_t>& SearchedTiles::getFoundOrders()
+{
+    std::sort(mFoundOrders.begin(), mFoundOrders.end());
+    return mFoundOrders;
+}
@@ -0,0 +1,71 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEARCHEDTILES_H
+#define SEARCHEDTILES_H
+
+#include <cstdint>
+#include <vector>
+
+/*! \brief Marks the tiles of a search and the ones where something has been found.
+ *
+ * Each searched tile is given its order (its index in the list of searched tiles). The tiles found
+ * are returned sorted by order so that the result of a search does not depend on the way the tiles
+ * have been found. Marking a tile is a stamp in an array as big as the map: starting a search does not
+ * need to clear anything.
+ */
+class SearchedTiles
+{
+public:
+    SearchedTiles();
+
+    //! \brief Forgets the marks and the map size
+    void clear();
+
+    //! \brief Starts a new search on a map of the given size. The marks of the previous search are forgotten
+    void start(int mapSizeX, int mapSizeY);
+
+    //! \brief Adds the given tile to the search with the given order. Returns false if it was already added
+    //! (it keeps its first order)
+    bool add(int x, int y, uint32_t order);
+
+    //! \brief Returns true if the given tile has been added to the current search
+    bool isSearched(int x, int y) const
+    { return mStamps[x * mMapSizeY + y] == mCurrentStamp; }
+
+    //! \brief Marks the given searched tile as found. Does nothing if it is already found
+    void found(int x, int y);
+
+    //! \brief Returns the orders of the tiles found during the current search, sorted
+    const std::vector<uint32_t>& getFoundOrders();
+
+private:
+    int mMapSizeX;
+    int mMapSizeY;
+
+    //! \brief A tile is searched if its stamp is mCurrentStamp (x * mapSizeY + y)
+    std::vector<uint32_t> mStamps;
+    //! \brief A tile is found if its stamp is mCurrentStamp (x * mapSizeY + y)
+    std::vector<uint32_t> mFoundStamps;
+    //! \brief Order of each searched tile (x * mapSizeY + y)
+    std::vector<uint32_t> mOrders;
+    uint32_t mCurrentStamp;
+
+    std::vector<uint32_t> mFoundOrders;
+};
+
+#endif // SEARCHEDTILES_H
@@ -18,6 +18,8 @@
 #ifndef TILECONTAINER_H
 #define TILECONTAINER_H
 
+#include "gamemap/LineOfSight.h"
+
 #include <cassert>
 #include <list>
 #include <vector>
@@ -97,6 +99,18 @@ public:
     //! the furthest
     std::vector<Tile*> visibleTiles(int x, int y, int radius);
 
+    //! \brief Same as above but fills the given vector (cleared before). Once the vector and the line of sight
+    //! buffers are big enough, no memory is allocated
+    void visibleTiles(int x, int y, int radius, std::vector<Tile*>& tiles);
+
+    //! \brief Same as above with the given line of sight buffers. The tile distances should have been built up to
+    //! radius (see buildTileDistance). It can then be called from several threads with different buffers
+    void visibleTiles(int x, int y, int radius, std::vector<Tile*>& tiles, LineOfSight::Buffers& buffers) const;
+
+    //! \brief Fills mTileDistance that will help to compute a vector with sorted Tiles more efficiently. Once it is built
+    //! up to a distance, circularRegion and visibleTiles do not modify the TileContainer for smaller radius
+    void buildTileDistance(int distance);
+
 protected:
     //! \brief The map size
     int mMapSizeX;
@@ -109,15 +123,16 @@ protected:
 private:
     Tile*** mTiles;
 
-    //! \brief Fills mTileDistance that will help to compute a vector with sorted Tiles more efficiently
-    void buildTileDistance(int distance);
-
     //! \brief Helper to compute tile distances more efficiently
     std::vector<TileDistance> mTileDistance;
 
     //! \brief Stores the highest distance computed. If a bigger distance is asked, mTileDistance will have to be updated by
     //! calling buildTileDistance with the higher distance
     int mTileDistanceComputed;
+
+    //! \brief Precomputed table used to compute the tiles visible from a given tile
+    LineOfSight mLineOfSight;
+    LineOfSight::Buffers mLineOfSightBuffers;
 };
 
 #endif //TILECONTAINER_H
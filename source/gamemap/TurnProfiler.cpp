@@ -0,0 +1,346 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/TurnProfiler.h"
+
+#include "utils/LogManager.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+const uint32_t TurnProfile::NB_PHASES;
+const uint32_t TurnProfile::NB_ENTITY_TYPES;
+const uint32_t TurnProfiler::HISTORY_SIZE = 1024;
+
+//! \brief Number of phases given for each of the slowest turns in the summary
+static const uint32_t NB_SUMMARY_PHASES = 3;
+
+void TurnProfile::clear(int64_t turn, double startUs)
+{
+    mTurn = turn;
+    mStartUs = startUs;
+    mDurationMs = 0.0;
+    mPhaseStartsMs.fill(-1.0);
+    mPhaseTimesMs.fill(0.0);
+    mEntityTimesMs.fill(0.0);
+}
+
+TurnProfiler::TurnProfiler() :
+    mIsEnabled(false),
+    mIsTurnRunning(false),
+    mCurrentPhase(TurnPhase::nbPhases),
+    mEpoch(std::chrono::steady_clock::now()),
+    mHistoryNext(0)
+{
+}
+
+void TurnProfiler::setEnabled(bool enabled)
+{
+    mIsEnabled = enabled;
+    if(!enabled)
+    {
+        mIsTurnRunning = false;
+        mCurrentPhase = TurnPhase::nbPhases;
+    }
+}
+
+void TurnProfiler::startTurn(int64_t turn)
+{
+    mIsTurnRunning = mIsEnabled;
+    mCurrentPhase = TurnPhase::nbPhases;
+    if(!mIsTurnRunning)
+        return;
+
+    mTurnStart = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::micro> sinceEpoch = mTurnStart - mEpoch;
+    mCurrent.clear(turn, sinceEpoch.count());
+}
+
+void TurnProfiler::endTurn()
+{
+    if(!mIsTurnRunning)
+        return;
+
+    switchPhase(TurnPhase::nbPhases);
+    mIsTurnRunning = false;
+    std::chrono::duration<double, std::milli> duration = mPhaseStart - mTurnStart;
+    mCurrent.mDurationMs = duration.count();
+
+    if(mHistory.size() < HISTORY_SIZE)
+    {
+        mHistory.push_back(mCurrent);
+        return;
+    }
+
+    mHistory[mHistoryNext] = mCurrent;
+    mHistoryNext = (mHistoryNext + 1) % HISTORY_SIZE;
+}
+
+void TurnProfiler::switchPhase(TurnPhase phase)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(mCurrentPhase != TurnPhase::nbPhases)
+    {
+        std::chrono::duration<double, std::milli> elapsed = now - mPhaseStart;
+        mCurrent.mPhaseTimesMs[static_cast<uint32_t>(mCurrentPhase)] += elapsed.count();
+    }
+
+    if((phase != TurnPhase::nbPhases) && (mCurrent.mPhaseStartsMs[static_cast<uint32_t>(phase)] < 0.0))
+    {
+        std::chrono::duration<double, std::milli> sinceTurnStart = now - mTurnStart;
+        mCurrent.mPhaseStartsMs[static_cast<uint32_t>(phase)] = sinceTurnStart.count();
+    }
+
+    mCurrentPhase = phase;
+    mPhaseStart = now;
+}
+
+void TurnProfiler::addEntityUpkeep(GameEntityType type, const std::chrono::steady_clock::time_point& start)
+{
+    uint32_t index = static_cast<uint32_t>(type);
+    if(index >= TurnProfile::NB_ENTITY_TYPES)
+        return;
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    mCurrent.mEntityTimesMs[index] += elapsed.count();
+}
+
+const TurnProfile& TurnProfiler::getProfile(uint32_t index) const
+{
+    return mHistory[(mHistoryNext + index) % mHistory.size()];
+}
+
+void TurnProfiler::clearHistory()
+{
+    mHistory.clear();
+    mHistoryNext = 0;
+}
+
+std::string TurnProfiler::getSummary(uint32_t nbSlowestTurns) const
+{
+    uint32_t nbProfiles = getNbProfiles();
+    if(nbProfiles == 0)
+        return "No turn profiled";
+
+    double totalMs = 0.0;
+    std::vector<uint32_t> indexes;
+    for(uint32_t i = 0; i < nbProfiles; ++i)
+    {
+        totalMs += getProfile(i).mDurationMs;
+        indexes.push_back(i);
+    }
+
+    std::stringstream ss;
+    ss << "Turns profiled: " << nbProfiles << " (from turn " << getProfile(0).mTurn
+        << "), average turn: " << (totalMs / nbProfiles) << "ms";
+
+    nbSlowestTurns = std::min(nbSlowestTurns, nbProfiles);
+    std::partial_sort(indexes.begin(), indexes.begin() + nbSlowestTurns, indexes.end(),
+        [this](uint32_t a, uint32_t b)
+        {
+            return getProfile(a).mDurationMs > getProfile(b).mDurationMs;
+        });
+
+    for(uint32_t i = 0; i < nbSlowestTurns; ++i)
+    {
+        const TurnProfile& profile = getProfile(indexes[i]);
+        std::vector<uint32_t> phases;
+        for(uint32_t phase = 0; phase < TurnProfile::NB_PHASES; ++phase)
+            phases.push_back(phase);
+
+        uint32_t nbPhases = std::min(NB_SUMMARY_PHASES, TurnProfile::NB_PHASES);
+        std::partial_sort(phases.begin(), phases.begin() + nbPhases, phases.end(),
+            [&profile](uint32_t a, uint32_t b)
+            {
+                return profile.mPhaseTimesMs[a] > profile.mPhaseTimesMs[b];
+            });
+
+        ss << std::endl << "Turn " << profile.mTurn << ": " << profile.mDurationMs << "ms (";
+        for(uint32_t j = 0; j < nbPhases; ++j)
+        {
+            if(j > 0)
+                ss << ", ";
+            ss << getPhaseName(static_cast<TurnPhase>(phases[j])) << "=" << profile.mPhaseTimesMs[phases[j]] << "ms";
+        }
+        ss << ")";
+    }
+
+    return ss.str();
+}
+
+bool TurnProfiler::saveCsv(const std::string& fileName) const
+{
+    std::ofstream file(fileName.c_str(), std::ios_base::out | std::ios_base::trunc);
+    if(!file.is_open())
+    {
+        OD_LOG_ERR("Could not write turn profile file " + fileName);
+        return false;
+    }
+
+    file << "turn,totalMs";
+    for(uint32_t phase = 0; phase < TurnProfile::NB_PHASES; ++phase)
+        file << "," << getPhaseName(static_cast<TurnPhase>(phase));
+    for(uint32_t type = 0; type < TurnProfile::NB_ENTITY_TYPES; ++type)
+        file << ",entities." << getEntityTypeName(static_cast<GameEntityType>(type));
+    file << std::endl;
+
+    for(uint32_t i = 0; i < getNbProfiles(); ++i)
+    {
+        const TurnProfile& profile = getProfile(i);
+        file << profile.mTurn << "," << profile.mDurationMs;
+        for(double timeMs : profile.mPhaseTimesMs)
+            file << "," << timeMs;
+        for(double timeMs : profile.mEntityTimesMs)
+            file << "," << timeMs;
+        file << std::endl;
+    }
+
+    return true;
+}
+
+bool TurnProfiler::saveChromeTrace(const std::string& fileName) const
+{
+    std::ofstream file(fileName.c_str(), std::ios_base::out | std::ios_base::trunc);
+    if(!file.is_open())
+    {
+        OD_LOG_ERR("Could not write turn trace file " + fileName);
+        return false;
+    }
+
+    // Timestamps and durations are in microseconds. The phases are nested in their turn
+    file << std::fixed;
+    file.precision(1);
+    file << "{\"traceEvents\":[";
+    bool isFirstEvent = true;
+    for(uint32_t i = 0; i < getNbProfiles(); ++i)
+    {
+        const TurnProfile& profile = getProfile(i);
+        file << (isFirstEvent ? "" : ",") << std::endl;
+        isFirstEvent = false;
+        file << "{\"name\":\"turn " << profile.mTurn << "\",\"cat\":\"turn\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+            << ",\"ts\":" << profile.mStartUs << ",\"dur\":" << (profile.mDurationMs * 1000.0) << "}";
+
+        for(uint32_t phase = 0; phase < TurnProfile::NB_PHASES; ++phase)
+        {
+            if(profile.mPhaseStartsMs[phase] < 0.0)
+                continue;
+
+            file << "," << std::endl;
+            file << "{\"name\":\"" << getPhaseName(static_cast<TurnPhase>(phase))
+                << "\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+                << ",\"ts\":" << (profile.mStartUs + profile.mPhaseStartsMs[phase] * 1000.0)
+                << ",\"dur\":" << (profile.mPhaseTimesMs[phase] * 1000.0);
+
+            // The entity types are interleaved during the entities phase. We only give their total
+            if(static_cast<TurnPhase>(phase) == TurnPhase::entities)
+            {
+                file << ",\"args\":{";
+                for(uint32_t type = 0; type < TurnProfile::NB_ENTITY_TYPES; ++type)
+                {
+                    file << (type == 0 ? "" : ",") << "\"" << getEntityTypeName(static_cast<GameEntityType>(type))
+                        << "Ms\":" << profile.mEntityTimesMs[type];
+                }
+                file << "}";
+            }
+            file << "}";
+        }
+    }
+    file << std::endl << "]}" << std::endl;
+
+    return true;
+}
+
+const char* TurnProfiler::getPhaseName(TurnPhase phase)
+{
+    switch(phase)
+    {
+        case TurnPhase::animations:
+            return "animations";
+        case TurnPhase::playerInfos:
+            return "playerInfos";
+        case TurnPhase::visibleEntities:
+            return "visibleEntities";
+        case TurnPhase::payDay:
+            return "payDay";
+        case TurnPhase::goals:
+            return "goals";
+        case TurnPhase::visionClear:
+            return "visionClear";
+        case TurnPhase::visionRecompute:
+            return "visionRecompute";
+        case TurnPhase::sendVisibleTiles:
+            return "sendVisibleTiles";
+        case TurnPhase::entities:
+            return "entities";
+        case TurnPhase::seats:
+            return "seats";
+        case TurnPhase::playerUpkeep:
+            return "playerUpkeep";
+        case TurnPhase::ai:
+            return "ai";
+        case TurnPhase::refreshEntities:
+            return "refreshEntities";
+        case TurnPhase::deletionQueues:
+            return "deletionQueues";
+        case TurnPhase::serverNotifications:
+            return "serverNotifications";
+        default:
+            return "unknown";
+    }
+}
+
+const char* TurnProfiler::getEntityTypeName(GameEntityType type)
+{
+    switch(type)
+    {
+        case GameEntityType::creature:
+            return "creature";
+        case GameEntityType::room:
+            return "room";
+        case GameEntityType::trap:
+            return "trap";
+        case GameEntityType::tile:
+            return "tile";
+        case GameEntityType::mapLight:
+            return "mapLight";
+        case GameEntityType::spell:
+            return "spell";
+        case GameEntityType::buildingObject:
+            return "buildingObject";
+        case GameEntityType::treasuryObject:
+            return "treasuryObject";
+        case GameEntityType::chickenEntity:
+            return "chickenEntity";
+        case GameEntityType::smallSpiderEntity:
+            return "smallSpiderEntity";
+        case GameEntityType::craftedTrap:
+            return "craftedTrap";
+        case GameEntityType::missileObject:
+            return "missileObject";
+        case GameEntityType::persistentObject:
+            return "persistentObject";
+        case GameEntityType::trapEntity:
+            return "trapEntity";
+        case GameEntityType::skillEntity:
+            return "skillEntity";
+        case GameEntityType::giftBoxEntity:
+            return "giftBoxEntity";
+        default:
+            return "unknown";
+    }
+}
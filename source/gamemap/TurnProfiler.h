@@ -0,0 +1,189 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TURNPROFILER_H
+#define TURNPROFILER_H
+
+#include "entities/GameEntityType.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! \brief Parts of a server turn, in the order they are processed
+enum class TurnPhase
+{
+    animations,
+    playerInfos,
+    visibleEntities,
+    payDay,
+    goals,
+    visionClear,
+    visionRecompute,
+    sendVisibleTiles,
+    entities,
+    seats,
+    playerUpkeep,
+    ai,
+    refreshEntities,
+    deletionQueues,
+    serverNotifications,
+    nbPhases
+};
+
+//! \brief Measures of one turn
+struct TurnProfile
+{
+    static const uint32_t NB_PHASES = static_cast<uint32_t>(TurnPhase::nbPhases);
+    static const uint32_t NB_ENTITY_TYPES = static_cast<uint32_t>(GameEntityType::giftBoxEntity) + 1;
+
+    TurnProfile()
+    { clear(-1, 0.0); }
+
+    int64_t mTurn;
+    //! \brief Start of the turn in microseconds since the profiler creation
+    double mStartUs;
+    double mDurationMs;
+    //! \brief Time since the start of the turn when each phase was first entered. Negative if it was not
+    std::array<double, NB_PHASES> mPhaseStartsMs;
+    std::array<double, NB_PHASES> mPhaseTimesMs;
+    //! \brief Upkeep time of the active objects of each type. It is a part of the entities phase
+    std::array<double, NB_ENTITY_TYPES> mEntityTimesMs;
+
+    void clear(int64_t turn, double startUs);
+};
+
+/*! \brief Measures the time spent in each phase of a server turn.
+ *
+ * The turn code calls startPhase when it enters a new phase, which ends the previous one. Thus, the phases
+ * follow each other without having to scope them. The upkeep of the active objects is measured by type
+ * with ScopedEntityUpkeep. When the profiler is disabled, these calls only check a flag.
+ * The last HISTORY_SIZE turns are kept so that the turns that spiked can be looked at afterwards, either
+ * from the console or by saving them as csv or as a Chrome trace (to be opened with chrome://tracing).
+ */
+class TurnProfiler
+{
+public:
+    //! \brief Number of turns kept in the history
+    static const uint32_t HISTORY_SIZE;
+
+    //! \brief Adds the time spent in its scope to the upkeep time of the given entity type
+    class ScopedEntityUpkeep
+    {
+    public:
+        ScopedEntityUpkeep(TurnProfiler& profiler, GameEntityType type) :
+            mProfiler(profiler.mIsTurnRunning ? &profiler : nullptr),
+            mType(type)
+        {
+            if(mProfiler != nullptr)
+                mStart = std::chrono::steady_clock::now();
+        }
+
+        ~ScopedEntityUpkeep()
+        {
+            if(mProfiler != nullptr)
+                mProfiler->addEntityUpkeep(mType, mStart);
+        }
+
+        ScopedEntityUpkeep(const ScopedEntityUpkeep&) = delete;
+        ScopedEntityUpkeep& operator=(const ScopedEntityUpkeep&) = delete;
+
+    private:
+        TurnProfiler* mProfiler;
+        GameEntityType mType;
+        std::chrono::steady_clock::time_point mStart;
+    };
+
+    TurnProfiler();
+
+    //! \brief Enabling the profiler takes effect at the next turn. Disabling it stops the current turn
+    //! without saving it in the history
+    void setEnabled(bool enabled);
+
+    inline bool isEnabled() const
+    { return mIsEnabled; }
+
+    //! \brief Clears the measures of the current turn. Should be called at the start of each turn
+    void startTurn(int64_t turn);
+
+    //! \brief Ends the current phase and saves the turn in the history
+    void endTurn();
+
+    //! \brief Ends the current phase (if any) and starts the given one
+    inline void startPhase(TurnPhase phase)
+    {
+        if(mIsTurnRunning)
+            switchPhase(phase);
+    }
+
+    //! \brief Ends the current phase (if any)
+    inline void endPhase()
+    {
+        if(mIsTurnRunning)
+            switchPhase(TurnPhase::nbPhases);
+    }
+
+    //! \brief Time spent in the given phase during the last started turn
+    inline double getPhaseTimeMs(TurnPhase phase) const
+    { return mCurrent.mPhaseTimesMs[static_cast<uint32_t>(phase)]; }
+
+    //! \brief Number of turns in the history
+    inline uint32_t getNbProfiles() const
+    { return static_cast<uint32_t>(mHistory.size()); }
+
+    //! \brief Returns the turn at the given index in the history. The oldest one has index 0
+    const TurnProfile& getProfile(uint32_t index) const;
+
+    //! \brief Removes every turn from the history
+    void clearHistory();
+
+    //! \brief Returns a few lines describing the history: average turn and slowest turns with their main phases
+    std::string getSummary(uint32_t nbSlowestTurns) const;
+
+    //! \brief Saves the history with one line per turn and one column per phase and per entity type
+    bool saveCsv(const std::string& fileName) const;
+
+    //! \brief Saves the history in the Chrome trace event format. Each phase is an event of its turn
+    bool saveChromeTrace(const std::string& fileName) const;
+
+    static const char* getPhaseName(TurnPhase phase);
+
+    static const char* getEntityTypeName(GameEntityType type);
+
+private:
+    bool mIsEnabled;
+    //! \brief True if the profiler was enabled when the current turn started and the turn is not ended
+    bool mIsTurnRunning;
+    //! \brief nbPhases if no phase is running
+    TurnPhase mCurrentPhase;
+    std::chrono::steady_clock::time_point mEpoch;
+    std::chrono::steady_clock::time_point mTurnStart;
+    std::chrono::steady_clock::time_point mPhaseStart;
+    TurnProfile mCurrent;
+
+    //! \brief Ring buffer of the last turns. When it is full, mHistoryNext is the oldest turn
+    std::vector<TurnProfile> mHistory;
+    uint32_t mHistoryNext;
+
+    void switchPhase(TurnPhase phase);
+
+    void addEntityUpkeep(GameEntityType type, const std::chrono::steady_clock::time_point& start);
+};
+
+#endif // TURNPROFILER_H
@@ -0,0 +1,343 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/VisionManager.h"
+
+#include "entities/GameEntity.h"
+#include "entities/Tile.h"
+#include "game/Seat.h"
+#include "gamemap/GameMap.h"
+#include "utils/LogManager.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+const uint32_t VisionManager::MAX_CHANGED_TILES = 256;
+const uint32_t VisionManager::NO_SEAT = ClaimedTiles::NO_SEAT;
+
+VisionManager::VisionManager(GameMap& gameMap) :
+    mGameMap(gameMap),
+    mIsInitialized(false),
+    mMapSizeX(0),
+    mMapSizeY(0),
+    mIsFOWActivated(true),
+    mAllSourcesDirty(false)
+{
+}
+
+void VisionManager::clear()
+{
+    mIsInitialized = false;
+    mSeats.clear();
+    mSharedVision.clear();
+    mVisionCounts.clear();
+    mClaimedTiles.clear();
+    mSources.clear();
+    mSourceIndexes.clear();
+    mChangedTiles.clear();
+    mAllSourcesDirty = false;
+}
+
+void VisionManager::tileVisionChanged(Tile* tile)
+{
+    if(mAllSourcesDirty)
+        return;
+
+    // If too many tiles changed, it is faster to recompute every source than to check each tile
+    if(mChangedTiles.size() >= MAX_CHANGED_TILES)
+    {
+        mChangedTiles.clear();
+        mAllSourcesDirty = true;
+        return;
+    }
+
+    mChangedTiles.push_back(tile);
+}
+
+void VisionManager::tileClaimChanged(Tile* tile)
+{
+    mClaimedTiles.tileChanged(tile->getX(), tile->getY());
+}
+
+void VisionManager::beginUpdate()
+{
+    if(!mIsInitialized ||
+       (mSeats != mGameMap.getSeats()) ||
+       (mMapSizeX != mGameMap.getMapSizeX()) ||
+       (mMapSizeY != mGameMap.getMapSizeY()))
+    {
+        reset();
+    }
+
+    // If the FOW is deactivated, every seat has vision on every tile. We add one more vision
+    // source on each tile for each seat
+    bool isFOWActivated = mGameMap.getIsFOWActivated();
+    if(isFOWActivated != mIsFOWActivated)
+    {
+        mIsFOWActivated = isFOWActivated;
+        for(int xxx = 0; xxx < mMapSizeX; ++xxx)
+        {
+            for(int yyy = 0; yyy < mMapSizeY; ++yyy)
+            {
+                Tile* tile = mGameMap.getTile(xxx, yyy);
+                for(uint32_t seatIndex = 0; seatIndex < mSeats.size(); ++seatIndex)
+                {
+                    if(mIsFOWActivated)
+                        decrementCount(seatIndex, tile);
+                    else
+                        incrementCount(seatIndex, tile);
+                }
+            }
+        }
+    }
+
+    // A claimed tile can see itself and its neighbors. We only have to update the
+    // tiles that may have been claimed or lost since the last update
+    mClaimedTiles.process([this](int x, int y)
+    {
+        Tile* tile = mGameMap.getTile(x, y);
+        if(!tile->isClaimed())
+            return NO_SEAT;
+
+        return getSeatIndex(tile->getSeat());
+    },
+    [this](int x, int y, uint32_t oldSeatIndex, uint32_t newSeatIndex)
+    {
+        Tile* tile = mGameMap.getTile(x, y);
+        if(newSeatIndex != NO_SEAT)
+            addClaimedTileVision(newSeatIndex, tile);
+
+        if(oldSeatIndex != NO_SEAT)
+            removeClaimedTileVision(oldSeatIndex, tile);
+    });
+}
+
+bool VisionManager::needSourceUpdate(const GameEntity* source, Seat* seat, Tile* positionTile, uint32_t radius)
+{
+    uint32_t seatIndex = getSeatIndex(seat);
+    if(seatIndex == NO_SEAT)
+    {
+        OD_LOG_ERR("name=" + source->getName() + ", unknown seat=" + Seat::displayAsString(seat));
+        return false;
+    }
+
+    auto it = mSourceIndexes.find(source);
+    if(it == mSourceIndexes.end())
+    {
+        mSourceIndexes[source] = static_cast<uint32_t>(mSources.size());
+        VisionSource newSource = { source, seatIndex, positionTile, radius, true, std::vector<Tile*>() };
+        mSources.push_back(newSource);
+        return true;
+    }
+
+    VisionSource& visionSource = mSources[it->second];
+    visionSource.mIsRefreshed = true;
+
+    // If the seat changed, the vision given to the old seat is lost
+    if(visionSource.mSeatIndex != seatIndex)
+    {
+        for(Tile* tile : visionSource.mTiles)
+            removeVision(visionSource.mSeatIndex, tile);
+
+        visionSource.mTiles.clear();
+        visionSource.mSeatIndex = seatIndex;
+        visionSource.mPositionTile = positionTile;
+        visionSource.mRadius = radius;
+        return true;
+    }
+
+    if(mAllSourcesDirty ||
+       (visionSource.mPositionTile != positionTile) ||
+       (visionSource.mRadius != radius))
+    {
+        visionSource.mPositionTile = positionTile;
+        visionSource.mRadius = radius;
+        return true;
+    }
+
+    int radiusInt = static_cast<int>(radius);
+    for(Tile* tile : mChangedTiles)
+    {
+        if((std::abs(tile->getX() - positionTile->getX()) <= radiusInt) &&
+           (std::abs(tile->getY() - positionTile->getY()) <= radiusInt))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void VisionManager::setSourceTiles(const GameEntity* source, const std::vector<Tile*>& tiles)
+{
+    auto it = mSourceIndexes.find(source);
+    if(it == mSourceIndexes.end())
+    {
+        OD_LOG_ERR("Unknown vision source name=" + source->getName());
+        return;
+    }
+
+    VisionSource& visionSource = mSources[it->second];
+
+    // We add the new vision before removing the old one so that tiles seen by both do not lose vision
+    for(Tile* tile : tiles)
+        addVision(visionSource.mSeatIndex, tile);
+
+    for(Tile* tile : visionSource.mTiles)
+        removeVision(visionSource.mSeatIndex, tile);
+
+    visionSource.mTiles = tiles;
+}
+
+void VisionManager::endUpdate()
+{
+    uint32_t index = 0;
+    while(index < mSources.size())
+    {
+        VisionSource& visionSource = mSources[index];
+        if(visionSource.mIsRefreshed)
+        {
+            visionSource.mIsRefreshed = false;
+            ++index;
+            continue;
+        }
+
+        for(Tile* tile : visionSource.mTiles)
+            removeVision(visionSource.mSeatIndex, tile);
+
+        mSourceIndexes.erase(visionSource.mEntity);
+        if(index + 1 < mSources.size())
+        {
+            visionSource = std::move(mSources.back());
+            mSourceIndexes[visionSource.mEntity] = index;
+        }
+        mSources.pop_back();
+    }
+
+    mChangedTiles.clear();
+    mAllSourcesDirty = false;
+}
+
+void VisionManager::reset()
+{
+    // We remove the vision given by the previous updates (if any)
+    for(int xxx = 0; xxx < mGameMap.getMapSizeX(); ++xxx)
+    {
+        for(int yyy = 0; yyy < mGameMap.getMapSizeY(); ++yyy)
+        {
+            Tile* tile = mGameMap.getTile(xxx, yyy);
+            for(Seat* seat : tile->getSeatsWithVision())
+                seat->notifyVisionLostOnTile(tile);
+
+            tile->clearVision();
+        }
+    }
+
+    mMapSizeX = mGameMap.getMapSizeX();
+    mMapSizeY = mGameMap.getMapSizeY();
+    mSeats = mGameMap.getSeats();
+    uint32_t nbSeats = static_cast<uint32_t>(mSeats.size());
+
+    // The vision is shared with the allied seats (and their allies)
+    mSharedVision.assign(nbSeats, std::vector<uint32_t>());
+    for(uint32_t seatIndex = 0; seatIndex < nbSeats; ++seatIndex)
+    {
+        std::vector<uint32_t>& sharedVision = mSharedVision[seatIndex];
+        sharedVision.push_back(seatIndex);
+        for(uint32_t i = 0; i < sharedVision.size(); ++i)
+        {
+            for(Seat* alliedSeat : mSeats[sharedVision[i]]->getAlliedSeats())
+            {
+                uint32_t alliedIndex = getSeatIndex(alliedSeat);
+                if(alliedIndex == NO_SEAT)
+                    continue;
+                if(std::find(sharedVision.begin(), sharedVision.end(), alliedIndex) != sharedVision.end())
+                    continue;
+
+                sharedVision.push_back(alliedIndex);
+            }
+        }
+    }
+
+    mVisionCounts.assign(mMapSizeX * mMapSizeY * nbSeats, 0);
+    mClaimedTiles.reset(mMapSizeX, mMapSizeY);
+    mIsFOWActivated = true;
+    mSources.clear();
+    mSourceIndexes.clear();
+    mChangedTiles.clear();
+    mAllSourcesDirty = false;
+    mIsInitialized = true;
+}
+
+uint32_t VisionManager::getSeatIndex(const Seat* seat) const
+{
+    for(uint32_t seatIndex = 0; seatIndex < mSeats.size(); ++seatIndex)
+    {
+        if(mSeats[seatIndex] == seat)
+            return seatIndex;
+    }
+
+    return NO_SEAT;
+}
+
+void VisionManager::incrementCount(uint32_t seatIndex, Tile* tile)
+{
+    uint32_t index = (tile->getX() * mMapSizeY + tile->getY()) * mSeats.size() + seatIndex;
+    ++mVisionCounts[index];
+    if(mVisionCounts[index] == 1)
+        tile->gainVision(mSeats[seatIndex]);
+}
+
+void VisionManager::decrementCount(uint32_t seatIndex, Tile* tile)
+{
+    uint32_t index = (tile->getX() * mMapSizeY + tile->getY()) * mSeats.size() + seatIndex;
+    if(mVisionCounts[index] == 0)
+    {
+        OD_LOG_ERR("Tile=" + Tile::displayAsString(tile) + ", seat=" + Seat::displayAsString(mSeats[seatIndex]));
+        return;
+    }
+
+    --mVisionCounts[index];
+    if(mVisionCounts[index] == 0)
+        tile->loseVision(mSeats[seatIndex]);
+}
+
+void VisionManager::addVision(uint32_t seatIndex, Tile* tile)
+{
+    for(uint32_t sharedIndex : mSharedVision[seatIndex])
+        incrementCount(sharedIndex, tile);
+}
+
+void VisionManager::removeVision(uint32_t seatIndex, Tile* tile)
+{
+    for(uint32_t sharedIndex : mSharedVision[seatIndex])
+        decrementCount(sharedIndex, tile);
+}
+
+void VisionManager::addClaimedTileVision(uint32_t seatIndex, Tile* tile)
+{
+    addVision(seatIndex, tile);
+    for(Tile* neighbor : tile->getAllNeighbors())
+        addVision(seatIndex, neighbor);
+}
+
+void VisionManager::removeClaimedTileVision(uint32_t seatIndex, Tile* tile)
+{
+    removeVision(seatIndex, tile);
+    for(Tile* neighbor : tile->getAllNeighbors())
+        removeVision(seatIndex, neighbor);
+}
@@ -0,0 +1,143 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VISIONMANAGER_H
+#define VISIONMANAGER_H
+
+#include "gamemap/ClaimedTiles.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class GameEntity;
+class GameMap;
+class Seat;
+class Tile;
+
+/*! \brief Keeps track of the tiles each seat has vision on.
+ *
+ * For each tile and each seat, we count how many vision sources give vision on the tile to
+ * the seat (allied seats share their vision). The tile is notified when a count goes from 0 to 1
+ * (vision gained) or from 1 to 0 (vision lost).
+ *
+ * Vision sources are claimed tiles (that see themselves and their neighbors) and entities
+ * (creatures, spells). An entity source keeps the tiles it gives vision on and is only recomputed
+ * when it moves, when its seat or its sight radius changes or when a tile within its sight radius
+ * starts or stops blocking vision (see tileVisionChanged). Entity sources that are not refreshed
+ * during an update (dead, picked up, removed, ...) lose their vision at the end of the update.
+ * Claimed tiles are only checked when they may have been claimed or lost (see tileClaimChanged).
+ *
+ * On server side, an update is done each turn:
+ * - beginUpdate
+ * - for each entity source: if needSourceUpdate returns true, setSourceTiles
+ * - endUpdate
+ */
+class VisionManager
+{
+public:
+    VisionManager(GameMap& gameMap);
+
+    //! \brief Forgets every vision source. Should be called when the map is cleared
+    void clear();
+
+    //! \brief Should be called when the given tile may start or stop blocking vision
+    void tileVisionChanged(Tile* tile);
+
+    //! \brief Should be called when the given tile may have been claimed or lost. Its vision is updated
+    //! during the next update
+    void tileClaimChanged(Tile* tile);
+
+    //! \brief Starts the update. Handles the fog of war toggling and the claimed tiles
+    void beginUpdate();
+
+    /*! \brief Refreshes the given entity source. Returns true if the tiles it gives vision on should
+     * be recomputed and given with setSourceTiles
+     */
+    bool needSourceUpdate(const GameEntity* source, Seat* seat, Tile* positionTile, uint32_t radius);
+
+    //! \brief Sets the tiles the given entity source gives vision on. The previous tiles lose this vision
+    void setSourceTiles(const GameEntity* source, const std::vector<Tile*>& tiles);
+
+    //! \brief Removes the vision of the sources that have not been refreshed since beginUpdate
+    void endUpdate();
+
+private:
+    //! \brief If more tiles change during a turn, every source is recomputed
+    static const uint32_t MAX_CHANGED_TILES;
+    //! \brief Seat index of tiles that do not give vision
+    static const uint32_t NO_SEAT;
+
+    struct VisionSource
+    {
+        const GameEntity* mEntity;
+        uint32_t mSeatIndex;
+        Tile* mPositionTile;
+        uint32_t mRadius;
+        //! \brief true if the source has been refreshed since beginUpdate
+        bool mIsRefreshed;
+        std::vector<Tile*> mTiles;
+    };
+
+    GameMap& mGameMap;
+
+    bool mIsInitialized;
+    int mMapSizeX;
+    int mMapSizeY;
+    bool mIsFOWActivated;
+
+    //! \brief Seats of the gamemap when the vision has been initialized. The seat index used in
+    //! this class is the index in this vector
+    std::vector<Seat*> mSeats;
+
+    //! \brief For each seat index, the indexes of the seats that get the vision it gains (itself and its allies)
+    std::vector<std::vector<uint32_t>> mSharedVision;
+
+    //! \brief Number of sources giving vision for each tile and seat (index (x * mapSizeY + y) * nbSeats + seatIndex)
+    std::vector<uint16_t> mVisionCounts;
+
+    //! \brief Seat index each tile gives vision to because it is claimed
+    ClaimedTiles mClaimedTiles;
+
+    std::vector<VisionSource> mSources;
+    //! \brief Index of each source in mSources
+    std::unordered_map<const GameEntity*, uint32_t> mSourceIndexes;
+
+    //! \brief Tiles that may have started or stopped blocking vision since the last update
+    std::vector<Tile*> mChangedTiles;
+    bool mAllSourcesDirty;
+
+    //! \brief Forgets every vision given and sets up the vision for the current seats and map size
+    void reset();
+
+    //! \brief Returns the index of the given seat. NO_SEAT if the seat is unknown
+    uint32_t getSeatIndex(const Seat* seat) const;
+
+    //! \brief Adds/removes one vision source on the given tile for the given seat only
+    void incrementCount(uint32_t seatIndex, Tile* tile);
+    void decrementCount(uint32_t seatIndex, Tile* tile);
+
+    //! \brief Adds/removes one vision source on the given tile for the given seat and its allies
+    void addVision(uint32_t seatIndex, Tile* tile);
+    void removeVision(uint32_t seatIndex, Tile* tile);
+
+    //! \brief Adds/removes the vision given by the given claimed tile (on itself and its neighbors)
+    void addClaimedTileVision(uint32_t seatIndex, Tile* tile);
+    void removeClaimedTileVision(uint32_t seatIndex, Tile* tile);
+};
+
+#endif // VISIONMANAGER_H
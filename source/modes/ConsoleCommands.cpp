@@ -15,6 +15,7 @@
 #include "utils/ConfigManager.h"
 #include "utils/Helper.h"
 #include "utils/LogManager.h"
+#include "utils/ResourceManager.h"
 
 #include <OgreCamera.h>
 #include <OgreSceneManager.h>
@@ -432,6 +433,43 @@ Command::Result cSetCameraFOVy(const Command::ArgumentList_t& args, ConsoleInter
     return Command::Result::SUCCESS;
 }
 
+Command::Result cReplaySpeed(const Command::ArgumentList_t& args, ConsoleInterface& c, AbstractModeManager&)
+{
+    if(args.size() < 2)
+    {
+        c.print("ERROR: Needs the replay speed");
+        return Command::Result::INVALID_ARGUMENT;
+    }
+
+    double speed = Helper::toDouble(args[1]);
+    if(!ODClient::getSingleton().setReplaySpeed(speed))
+    {
+        c.print("ERROR: Cannot set replay speed to " + args[1] + ". Is a replay played?");
+        return Command::Result::FAILED;
+    }
+
+    c.print("Replay speed set to: " + Helper::toString(speed));
+    return Command::Result::SUCCESS;
+}
+
+Command::Result cReplaySeek(const Command::ArgumentList_t& args, ConsoleInterface& c, AbstractModeManager&)
+{
+    if(args.size() < 2)
+    {
+        c.print("ERROR: Needs the turn to reach");
+        return Command::Result::INVALID_ARGUMENT;
+    }
+
+    int64_t turn = Helper::toInt(args[1]);
+    if(!ODClient::getSingleton().seekReplayTurn(turn))
+    {
+        c.print("ERROR: Cannot reach turn " + args[1] + ". Is an indexed replay played?");
+        return Command::Result::FAILED;
+    }
+
+    return Command::Result::SUCCESS;
+}
+
 Command::Result cListMeshAnims(const Command::ArgumentList_t& args, ConsoleInterface& c, AbstractModeManager&)
 {
     if(args.size() < 2)
@@ -450,6 +488,61 @@ Command::Result cSrvUnlockSkills(const Command::ArgumentList_t& args, ConsoleInt
     return Command::Result::SUCCESS;
 }
 
+Command::Result cSrvProfileTurns(const Command::ArgumentList_t& args, ConsoleInterface& c, GameMap& gameMap)
+{
+    TurnProfiler& profiler = gameMap.getTurnProfiler();
+    const std::string action = (args.size() < 2) ? "summary" : args[1];
+    if((action == "on") || (action == "off"))
+    {
+        profiler.setEnabled(action == "on");
+        c.print("\nTurn profiler " + action);
+        return Command::Result::SUCCESS;
+    }
+
+    if(action == "clear")
+    {
+        profiler.clearHistory();
+        return Command::Result::SUCCESS;
+    }
+
+    if(action == "summary")
+    {
+        uint32_t nbSlowestTurns = (args.size() < 3) ? 5 : Helper::toUInt32(args[2]);
+        c.print("\n" + profiler.getSummary(nbSlowestTurns));
+        return Command::Result::SUCCESS;
+    }
+
+    if((action == "csv") || (action == "trace"))
+    {
+        if(args.size() < 3)
+            return Command::Result::INVALID_ARGUMENT;
+
+        // The file name comes from a client. We only accept a plain name and write it in the profile folder
+        // of the server so that no other file can be overwritten
+        const std::string& fileName = args[2];
+        if(fileName.empty() || (fileName.find_first_of("/\\:") != std::string::npos) ||
+           (fileName.find("..") != std::string::npos))
+        {
+            c.print("\nERROR: Expected a file name without folder");
+            return Command::Result::INVALID_ARGUMENT;
+        }
+
+        const std::string& profilePath = ResourceManager::getSingleton().getTurnProfilePath();
+        if(profilePath.empty())
+            return Command::Result::FAILED;
+
+        const std::string filePath = profilePath + fileName;
+        bool saved = (action == "csv") ? profiler.saveCsv(filePath) : profiler.saveChromeTrace(filePath);
+        if(!saved)
+            return Command::Result::FAILED;
+
+        c.print("\nTurn profile saved in " + filePath);
+        return Command::Result::SUCCESS;
+    }
+
+    return Command::Result::INVALID_ARGUMENT;
+}
+
 Command::Result cKeys(const Command::ArgumentList_t&, ConsoleInterface& c, AbstractModeManager&)
 {
     c.print("|| Action               || US Keyboard layout ||     Mouse      ||\n\
@@ -608,6 +701,19 @@ void addConsoleCommands(ConsoleInterface& cl)
                    cSetCameraFOVy,
                    Command::cStubServer,
                    {AbstractModeManager::ModeType::GAME, AbstractModeManager::ModeType::EDITOR});
+    cl.addCommand("replayspeed",
+                   "When playing a replay, sets how many times faster than real time it is played.\n\nExample:\n"
+                   "replayspeed 8",
+                   cReplaySpeed,
+                   Command::cStubServer,
+                   {AbstractModeManager::ModeType::GAME});
+    cl.addCommand("replayseek",
+                   "When playing a replay, plays it as fast as possible until the given turn is reached. "
+                   "It is not possible to go back.\n\nExample:\n"
+                   "replayseek 1500",
+                   cReplaySeek,
+                   Command::cStubServer,
+                   {AbstractModeManager::ModeType::GAME});
     cl.addCommand("addgold",
                    "'addgold' adds the given amount of gold to one player. It takes as arguments the ID of the player to"
                    "whom the gold should be given and the amount. If the player's treasuries are full, no more gold is given."
@@ -669,6 +775,16 @@ void addConsoleCommands(ConsoleInterface& cl)
                    cSendCmdToServer,
                    cSrvUnlockSkills,
                    {AbstractModeManager::ModeType::GAME});
+    cl.addCommand("profileturns",
+                   "'profileturns' measures the time spent in each phase of the server turns and keeps the last turns.\n"
+                   "profileturns on|off\tStarts or stops measuring the turns.\n"
+                   "profileturns [summary] [n]\tPrints the average turn and the n slowest turns with their main phases.\n"
+                   "profileturns csv <file>\tSaves the measured turns in the given csv file, in the profiles folder of the server.\n"
+                   "profileturns trace <file>\tSaves the measured turns as a Chrome trace (chrome://tracing), in the profiles folder of the server.\n"
+                   "profileturns clear\tForgets the measured turns.",
+                   cSendCmdToServer,
+                   cSrvProfileTurns,
+                   {AbstractModeManager::ModeType::GAME});
 
 }
 
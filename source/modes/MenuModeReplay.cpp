@@ -23,8 +23,10 @@
 #include "sound/MusicPlayer.h"
 #include "gamemap/GameMap.h"
 #include "render/ODFrameListener.h"
+#include "network/ClientNotification.h"
 #include "network/ODServer.h"
 #include "network/ODClient.h"
+#include "network/ReplayReader.h"
 #include "network/ServerNotification.h"
 #include "ODApplication.h"
 #include "utils/LogManager.h"
@@ -218,18 +220,24 @@ bool MenuModeReplay::listReplaysClicked(const CEGUI::EventArgs&)
 bool MenuModeReplay::checkReplayValid(const std::string& replayFileName, std::string& mapDescription, std::string& errorMsg)
 {
     // We open the replay to get the level file name
-    std::ifstream is(replayFileName, std::ios::in | std::ios::binary);
+    ReplayReader reader;
     ODPacket packet;
     ServerNotificationType type;
-    do
+    bool isLevelFound = false;
+    if(reader.open(replayFileName))
     {
-        packet.readPacket(is);
-        OD_ASSERT_TRUE(packet >> type);
-        if(is.eof())
+        while(reader.readPacket(packet) >= 0)
+        {
+            OD_ASSERT_TRUE(packet >> type);
+            if(type != ServerNotificationType::loadLevel)
+                continue;
+
+            isLevelFound = true;
             break;
-    } while(type != ServerNotificationType::loadLevel);
+        }
+    }
 
-    if(is.eof())
+    if(!isLevelFound)
     {
         errorMsg = "Invalid replay file";
         return false;
@@ -249,7 +257,7 @@ bool MenuModeReplay::checkReplayValid(const std::string& replayFileName, std::st
     // LevelDescription
     OD_ASSERT_TRUE(packet >> mapDescription);
 
-    if(odVersion.compare(std::string("OpenDungeons V ") + ODApplication::VERSION) != 0)
+    if(odVersion.compare(ClientNotification::getProtocolVersion(ODApplication::VERSION)) != 0)
     {
         errorMsg = odVersion + " (Wrong version)\n\n" + mapDescription;
         return false;
@@ -19,12 +19,19 @@
 #include "utils/LogManager.h"
 #include "utils/Helper.h"
 
+const uint32_t ClientNotification::PROTOCOL_VERSION = 3;
+
 ClientNotification::ClientNotification(ClientNotificationType type):
         mType(type)
 {
     mPacket << type;
 }
 
+std::string ClientNotification::getProtocolVersion(const std::string& applicationVersion)
+{
+    return "OpenDungeons V " + applicationVersion + " protocol " + Helper::toString(PROTOCOL_VERSION);
+}
+
 std::string ClientNotification::typeString(ClientNotificationType type)
 {
     switch(type)
@@ -84,6 +84,14 @@ public:
 
     static std::string typeString(ClientNotificationType type);
 
+    /*! \brief Version sent by the client in the hello message. The server refuses the clients that do not send the
+     * same one, so it is also used to check replays. Besides the application version, it contains PROTOCOL_VERSION.
+     */
+    static std::string getProtocolVersion(const std::string& applicationVersion);
+
+    //! \brief Should be incremented each time the layout of a message exchanged by the client and the server changes
+    static const uint32_t PROTOCOL_VERSION;
+
 private:
     ClientNotificationType mType;
 };
@@ -0,0 +1,175 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "network/CommandLog.h"
+
+#include "network/ReplayReader.h"
+#include "utils/Helper.h"
+#include "utils/LogManager.h"
+
+const int64_t CommandLog::CHECKSUM_PERIOD = 10;
+
+//! \brief Version of the records. Should be increased each time they change
+static const uint32_t COMMAND_LOG_VERSION = 1;
+static const std::string COMMAND_LOG_MAGIC = "ODCommandLog";
+
+//! \brief The first record is the game configuration. The others are commands or checksums
+enum CommandLogRecordType : uint8_t
+{
+    commandLogRecordConfig,
+    commandLogRecordCommand,
+    commandLogRecordChecksum
+};
+
+CommandLog::CommandLog() :
+    mIsRecording(false),
+    mSeed(0)
+{
+}
+
+bool CommandLog::startRecording(const std::string& fileName, const std::string& levelFilename, uint64_t seed,
+    const std::vector<SeatConfig>& seats)
+{
+    stopRecording();
+    if(!mRecorder.start(fileName))
+        return false;
+
+    mIsRecording = true;
+    ODPacket packet;
+    packet << static_cast<uint8_t>(commandLogRecordConfig) << COMMAND_LOG_MAGIC << COMMAND_LOG_VERSION
+        << levelFilename << seed;
+    uint32_t nbSeats = static_cast<uint32_t>(seats.size());
+    packet << nbSeats;
+    for(const SeatConfig& seat : seats)
+        packet << seat.mSeatId << seat.mConfigPlayerId << seat.mFaction << seat.mTeamId;
+
+    // The replay timestamps are not used: the records are ordered by turn
+    mRecorder.record(0, 0, packet);
+    return true;
+}
+
+void CommandLog::recordCommand(int64_t turn, int32_t seatId, const ODPacket& packet)
+{
+    if(!mIsRecording)
+        return;
+
+    ODPacket record;
+    record << static_cast<uint8_t>(commandLogRecordCommand) << turn << seatId;
+    record.appendPacket(packet);
+    mRecorder.record(0, turn, record);
+}
+
+void CommandLog::recordChecksum(int64_t turn, uint64_t checksum)
+{
+    if(!mIsRecording)
+        return;
+
+    ODPacket record;
+    record << static_cast<uint8_t>(commandLogRecordChecksum) << turn << checksum;
+    mRecorder.record(0, turn, record);
+}
+
+void CommandLog::stopRecording()
+{
+    if(!mIsRecording)
+        return;
+
+    mRecorder.stop();
+    mIsRecording = false;
+}
+
+bool CommandLog::load(const std::string& fileName)
+{
+    mSeats.clear();
+    mCommands.clear();
+    mChecksums.clear();
+
+    ReplayReader reader;
+    if(!reader.open(fileName))
+        return false;
+
+    ODPacket packet;
+    uint8_t recordType;
+    std::string magic;
+    uint32_t version;
+    uint32_t nbSeats;
+    if((reader.readPacket(packet) < 0) ||
+       !(packet >> recordType) ||
+       (recordType != commandLogRecordConfig) ||
+       !(packet >> magic >> version) ||
+       (magic != COMMAND_LOG_MAGIC) ||
+       (version != COMMAND_LOG_VERSION) ||
+       !(packet >> mLevelFilename >> mSeed >> nbSeats))
+    {
+        OD_LOG_ERR("Not a command log version " + Helper::toString(COMMAND_LOG_VERSION) + ": " + fileName);
+        return false;
+    }
+
+    for(uint32_t i = 0; i < nbSeats; ++i)
+    {
+        SeatConfig seat;
+        if(!(packet >> seat.mSeatId >> seat.mConfigPlayerId >> seat.mFaction >> seat.mTeamId))
+        {
+            OD_LOG_ERR("Invalid seats in command log " + fileName);
+            return false;
+        }
+        mSeats.push_back(seat);
+    }
+
+    while(reader.readPacket(packet) >= 0)
+    {
+        int64_t turn;
+        if(!(packet >> recordType >> turn))
+        {
+            OD_LOG_ERR("Invalid record in command log " + fileName);
+            return false;
+        }
+
+        switch(recordType)
+        {
+            case commandLogRecordCommand:
+            {
+                Command command;
+                command.mTurn = turn;
+                if(!(packet >> command.mSeatId) || !packet.extractPacket(command.mPacket))
+                {
+                    OD_LOG_ERR("Invalid command in command log " + fileName + " at turn " + Helper::toString(turn));
+                    return false;
+                }
+                mCommands.push_back(command);
+                break;
+            }
+            case commandLogRecordChecksum:
+            {
+                uint64_t checksum;
+                if(!(packet >> checksum))
+                {
+                    OD_LOG_ERR("Invalid checksum in command log " + fileName + " at turn " + Helper::toString(turn));
+                    return false;
+                }
+                mChecksums[turn] = checksum;
+                break;
+            }
+            default:
+                OD_LOG_ERR("Unknown record type=" + Helper::toString(static_cast<uint32_t>(recordType))
+                    + " in command log " + fileName);
+                return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,109 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMMANDLOG_H
+#define COMMANDLOG_H
+
+#include "network/ODPacket.h"
+#include "network/ReplayRecorder.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/*! \brief Everything needed to play a game again: the level, the random seed, the seats configuration and the
+ * player commands applied at each turn. The game state checksum is saved periodically so that a game played from
+ * the log can detect when it desyncs.
+ * It is only used to check the server simulation is deterministic: the clients are not involved and still
+ * receive the full game state.
+ *
+ * The log is a replay file (see ReplayReader) where each packet is a record: a record type followed by its data.
+ * It is written from a dedicated thread by a ReplayRecorder.
+ */
+class CommandLog
+{
+public:
+    //! \brief Configuration of a seat when the game was launched
+    struct SeatConfig
+    {
+        int32_t mSeatId;
+        //! \brief Same meaning as Seat::getConfigPlayerId (inactive, AI type or human)
+        int32_t mConfigPlayerId;
+        std::string mFaction;
+        int32_t mTeamId;
+    };
+
+    //! \brief Command sent by the player of the given seat (the packet starts with the ClientNotificationType)
+    struct Command
+    {
+        int64_t mTurn;
+        int32_t mSeatId;
+        ODPacket mPacket;
+    };
+
+    //! \brief Number of turns between 2 saved checksums
+    static const int64_t CHECKSUM_PERIOD;
+
+    CommandLog();
+
+    //! \brief Creates the given file and writes the game configuration. Returns false if the file cannot be created
+    bool startRecording(const std::string& fileName, const std::string& levelFilename, uint64_t seed,
+        const std::vector<SeatConfig>& seats);
+
+    void recordCommand(int64_t turn, int32_t seatId, const ODPacket& packet);
+
+    void recordChecksum(int64_t turn, uint64_t checksum);
+
+    //! \brief Writes the remaining records and closes the file
+    void stopRecording();
+
+    inline bool isRecording() const
+    { return mIsRecording; }
+
+    //! \brief Reads the given log. Returns false if it cannot be read or if it is not a command log
+    bool load(const std::string& fileName);
+
+    inline const std::string& getLevelFilename() const
+    { return mLevelFilename; }
+
+    inline uint64_t getSeed() const
+    { return mSeed; }
+
+    inline const std::vector<SeatConfig>& getSeats() const
+    { return mSeats; }
+
+    //! \brief The commands in the order they were applied
+    inline const std::vector<Command>& getCommands() const
+    { return mCommands; }
+
+    //! \brief The saved checksums by turn
+    inline const std::map<int64_t, uint64_t>& getChecksums() const
+    { return mChecksums; }
+
+private:
+    ReplayRecorder mRecorder;
+    bool mIsRecording;
+
+    std::string mLevelFilename;
+    uint64_t mSeed;
+    std::vector<SeatConfig> mSeats;
+    std::vector<Command> mCommands;
+    std::map<int64_t, uint64_t> mChecksums;
+};
+
+#endif // COMMANDLOG_H
@@ -0,0 +1,239 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "network/MultiGameServer.h"
+
+#include "network/ODServer.h"
+#include "network/ServerMode.h"
+#include "utils/Helper.h"
+#include "utils/LogManager.h"
+#include "ODApplication.h"
+
+#include <algorithm>
+
+//! \brief Delay before trying again to launch a game that could not be launched
+static const std::chrono::seconds LAUNCH_RETRY_DELAY(5);
+
+MultiGameServer::MultiGameServer() :
+    mUseMasterServer(false),
+    mTurnLength(0),
+    mIsStopping(false)
+{
+}
+
+MultiGameServer::~MultiGameServer()
+{
+    stop();
+}
+
+bool MultiGameServer::start(const std::string& creator, const std::string& levelFilename, bool useMasterServer,
+    uint32_t nbGames, int32_t firstPort, uint32_t nbThreads)
+{
+    mCreator = creator;
+    mLevelFilename = levelFilename;
+    mUseMasterServer = useMasterServer;
+    mTurnLength = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / ODApplication::turnsPerSecond));
+    mIsStopping = false;
+
+    // The games are reached through the server bound to the thread processing them
+    ODServer::setHostsManyServers(true);
+
+    if(!mReactor.start())
+    {
+        OD_LOG_ERR("Could not start the socket reactor");
+        ODServer::setHostsManyServers(false);
+        return false;
+    }
+
+    if(!mSender.start())
+    {
+        OD_LOG_ERR("Could not start the network sender");
+        mReactor.stop();
+        ODServer::setHostsManyServers(false);
+        return false;
+    }
+
+    uint32_t nbGamesLaunched = 0;
+    for(uint32_t i = 0; i < nbGames; ++i)
+    {
+        std::unique_ptr<HostedGame> game(new HostedGame);
+        game->mServer.reset(new ODServer);
+        game->mPort = firstPort + static_cast<int32_t>(i);
+        game->mHasReadySockets = false;
+        game->mIsProcessed = false;
+
+        // The level is loaded when launching. The game code should reach the server being launched
+        ODServer::setThreadServer(game->mServer.get());
+        game->mIsLaunched = launchGame(*game);
+        ODServer::setThreadServer(nullptr);
+
+        if(game->mIsLaunched)
+        {
+            ++nbGamesLaunched;
+            game->mNextTurnTime = std::chrono::steady_clock::now() + mTurnLength;
+        }
+        else
+        {
+            OD_LOG_ERR("Could not launch game on port " + Helper::toString(game->mPort));
+            game->mNextTurnTime = std::chrono::steady_clock::now() + LAUNCH_RETRY_DELAY;
+        }
+
+        mGames.push_back(std::move(game));
+    }
+
+    if(nbGamesLaunched == 0)
+    {
+        stop();
+        return false;
+    }
+
+    OD_LOG_INF("Hosting " + Helper::toString(nbGamesLaunched) + " games with "
+        + Helper::toString(std::max(nbThreads, 1u)) + " simulation threads");
+    for(uint32_t i = 0; i < std::max(nbThreads, 1u); ++i)
+        mThreads.emplace_back(&MultiGameServer::simulationThread, this);
+
+    return true;
+}
+
+void MultiGameServer::waitEnd()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this]() { return mIsStopping; });
+}
+
+void MultiGameServer::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsStopping = true;
+    }
+    mCondition.notify_all();
+
+    for(std::thread& thread : mThreads)
+        thread.join();
+    mThreads.clear();
+
+    // The servers are also deleted while bound because clearing a game map may reach its server
+    for(std::unique_ptr<HostedGame>& game : mGames)
+    {
+        ODServer::setThreadServer(game->mServer.get());
+        if(game->mIsLaunched)
+            game->mServer->stopServer();
+        game->mServer.reset();
+        ODServer::setThreadServer(nullptr);
+    }
+
+    mSender.stop();
+    mReactor.stop();
+    mGames.clear();
+    ODServer::setHostsManyServers(false);
+}
+
+void MultiGameServer::notifyGameReady(HostedGame* game)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    game->mHasReadySockets = true;
+    if(!game->mIsProcessed)
+        mCondition.notify_one();
+}
+
+void MultiGameServer::simulationThread()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while(!mIsStopping)
+    {
+        // We process the game that waits for the longest time (a game with messages to process is
+        // considered as due now)
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point wakeUpTime = now + LAUNCH_RETRY_DELAY;
+        std::chrono::steady_clock::time_point gameDueTime;
+        HostedGame* gameToProcess = nullptr;
+        for(std::unique_ptr<HostedGame>& game : mGames)
+        {
+            if(game->mIsProcessed)
+                continue;
+
+            std::chrono::steady_clock::time_point dueTime = game->mHasReadySockets ?
+                std::min(now, game->mNextTurnTime) : game->mNextTurnTime;
+            if(dueTime > now)
+            {
+                wakeUpTime = std::min(wakeUpTime, dueTime);
+                continue;
+            }
+
+            if((gameToProcess != nullptr) && (dueTime >= gameDueTime))
+                continue;
+
+            gameToProcess = game.get();
+            gameDueTime = dueTime;
+        }
+
+        if(gameToProcess == nullptr)
+        {
+            mCondition.wait_until(lock, wakeUpTime);
+            continue;
+        }
+
+        bool isTurnDue = (gameToProcess->mNextTurnTime <= now);
+        if(isTurnDue)
+        {
+            // If the game is late by more than a turn, we do not try to catch up
+            gameToProcess->mNextTurnTime += mTurnLength;
+            if(gameToProcess->mNextTurnTime < now)
+                gameToProcess->mNextTurnTime = now + mTurnLength;
+        }
+        gameToProcess->mHasReadySockets = false;
+        gameToProcess->mIsProcessed = true;
+
+        lock.unlock();
+        processGame(*gameToProcess, isTurnDue);
+        lock.lock();
+
+        gameToProcess->mIsProcessed = false;
+        if(!gameToProcess->mIsLaunched)
+            gameToProcess->mNextTurnTime = std::chrono::steady_clock::now() + LAUNCH_RETRY_DELAY;
+
+        // Messages may have been received while the game was processed
+        if(gameToProcess->mHasReadySockets)
+            mCondition.notify_one();
+    }
+}
+
+void MultiGameServer::processGame(HostedGame& game, bool isTurnDue)
+{
+    ODServer::setThreadServer(game.mServer.get());
+    if(!game.mIsLaunched)
+    {
+        if(isTurnDue)
+            game.mIsLaunched = launchGame(game);
+    }
+    else if(!game.mServer->processHostedTick(isTurnDue))
+    {
+        OD_LOG_INF("Game on port " + Helper::toString(game.mPort) + " is over. Launching it again");
+        game.mServer->stopServer();
+        game.mIsLaunched = launchGame(game);
+    }
+    ODServer::setThreadServer(nullptr);
+}
+
+bool MultiGameServer::launchGame(HostedGame& game)
+{
+    HostedGame* gamePtr = &game;
+    game.mServer->setHosted(&mReactor, &mSender, game.mPort, [this, gamePtr]() { notifyGameReady(gamePtr); });
+    return game.mServer->startServer(mCreator, mLevelFilename, ServerMode::ModeGameMultiPlayer, mUseMasterServer);
+}
@@ -0,0 +1,103 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MULTIGAMESERVER_H
+#define MULTIGAMESERVER_H
+
+#include "network/NetworkSender.h"
+#include "network/SocketReactor.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ODServer;
+
+/*! \brief Hosts many games in the same process.
+ *
+ * Each game has its own ODServer (and thus its own GameMap) listening on its own port. The sockets of every
+ * game are watched by a single SocketReactor, their packets are sent by a single NetworkSender and the games
+ * are processed by a pool of simulation threads: a game is processed when one of its sockets can be read or
+ * when its next turn is due. A game is only processed by one thread at a time and the thread is bound to its
+ * server while processing it (see ODServer::getSingleton). When a game is over, it is launched again on the
+ * same port.
+ */
+class MultiGameServer
+{
+public:
+    MultiGameServer();
+    ~MultiGameServer();
+
+    /*! \brief Launches nbGames games of the given level listening on consecutive ports starting from firstPort.
+     * The games are processed by nbThreads simulation threads. Returns false if no game could be launched
+     */
+    bool start(const std::string& creator, const std::string& levelFilename, bool useMasterServer,
+        uint32_t nbGames, int32_t firstPort, uint32_t nbThreads);
+
+    //! \brief Blocks the calling thread until stop is called
+    void waitEnd();
+
+    void stop();
+
+private:
+    struct HostedGame
+    {
+        std::unique_ptr<ODServer> mServer;
+        int32_t mPort;
+        bool mIsLaunched;
+        //! \brief Time at which the next turn should be played (or the launch retried if the game is not launched)
+        std::chrono::steady_clock::time_point mNextTurnTime;
+        //! \brief Set from the reactor thread when a socket of the game can be read
+        bool mHasReadySockets;
+        //! \brief True while a simulation thread processes the game
+        bool mIsProcessed;
+    };
+
+    std::string mCreator;
+    std::string mLevelFilename;
+    bool mUseMasterServer;
+    std::chrono::steady_clock::duration mTurnLength;
+
+    SocketReactor mReactor;
+    NetworkSender mSender;
+    std::vector<std::thread> mThreads;
+
+    //! \brief Protects the members below
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<std::unique_ptr<HostedGame>> mGames;
+    bool mIsStopping;
+
+    void simulationThread();
+
+    //! \brief Called from the reactor thread when a socket of the given game can be read
+    void notifyGameReady(HostedGame* game);
+
+    //! \brief Launches the game if needed and processes it. Called from a simulation thread without
+    //! mMutex locked
+    void processGame(HostedGame& game, bool isTurnDue);
+
+    //! \brief Launches the server of the given game. Returns false if the game could not be launched
+    bool launchGame(HostedGame& game);
+};
+
+#endif // MULTIGAMESERVER_H
@@ -0,0 +1,357 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "network/NetworkSender.h"
+
+#include "network/SocketHandle.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+//! \brief Maximum time the sending thread waits for a socket before checking if it should stop
+static const int SENDER_WAIT_MS = 100;
+#endif
+
+const uint32_t NetworkSender::MAX_QUEUED_BYTES = 4 * 1024 * 1024;
+
+class NetworkSender::Outbound
+{
+public:
+    Outbound(sf::TcpSocket& socket) :
+        mSocket(socket),
+        mOffset(0),
+        mQueuedBytes(0),
+        mHasFailed(false),
+        mIsDetached(false),
+        mIsSending(false)
+    {
+    }
+
+    //! \brief Drops the frames not sent yet
+    void clearFrames()
+    {
+        mFrames.clear();
+        mOffset = 0;
+        mQueuedBytes = 0;
+    }
+
+    sf::TcpSocket& mSocket;
+    //! \brief Frames as written on the socket: the packet size (big endian) followed by the packet data,
+    //! like sf::TcpSocket::send(sf::Packet&) does
+    std::deque<std::vector<char>> mFrames;
+    //! \brief Number of bytes of the first frame already sent
+    size_t mOffset;
+    uint32_t mQueuedBytes;
+    bool mHasFailed;
+    bool mIsDetached;
+    //! \brief (Windows) True while the sending thread sends a frame without mMutex locked
+    bool mIsSending;
+};
+
+NetworkSender::NetworkSender() :
+    mIsStopping(false)
+{
+#ifndef _WIN32
+    mWakeUpPipe[0] = -1;
+    mWakeUpPipe[1] = -1;
+#endif
+}
+
+NetworkSender::~NetworkSender()
+{
+    stop();
+}
+
+bool NetworkSender::start()
+{
+    stop();
+
+#ifndef _WIN32
+    if(pipe(mWakeUpPipe) != 0)
+        return false;
+
+    // A full pipe means the thread will wake up anyway
+    fcntl(mWakeUpPipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(mWakeUpPipe[1], F_SETFL, O_NONBLOCK);
+#endif
+
+    mIsStopping = false;
+    mThread = std::thread(&NetworkSender::senderThread, this);
+    return true;
+}
+
+void NetworkSender::stop()
+{
+    if(!mThread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsStopping = true;
+#ifndef _WIN32
+        wakeUp();
+#endif
+    }
+    mCondition.notify_all();
+    mThread.join();
+
+#ifndef _WIN32
+    close(mWakeUpPipe[0]);
+    close(mWakeUpPipe[1]);
+    mWakeUpPipe[0] = -1;
+    mWakeUpPipe[1] = -1;
+#endif
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    for(std::shared_ptr<Outbound>& outbound : mOutbounds)
+        outbound->mIsDetached = true;
+    mOutbounds.clear();
+}
+
+std::shared_ptr<NetworkSender::Outbound> NetworkSender::attach(sf::TcpSocket& socket)
+{
+    std::shared_ptr<Outbound> outbound = std::make_shared<Outbound>(socket);
+    std::lock_guard<std::mutex> lock(mMutex);
+    mOutbounds.push_back(outbound);
+    return outbound;
+}
+
+void NetworkSender::detach(const std::shared_ptr<Outbound>& outbound)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    outbound->mIsDetached = true;
+#ifdef _WIN32
+    mCondition.wait(lock, [&outbound]() { return !outbound->mIsSending; });
+#endif
+    outbound->clearFrames();
+    mOutbounds.erase(std::remove(mOutbounds.begin(), mOutbounds.end(), outbound), mOutbounds.end());
+}
+
+bool NetworkSender::push(Outbound& outbound, const sf::Packet& packet)
+{
+    uint32_t size = static_cast<uint32_t>(packet.getDataSize());
+    uint32_t frameSize = size + sizeof(uint32_t);
+
+    // We copy the packet before locking so that the sending thread is not blocked while we do
+    std::vector<char> frame(frameSize);
+    frame[0] = static_cast<char>((size >> 24) & 0xFF);
+    frame[1] = static_cast<char>((size >> 16) & 0xFF);
+    frame[2] = static_cast<char>((size >> 8) & 0xFF);
+    frame[3] = static_cast<char>(size & 0xFF);
+    if(size > 0)
+        std::memcpy(frame.data() + sizeof(uint32_t), packet.getData(), size);
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(outbound.mHasFailed || outbound.mIsDetached || !mThread.joinable())
+            return false;
+
+        if(outbound.mQueuedBytes + frameSize > MAX_QUEUED_BYTES)
+        {
+            // The client does not read fast enough. The frames already queued are useless since the
+            // client will miss this one
+            outbound.mHasFailed = true;
+            outbound.clearFrames();
+            return false;
+        }
+
+        outbound.mFrames.push_back(std::move(frame));
+        outbound.mQueuedBytes += frameSize;
+#ifndef _WIN32
+        // If frames were already queued, the sending thread is waiting for the socket
+        if(outbound.mFrames.size() == 1)
+            wakeUp();
+#endif
+    }
+    mCondition.notify_all();
+    return true;
+}
+
+bool NetworkSender::flush(Outbound& outbound, const std::chrono::steady_clock::time_point& deadline)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait_until(lock, deadline, [this, &outbound]()
+    {
+        if(outbound.mHasFailed || outbound.mIsDetached || mIsStopping || !mThread.joinable())
+            return true;
+
+        return outbound.mFrames.empty() && !outbound.mIsSending;
+    });
+    return outbound.mFrames.empty() && !outbound.mIsSending && !outbound.mHasFailed && !outbound.mIsDetached;
+}
+
+uint32_t NetworkSender::getQueuedBytes(const Outbound& outbound)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return outbound.mQueuedBytes;
+}
+
+#ifndef _WIN32
+void NetworkSender::wakeUp()
+{
+    char byte = 0;
+    if(write(mWakeUpPipe[1], &byte, sizeof(byte)) < 0)
+    {
+        // The pipe is full: the thread will wake up anyway
+    }
+}
+
+void NetworkSender::sendFrames(Outbound& outbound)
+{
+    int fd = SocketHandle::get(outbound.mSocket);
+    while(!outbound.mFrames.empty())
+    {
+        const std::vector<char>& frame = outbound.mFrames.front();
+        ssize_t nbSent = ::send(fd, frame.data() + outbound.mOffset, frame.size() - outbound.mOffset,
+            MSG_DONTWAIT | MSG_NOSIGNAL);
+        if(nbSent < 0)
+        {
+            if((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+                return;
+
+            outbound.mHasFailed = true;
+            outbound.clearFrames();
+            return;
+        }
+
+        outbound.mOffset += static_cast<size_t>(nbSent);
+        if(outbound.mOffset < frame.size())
+            return;
+
+        outbound.mQueuedBytes -= static_cast<uint32_t>(frame.size());
+        outbound.mOffset = 0;
+        outbound.mFrames.pop_front();
+    }
+}
+
+void NetworkSender::senderThread()
+{
+    std::vector<pollfd> pollFds;
+    std::vector<std::shared_ptr<Outbound>> outbounds;
+    std::unique_lock<std::mutex> lock(mMutex);
+    while(!mIsStopping)
+    {
+        // The first entry is the wake up pipe. Then, we wait for the sockets having frames to send
+        pollFds.clear();
+        outbounds.clear();
+        pollfd wakeUpFd;
+        wakeUpFd.fd = mWakeUpPipe[0];
+        wakeUpFd.events = POLLIN;
+        wakeUpFd.revents = 0;
+        pollFds.push_back(wakeUpFd);
+        for(std::shared_ptr<Outbound>& outbound : mOutbounds)
+        {
+            if(outbound->mFrames.empty() || outbound->mHasFailed)
+                continue;
+
+            pollfd socketFd;
+            socketFd.fd = SocketHandle::get(outbound->mSocket);
+            socketFd.events = POLLOUT;
+            socketFd.revents = 0;
+            pollFds.push_back(socketFd);
+            outbounds.push_back(outbound);
+        }
+
+        lock.unlock();
+        int nbReady = poll(pollFds.data(), static_cast<nfds_t>(pollFds.size()), SENDER_WAIT_MS);
+        lock.lock();
+
+        if(nbReady <= 0)
+            continue;
+
+        if((pollFds[0].revents & POLLIN) != 0)
+        {
+            char buffer[64];
+            while(read(mWakeUpPipe[0], buffer, sizeof(buffer)) > 0)
+            {
+            }
+        }
+
+        // The queues detached while we were waiting may have had their socket closed. We do not use them
+        for(uint32_t i = 0; i < outbounds.size(); ++i)
+        {
+            Outbound& outbound = *outbounds[i];
+            if(outbound.mIsDetached || outbound.mHasFailed)
+                continue;
+
+            if((pollFds[i + 1].revents & (POLLOUT | POLLERR | POLLHUP)) == 0)
+                continue;
+
+            sendFrames(outbound);
+        }
+        // flush may be waiting for the frames to be sent
+        mCondition.notify_all();
+    }
+}
+#else
+void NetworkSender::senderThread()
+{
+    // SFML sockets cannot be written without blocking on every platform. We send the frames one by one,
+    // going through the queues in turn so that a client does not delay the others for more than one frame
+    uint32_t nextIndex = 0;
+    std::unique_lock<std::mutex> lock(mMutex);
+    while(!mIsStopping)
+    {
+        std::shared_ptr<Outbound> outbound;
+        for(uint32_t i = 0; i < mOutbounds.size(); ++i)
+        {
+            uint32_t index = (nextIndex + i) % mOutbounds.size();
+            if(mOutbounds[index]->mFrames.empty() || mOutbounds[index]->mHasFailed)
+                continue;
+
+            outbound = mOutbounds[index];
+            nextIndex = index + 1;
+            break;
+        }
+
+        if(outbound == nullptr)
+        {
+            mCondition.wait(lock);
+            continue;
+        }
+
+        std::vector<char> frame = std::move(outbound->mFrames.front());
+        outbound->mFrames.pop_front();
+        outbound->mQueuedBytes -= static_cast<uint32_t>(frame.size());
+        outbound->mIsSending = true;
+
+        lock.unlock();
+        sf::Socket::Status status = outbound->mSocket.send(frame.data(), frame.size());
+        lock.lock();
+
+        outbound->mIsSending = false;
+        if(status != sf::Socket::Done)
+        {
+            outbound->mHasFailed = true;
+            outbound->clearFrames();
+        }
+        // detach or flush may be waiting for the frame to be sent
+        mCondition.notify_all();
+    }
+}
+#endif
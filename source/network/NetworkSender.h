@@ -0,0 +1,99 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NETWORKSENDER_H
+#define NETWORKSENDER_H
+
+#include <SFML/Network.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*! \brief Sends the packets of many sockets from a dedicated thread.
+ *
+ * Each attached socket has its own queue of frames. Pushing a packet copies it to the queue and returns
+ * immediately: the sending thread writes the queued frames when the socket can accept them. Thus, the
+ * thread processing the game never waits for the network. On POSIX systems, the sockets are written without
+ * blocking so that a slow client does not delay the others. On Windows, the frames are sent with the blocking
+ * SFML calls from the sending thread.
+ * A queue cannot hold more than MAX_QUEUED_BYTES. When a client falls that far behind (or its socket fails),
+ * push returns false and the client should be dropped: the queued frames are lost anyway.
+ * Detaching a queue drops the frames it still holds. To have them sent (for example before disconnecting the
+ * clients on shutdown), flush should be called first.
+ */
+class NetworkSender
+{
+public:
+    //! \brief Maximum size of the frames waiting to be sent to a socket
+    static const uint32_t MAX_QUEUED_BYTES;
+
+    //! \brief Queue of an attached socket
+    class Outbound;
+
+    NetworkSender();
+    ~NetworkSender();
+
+    bool start();
+    void stop();
+
+    //! \brief Attaches the given socket. The packets pushed to the returned queue will be sent through it
+    std::shared_ptr<Outbound> attach(sf::TcpSocket& socket);
+
+    //! \brief Detaches the given queue. The frames not sent yet are dropped. Once this returns, the socket is not
+    //! used anymore by the sending thread so it can be closed
+    void detach(const std::shared_ptr<Outbound>& outbound);
+
+    //! \brief Queues the given packet. Returns false if the queue is full or if sending failed
+    bool push(Outbound& outbound, const sf::Packet& packet);
+
+    //! \brief Waits until the frames queued for the given queue are sent or until the deadline. Returns true if
+    //! every frame was sent
+    bool flush(Outbound& outbound, const std::chrono::steady_clock::time_point& deadline);
+
+    //! \brief Returns the size of the frames waiting to be sent through the given queue
+    uint32_t getQueuedBytes(const Outbound& outbound);
+
+private:
+    std::thread mThread;
+
+    //! \brief Protects the members below and the attached queues
+    std::mutex mMutex;
+    //! \brief Notified when frames are pushed and when frames have been sent
+    std::condition_variable mCondition;
+    std::vector<std::shared_ptr<Outbound>> mOutbounds;
+    bool mIsStopping;
+
+#ifndef _WIN32
+    //! \brief Written to wake up the sending thread while it waits for sockets to be writable
+    int mWakeUpPipe[2];
+
+    //! \brief Wakes up the sending thread. mMutex should be locked
+    void wakeUp();
+    //! \brief Sends as many frames as the socket accepts without blocking. mMutex should be locked
+    void sendFrames(Outbound& outbound);
+#endif
+
+    void senderThread();
+};
+
+#endif // NETWORKSENDER_H
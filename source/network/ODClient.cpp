@@ -433,13 +433,12 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
 
         case ServerNotificationType::removeEntity:
         {
-            GameEntityType entityType;
-            std::string entityName;
-            OD_ASSERT_TRUE(packetReceived >> entityType >> entityName);
-            GameEntity* entity = gameMap->getEntityFromTypeAndName(entityType, entityName);
+            uint32_t handle;
+            OD_ASSERT_TRUE(packetReceived >> handle);
+            GameEntity* entity = gameMap->getEntityFromHandle(handle);
             if(entity == nullptr)
             {
-                OD_LOG_ERR("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", entityName=" + entityName);
+                OD_LOG_ERR("handle=" + Helper::toString(handle));
                 break;
             }
 
@@ -456,6 +455,7 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
             OD_LOG_INF("Client (" + getPlayer()->getNick() + ") received turnStarted="
                 + boost::lexical_cast<std::string>(turnNum));
 
+            setReplayTurn(turnNum);
             gameMap->clientUpKeep(turnNum);
             // We acknowledge the new turn to the server so that he knows we are
             // ready for next one
@@ -473,19 +473,19 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
 
         case ServerNotificationType::animatedObjectSetWalkPath:
         {
-            std::string objName;
+            uint32_t handle;
             std::string walkAnim;
             std::string endAnim;
             bool loopEndAnim;
             bool playIdleWhenAnimationEnds;
             uint32_t nbDest;
-            OD_ASSERT_TRUE(packetReceived >> objName >> walkAnim >> endAnim);
+            OD_ASSERT_TRUE(packetReceived >> handle >> walkAnim >> endAnim);
             OD_ASSERT_TRUE(packetReceived >> loopEndAnim >> playIdleWhenAnimationEnds >> nbDest);
 
-            MovableGameEntity *tempAnimatedObject = gameMap->getAnimatedObject(objName);
+            MovableGameEntity *tempAnimatedObject = dynamic_cast<MovableGameEntity*>(gameMap->getEntityFromHandle(handle));
             if(tempAnimatedObject == nullptr)
             {
-                OD_LOG_ERR("objName=" + objName);
+                OD_LOG_ERR("handle=" + Helper::toString(handle));
                 break;
             }
 
@@ -552,17 +552,17 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
 
         case ServerNotificationType::setObjectAnimationState:
         {
-            std::string objName;
+            uint32_t handle;
             std::string animState;
             bool loop;
             bool playIdleWhenAnimationEnds;
             bool shouldSetWalkDirection;
-            OD_ASSERT_TRUE(packetReceived >> objName >> animState
+            OD_ASSERT_TRUE(packetReceived >> handle >> animState
                 >> loop >> playIdleWhenAnimationEnds >> shouldSetWalkDirection);
-            MovableGameEntity *obj = gameMap->getAnimatedObject(objName);
+            MovableGameEntity *obj = dynamic_cast<MovableGameEntity*>(gameMap->getEntityFromHandle(handle));
             if (obj == nullptr)
             {
-                OD_LOG_ERR("objName=" + objName + ", state=" + animState);
+                OD_LOG_ERR("handle=" + Helper::toString(handle) + ", state=" + animState);
                 break;
             }
 
@@ -590,18 +590,16 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
         case ServerNotificationType::entitiesRefresh:
         {
             uint32_t nbEntities;
-            GameEntityType entityType;
-            std::string entityName;
+            uint32_t handle;
             OD_ASSERT_TRUE(packetReceived >> nbEntities);
             while(nbEntities > 0)
             {
                 --nbEntities;
-                OD_ASSERT_TRUE(packetReceived >> entityType);
-                OD_ASSERT_TRUE(packetReceived >> entityName);
-                GameEntity* entity = gameMap->getEntityFromTypeAndName(entityType, entityName);
+                OD_ASSERT_TRUE(packetReceived >> handle);
+                GameEntity* entity = gameMap->getEntityFromHandle(handle);
                 if(entity == nullptr)
                 {
-                    OD_LOG_ERR("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", entityName=" + entityName);
+                    OD_LOG_ERR("handle=" + Helper::toString(handle));
                     break;
                 }
 
@@ -638,14 +636,14 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
 
         case ServerNotificationType::setEntityOpacity:
         {
-            std::string entityName;
+            uint32_t handle;
             float opacity;
-            OD_ASSERT_TRUE(packetReceived >> entityName >> opacity);
+            OD_ASSERT_TRUE(packetReceived >> handle >> opacity);
 
-            RenderedMovableEntity* entity = gameMap->getRenderedMovableEntity(entityName);
+            RenderedMovableEntity* entity = dynamic_cast<RenderedMovableEntity*>(gameMap->getEntityFromHandle(handle));
             if(entity == nullptr)
             {
-                OD_LOG_ERR("entityName=" + entityName);
+                OD_LOG_ERR("handle=" + Helper::toString(handle));
                 break;
             }
 
@@ -828,21 +826,20 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
 
         case ServerNotificationType::carryEntity:
         {
-            std::string carrierName;
-            GameEntityType entityType;
-            std::string carriedName;
-            OD_ASSERT_TRUE(packetReceived >> carrierName >> entityType >> carriedName);
-            Creature* carrier = gameMap->getCreature(carrierName);
+            uint32_t carrierHandle;
+            uint32_t carriedHandle;
+            OD_ASSERT_TRUE(packetReceived >> carrierHandle >> carriedHandle);
+            Creature* carrier = dynamic_cast<Creature*>(gameMap->getEntityFromHandle(carrierHandle));
             if(carrier == nullptr)
             {
-                OD_LOG_ERR("carrierName=" + carrierName);
+                OD_LOG_ERR("carrierHandle=" + Helper::toString(carrierHandle));
                 break;
             }
 
-            GameEntity* carried = gameMap->getEntityFromTypeAndName(entityType, carriedName);
+            GameEntity* carried = gameMap->getEntityFromHandle(carriedHandle);
             if(carried == nullptr)
             {
-                OD_LOG_ERR("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", carriedName=" + carriedName);
+                OD_LOG_ERR("carriedHandle=" + Helper::toString(carriedHandle));
                 break;
             }
 
@@ -854,22 +851,21 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
 
         case ServerNotificationType::releaseCarriedEntity:
         {
-            std::string carrierName;
-            GameEntityType entityType;
-            std::string carriedName;
+            uint32_t carrierHandle;
+            uint32_t carriedHandle;
             Ogre::Vector3 pos;
-            OD_ASSERT_TRUE(packetReceived >> carrierName >> entityType >> carriedName >> pos);
-            Creature* carrier = gameMap->getCreature(carrierName);
+            OD_ASSERT_TRUE(packetReceived >> carrierHandle >> carriedHandle >> pos);
+            Creature* carrier = dynamic_cast<Creature*>(gameMap->getEntityFromHandle(carrierHandle));
             if(carrier == nullptr)
             {
-                OD_LOG_ERR("carrierName=" + carrierName);
+                OD_LOG_ERR("carrierHandle=" + Helper::toString(carrierHandle));
                 break;
             }
 
-            GameEntity* carried = gameMap->getEntityFromTypeAndName(entityType, carriedName);
+            GameEntity* carried = gameMap->getEntityFromHandle(carriedHandle);
             if(carried == nullptr)
             {
-                OD_LOG_ERR("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", carriedName=" + carriedName);
+                OD_LOG_ERR("carriedHandle=" + Helper::toString(carriedHandle));
                 break;
             }
 
@@ -1031,8 +1027,11 @@ bool ODClient::connect(const std::string& host, const int port, uint32_t timeout
 
     // Send a hello request to start the conversation with the server
     ODPacket packSend;
+    // Compression is only worth it if the server is not on this computer
+    bool useCompression = !isRemoteLoopback();
+    setUseCompression(useCompression);
     packSend << ClientNotificationType::hello
-        << std::string("OpenDungeons V ") + ODApplication::VERSION;
+        << ClientNotification::getProtocolVersion(ODApplication::VERSION) << useCompression;
     send(packSend);
 
     return true;
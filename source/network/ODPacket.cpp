@@ -17,12 +17,24 @@
 
 #include "network/ODPacket.h"
 
+#include <zlib.h>
+
+#include <cstring>
+#include <vector>
+
 #define OD_INT64TOINT32H(valInt64)              (static_cast<int32_t>(valInt64 >> 32))
 #define OD_INT64TOINT32L(valInt64)              (static_cast<int32_t>(valInt64))
 #define OD_INT32TOINT64(valInt32h,valInt32l)    ((((static_cast<int64_t>(valInt32h)) << 32) & static_cast<int64_t>(0xFFFFFFFF00000000)) + ((static_cast<int64_t>(valInt32l)) & static_cast<int64_t>(0x00000000FFFFFFFF)))
 
-// The max buffer size when reading packets.
-const int32_t BUFFER_SIZE = 1024;
+// Frames smaller than this are not worth compressing
+const uLong FRAME_COMPRESSION_MIN_SIZE = 256;
+// First byte of the frames sent through the network
+const sf::Uint8 FRAME_FLAG_RAW = 0;
+const sf::Uint8 FRAME_FLAG_COMPRESSED = 1;
+// The uncompressed size of a compressed frame is read from the network. It is checked before allocating it:
+// bigger frames are sent raw and deflate cannot compress more than about 1032:1
+const uLong FRAME_MAX_UNCOMPRESSED_SIZE = 64 * 1024 * 1024;
+const uint64_t FRAME_MAX_COMPRESSION_RATIO = 1032;
 
 ODPacket& ODPacket::operator >>(bool& data)
 {
@@ -243,37 +255,126 @@ void ODPacket::clear()
     mPacket.clear();
 }
 
-void ODPacket::writePacket(int32_t timestamp, std::ofstream& os)
+bool ODPacket::isEndOfPacket() const
+{
+    return mPacket.endOfPacket();
+}
+
+void ODPacket::appendPacket(const ODPacket& packet)
+{
+    // The content is written the same way sf::Packet writes strings (size followed by the raw data). That
+    // allows to export it as a string without parsing it
+    sf::Uint32 size = static_cast<sf::Uint32>(packet.mPacket.getDataSize());
+    mPacket << size;
+    mPacket.append(packet.mPacket.getData(), size);
+}
+
+bool ODPacket::extractPacket(ODPacket& packet)
+{
+    packet.clear();
+    if(mPacket.endOfPacket())
+        return false;
+
+    std::string data;
+    if(!(mPacket >> data))
+        return false;
+
+    packet.mPacket.append(data.data(), data.size());
+    return true;
+}
+
+void ODPacket::encodeFrame(const ODPacket& packet, bool compress, ODPacket& frame)
+{
+    frame.clear();
+    const Bytef* data = static_cast<const Bytef*>(packet.mPacket.getData());
+    uLong dataSize = static_cast<uLong>(packet.mPacket.getDataSize());
+    if(compress && (dataSize >= FRAME_COMPRESSION_MIN_SIZE) && (dataSize <= FRAME_MAX_UNCOMPRESSED_SIZE))
+    {
+        // We compress with the fastest level: the frames are compressed at each turn by the server
+        std::vector<Bytef> buffer(compressBound(dataSize));
+        uLongf bufferSize = static_cast<uLongf>(buffer.size());
+        if((compress2(buffer.data(), &bufferSize, data, dataSize, Z_BEST_SPEED) == Z_OK) &&
+           (bufferSize < dataSize))
+        {
+            sf::Uint8 flag = FRAME_FLAG_COMPRESSED;
+            sf::Uint32 size = static_cast<sf::Uint32>(dataSize);
+            frame.mPacket << flag << size;
+            frame.mPacket.append(buffer.data(), bufferSize);
+            return;
+        }
+    }
+
+    sf::Uint8 flag = FRAME_FLAG_RAW;
+    frame.mPacket << flag;
+    frame.mPacket.append(data, dataSize);
+}
+
+bool ODPacket::decodeFrame(const ODPacket& frame, ODPacket& packet)
+{
+    packet.clear();
+    const Bytef* data = static_cast<const Bytef*>(frame.mPacket.getData());
+    std::size_t dataSize = frame.mPacket.getDataSize();
+    if(dataSize < sizeof(sf::Uint8))
+        return false;
+
+    sf::Uint8 flag = data[0];
+    ++data;
+    --dataSize;
+    if(flag == FRAME_FLAG_RAW)
+    {
+        packet.mPacket.append(data, dataSize);
+        return true;
+    }
+
+    if((flag != FRAME_FLAG_COMPRESSED) || (dataSize < sizeof(sf::Uint32)))
+        return false;
+
+    // The uncompressed size is written in network byte order by sf::Packet
+    sf::Uint32 size = (static_cast<sf::Uint32>(data[0]) << 24) | (static_cast<sf::Uint32>(data[1]) << 16) |
+        (static_cast<sf::Uint32>(data[2]) << 8) | static_cast<sf::Uint32>(data[3]);
+    data += sizeof(sf::Uint32);
+    dataSize -= sizeof(sf::Uint32);
+    if((size > FRAME_MAX_UNCOMPRESSED_SIZE) ||
+       (static_cast<uint64_t>(size) > static_cast<uint64_t>(dataSize) * FRAME_MAX_COMPRESSION_RATIO))
+    {
+        return false;
+    }
+
+    std::vector<Bytef> buffer(size);
+    uLongf bufferSize = static_cast<uLongf>(size);
+    int status = uncompress(buffer.data(), &bufferSize, data, static_cast<uLong>(dataSize));
+    if((status != Z_OK) || (bufferSize != size))
+        return false;
+
+    packet.mPacket.append(buffer.data(), bufferSize);
+    return true;
+}
+
+void ODPacket::writePacket(int32_t timestamp, std::vector<char>& os) const
 {
     int32_t bufferSize = mPacket.getDataSize();
     const char* buffer = static_cast<const char*>(mPacket.getData());
-    os.write(reinterpret_cast<const char*>(&timestamp), sizeof(int32_t));
-    os.write(reinterpret_cast<const char*>(&bufferSize), sizeof(int32_t));
-    os.write(buffer, bufferSize);
+    os.reserve(os.size() + 2 * sizeof(int32_t) + bufferSize);
+    os.insert(os.end(), reinterpret_cast<const char*>(&timestamp), reinterpret_cast<const char*>(&timestamp) + sizeof(int32_t));
+    os.insert(os.end(), reinterpret_cast<const char*>(&bufferSize), reinterpret_cast<const char*>(&bufferSize) + sizeof(int32_t));
+    os.insert(os.end(), buffer, buffer + bufferSize);
 }
 
-int32_t ODPacket::readPacket(std::ifstream& is)
+int32_t ODPacket::readPacket(const char*& data, const char* end)
 {
     int32_t timestamp;
     int32_t packetSize;
-
-    is.read(reinterpret_cast<char*>(&timestamp), sizeof(int32_t));
-    if(is.eof())
+    if(end - data < static_cast<std::ptrdiff_t>(2 * sizeof(int32_t)))
         return -1;
 
-    is.read(reinterpret_cast<char*>(&packetSize), sizeof(int32_t));
-    if(is.eof())
+    std::memcpy(&timestamp, data, sizeof(int32_t));
+    std::memcpy(&packetSize, data + sizeof(int32_t), sizeof(int32_t));
+    if((packetSize < 0) || (end - data - static_cast<std::ptrdiff_t>(2 * sizeof(int32_t)) < packetSize))
         return -1;
 
+    data += 2 * sizeof(int32_t);
     mPacket.clear();
-    char buffer[BUFFER_SIZE];
-    while(packetSize > 0)
-    {
-        int32_t sizeToRead = std::min(packetSize, BUFFER_SIZE);
-        is.read(buffer, sizeToRead);
-        mPacket.append(buffer, sizeToRead);
-        packetSize -= sizeToRead;
-    }
-
+    mPacket.append(data, packetSize);
+    data += packetSize;
     return timestamp;
 }
@@ -23,6 +23,7 @@
 
 #include <string>
 #include <cstdint>
+#include <vector>
 
 /*! \brief This class is an utility class to transfer data through ODSocketClient.
  * It should also override operators << and >> for each standard types.
@@ -125,15 +126,40 @@ class ODPacket
          */
         void clear();
 
-        /*! \brief Writes the packet content to the given ofstream.
+        //! \brief Returns true if every data in the packet has been exported
+        bool isEndOfPacket() const;
+
+        /*! \brief Appends the whole content of the given packet so that several packets can be sent
+         * at once. It can be retrieved with extractPacket.
+         */
+        void appendPacket(const ODPacket& packet);
+
+        /*! \brief Exports a packet appended with appendPacket. The given packet is cleared before.
+         * Returns false if there is no packet to export.
+         */
+        bool extractPacket(ODPacket& packet);
+
+        /*! \brief Fills frame (cleared before) with the content of the given packet as it should be sent
+         * through the network. If compress is true and the packet is big enough, the content is compressed.
+         * The frame starts with a flag telling if it is compressed so that the receiver does not have to know.
+         */
+        static void encodeFrame(const ODPacket& packet, bool compress, ODPacket& frame);
+
+        /*! \brief Fills packet (cleared before) with the content of a frame written by encodeFrame.
+         * Returns false if the frame is corrupted or if its uncompressed size is not plausible.
+         */
+        static bool decodeFrame(const ODPacket& frame, ODPacket& packet);
+
+        /*! \brief Appends the packet content to the given buffer the way readPacket expects it
+         *         in a replay file.
          */
-        void writePacket(int32_t timestamp, std::ofstream& os);
+        void writePacket(int32_t timestamp, std::vector<char>& os) const;
 
-        /*! \brief Reads the packet content from the given ifstream.
-         *         Returns the timestamp at which the packet has been sent.
-         *         If EOF has been reached, returns -1
+        /*! \brief Reads the packet content written by writePacket from the given buffer and moves data
+         *         after it. Returns the timestamp at which the packet has been sent.
+         *         If there is no complete packet before end, returns -1
          */
-        int32_t readPacket(std::ifstream& is);
+        int32_t readPacket(const char*& data, const char* end);
 
         /*! \brief Template function to put arguments in a packet, used for in-place construction.
          */
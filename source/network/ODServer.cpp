@@ -31,7 +31,9 @@
 #include "game/Seat.h"
 #include "gamemap/GameMap.h"
 #include "gamemap/MapHandler.h"
+#include "gamemap/PathfindingBenchmark.h"
 #include "modes/ConsoleCommands.h"
+#include "network/ClientNotification.h"
 #include "network/ODClient.h"
 #include "network/ServerMode.h"
 #include "network/ServerNotification.h"
@@ -46,6 +48,7 @@
 #include "utils/Helper.h"
 #include "utils/LogManager.h"
 #include "utils/MasterServer.h"
+#include "utils/Random.h"
 #include "utils/ResourceManager.h"
 #include "ODApplication.h"
 
@@ -57,15 +60,22 @@
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <memory>
 
 const std::string SAVEGAME_SKIRMISH_PREFIX = "SK-";
 const std::string SAVEGAME_MULTIPLAYER_PREFIX = "MP-";
 static const double MASTER_SERVER_UPDATE_PERIOD_MS = 30000.0;
+//! \brief During a game, a client that did not acknowledge the current turn after this time is dropped
+static const float CLIENT_TURN_ACK_TIMEOUT_S = 30.0f;
 static const int32_t MASTER_SERVER_STATUS_PENDING = 0;
 static const int32_t MASTER_SERVER_STATUS_STARTED = 1;
 static const int32_t MASTER_SERVER_STATUS_FINISHED = 2;
 
-template<> ODServer* Ogre::Singleton<ODServer>::msSingleton = nullptr;
+ODServer* ODServer::msMainServer = nullptr;
+thread_local ODServer* ODServer::msThreadServer = nullptr;
+std::atomic<bool> ODServer::msHostsManyServers(false);
 
 ODServer::ODServer() :
     mUniqueNumberPlayer(0),
@@ -75,16 +85,58 @@ ODServer::ODServer() :
     mSeatsConfigured(false),
     mPlayerConfig(nullptr),
     mConsoleInterface(std::bind(&ODServer::printConsoleMsg, this, std::placeholders::_1)),
-    mMasterServerGameStatusUpdateTime(0)
+    mMasterServerGameStatusUpdateTime(0),
+    mHostedPort(-1),
+    mUseCommandLog(false),
+    mCommandLogSeed(0)
 {
+    if(msMainServer == nullptr)
+        msMainServer = this;
+
     ConsoleCommands::addConsoleCommands(mConsoleInterface);
 }
 
 ODServer::~ODServer()
 {
+    if(msMainServer == this)
+        msMainServer = nullptr;
+    if(msThreadServer == this)
+        msThreadServer = nullptr;
+
     delete mGameMap;
 }
 
+ODServer& ODServer::getSingleton()
+{
+    ODServer* server = getSingletonPtr();
+    OD_ASSERT_TRUE_MSG(server != nullptr, "No server is bound to the calling thread");
+    return *server;
+}
+
+ODServer* ODServer::getSingletonPtr()
+{
+    if(msThreadServer != nullptr)
+        return msThreadServer;
+
+    // When many games are hosted, a thread processing none of them should not change the first one
+    if(msHostsManyServers)
+        return nullptr;
+
+    return msMainServer;
+}
+
+void ODServer::setHostsManyServers(bool hostsManyServers)
+{
+    msHostsManyServers = hostsManyServers;
+}
+
+void ODServer::setThreadServer(ODServer* server)
+{
+    msThreadServer = server;
+    // The random numbers drawn while processing a game come from its game map
+    Random::setThreadGenerator((server != nullptr) ? &server->mGameMap->getRandom() : nullptr);
+}
+
 bool ODServer::startServer(const std::string& creator, const std::string& levelFilename, ServerMode mode, bool useMasterServer)
 {
     OD_LOG_INF("Asked to launch server with levelFilename=" + levelFilename);
@@ -114,7 +166,20 @@ bool ODServer::startServer(const std::string& creator, const std::string& levelF
     mServerState = ServerState::StateConfiguration;
     mUniqueNumberPlayer = 0;
     GameMap* gameMap = mGameMap;
-    if (!gameMap->loadLevel(levelFilename))
+
+    // The level is loaded with the game map generator so that a game with a command log can be played again from its seed.
+    // Clients still receive the full game state: the command log is only a desync check, so it is kept to the
+    // games hosted by a dedicated server and out of the games hosted from the menus
+    const ResourceManager& resMgr = ResourceManager::getSingleton();
+    mUseCommandLog = resMgr.isSavingCommandLog() && resMgr.isServerMode() && (mode == ServerMode::ModeGameMultiPlayer);
+    mCommandLogLevelFilename = levelFilename;
+    mCommandLogSeed = gameMap->getRandom().getSeed();
+    bool isLevelLoaded;
+    {
+        Random::ScopedThreadGenerator scopedRandom(gameMap->getRandom());
+        isLevelLoaded = gameMap->loadLevel(levelFilename);
+    }
+    if (!isLevelLoaded)
     {
         mServerMode = ServerMode::ModeNone;
         mServerState = ServerState::StateNone;
@@ -258,6 +323,28 @@ void ODServer::sendMsg(Player* player, ODPacket& packet)
         return;
     }
 
+    ODSocketClient* client = getMsgClient(player, packet);
+    if(client != nullptr)
+        client->send(packet);
+}
+
+void ODServer::queueMsg(Player* player, ODPacket& packet)
+{
+    if(player == nullptr)
+    {
+        for (ODSocketClient* client : mSockClients)
+            client->queue(packet);
+
+        return;
+    }
+
+    ODSocketClient* client = getMsgClient(player, packet);
+    if(client != nullptr)
+        client->queue(packet);
+}
+
+ODSocketClient* ODServer::getMsgClient(Player* player, ODPacket& packet)
+{
     ODSocketClient* client = getClientFromPlayer(player);
     if((client == nullptr) &&
        (std::find(mDisconnectedPlayers.begin(), mDisconnectedPlayers.end(), player) == mDisconnectedPlayers.end()))
@@ -266,11 +353,9 @@ void ODServer::sendMsg(Player* player, ODPacket& packet)
         OD_ASSERT_TRUE(packet >> type);
         OD_ASSERT_TRUE_MSG(client != nullptr, "player=" + player->getNick()
             + ", ServerNotificationType=" + ServerNotification::typeString(type));
-        return;
     }
 
-    if(client != nullptr)
-        client->send(packet);
+    return client;
 }
 
 void ODServer::handleConsoleCommand(Player* player, GameMap* gameMap, const std::vector<std::string>& args)
@@ -314,19 +399,28 @@ void ODServer::startNewTurn(double timeSinceLastTurn)
             return;
     }
 
+    TurnProfiler& profiler = gameMap->getTurnProfiler();
+    profiler.startTurn(turn + 1);
+
+    if(mUseCommandLog)
+        applyQueuedGameCommands(turn + 1);
+
     gameMap->setTurnNumber(++turn);
+    mTurnAckClock.restart();
 
     ServerNotification* serverNotification = new ServerNotification(
         ServerNotificationType::turnStarted, nullptr);
     serverNotification->mPacket << turn;
     queueServerNotification(serverNotification);
 
+    profiler.startPhase(TurnPhase::animations);
     if(mServerMode == ServerMode::ModeEditor)
         gameMap->updateVisibleEntities();
 
     gameMap->updateAnimations(timeSinceLastTurn);
 
     // We notify the clients about what they got
+    profiler.startPhase(TurnPhase::playerInfos);
     for (ODSocketClient* sock : mSockClients)
     {
         Player* player = sock->getPlayer();
@@ -364,6 +458,7 @@ void ODServer::startNewTurn(double timeSinceLastTurn)
         }
     }
 
+    profiler.startPhase(TurnPhase::visibleEntities);
     gameMap->updateVisibleEntities();
     switch(mServerMode)
     {
@@ -372,6 +467,7 @@ void ODServer::startNewTurn(double timeSinceLastTurn)
         case ServerMode::ModeGameLoaded:
         {
             gameMap->doTurn(timeSinceLastTurn);
+            profiler.startPhase(TurnPhase::ai);
             gameMap->doPlayerAITurn(timeSinceLastTurn);
             break;
         }
@@ -386,135 +482,148 @@ void ODServer::startNewTurn(double timeSinceLastTurn)
             break;
     }
 
+    profiler.startPhase(TurnPhase::refreshEntities);
     gameMap->fireRefreshEntities();
+    profiler.startPhase(TurnPhase::deletionQueues);
     gameMap->processDeletionQueues();
+    profiler.endPhase();
 }
 
 void ODServer::serverThread()
 {
-    GameMap* gameMap = mGameMap;
+    setThreadServer(this);
+
     sf::Clock clock;
     double turnLengthMs = 1000.0 / ODApplication::turnsPerSecond;
-    bool isClientConnected = true;
-    while(isConnected() && isClientConnected)
+    while(isConnected())
     {
         // doTask should return after the length of 1 turn even if their are communications. When
         // it returns, we can launch next turn.
         doTask(static_cast<int32_t>(turnLengthMs));
-        // If all the clients are disconnected during a game, we close the server
-        if((mServerState == ServerState::StateGame) &&
-           (mSockClients.empty()))
-        {
-            // Time to stop the game
-            isClientConnected = false;
-            continue;
-        }
+        if(!processTurn(clock))
+            break;
+    }
 
-        if(gameMap->getTurnNumber() == -1)
+    notifyGameFinished();
+}
+
+bool ODServer::processTurn(sf::Clock& turnClock)
+{
+    GameMap* gameMap = mGameMap;
+
+    checkPendingSave(false);
+
+    dropLaggingClients();
+
+    // If all the clients are disconnected during a game, we close the server
+    if((mServerState == ServerState::StateGame) &&
+       (mSockClients.empty()))
+    {
+        // Time to stop the game
+        return false;
+    }
+
+    if(gameMap->getTurnNumber() == -1)
+    {
+        // The game is not started
+        if(!mSeatsConfigured)
         {
-            // The game is not started
-            if(mSeatsConfigured)
+            // We are still waiting for players
+            if(!mMasterServerGameId.empty())
             {
-                // We notify the master server that we are not waiting for players anymore
-                if(!mMasterServerGameId.empty())
+                mMasterServerGameStatusUpdateTime += 1000.0 / ODApplication::turnsPerSecond;
+                if(mMasterServerGameStatusUpdateTime >= MASTER_SERVER_UPDATE_PERIOD_MS)
                 {
                     mMasterServerGameStatusUpdateTime = 0.0;
-                    MasterServer::updateGame(mMasterServerGameId, MASTER_SERVER_STATUS_STARTED);
+                    MasterServer::updateGame(mMasterServerGameId, MASTER_SERVER_STATUS_PENDING);
                 }
+            }
+            return true;
+        }
 
-                // We configure the game for launching
-                const std::vector<Seat*>& seats = gameMap->getSeats();
-                for (int jj = 0; jj < gameMap->getMapSizeY(); ++jj)
-                {
-                    for (int ii = 0; ii < gameMap->getMapSizeX(); ++ii)
-                    {
-                        Tile* tile = gameMap->getTile(ii,jj);
-                        tile->setSeats(seats);
-                    }
-                }
+        // We notify the master server that we are not waiting for players anymore
+        if(!mMasterServerGameId.empty())
+        {
+            mMasterServerGameStatusUpdateTime = 0.0;
+            MasterServer::updateGame(mMasterServerGameId, MASTER_SERVER_STATUS_STARTED);
+        }
 
-                // We set allied seats
-                for(Seat* seat : seats)
-                {
-                    for(Seat* alliedSeat : seats)
-                    {
-                        if(alliedSeat == seat)
-                            continue;
-                        if(!seat->isAlliedSeat(alliedSeat))
-                            continue;
-                        seat->addAlliedSeat(alliedSeat);
-                    }
-                }
+        if(mUseCommandLog)
+            startCommandLog();
 
-                // Every client is connected and ready, we can launch the game
-                // Send turn 0 to init the map
-                ServerNotification* serverNotification = new ServerNotification(
-                    ServerNotificationType::turnStarted, nullptr);
-                serverNotification->mPacket << static_cast<int64_t>(0);
-                queueServerNotification(serverNotification);
+        launchGame();
+    }
 
-                OD_LOG_INF("Server ready, starting game");
-                gameMap->setTurnNumber(0);
-                gameMap->setGamePaused(false);
+    // After starting a new turn, we should process server notifications
+    // before processing client messages. Otherwise, we could have weird issues
+    // like allow picking up a dead creature for example.
+    // We make sure the server time is a little bit late regarding the clients to
+    // make sure server is not more advanced than clients. We do that because it is better for clients
+    // to wait for server. If server is in advance, he might send commands before the
+    // creatures arrive at their destination. That could result in weird issues like
+    // creatures going through walls.
+    double timeSinceLastTurn = static_cast<double>(turnClock.restart().asSeconds()) * 0.95;
+    // When a command log is saved, every turn simulates the same time so that the game does not depend on the server load
+    if(mUseCommandLog)
+        timeSinceLastTurn = 1.0 / ODApplication::turnsPerSecond;
+
+    int64_t previousTurn = gameMap->getTurnNumber();
+    startNewTurn(timeSinceLastTurn);
+
+    TurnProfiler& profiler = gameMap->getTurnProfiler();
+    profiler.startPhase(TurnPhase::serverNotifications);
+    processServerNotifications();
+    profiler.endTurn();
 
-                // In editor mode, we give vision on all the gamemap tiles
-                if(mServerMode == ServerMode::ModeEditor)
-                {
-                    for (Seat* seat : gameMap->getSeats())
-                    {
-                        for (int jj = 0; jj < gameMap->getMapSizeY(); ++jj)
-                        {
-                            for (int ii = 0; ii < gameMap->getMapSizeX(); ++ii)
-                            {
-                                gameMap->getTile(ii,jj)->notifyVision(seat);
-                            }
-                        }
+    int64_t turn = gameMap->getTurnNumber();
+    if(mCommandLog.isRecording() && (turn != previousTurn) && ((turn % CommandLog::CHECKSUM_PERIOD) == 0))
+        mCommandLog.recordChecksum(turn, gameMap->computeStateChecksum());
 
-                        seat->sendVisibleTiles();
-                    }
-                }
+    return true;
+}
 
-                gameMap->createAllEntities();
+void ODServer::saveGameMap(const std::string& fileName)
+{
+    // Only one save is written at a time
+    checkPendingSave(true);
+
+    // The snapshot is taken between 2 turns so it is consistent. Formatting the tiles and writing the
+    // file is done by another thread while the game goes on
+    std::shared_ptr<LevelSnapshot> snapshot = std::make_shared<LevelSnapshot>();
+    MapHandler::takeLevelSnapshot(*mGameMap, *snapshot);
+    mPendingSaveFilename = fileName;
+    mPendingSave = std::async(std::launch::async, [snapshot, fileName]()
+    {
+        // If the file exists, we make a backup
+        boost::system::error_code ec;
+        if (boost::filesystem::exists(fileName, ec))
+            boost::filesystem::rename(fileName, fileName + ".bak", ec);
 
-                // Fill starting gold
-                for(Seat* seat : gameMap->getSeats())
-                {
-                    if(seat->getPlayer() == nullptr)
-                        continue;
+        return MapHandler::writeLevelSnapshotToFile(fileName, *snapshot);
+    });
+}
 
-                    if(seat->getGold() > 0)
-                        gameMap->addGoldToSeat(seat->getGold(), seat->getId());
-                }
-            }
-            else
-            {
-                // We are still waiting for players
-                if(!mMasterServerGameId.empty())
-                {
-                    mMasterServerGameStatusUpdateTime += turnLengthMs;
-                    if(mMasterServerGameStatusUpdateTime >= MASTER_SERVER_UPDATE_PERIOD_MS)
-                    {
-                        mMasterServerGameStatusUpdateTime = 0.0;
-                        MasterServer::updateGame(mMasterServerGameId, MASTER_SERVER_STATUS_PENDING);
-                    }
-                }
-                continue;
-            }
-        }
+void ODServer::checkPendingSave(bool wait)
+{
+    if(!mPendingSave.valid())
+        return;
 
-        // After starting a new turn, we should process server notifications
-        // before processing client messages. Otherwise, we could have weird issues
-        // like allow picking up a dead creature for example.
-        // We make sure the server time is a little bit late regarding the clients to
-        // make sure server is not more advanced than clients. We do that because it is better for clients
-        // to wait for server. If server is in advance, he might send commands before the
-        // creatures arrive at their destination. That could result in weird issues like
-        // creatures going through walls.
-        startNewTurn(static_cast<double>(clock.restart().asSeconds()) * 0.95);
+    if(!wait && (mPendingSave.wait_for(std::chrono::seconds(0)) != std::future_status::ready))
+        return;
 
-        processServerNotifications();
+    std::string msg = "Map saved successfully as: " + mPendingSaveFilename;
+    if (!mPendingSave.get())
+    {
+        msg = "Couldn't not save map file as: " + mPendingSaveFilename + "\nPlease check logs.";
     }
+    // We notify all the players that the game was saved successfully
+    ServerNotification notif(ServerNotificationType::chatServer, nullptr);
+    notif.mPacket << msg << EventShortNoticeType::genericGameInfo;
+    sendAsyncMsg(notif);
+}
 
+void ODServer::notifyGameFinished()
+{
     if(!mMasterServerGameId.empty())
     {
         mMasterServerGameStatusUpdateTime = 0.0;
@@ -522,392 +631,822 @@ void ODServer::serverThread()
     }
 }
 
-void ODServer::processServerNotifications()
+void ODServer::dropLaggingClients()
 {
-    GameMap* gameMap = mGameMap;
-
-    bool running = true;
+    if(mServerState != ServerState::StateGame)
+        return;
 
-    while (running)
+    // The clients are not waited for forever: every other player would be stuck. We cannot resync a client that
+    // missed packets (reconnecting is not supported) so it is disconnected
+    int64_t turn = mGameMap->getTurnNumber();
+    bool isAckLate = (mTurnAckClock.getElapsedTime().asSeconds() > CLIENT_TURN_ACK_TIMEOUT_S);
+    std::vector<ODSocketClient*> clients = mSockClients;
+    for(ODSocketClient* client : clients)
     {
-        // If the queue is empty, let's get out of the loop.
-        if (mServerNotificationQueue.empty())
-            break;
-
-        // Take a message out of the front of the notification queue
-        ServerNotification *event = mServerNotificationQueue.front();
-        mServerNotificationQueue.pop_front();
-
-        if(event == nullptr)
-        {
-            OD_LOG_ERR("unexpected null event");
+        std::string reason;
+        if(client->hasSendFailed())
+            reason = "its packets could not be sent";
+        else if(isAckLate && (client->getLastTurnAck() != turn))
+            reason = "it did not acknowledge turn " + Helper::toString(turn);
+        else
             continue;
-        }
 
-        OD_LOG_DBG("processServerNotifications type=" + ServerNotification::typeString(event->mType));
-        switch (event->mType)
-        {
-            case ServerNotificationType::turnStarted:
-                OD_LOG_INF("Server sends newturn="
-                    + boost::lexical_cast<std::string>(gameMap->getTurnNumber()));
-                sendMsg(event->mConcernedPlayer, event->mPacket);
-                break;
+        std::string nick = client->getPlayer() ? client->getPlayer()->getNick() : std::string();
+        OD_LOG_WRN("Dropping client " + nick + " because " + reason);
+        clientDisconnected(client);
+        removeClient(client);
+    }
+}
 
-            case ServerNotificationType::entityPickedUp:
-                // This message should not be sent by human players (they are notified asynchronously)
-                OD_ASSERT_TRUE_MSG(event->mConcernedPlayer->getIsHuman(), "nick=" + event->mConcernedPlayer->getNick());
-                sendMsg(event->mConcernedPlayer, event->mPacket);
-                break;
+void ODServer::setHosted(SocketReactor* reactor, NetworkSender* sender, int32_t port,
+    const std::function<void()>& onSocketReady)
+{
+    mHostedPort = port;
+    mHostedTurnClock.restart();
+    setReactor(reactor, onSocketReady);
+    setSender(sender);
 
-            case ServerNotificationType::entityDropped:
-                // This message should not be sent by human players (they are notified asynchronously)
-                OD_ASSERT_TRUE_MSG(event->mConcernedPlayer->getIsHuman(), "nick=" + event->mConcernedPlayer->getNick());
-                sendMsg(event->mConcernedPlayer, event->mPacket);
-                break;
+    // The hosting server already uses every core to process the games
+    mGameMap->setNbWorkerThreads(0);
+}
 
-            case ServerNotificationType::entitySlapped:
-                // This message should not be sent by human players (they are notified asynchronously)
-                OD_ASSERT_TRUE_MSG(!event->mConcernedPlayer->getIsHuman(), "nick=" + event->mConcernedPlayer->getNick());
-                sendMsg(event->mConcernedPlayer, event->mPacket);
-                break;
+bool ODServer::processHostedTick(bool isTurnDue)
+{
+    processReadySockets();
+    if(!isConnected())
+        return false;
 
-            case ServerNotificationType::exit:
-                running = false;
-                stopServer();
-                break;
+    if(!isTurnDue)
+        return true;
 
-            default:
-                sendMsg(event->mConcernedPlayer, event->mPacket);
-                break;
-        }
+    if(processTurn(mHostedTurnClock) && isConnected())
+        return true;
 
-        delete event;
-        event = nullptr;
-    }
+    notifyGameFinished();
+    return false;
 }
 
-bool ODServer::processClientNotifications(ODSocketClient* clientSocket)
+void ODServer::createAIPlayer(Seat* seat, int32_t configPlayerId)
 {
-    if (!clientSocket)
-        return false;
-
     GameMap* gameMap = mGameMap;
+    int seatId = seat->getId();
+    if(configPlayerId == Seat::PLAYER_TYPE_INACTIVE_ID)
+    {
+        // It is an inactive player
+        Player* inactivePlayer = new Player(gameMap, 0);
+        inactivePlayer->setNick("Inactive AI " + Helper::toString(seatId));
+        gameMap->addPlayer(inactivePlayer);
+        seat->setPlayer(inactivePlayer);
+        return;
+    }
 
-    ODPacket packetReceived;
+    // It is an AI
+    KeeperAIType aiType = Seat::playerIdToAIType(configPlayerId);
+    if(aiType >= KeeperAIType::nbAI)
+    {
+        OD_LOG_ERR("Wrong value for keeper seatId=" + Helper::toString(seatId)
+            + ", ConfigPlayerId=" + Helper::toString(configPlayerId));
 
-    ODSocketClient::ODComStatus status = clientSocket->recv(packetReceived);
+        // Default to normal
+        aiType = KeeperAIType::normal;
+    }
+    // We set player id = 0 for AI players. ID is only used during seat configuration phase
+    // During the game, one should use the seat ID to identify a player
+    Player* aiPlayer = new Player(gameMap, 0);
+    aiPlayer->setNick("Keeper AI " + KeeperAITypes::toString(aiType) + " " + Helper::toString(seatId));
+    gameMap->addPlayer(aiPlayer);
+    seat->setPlayer(aiPlayer);
+    gameMap->assignAI(*aiPlayer, aiType);
+}
 
-    // If the client closed the connection
-    if (status != ODSocketClient::ODComStatus::OK)
+void ODServer::initSeats()
+{
+    for(Seat* seat : mGameMap->getSeats())
     {
-        // If a client disconnects during seat configuration, we delete him from the list
-        if(mServerState != ServerState::StateConfiguration)
-            return (status != ODSocketClient::ODComStatus::Error);
+        // We initialize the seats
+        seat->initSeat();
+    }
 
-        // If the client is in a state where he has been notified to the other clients,
-        // we notify his deconnexion
-        if(std::string("ready").compare(clientSocket->getState()) != 0)
-            return (status != ODSocketClient::ODComStatus::Error);
+    mSeatsConfigured = true;
+    mGameMap->notifySeatsConfigured();
+}
 
-        OD_LOG_INF("Disconnected player: " + clientSocket->getPlayer()->getNick());
-        // We notify
-        uint32_t nbPlayers = 1;
-        ODPacket packetSend;
-        packetSend << ServerNotificationType::removePlayers << nbPlayers;
-        int32_t id = clientSocket->getPlayer()->getId();
-        packetSend << id;
-        sendMsg(nullptr, packetSend);
+void ODServer::launchGame()
+{
+    GameMap* gameMap = mGameMap;
 
-        ODSocketClient* otherHumanConnected = nullptr;
-        for(Seat* seat : gameMap->getSeats())
+    // We configure the game for launching
+    const std::vector<Seat*>& seats = gameMap->getSeats();
+    for (int jj = 0; jj < gameMap->getMapSizeY(); ++jj)
+    {
+        for (int ii = 0; ii < gameMap->getMapSizeX(); ++ii)
         {
-            if(seat->getConfigPlayerId() == id)
-            {
-                seat->setConfigPlayerId(-1);
-                if(clientSocket->getPlayer() == mPlayerConfig)
-                    mPlayerConfig = nullptr;
-            }
-
-            if(seat->getConfigPlayerId() < Seat::PLAYER_ID_HUMAN_MIN)
-                continue;
-
-            otherHumanConnected = getClientFromPlayerId(seat->getConfigPlayerId());
+            Tile* tile = gameMap->getTile(ii,jj);
+            tile->setSeats(seats);
         }
-        if((mPlayerConfig == nullptr) &&
-           (otherHumanConnected != nullptr))
-        {
-            mPlayerConfig = otherHumanConnected->getPlayer();
-            ODPacket packetSend;
-            packetSend << ServerNotificationType::playerConfigChange;
-            otherHumanConnected->send(packetSend);
+    }
 
-            OD_LOG_INF("Changing game host to " + mPlayerConfig->getNick());
+    // We set allied seats
+    for(Seat* seat : seats)
+    {
+        for(Seat* alliedSeat : seats)
+        {
+            if(alliedSeat == seat)
+                continue;
+            if(!seat->isAlliedSeat(alliedSeat))
+                continue;
+            seat->addAlliedSeat(alliedSeat);
         }
-        return (status != ODSocketClient::ODComStatus::Error);
     }
 
-    ClientNotificationType clientCommand;
-    OD_ASSERT_TRUE(packetReceived >> clientCommand);
+    // Every client is connected and ready, we can launch the game
+    // Send turn 0 to init the map
+    ServerNotification* serverNotification = new ServerNotification(
+        ServerNotificationType::turnStarted, nullptr);
+    serverNotification->mPacket << static_cast<int64_t>(0);
+    queueServerNotification(serverNotification);
 
-    OD_LOG_DBG("processClientNotifications type=" + ClientNotification::typeString(clientCommand));
-    switch(clientCommand)
+    OD_LOG_INF("Server ready, starting game");
+    gameMap->setTurnNumber(0);
+    gameMap->setGamePaused(false);
+
+    // In editor mode, we give vision on all the gamemap tiles
+    if(mServerMode == ServerMode::ModeEditor)
     {
-        case ClientNotificationType::hello:
+        for (Seat* seat : gameMap->getSeats())
         {
-            if(std::string("connected").compare(clientSocket->getState()) != 0)
-                return false;
-            std::string version;
-            OD_ASSERT_TRUE(packetReceived >> version);
-
-            // If the version is different, we refuse the client
-            if(version.compare(std::string("OpenDungeons V ") + ODApplication::VERSION) != 0)
+            for (int jj = 0; jj < gameMap->getMapSizeY(); ++jj)
             {
-                OD_LOG_INF("Server rejected client. Application version mismatch: required= "
-                    + ODApplication::VERSION + ", received=" + version);
-                return false;
+                for (int ii = 0; ii < gameMap->getMapSizeX(); ++ii)
+                {
+                    gameMap->getTile(ii,jj)->notifyVision(seat);
+                }
             }
 
-            // Tell the client to load the given map
-            OD_LOG_INF("Level sent to client: " + gameMap->getLevelName());
-            clientSocket->setState("loadLevel");
-            int32_t mapSizeX = gameMap->getMapSizeX();
-            int32_t mapSizeY = gameMap->getMapSizeY();
+            seat->sendVisibleTiles();
+        }
+    }
 
-            ODPacket packet;
-            packet << ServerNotificationType::loadLevel;
-            packet << version;
-            packet << mapSizeX << mapSizeY;
-            // Map infos
-            packet << gameMap->getLevelName();
-            packet << gameMap->getLevelDescription();
-            packet << gameMap->getLevelMusicFile();
-            packet << gameMap->getLevelFightMusicFile();
+    gameMap->createAllEntities();
 
-            packet << gameMap->getTileSetName();
+    // Fill starting gold
+    for(Seat* seat : gameMap->getSeats())
+    {
+        if(seat->getPlayer() == nullptr)
+            continue;
 
-            int32_t nb;
-            // Seats
-            const std::vector<Seat*>& seats = gameMap->getSeats();
-            nb = seats.size();
-            packet << nb;
-            for(Seat* seat : seats)
-                seat->exportToPacket(packet);
+        if(seat->getGold() > 0)
+            gameMap->addGoldToSeat(seat->getGold(), seat->getId());
+    }
+}
 
-            // Creature definitions
-            nb = gameMap->numClassDescriptions();
-            packet << nb;
-            for(int32_t i = 0; i < nb; ++i)
-            {
-                const CreatureDefinition* def = gameMap->getClassDescription(i);
-                packet << def;
-            }
+bool ODServer::runHeadless(const std::string& levelFilename, int64_t nbTurns, uint64_t seed, HeadlessTurnStats& stats)
+{
+    OD_LOG_INF("Asked to run headless game with levelFilename=" + levelFilename);
 
-            // Weapons
-            nb = gameMap->numWeapons();
-            packet << nb;
-            for(int32_t i = 0; i < nb; ++i)
-            {
-                const Weapon* def = gameMap->getWeapon(i);
-                packet << def;
-            }
+    if(!startHeadlessGame(levelFilename, seed))
+        return false;
 
-            // Tiles
-            std::vector<Tile*> goldTiles;
-            std::vector<Tile*> rockTiles;
-            std::vector<Tile*> gemTiles;
-            for (int xxx = 0; xxx < mapSizeX; ++xxx)
-            {
-                for (int yyy = 0; yyy < mapSizeY; ++yyy)
-                {
-                    Tile* tile = gameMap->getTile(xxx,yyy);
-                    switch(tile->getType())
-                    {
-                        case TileType::gold:
-                            goldTiles.push_back(tile);
-                            break;
-                        case TileType::rock:
-                            rockTiles.push_back(tile);
-                            break;
-                        case TileType::gem:
-                            gemTiles.push_back(tile);
-                            break;
-                        default:
-                            // Per default, tiles are dirt and don't need to be notified
-                            break;
-                    }
-                }
-            }
+    stats.mTurnDurationsMs.reserve(stats.mTurnDurationsMs.size() + static_cast<size_t>(nbTurns));
+    stats.mTurnChecksums.reserve(stats.mTurnChecksums.size() + static_cast<size_t>(nbTurns));
+    for(int64_t turn = 0; turn < nbTurns; ++turn)
+        playHeadlessTurn(stats);
 
-            nb = goldTiles.size();
-            packet << nb;
-            for(Tile* tile : goldTiles)
-            {
-                gameMap->tileToPacket(packet, tile);
-            }
+    stopServer();
+    setThreadServer(nullptr);
+    return true;
+}
 
-            nb = rockTiles.size();
-            packet << nb;
-            for(Tile* tile : rockTiles)
-            {
-                gameMap->tileToPacket(packet, tile);
-            }
+bool ODServer::runPathfindingBenchmark(const std::string& levelFilename, const std::string& levelName,
+    PathfindingBenchmark& benchmark)
+{
+    OD_LOG_INF("Asked to run pathfinding benchmark with levelFilename=" + levelFilename);
 
-            nb = gemTiles.size();
-            packet << nb;
-            for(Tile* tile : gemTiles)
-            {
-                gameMap->tileToPacket(packet, tile);
-            }
+    if(!startHeadlessGame(levelFilename, benchmark.getSeed()))
+        return false;
 
-            clientSocket->send(packet);
-            break;
-        }
+    benchmark.runLevel(levelName, *mGameMap);
 
-        case ClientNotificationType::levelOK:
-        {
-            if(std::string("loadLevel").compare(clientSocket->getState()) != 0)
-                return false;
+    stopServer();
+    setThreadServer(nullptr);
+    return true;
+}
 
-            clientSocket->setState("nick");
-            // Tell the client to give us their nickname
-            ODPacket packetSend;
-            packetSend << ServerNotificationType::pickNick << mServerMode;
-            clientSocket->send(packetSend);
-            break;
-        }
+bool ODServer::startHeadlessGame(const std::string& levelFilename, uint64_t seed)
+{
+    if(!loadHeadlessLevel(levelFilename, seed))
+        return false;
 
-        case ClientNotificationType::setNick:
-        {
-            if(std::string("nick").compare(clientSocket->getState()) != 0)
-                return false;
+    // Every seat that is not inactive is played by a Keeper AI. Faction and team are the ones
+    // fixed by the level or the first available
+    GameMap* gameMap = mGameMap;
+    const std::vector<std::string>& factions = ConfigManager::getSingleton().getFactions();
+    for(Seat* seat : gameMap->getSeats())
+    {
+        if(seat->isRogueSeat())
+            continue;
 
-            // Pick nick
-            std::string clientNick;
-            OD_ASSERT_TRUE(packetReceived >> clientNick);
+        std::string faction = factions.front();
+        if((seat->getFaction().compare(Seat::PLAYER_FACTION_CHOICE) != 0) &&
+           (std::find(factions.begin(), factions.end(), seat->getFaction()) != factions.end()))
+        {
+            faction = seat->getFaction();
+        }
+        seat->setFaction(faction);
 
-            // NOTE : playerId 0 is reserved for inactive players and 1 is reserved for AI
-            int32_t playerId = mUniqueNumberPlayer + Seat::PLAYER_ID_HUMAN_MIN;
-            mUniqueNumberPlayer++;
-            Player* curPlayer = new Player(gameMap, playerId);
-            curPlayer->setNick(clientNick);
-            curPlayer->setIsHuman(true);
-            clientSocket->setPlayer(curPlayer);
-            clientSocket->setState("ready");
+        if(seat->getPlayerType().compare(Seat::PLAYER_TYPE_INACTIVE) == 0)
+            createAIPlayer(seat, Seat::PLAYER_TYPE_INACTIVE_ID);
+        else
+            createAIPlayer(seat, Seat::aITypeToPlayerId(KeeperAIType::normal));
 
-            OD_LOG_INF("Player id: " + Helper::toString(playerId) + " nickname is: " + clientNick);
+        const std::vector<int>& availableTeamIds = seat->getAvailableTeamIds();
+        if(availableTeamIds.empty())
+            OD_LOG_ERR("No team available for seatId=" + Helper::toString(seat->getId()));
+        else
+            seat->setTeamId(availableTeamIds.front());
+        seat->setMapSize(gameMap->getMapSizeX(), gameMap->getMapSizeY());
+    }
 
-            if(mServerMode != ServerMode::ModeEditor)
-                break;
+    // Like in a network game, the seats get their spawn pool and their worker class before the game starts
+    mServerState = ServerState::StateGame;
+    initSeats();
+    launchGame();
+    return true;
+}
 
-            // On editor mode, we configure automatically seats
-            mServerState = ServerState::StateGame;
-            const std::vector<Seat*>& seats = gameMap->getSeats();
-            if(seats.empty())
-            {
-                OD_LOG_ERR("unexpected empty seats in gamemap");
-                break;
-            }
+bool ODServer::runCommandLog(const std::string& logFilename, HeadlessTurnStats& stats, int64_t& desyncTurn)
+{
+    OD_LOG_INF("Asked to play command log=" + logFilename);
 
-            // By default, the first player to connect is the one allowed to configure game
-            if(mPlayerConfig == nullptr)
-            {
-                mPlayerConfig = curPlayer;
-                ODPacket packetSend;
-                packetSend << ServerNotificationType::playerConfigChange;
-                clientSocket->send(packetSend);
-            }
+    desyncTurn = -1;
+    CommandLog log;
+    if(!log.load(logFilename))
+        return false;
 
-            Seat* seat = seats[0];
-            seat->setPlayer(curPlayer);
-            //This makes sure the player is deleted on exit.
-            gameMap->addPlayer(curPlayer);
-            ODPacket packetSend;
-            packetSend << ServerNotificationType::clientAccepted << ODApplication::turnsPerSecond;
-            int32_t nbPlayers = 1;
-            packetSend << nbPlayers;
-            const std::string& nick = clientSocket->getPlayer()->getNick();
-            int32_t id = clientSocket->getPlayer()->getId();
-            int32_t seatId = seat->getId();
-            int32_t teamId = 0;
-            seat->setMapSize(gameMap->getMapSizeX(), gameMap->getMapSizeY());
-            packetSend << nick << id << seatId << teamId;
-            clientSocket->send(packetSend);
+    if(!loadHeadlessLevel(log.getLevelFilename(), log.getSeed()))
+        return false;
 
-            packetSend.clear();
-            packetSend << ServerNotificationType::startGameMode << seatId << mServerMode;
-            clientSocket->send(packetSend);
-            mSeatsConfigured = true;
-            break;
+    // The seats are configured like they were in the recorded game. The human players do the recorded commands
+    GameMap* gameMap = mGameMap;
+    for(const CommandLog::SeatConfig& seatConfig : log.getSeats())
+    {
+        Seat* seat = gameMap->getSeatById(seatConfig.mSeatId);
+        if(seat == nullptr)
+        {
+            OD_LOG_ERR("Command log does not match the level seatId=" + Helper::toString(seatConfig.mSeatId));
+            stopServer();
+            setThreadServer(nullptr);
+            return false;
         }
 
-        case ClientNotificationType::readyForSeatConfiguration:
+        seat->setFaction(seatConfig.mFaction);
+        if(seatConfig.mConfigPlayerId < Seat::PLAYER_ID_HUMAN_MIN)
         {
-            if(std::string("ready").compare(clientSocket->getState()) != 0)
-                return false;
+            createAIPlayer(seat, seatConfig.mConfigPlayerId);
+        }
+        else
+        {
+            Player* player = new Player(gameMap, seatConfig.mConfigPlayerId);
+            player->setNick("Player " + Helper::toString(seatConfig.mSeatId));
+            player->setIsHuman(true);
+            gameMap->addPlayer(player);
+            seat->setPlayer(player);
+        }
+        seat->setTeamId(seatConfig.mTeamId);
+        seat->setMapSize(gameMap->getMapSizeX(), gameMap->getMapSizeY());
+    }
 
-            // By default, the first player to connect is the one allowed to configure game
-            if(mPlayerConfig == nullptr)
-            {
-                mPlayerConfig = clientSocket->getPlayer();
-                OD_LOG_INF("New player host: " + mPlayerConfig->getNick());
-                ODPacket packetSend;
-                packetSend << ServerNotificationType::playerConfigChange;
-                clientSocket->send(packetSend);
-            }
+    mServerState = ServerState::StateGame;
+    mUseCommandLog = true;
+    initSeats();
+    launchGame();
 
-            ODPacket packetSend;
-            OD_LOG_INF("New player: " + clientSocket->getPlayer()->getNick());
-            // We notify to the newly connected player all the currently connected players (including himself)
-            uint32_t nbPlayers = mSockClients.size();
-            packetSend << ServerNotificationType::addPlayers << nbPlayers;
-            for (ODSocketClient* client : mSockClients)
-            {
-                const std::string& nick = client->getPlayer()->getNick();
-                int32_t id = client->getPlayer()->getId();
-                packetSend << nick << id;
-            }
-            clientSocket->send(packetSend);
+    // Each command is queued before the turn where it was applied. The turns are played until the last saved checksum
+    const std::vector<CommandLog::Command>& commands = log.getCommands();
+    const std::map<int64_t, uint64_t>& checksums = log.getChecksums();
+    int64_t lastTurn = checksums.empty() ? 0 : checksums.rbegin()->first;
+    if(!commands.empty())
+        lastTurn = std::max(lastTurn, commands.back().mTurn);
 
-            // Then, we notify the newly connected client to every client
-            const std::string& clientNick = clientSocket->getPlayer()->getNick();
-            int32_t clientPlayerId = clientSocket->getPlayer()->getId();
-            packetSend.clear();
-            nbPlayers = 1;
-            packetSend << ServerNotificationType::addPlayers << nbPlayers;
-            packetSend << clientNick << clientPlayerId;
-            for (ODSocketClient* client : mSockClients)
-            {
-                if(clientSocket == client)
-                    continue;
+    std::vector<CommandLog::Command>::const_iterator itCommand = commands.begin();
+    while(gameMap->getTurnNumber() < lastTurn)
+    {
+        int64_t turn = gameMap->getTurnNumber() + 1;
+        while((itCommand != commands.end()) && (itCommand->mTurn <= turn))
+        {
+            mQueuedGameCommands.push_back(*itCommand);
+            ++itCommand;
+        }
 
-                client->send(packetSend);
-            }
+        playHeadlessTurn(stats);
 
-            // Then we look for the first available human seat and assign the player there (if available)
-            Seat* seatToUse = nullptr;
-            // If we find an unused human only seat, we use it. If not, we take the first choosable
-            for(Seat* seat : gameMap->getSeats())
-            {
-                if(seat->isRogueSeat())
-                    continue;
-                if((seat->getPlayerType().compare(Seat::PLAYER_TYPE_HUMAN) != 0) &&
-                   (seat->getPlayerType().compare(Seat::PLAYER_TYPE_CHOICE) != 0))
-                {
-                    continue;
-                }
+        auto itChecksum = checksums.find(turn);
+        if((itChecksum != checksums.end()) && (itChecksum->second != stats.mTurnChecksums.back()))
+        {
+            desyncTurn = turn;
+            break;
+        }
+    }
 
-                if(seat->getConfigPlayerId() != -1)
-                    continue;
+    stopServer();
+    setThreadServer(nullptr);
+    return true;
+}
 
-                //Suitable seat
-                if(seat->getPlayerType().compare(Seat::PLAYER_TYPE_HUMAN) == 0)
-                {
-                    seatToUse = seat;
-                    break;
-                }
+bool ODServer::loadHeadlessLevel(const std::string& levelFilename, uint64_t seed)
+{
+    // Everything drawn while the level is loaded and played comes from the seeded game map generator
+    mGameMap->setRandomSeed(seed);
+    mGameMap->getTurnProfiler().setEnabled(true);
+    setThreadServer(this);
 
-                if(seatToUse == nullptr)
-                    seatToUse = seat;
+    // No socket is created: the notifications are dropped since there is nobody to send them to
+    mServerMode = ServerMode::ModeGameMultiPlayer;
+    mServerState = ServerState::StateConfiguration;
+    if(!mGameMap->loadLevel(levelFilename))
+    {
+        mServerMode = ServerMode::ModeNone;
+        mServerState = ServerState::StateNone;
+        setThreadServer(nullptr);
+        OD_LOG_ERR("The level file can't be loaded: " + levelFilename);
+        return false;
+    }
+
+    return true;
+}
+
+void ODServer::playHeadlessTurn(HeadlessTurnStats& stats)
+{
+    // There is no wall clock pacing: each turn simulates the time of a normal turn
+    TurnProfiler& profiler = mGameMap->getTurnProfiler();
+    sf::Clock clock;
+    startNewTurn(1.0 / ODApplication::turnsPerSecond);
+    profiler.startPhase(TurnPhase::serverNotifications);
+    processServerNotifications();
+    profiler.endTurn();
+    stats.mTurnDurationsMs.push_back(static_cast<double>(clock.getElapsedTime().asMicroseconds()) / 1000.0);
+    stats.mTurnChecksums.push_back(mGameMap->computeStateChecksum());
+    stats.mTurnNbCreatures.push_back(static_cast<uint32_t>(mGameMap->getCreatures().size()));
+
+    uint32_t nbPhases = static_cast<uint32_t>(TurnPhase::nbPhases);
+    stats.mPhaseTimesMs.resize(nbPhases);
+    for(uint32_t phase = 0; phase < nbPhases; ++phase)
+        stats.mPhaseTimesMs[phase].push_back(profiler.getPhaseTimeMs(static_cast<TurnPhase>(phase)));
+}
+
+void ODServer::startCommandLog()
+{
+    std::vector<CommandLog::SeatConfig> seats;
+    for(Seat* seat : mGameMap->getSeats())
+    {
+        if(seat->isRogueSeat())
+            continue;
+
+        CommandLog::SeatConfig seatConfig;
+        seatConfig.mSeatId = seat->getId();
+        seatConfig.mConfigPlayerId = seat->getConfigPlayerId();
+        seatConfig.mFaction = seat->getFaction();
+        seatConfig.mTeamId = seat->getTeamId();
+        seats.push_back(seatConfig);
+    }
+
+    ResourceManager& resMgr = ResourceManager::getSingleton();
+    std::string fileName = resMgr.getReplayDataPath() + resMgr.buildCommandLogFilename(getNetworkPort());
+    if(!mCommandLog.startRecording(fileName, mCommandLogLevelFilename, mCommandLogSeed, seats))
+    {
+        OD_LOG_ERR("Could not create command log " + fileName);
+        return;
+    }
+
+    OD_LOG_INF("Recording command log " + fileName);
+}
+
+void ODServer::processServerNotifications()
+{
+    GameMap* gameMap = mGameMap;
+
+    bool running = true;
+
+    while (running)
+    {
+        // If the queue is empty, let's get out of the loop.
+        if (mServerNotificationQueue.empty())
+            break;
+
+        // Take a message out of the front of the notification queue
+        ServerNotification *event = mServerNotificationQueue.front();
+        mServerNotificationQueue.pop_front();
+
+        if(event == nullptr)
+        {
+            OD_LOG_ERR("unexpected null event");
+            continue;
+        }
+
+        OD_LOG_DBG("processServerNotifications type=" + ServerNotification::typeString(event->mType));
+        switch (event->mType)
+        {
+            case ServerNotificationType::turnStarted:
+                OD_LOG_INF("Server sends newturn="
+                    + boost::lexical_cast<std::string>(gameMap->getTurnNumber()));
+                queueMsg(event->mConcernedPlayer, event->mPacket);
+                break;
+
+            case ServerNotificationType::entityPickedUp:
+                // This message should not be sent by human players (they are notified asynchronously)
+                OD_ASSERT_TRUE_MSG(event->mConcernedPlayer->getIsHuman(), "nick=" + event->mConcernedPlayer->getNick());
+                queueMsg(event->mConcernedPlayer, event->mPacket);
+                break;
+
+            case ServerNotificationType::entityDropped:
+                // This message should not be sent by human players (they are notified asynchronously)
+                OD_ASSERT_TRUE_MSG(event->mConcernedPlayer->getIsHuman(), "nick=" + event->mConcernedPlayer->getNick());
+                queueMsg(event->mConcernedPlayer, event->mPacket);
+                break;
+
+            case ServerNotificationType::entitySlapped:
+                // This message should not be sent by human players (they are notified asynchronously)
+                OD_ASSERT_TRUE_MSG(!event->mConcernedPlayer->getIsHuman(), "nick=" + event->mConcernedPlayer->getNick());
+                queueMsg(event->mConcernedPlayer, event->mPacket);
+                break;
+
+            case ServerNotificationType::exit:
+                running = false;
+                stopServer();
+                break;
+
+            default:
+                queueMsg(event->mConcernedPlayer, event->mPacket);
+                break;
+        }
+
+        delete event;
+        event = nullptr;
+    }
+
+    // The messages of the turn are sent at once to each client
+    for (ODSocketClient* client : mSockClients)
+        client->flush();
+}
+
+bool ODServer::processClientNotifications(ODSocketClient* clientSocket)
+{
+    if (!clientSocket)
+        return false;
+
+    GameMap* gameMap = mGameMap;
+
+    ODPacket packetReceived;
+
+    ODSocketClient::ODComStatus status = clientSocket->recv(packetReceived);
+
+    // If the client closed the connection
+    if (status != ODSocketClient::ODComStatus::OK)
+    {
+        // If a client disconnects during seat configuration, we delete him from the list
+        if(mServerState != ServerState::StateConfiguration)
+            return (status != ODSocketClient::ODComStatus::Error);
+
+        // If the client is in a state where he has been notified to the other clients,
+        // we notify his deconnexion
+        if(std::string("ready").compare(clientSocket->getState()) != 0)
+            return (status != ODSocketClient::ODComStatus::Error);
+
+        OD_LOG_INF("Disconnected player: " + clientSocket->getPlayer()->getNick());
+        // We notify
+        uint32_t nbPlayers = 1;
+        ODPacket packetSend;
+        packetSend << ServerNotificationType::removePlayers << nbPlayers;
+        int32_t id = clientSocket->getPlayer()->getId();
+        packetSend << id;
+        sendMsg(nullptr, packetSend);
+
+        ODSocketClient* otherHumanConnected = nullptr;
+        for(Seat* seat : gameMap->getSeats())
+        {
+            if(seat->getConfigPlayerId() == id)
+            {
+                seat->setConfigPlayerId(-1);
+                if(clientSocket->getPlayer() == mPlayerConfig)
+                    mPlayerConfig = nullptr;
+            }
+
+            if(seat->getConfigPlayerId() < Seat::PLAYER_ID_HUMAN_MIN)
+                continue;
+
+            otherHumanConnected = getClientFromPlayerId(seat->getConfigPlayerId());
+        }
+        if((mPlayerConfig == nullptr) &&
+           (otherHumanConnected != nullptr))
+        {
+            mPlayerConfig = otherHumanConnected->getPlayer();
+            ODPacket packetSend;
+            packetSend << ServerNotificationType::playerConfigChange;
+            otherHumanConnected->send(packetSend);
+
+            OD_LOG_INF("Changing game host to " + mPlayerConfig->getNick());
+        }
+        return (status != ODSocketClient::ODComStatus::Error);
+    }
+
+    // When a command log is saved, the game commands are applied at the start of the next turn. We keep them as received
+    ODPacket commandPacket;
+    if(mUseCommandLog)
+        commandPacket = packetReceived;
+
+    ClientNotificationType clientCommand;
+    OD_ASSERT_TRUE(packetReceived >> clientCommand);
+
+    OD_LOG_DBG("processClientNotifications type=" + ClientNotification::typeString(clientCommand));
+    if(isGameCommand(clientCommand))
+    {
+        Player* player = clientSocket->getPlayer();
+        if(!mUseCommandLog)
+        {
+            processGameCommand(player, clientCommand, packetReceived);
+            return true;
+        }
+
+        if(player->getSeat() == nullptr)
+        {
+            OD_LOG_ERR("Game command received from player without seat nick=" + player->getNick()
+                + ", type=" + ClientNotification::typeString(clientCommand));
+            return true;
+        }
+
+        CommandLog::Command command;
+        command.mTurn = gameMap->getTurnNumber() + 1;
+        command.mSeatId = player->getSeat()->getId();
+        command.mPacket = commandPacket;
+        mQueuedGameCommands.push_back(command);
+        return true;
+    }
+
+    switch(clientCommand)
+    {
+        case ClientNotificationType::hello:
+        {
+            if(std::string("connected").compare(clientSocket->getState()) != 0)
+                return false;
+            std::string version;
+            OD_ASSERT_TRUE(packetReceived >> version);
+
+            // If the version is different, we refuse the client
+            const std::string requiredVersion = ClientNotification::getProtocolVersion(ODApplication::VERSION);
+            if(version.compare(requiredVersion) != 0)
+            {
+                OD_LOG_INF("Server rejected client. Application version mismatch: required= "
+                    + requiredVersion + ", received=" + version);
+                return false;
+            }
+
+            // Compression is used if the client asks for it and it is not on the same computer
+            bool useCompression;
+            if(!(packetReceived >> useCompression))
+                useCompression = false;
+            clientSocket->setUseCompression(useCompression && !clientSocket->isRemoteLoopback());
+
+            // Tell the client to load the given map
+            OD_LOG_INF("Level sent to client: " + gameMap->getLevelName());
+            clientSocket->setState("loadLevel");
+            int32_t mapSizeX = gameMap->getMapSizeX();
+            int32_t mapSizeY = gameMap->getMapSizeY();
+
+            ODPacket packet;
+            packet << ServerNotificationType::loadLevel;
+            packet << version;
+            packet << mapSizeX << mapSizeY;
+            // Map infos
+            packet << gameMap->getLevelName();
+            packet << gameMap->getLevelDescription();
+            packet << gameMap->getLevelMusicFile();
+            packet << gameMap->getLevelFightMusicFile();
+
+            packet << gameMap->getTileSetName();
+
+            int32_t nb;
+            // Seats
+            const std::vector<Seat*>& seats = gameMap->getSeats();
+            nb = seats.size();
+            packet << nb;
+            for(Seat* seat : seats)
+                seat->exportToPacket(packet);
+
+            // Creature definitions
+            nb = gameMap->numClassDescriptions();
+            packet << nb;
+            for(int32_t i = 0; i < nb; ++i)
+            {
+                const CreatureDefinition* def = gameMap->getClassDescription(i);
+                packet << def;
+            }
+
+            // Weapons
+            nb = gameMap->numWeapons();
+            packet << nb;
+            for(int32_t i = 0; i < nb; ++i)
+            {
+                const Weapon* def = gameMap->getWeapon(i);
+                packet << def;
+            }
+
+            // Tiles
+            std::vector<Tile*> goldTiles;
+            std::vector<Tile*> rockTiles;
+            std::vector<Tile*> gemTiles;
+            for (int xxx = 0; xxx < mapSizeX; ++xxx)
+            {
+                for (int yyy = 0; yyy < mapSizeY; ++yyy)
+                {
+                    Tile* tile = gameMap->getTile(xxx,yyy);
+                    switch(tile->getType())
+                    {
+                        case TileType::gold:
+                            goldTiles.push_back(tile);
+                            break;
+                        case TileType::rock:
+                            rockTiles.push_back(tile);
+                            break;
+                        case TileType::gem:
+                            gemTiles.push_back(tile);
+                            break;
+                        default:
+                            // Per default, tiles are dirt and don't need to be notified
+                            break;
+                    }
+                }
+            }
+
+            nb = goldTiles.size();
+            packet << nb;
+            for(Tile* tile : goldTiles)
+            {
+                gameMap->tileToPacket(packet, tile);
+            }
+
+            nb = rockTiles.size();
+            packet << nb;
+            for(Tile* tile : rockTiles)
+            {
+                gameMap->tileToPacket(packet, tile);
+            }
+
+            nb = gemTiles.size();
+            packet << nb;
+            for(Tile* tile : gemTiles)
+            {
+                gameMap->tileToPacket(packet, tile);
+            }
+
+            clientSocket->send(packet);
+            break;
+        }
+
+        case ClientNotificationType::levelOK:
+        {
+            if(std::string("loadLevel").compare(clientSocket->getState()) != 0)
+                return false;
+
+            clientSocket->setState("nick");
+            // Tell the client to give us their nickname
+            ODPacket packetSend;
+            packetSend << ServerNotificationType::pickNick << mServerMode;
+            clientSocket->send(packetSend);
+            break;
+        }
+
+        case ClientNotificationType::setNick:
+        {
+            if(std::string("nick").compare(clientSocket->getState()) != 0)
+                return false;
+
+            // Pick nick
+            std::string clientNick;
+            OD_ASSERT_TRUE(packetReceived >> clientNick);
+
+            // NOTE : playerId 0 is reserved for inactive players and 1 is reserved for AI
+            int32_t playerId = mUniqueNumberPlayer + Seat::PLAYER_ID_HUMAN_MIN;
+            mUniqueNumberPlayer++;
+            Player* curPlayer = new Player(gameMap, playerId);
+            curPlayer->setNick(clientNick);
+            curPlayer->setIsHuman(true);
+            clientSocket->setPlayer(curPlayer);
+            clientSocket->setState("ready");
+
+            OD_LOG_INF("Player id: " + Helper::toString(playerId) + " nickname is: " + clientNick);
+
+            if(mServerMode != ServerMode::ModeEditor)
+                break;
+
+            // On editor mode, we configure automatically seats
+            mServerState = ServerState::StateGame;
+            const std::vector<Seat*>& seats = gameMap->getSeats();
+            if(seats.empty())
+            {
+                OD_LOG_ERR("unexpected empty seats in gamemap");
+                break;
+            }
+
+            // By default, the first player to connect is the one allowed to configure game
+            if(mPlayerConfig == nullptr)
+            {
+                mPlayerConfig = curPlayer;
+                ODPacket packetSend;
+                packetSend << ServerNotificationType::playerConfigChange;
+                clientSocket->send(packetSend);
+            }
+
+            Seat* seat = seats[0];
+            seat->setPlayer(curPlayer);
+            //This makes sure the player is deleted on exit.
+            gameMap->addPlayer(curPlayer);
+            ODPacket packetSend;
+            packetSend << ServerNotificationType::clientAccepted << ODApplication::turnsPerSecond;
+            int32_t nbPlayers = 1;
+            packetSend << nbPlayers;
+            const std::string& nick = clientSocket->getPlayer()->getNick();
+            int32_t id = clientSocket->getPlayer()->getId();
+            int32_t seatId = seat->getId();
+            int32_t teamId = 0;
+            seat->setMapSize(gameMap->getMapSizeX(), gameMap->getMapSizeY());
+            packetSend << nick << id << seatId << teamId;
+            clientSocket->send(packetSend);
+
+            packetSend.clear();
+            packetSend << ServerNotificationType::startGameMode << seatId << mServerMode;
+            clientSocket->send(packetSend);
+            mSeatsConfigured = true;
+            break;
+        }
+
+        case ClientNotificationType::readyForSeatConfiguration:
+        {
+            if(std::string("ready").compare(clientSocket->getState()) != 0)
+                return false;
+
+            // By default, the first player to connect is the one allowed to configure game
+            if(mPlayerConfig == nullptr)
+            {
+                mPlayerConfig = clientSocket->getPlayer();
+                OD_LOG_INF("New player host: " + mPlayerConfig->getNick());
+                ODPacket packetSend;
+                packetSend << ServerNotificationType::playerConfigChange;
+                clientSocket->send(packetSend);
+            }
+
+            ODPacket packetSend;
+            OD_LOG_INF("New player: " + clientSocket->getPlayer()->getNick());
+            // We notify to the newly connected player all the currently connected players (including himself)
+            uint32_t nbPlayers = mSockClients.size();
+            packetSend << ServerNotificationType::addPlayers << nbPlayers;
+            for (ODSocketClient* client : mSockClients)
+            {
+                const std::string& nick = client->getPlayer()->getNick();
+                int32_t id = client->getPlayer()->getId();
+                packetSend << nick << id;
+            }
+            clientSocket->send(packetSend);
+
+            // Then, we notify the newly connected client to every client
+            const std::string& clientNick = clientSocket->getPlayer()->getNick();
+            int32_t clientPlayerId = clientSocket->getPlayer()->getId();
+            packetSend.clear();
+            nbPlayers = 1;
+            packetSend << ServerNotificationType::addPlayers << nbPlayers;
+            packetSend << clientNick << clientPlayerId;
+            for (ODSocketClient* client : mSockClients)
+            {
+                if(clientSocket == client)
+                    continue;
+
+                client->send(packetSend);
+            }
+
+            // Then we look for the first available human seat and assign the player there (if available)
+            Seat* seatToUse = nullptr;
+            // If we find an unused human only seat, we use it. If not, we take the first choosable
+            for(Seat* seat : gameMap->getSeats())
+            {
+                if(seat->isRogueSeat())
+                    continue;
+                if((seat->getPlayerType().compare(Seat::PLAYER_TYPE_HUMAN) != 0) &&
+                   (seat->getPlayerType().compare(Seat::PLAYER_TYPE_CHOICE) != 0))
+                {
+                    continue;
+                }
+
+                if(seat->getConfigPlayerId() != -1)
+                    continue;
+
+                //Suitable seat
+                if(seat->getPlayerType().compare(Seat::PLAYER_TYPE_HUMAN) == 0)
+                {
+                    seatToUse = seat;
+                    break;
+                }
+
+                if(seatToUse == nullptr)
+                    seatToUse = seat;
             }
 
             if(seatToUse != nullptr)
@@ -1016,35 +1555,10 @@ bool ODServer::processClientNotifications(ODSocketClient* clientSocket)
 
                 seat->setFaction(factions[seat->getConfigFactionIndex()]);
 
-                int seatId = seat->getId();
                 int32_t playerId = seat->getConfigPlayerId();
-                if(playerId == Seat::PLAYER_TYPE_INACTIVE_ID)
-                {
-                    // It is an inactive player
-                    Player* inactivePlayer = new Player(gameMap, 0);
-                    inactivePlayer->setNick("Inactive AI " + Helper::toString(seatId));
-                    gameMap->addPlayer(inactivePlayer);
-                    seat->setPlayer(inactivePlayer);
-                }
-                else if(playerId < Seat::PLAYER_ID_HUMAN_MIN)
+                if(playerId < Seat::PLAYER_ID_HUMAN_MIN)
                 {
-                    // It is an AI
-                    KeeperAIType aiType = Seat::playerIdToAIType(playerId);
-                    if(aiType >= KeeperAIType::nbAI)
-                    {
-                        OD_LOG_ERR("Wrong value for keeper seatId=" + Helper::toString(seat->getId())
-                            + ", ConfigPlayerId=" + Helper::toString(playerId));
-
-                        // Default to normal
-                        aiType = KeeperAIType::normal;
-                    }
-                    // We set player id = 0 for AI players. ID is only used during seat configuration phase
-                    // During the game, one should use the seat ID to identify a player
-                    Player* aiPlayer = new Player(gameMap, 0);
-                    aiPlayer->setNick("Keeper AI " + KeeperAITypes::toString(aiType) + " " + Helper::toString(seatId));
-                    gameMap->addPlayer(aiPlayer);
-                    seat->setPlayer(aiPlayer);
-                    gameMap->assignAI(*aiPlayer, aiType);
+                    createAIPlayer(seat, playerId);
                 }
                 else
                 {
@@ -1112,14 +1626,7 @@ bool ODServer::processClientNotifications(ODSocketClient* clientSocket)
                 client->send(packetSend);
             }
 
-            for(Seat* seat : gameMap->getSeats())
-            {
-                // We initialize the seats
-                seat->initSeat();
-            }
-
-            mSeatsConfigured = true;
-            gameMap->notifySeatsConfigured();
+            initSeats();
             break;
         }
 
@@ -1143,137 +1650,257 @@ bool ODServer::processClientNotifications(ODSocketClient* clientSocket)
             break;
         }
 
-        case ClientNotificationType::askEntityPickUp:
+        case ClientNotificationType::editorAskDestroyRoomTiles:
         {
-            std::string entityName;
-            GameEntityType entityType;
-            OD_ASSERT_TRUE(packetReceived >> entityType >> entityName);
-
-            Player *player = clientSocket->getPlayer();
-            GameEntity* entity = gameMap->getEntityFromTypeAndName(entityType, entityName);
-            if(entity == nullptr)
-            {
-                OD_LOG_ERR("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", entityName=" + entityName);
-                break;
-            }
-            bool allowPickup = entity->tryPickup(player->getSeat());
-            if(!allowPickup)
+            if(mServerMode != ServerMode::ModeEditor)
             {
-                OD_LOG_INF("player=" + player->getNick()
-                        + " could not pickup entity entityType="
-                        + Helper::toString(static_cast<int32_t>(entityType))
-                        + ", entityName=" + entityName);
+                OD_LOG_ERR("Received editor command while wrong mode mode"
+                    + Helper::toString(static_cast<int>(mServerMode)));
                 break;
             }
 
-            player->pickUpEntity(entity);
+            RoomManager::sellRoomTilesEditor(gameMap, packetReceived);
             break;
         }
 
-        case ClientNotificationType::askHandDrop:
+        case ClientNotificationType::editorAskDestroyTrapTiles:
         {
-            Player *player = clientSocket->getPlayer();
-            Tile* tile = gameMap->tileFromPacket(packetReceived);
-            if(tile == nullptr)
-            {
-                OD_LOG_ERR("player seatId=" + Helper::toString(player->getSeat()->getId())
-                    + " send wrong tile");
-                break;
-            }
-            if(!player->isDropHandPossible(tile, 0))
+            if(mServerMode != ServerMode::ModeEditor)
             {
-                OD_LOG_ERR("player seatId=" + Helper::toString(player->getSeat()->getId())
-                    + " could not drop entity in hand on tile "
-                    + Tile::displayAsString(tile));
+                OD_LOG_ERR("Received editor command while wrong mode mode"
+                    + Helper::toString(static_cast<int>(mServerMode)));
                 break;
             }
-            player->dropHand(tile, 0);
+
+            TrapManager::sellTrapTilesEditor(gameMap, packetReceived);
             break;
         }
 
-        case ClientNotificationType::askPickupWorker:
+        case ClientNotificationType::ackNewTurn:
         {
-            Player *player = clientSocket->getPlayer();
-            Creature* creature = gameMap->getWorkerToPickupBySeat(player->getSeat());
-            if(creature == nullptr)
-                break;
-
-            player->pickUpEntity(creature);
+            int64_t turn;
+            OD_ASSERT_TRUE(packetReceived >> turn);
+            clientSocket->setLastTurnAck(turn);
             break;
         }
 
-        case ClientNotificationType::askPickupFighter:
+        case ClientNotificationType::askCreatureInfos:
         {
-            Player *player = clientSocket->getPlayer();
-            Creature* creature = gameMap->getFighterToPickupBySeat(player->getSeat());
-            if(creature == nullptr)
-                break;
+            std::string name;
+            bool refreshEachTurn;
+            OD_ASSERT_TRUE(packetReceived >> name >> refreshEachTurn);
+            std::vector<std::string>& creatures = mCreaturesInfoWanted[clientSocket];
+
+            std::vector<std::string>::iterator it = std::find(creatures.begin(), creatures.end(), name);
+            if(refreshEachTurn && (it == creatures.end()))
+            {
+                creatures.push_back(name);
+            }
+            else if(!refreshEachTurn && (it != creatures.end()))
+                creatures.erase(it);
 
-            player->pickUpEntity(creature);
             break;
         }
 
-        case ClientNotificationType::askMarkTiles:
+        case ClientNotificationType::askSaveMap:
         {
-            int x1, y1, x2, y2;
-            bool isDigSet;
             Player* player = clientSocket->getPlayer();
+            // Only the player allowed to configure the game can save games
+            if(mPlayerConfig != player)
+                break;
 
-            OD_ASSERT_TRUE(packetReceived >> x1 >> y1 >> x2 >> y2 >> isDigSet);
-            std::vector<Tile*> tiles = gameMap->rectangularRegion(x1, y1, x2, y2);
-            player->markTilesForDigging(isDigSet, tiles, true);
+            // We only allow to save game if launching in client+server mode
+            if(ODClient::getSingletonPtr() == nullptr)
+                break;
+            if(!ODClient::getSingleton().isConnected())
+                break;
+
+            const boost::filesystem::path levelPath(gameMap->getLevelFileName());
+            std::string fileLevel = levelPath.filename().string();
+            // In editor mode, we don't allow a player to have creatures in hand while saving map
+            if((mServerMode == ServerMode::ModeEditor) &&
+                (player->numObjectsInHand() > 0))
+            {
+                // We cannot save the map
+                std::string msg = "Map could not be saved because player hand is not empty";
+                ServerNotification notif(ServerNotificationType::chatServer, player);
+                notif.mPacket << msg << EventShortNoticeType::genericGameInfo;
+                sendAsyncMsg(notif);
+                break;
+            }
+
+            boost::filesystem::path levelSave;
+            if(mServerMode == ServerMode::ModeEditor)
+            {
+                // In editor mode, we save in the original folder
+                levelSave = levelPath;
+
+                // If the level was not a custom one, we save it as a custom one now.
+                // Note: We don't compare for official levels path, as they may be relative and unreliable.
+                std::string levelStr = levelSave.string();
+                ResourceManager& resMgr = ResourceManager::getSingleton();
+                bool skirmishLevelType = (levelStr.find("skirmish") != std::string::npos);
+                if (skirmishLevelType) {
+                    if (levelStr.find(resMgr.getUserLevelPathSkirmish()) == std::string::npos) {
+                        levelSave = boost::filesystem::path(resMgr.getUserLevelPathSkirmish() + fileLevel);
+                    }
+                }
+                else if (levelStr.find(resMgr.getUserLevelPathMultiplayer()) == std::string::npos) {
+                    levelSave = boost::filesystem::path(resMgr.getUserLevelPathMultiplayer() + fileLevel);
+                }
+                std::cout << levelSave.string() << std::endl;
+            }
+            else
+            {
+                // We save in the saved game folder
+                static std::locale loc(std::wcout.getloc(), new boost::posix_time::time_facet("%Y-%m-%d_%H%M%S"));
+
+                std::ostringstream ss;
+                ss.imbue(loc);
+                ss << boost::posix_time::second_clock::local_time() << "-";
+                switch(mServerMode)
+                {
+                    case ServerMode::ModeGameSinglePlayer:
+                        ss << SAVEGAME_SKIRMISH_PREFIX;
+                        ss << fileLevel;
+                        break;
+                    case ServerMode::ModeGameMultiPlayer:
+                        ss << SAVEGAME_MULTIPLAYER_PREFIX;
+                        ss << fileLevel;
+                        break;
+                    case ServerMode::ModeGameLoaded:
+                    {
+                        // We look for the Skirmish or multiplayer prefix and keep it.
+                        uint32_t indexSk = fileLevel.find(SAVEGAME_SKIRMISH_PREFIX);
+                        uint32_t indexMp = fileLevel.find(SAVEGAME_MULTIPLAYER_PREFIX);
+                        if((indexSk != std::string::npos) && (indexMp == std::string::npos))
+                        {
+                            // Skirmish savegame
+                            ss << SAVEGAME_SKIRMISH_PREFIX;
+                            ss << fileLevel.substr(indexSk + SAVEGAME_SKIRMISH_PREFIX.length());
+
+                        }
+                        else if((indexSk == std::string::npos) && (indexMp != std::string::npos))
+                        {
+                            // Multiplayer savegame
+                            ss << SAVEGAME_MULTIPLAYER_PREFIX;
+                            ss << fileLevel.substr(indexMp + SAVEGAME_MULTIPLAYER_PREFIX.length());
+                        }
+                        else if((indexSk != std::string::npos) && (indexMp != std::string::npos))
+                        {
+                            // We found both prefixes. That can happen if the name contains the other
+                            // prefix. Because of filename construction, we know that the lowest is the good
+                            if(indexSk < indexMp)
+                            {
+                                ss << SAVEGAME_SKIRMISH_PREFIX;
+                                ss << fileLevel.substr(indexSk + SAVEGAME_SKIRMISH_PREFIX.length());
+                            }
+                            else
+                            {
+                                ss << SAVEGAME_MULTIPLAYER_PREFIX;
+                                ss << fileLevel.substr(indexMp + SAVEGAME_MULTIPLAYER_PREFIX.length());
+                            }
+                        }
+                        else
+                        {
+                            // We couldn't find any prefix. That's not normal
+                            OD_LOG_ERR("fileLevel=" + fileLevel);
+                            ss << fileLevel;
+                        }
+                        break;
+                    }
+                    default:
+                        OD_LOG_ERR("mode=" + Helper::toString(static_cast<int>(mServerMode)));
+                        ss << fileLevel;
+                        break;
+                }
+                std::string savePath = ResourceManager::getSingleton().getSaveGamePath() + ss.str();
+                levelSave = boost::filesystem::path(savePath);
+            }
 
+            // The players will be notified when the file is written
+            saveGameMap(levelSave.string());
             break;
         }
 
-        case ClientNotificationType::askSlapEntity:
+        case ClientNotificationType::editorAskChangeTiles:
         {
-            GameEntityType entityType;
-            std::string entityName;
-            Player* player = clientSocket->getPlayer();
-            OD_ASSERT_TRUE(packetReceived >> entityType >> entityName);
-            GameEntity* entity = gameMap->getEntityFromTypeAndName(entityType, entityName);
-            if(entity == nullptr)
+            if(mServerMode != ServerMode::ModeEditor)
             {
-                OD_LOG_WRN("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", entityName=" + entityName);
+                OD_LOG_ERR("Received editor command while wrong mode mode" + Helper::toString(static_cast<int>(mServerMode)));
                 break;
             }
+            int x1, y1, x2, y2;
+            TileType tileType;
+            double tileFullness;
+            int seatId;
 
-            if(!entity->canSlap(player->getSeat()))
+            OD_ASSERT_TRUE(packetReceived >> x1 >> y1 >> x2 >> y2 >> tileType >> tileFullness >> seatId);
+            std::vector<Tile*> selectedTiles = gameMap->rectangularRegion(x1, y1, x2, y2);
+            std::vector<Tile*> affectedTiles;
+            Seat* seat = nullptr;
+            if(seatId != -1)
+                seat = gameMap->getSeatById(seatId);
+
+            for(Tile* tile : selectedTiles)
             {
-                OD_LOG_INF("player seatId=" + Helper::toString(player->getSeat()->getId())
-                    + " could not slap entity entityType="
-                    + Helper::toString(static_cast<int32_t>(entityType))
-                    + ", entityName=" + entityName);
-                break;
+                // We do not change tiles where there is something
+                if((tile->numEntitiesInTile() > 0) &&
+                   ((tileFullness > 0.0) || (tileType == TileType::lava) || (tileType == TileType::water)))
+                    continue;
+                if(tile->getCoveringBuilding() != nullptr)
+                    continue;
+
+                affectedTiles.push_back(tile);
+                tile->setType(tileType);
+                tile->setFullness(tileFullness);
+                if(seat != nullptr)
+                    tile->claimTile(seat);
+                else
+                    tile->unclaimTile();
+
+                tile->computeTileVisual();
             }
+            if(!affectedTiles.empty())
+            {
+                uint32_t nbTiles = affectedTiles.size();
+                const std::vector<Seat*>& seats = gameMap->getSeats();
+                for(Seat* seat : seats)
+                {
+                    if(seat->getPlayer() == nullptr)
+                        continue;
+                    if(!seat->getPlayer()->getIsHuman())
+                        continue;
 
-            OD_LOG_INF("player seatId=" + Helper::toString(player->getSeat()->getId()) + " slapped entity " + entity->getName());
-            entity->slap();
+                    ServerNotification notif(ServerNotificationType::refreshTiles, seat->getPlayer());
+                    notif.mPacket << nbTiles;
+                    for(Tile* tile : affectedTiles)
+                    {
+                        gameMap->tileToPacket(notif.mPacket, tile);
+                        seat->updateTileStateForSeat(tile, false);
+                        tile->exportToPacketForUpdate(notif.mPacket, seat);
 
-            ServerNotification notif(ServerNotificationType::entitySlapped, player);
-            sendAsyncMsg(notif);
+                    }
+                    sendAsyncMsg(notif);
+                }
+            }
             break;
         }
 
-        case ClientNotificationType::askBuildRoom:
+        case ClientNotificationType::editorAskBuildRoom:
         {
-            RoomType type;
-
-            OD_ASSERT_TRUE(packetReceived >> type);
-            Player* player = clientSocket->getPlayer();
-
-            // We check if the room is available. It is not normal to receive a message
-            // asking to build an unbuildable room since the client should only display
-            // available rooms
-            if(!SkillManager::isRoomAvailable(type, player->getSeat()))
+            if(mServerMode != ServerMode::ModeEditor)
             {
-                OD_LOG_INF("WARNING: player seatId=" + Helper::toString(player->getSeat()->getId())
-                    + " asked to build a room not available: " + RoomManager::getRoomNameFromRoomType(type));
+                OD_LOG_ERR("Received editor command while wrong mode mode"
+                    + Helper::toString(static_cast<int>(mServerMode)));
                 break;
             }
+            RoomType type;
 
-            if(!RoomManager::buildRoom(gameMap, type, player, packetReceived))
+            OD_ASSERT_TRUE(packetReceived >> type);
+
+            Player* player = clientSocket->getPlayer();
+            if(!RoomManager::buildRoomEditor(gameMap, type, packetReceived))
             {
                 OD_LOG_INF("WARNING: player seatId=" + Helper::toString(player->getSeat()->getId())
                     + " couldn't build room: " + RoomManager::getRoomNameFromRoomType(type));
@@ -1282,14 +1909,7 @@ bool ODServer::processClientNotifications(ODSocketClient* clientSocket)
             break;
         }
 
-        case ClientNotificationType::askSellRoomTiles:
-        {
-            Player* player = clientSocket->getPlayer();
-            RoomManager::sellRoomTiles(gameMap, player, packetReceived);
-            break;
-        }
-
-        case ClientNotificationType::editorAskDestroyRoomTiles:
+        case ClientNotificationType::editorAskBuildTrap:
         {
             if(mServerMode != ServerMode::ModeEditor)
             {
@@ -1297,470 +1917,395 @@ bool ODServer::processClientNotifications(ODSocketClient* clientSocket)
                     + Helper::toString(static_cast<int>(mServerMode)));
                 break;
             }
-
-            RoomManager::sellRoomTilesEditor(gameMap, packetReceived);
-            break;
-        }
-
-        case ClientNotificationType::askBuildTrap:
-        {
             TrapType type;
 
             OD_ASSERT_TRUE(packetReceived >> type);
-            Player* player = clientSocket->getPlayer();
 
-            // We check if the trap is available. It is not normal to receive a message
-            // asking to build an unbuildable trap since the client should only display
-            // available rooms
-            if(!SkillManager::isTrapAvailable(type, player->getSeat()))
+            Player* player = clientSocket->getPlayer();
+            if(!TrapManager::buildTrapEditor(gameMap, type, packetReceived))
             {
                 OD_LOG_INF("WARNING: player seatId=" + Helper::toString(player->getSeat()->getId())
-                    + " asked to build a trap not available: " + TrapManager::getTrapNameFromTrapType(type));
+                    + " couldn't build trap: " + TrapManager::getTrapNameFromTrapType(type));
                 break;
             }
+            break;
+        }
 
-            if(!TrapManager::buildTrap(gameMap, type, player, packetReceived))
+        case ClientNotificationType::editorCreateWorker:
+        {
+            if(mServerMode != ServerMode::ModeEditor)
             {
-                OD_LOG_INF("WARNING: player seatId=" + Helper::toString(player->getSeat()->getId())
-                    + " couldn't build trap: " + TrapManager::getTrapNameFromTrapType(type));
+                OD_LOG_ERR("Received editor command while wrong mode mode" + Helper::toString(static_cast<int>(mServerMode)));
                 break;
             }
-
-            // If the player is human and do not own a workshop, we warn him
-            if(!player->getIsHuman())
-                break;
-            if(player->getHasLost())
+            Player* player = clientSocket->getPlayer();
+            int seatId;
+            OD_ASSERT_TRUE(packetReceived >> seatId);
+            Seat* seatCreature = gameMap->getSeatById(seatId);
+            if(seatCreature == nullptr)
+            {
+                OD_LOG_ERR("seatId=" + Helper::toString(seatId));
                 break;
+            }
 
-            std::vector<Room*> rooms = gameMap->getRoomsByTypeAndSeat(RoomType::workshop, player->getSeat());
-            if(!rooms.empty())
+            const CreatureDefinition *classToSpawn = ConfigManager::getSingleton().getCreatureDefinitionDefaultWorker();
+            if(classToSpawn == nullptr)
+            {
+                OD_LOG_ERR("unexpected null classToSpawn for getCreatureDefinitionDefaultWorker");
                 break;
+            }
+            Creature* newCreature = new Creature(gameMap, classToSpawn, seatCreature);
+            newCreature->addToGameMap();
+            newCreature->setPosition(Ogre::Vector3(0.0, 0.0, 0.0));
+            // In editor mode, every player has vision
+            for(Seat* seat : gameMap->getSeats())
+            {
+                if(seat->getPlayer() == nullptr)
+                    continue;
+                if(!seat->getPlayer()->getIsHuman())
+                    continue;
 
-            ServerNotification *serverNotification = new ServerNotification(
-                ServerNotificationType::chatServer, player);
+                newCreature->addSeatWithVision(seat, true);
+            }
 
-            std::string msg = "You need a workshop to craft the trap!";
-            serverNotification->mPacket << msg << EventShortNoticeType::genericGameInfo;
-            ODServer::getSingleton().queueServerNotification(serverNotification);
+            player->pickUpEntity(newCreature);
             break;
         }
 
-        case ClientNotificationType::askCastSpell:
+        case ClientNotificationType::editorCreateFighter:
         {
-            SpellType spellType;
-
-            OD_ASSERT_TRUE(packetReceived >> spellType);
+            if(mServerMode != ServerMode::ModeEditor)
+            {
+                OD_LOG_ERR("Received editor command while wrong mode=" + Helper::toString(static_cast<int>(mServerMode)));
+                break;
+            }
             Player* player = clientSocket->getPlayer();
-
-            // We check if the spell is available. It is not normal to receive a message
-            // asking to cast an uncastable spell since the client should only display
-            // available spells
-            if(!SkillManager::isSpellAvailable(spellType, player->getSeat()))
+            int seatId;
+            std::string className;
+            OD_ASSERT_TRUE(packetReceived >> seatId >> className);
+            Seat* seatCreature = gameMap->getSeatById(seatId);
+            if(seatCreature == nullptr)
             {
-                OD_LOG_WRN("player " + player->getNick()
-                    + " asked to cast a spell not available: " + SpellManager::getSpellNameFromSpellType(spellType));
+                OD_LOG_ERR("seatId=" + Helper::toString(seatId));
                 break;
             }
-
-            uint32_t cooldown = player->getSpellCooldownTurns(spellType);
-            if(cooldown > 0)
+            const CreatureDefinition *classToSpawn = gameMap->getClassDescription(className);
+            if(classToSpawn == nullptr)
             {
-                OD_LOG_WRN("player " + player->getNick()
-                    + " asked to cast a spell " + SpellManager::getSpellNameFromSpellType(spellType) + " before end of cooldown: "
-                    + Helper::toString(cooldown));
+                OD_LOG_ERR("Couldn't spawn creature class=" + className);
                 break;
             }
+            Creature* newCreature = new Creature(gameMap, classToSpawn, seatCreature);
+            newCreature->addToGameMap();
+            newCreature->setPosition(Ogre::Vector3(0.0, 0.0, 0.0));
+            // In editor mode, every player has vision
+            for(Seat* seat : gameMap->getSeats())
+            {
+                if(seat->getPlayer() == nullptr)
+                    continue;
+                if(!seat->getPlayer()->getIsHuman())
+                    continue;
 
-            OD_LOG_INF("Player id: " + Helper::toString(player->getSeat()->getId()) + " casts spell " + SpellManager::getSpellNameFromSpellType(spellType));
-
-            if(!SpellManager::castSpell(gameMap, spellType, player, packetReceived))
-                break;
+                newCreature->addSeatWithVision(seat, true);
+            }
 
-            uint32_t newCooldown = SpellManager::getSpellCooldown(spellType);
-            player->setSpellCooldownTurns(spellType, newCooldown);
+            player->pickUpEntity(newCreature);
             break;
         }
 
-        case ClientNotificationType::askSellTrapTiles:
+        case ClientNotificationType::editorAskCreateMapLight:
         {
             Player* player = clientSocket->getPlayer();
-            TrapManager::sellTrapTiles(gameMap, player->getSeat(), packetReceived);
-            break;
-        }
-
-        case ClientNotificationType::askSetPlayerSettings:
-        {
-            Seat* playerSeat = clientSocket->getPlayer()->getSeat();
-            bool koCreatures;
-            OD_ASSERT_TRUE(packetReceived >> koCreatures);
-            playerSeat->setPlayerSettings(koCreatures);
-            break;
-        }
-
-        case ClientNotificationType::editorAskDestroyTrapTiles:
-        {
-            if(mServerMode != ServerMode::ModeEditor)
+            MapLight* mapLight = new MapLight(gameMap, true);
+            mapLight->setName(gameMap->nextUniqueNameMapLight());
+            mapLight->addToGameMap();
+            mapLight->setPosition(Ogre::Vector3(0.0, 0.0, 3.75));
+            // In editor mode, every player has vision
+            for(Seat* seat : gameMap->getSeats())
             {
-                OD_LOG_ERR("Received editor command while wrong mode mode"
-                    + Helper::toString(static_cast<int>(mServerMode)));
-                break;
-            }
+                if(seat->getPlayer() == nullptr)
+                    continue;
+                if(!seat->getPlayer()->getIsHuman())
+                    continue;
 
-            TrapManager::sellTrapTilesEditor(gameMap, packetReceived);
+                mapLight->addSeatWithVision(seat, true);
+            }
+            player->pickUpEntity(mapLight);
             break;
         }
 
-        case ClientNotificationType::ackNewTurn:
+        default:
         {
-            int64_t turn;
-            OD_ASSERT_TRUE(packetReceived >> turn);
-            clientSocket->setLastTurnAck(turn);
-            break;
+            OD_LOG_ERR("Unhandled command received from client:"
+                + Helper::toString(static_cast<int>(clientCommand)));
         }
+    }
 
-        case ClientNotificationType::askCreatureInfos:
-        {
-            std::string name;
-            bool refreshEachTurn;
-            OD_ASSERT_TRUE(packetReceived >> name >> refreshEachTurn);
-            std::vector<std::string>& creatures = mCreaturesInfoWanted[clientSocket];
+    return true;
+}
 
-            std::vector<std::string>::iterator it = std::find(creatures.begin(), creatures.end(), name);
-            if(refreshEachTurn && (it == creatures.end()))
-            {
-                creatures.push_back(name);
-            }
-            else if(!refreshEachTurn && (it != creatures.end()))
-                creatures.erase(it);
+bool ODServer::isGameCommand(ClientNotificationType type)
+{
+    switch(type)
+    {
+        case ClientNotificationType::askEntityPickUp:
+        case ClientNotificationType::askHandDrop:
+        case ClientNotificationType::askPickupWorker:
+        case ClientNotificationType::askPickupFighter:
+        case ClientNotificationType::askMarkTiles:
+        case ClientNotificationType::askSlapEntity:
+        case ClientNotificationType::askBuildRoom:
+        case ClientNotificationType::askSellRoomTiles:
+        case ClientNotificationType::askBuildTrap:
+        case ClientNotificationType::askCastSpell:
+        case ClientNotificationType::askSellTrapTiles:
+        case ClientNotificationType::askSetPlayerSettings:
+        case ClientNotificationType::askSetSkillTree:
+        case ClientNotificationType::askExecuteConsoleCommand:
+            return true;
+        default:
+            return false;
+    }
+}
 
-            break;
-        }
+void ODServer::processGameCommand(Player* player, ClientNotificationType type, ODPacket& packetReceived)
+{
+    GameMap* gameMap = mGameMap;
 
-        case ClientNotificationType::askSaveMap:
+    switch(type)
+    {
+        case ClientNotificationType::askEntityPickUp:
         {
-            Player* player = clientSocket->getPlayer();
-            // Only the player allowed to configure the game can save games
-            if(mPlayerConfig != player)
-                break;
-
-            // We only allow to save game if launching in client+server mode
-            if(ODClient::getSingletonPtr() == nullptr)
-                break;
-            if(!ODClient::getSingleton().isConnected())
-                break;
+            std::string entityName;
+            GameEntityType entityType;
+            OD_ASSERT_TRUE(packetReceived >> entityType >> entityName);
 
-            const boost::filesystem::path levelPath(gameMap->getLevelFileName());
-            std::string fileLevel = levelPath.filename().string();
-            // In editor mode, we don't allow a player to have creatures in hand while saving map
-            if((mServerMode == ServerMode::ModeEditor) &&
-                (player->numObjectsInHand() > 0))
+            GameEntity* entity = gameMap->getEntityFromTypeAndName(entityType, entityName);
+            if(entity == nullptr)
             {
-                // We cannot save the map
-                std::string msg = "Map could not be saved because player hand is not empty";
-                ServerNotification notif(ServerNotificationType::chatServer, player);
-                notif.mPacket << msg << EventShortNoticeType::genericGameInfo;
-                sendAsyncMsg(notif);
+                OD_LOG_ERR("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", entityName=" + entityName);
                 break;
             }
-
-            boost::filesystem::path levelSave;
-            if(mServerMode == ServerMode::ModeEditor)
+            bool allowPickup = entity->tryPickup(player->getSeat());
+            if(!allowPickup)
             {
-                // In editor mode, we save in the original folder
-                levelSave = levelPath;
-
-                // If the level was not a custom one, we save it as a custom one now.
-                // Note: We don't compare for official levels path, as they may be relative and unreliable.
-                std::string levelStr = levelSave.string();
-                ResourceManager& resMgr = ResourceManager::getSingleton();
-                bool skirmishLevelType = (levelStr.find("skirmish") != std::string::npos);
-                if (skirmishLevelType) {
-                    if (levelStr.find(resMgr.getUserLevelPathSkirmish()) == std::string::npos) {
-                        levelSave = boost::filesystem::path(resMgr.getUserLevelPathSkirmish() + fileLevel);
-                    }
-                }
-                else if (levelStr.find(resMgr.getUserLevelPathMultiplayer()) == std::string::npos) {
-                    levelSave = boost::filesystem::path(resMgr.getUserLevelPathMultiplayer() + fileLevel);
-                }
-                std::cout << levelSave.string() << std::endl;
+                OD_LOG_INF("player=" + player->getNick()
+                        + " could not pickup entity entityType="
+                        + Helper::toString(static_cast<int32_t>(entityType))
+                        + ", entityName=" + entityName);
+                break;
             }
-            else
-            {
-                // We save in the saved game folder
-                static std::locale loc(std::wcout.getloc(), new boost::posix_time::time_facet("%Y-%m-%d_%H%M%S"));
 
-                std::ostringstream ss;
-                ss.imbue(loc);
-                ss << boost::posix_time::second_clock::local_time() << "-";
-                switch(mServerMode)
-                {
-                    case ServerMode::ModeGameSinglePlayer:
-                        ss << SAVEGAME_SKIRMISH_PREFIX;
-                        ss << fileLevel;
-                        break;
-                    case ServerMode::ModeGameMultiPlayer:
-                        ss << SAVEGAME_MULTIPLAYER_PREFIX;
-                        ss << fileLevel;
-                        break;
-                    case ServerMode::ModeGameLoaded:
-                    {
-                        // We look for the Skirmish or multiplayer prefix and keep it.
-                        uint32_t indexSk = fileLevel.find(SAVEGAME_SKIRMISH_PREFIX);
-                        uint32_t indexMp = fileLevel.find(SAVEGAME_MULTIPLAYER_PREFIX);
-                        if((indexSk != std::string::npos) && (indexMp == std::string::npos))
-                        {
-                            // Skirmish savegame
-                            ss << SAVEGAME_SKIRMISH_PREFIX;
-                            ss << fileLevel.substr(indexSk + SAVEGAME_SKIRMISH_PREFIX.length());
+            player->pickUpEntity(entity);
+            break;
+        }
 
-                        }
-                        else if((indexSk == std::string::npos) && (indexMp != std::string::npos))
-                        {
-                            // Multiplayer savegame
-                            ss << SAVEGAME_MULTIPLAYER_PREFIX;
-                            ss << fileLevel.substr(indexMp + SAVEGAME_MULTIPLAYER_PREFIX.length());
-                        }
-                        else if((indexSk != std::string::npos) && (indexMp != std::string::npos))
-                        {
-                            // We found both prefixes. That can happen if the name contains the other
-                            // prefix. Because of filename construction, we know that the lowest is the good
-                            if(indexSk < indexMp)
-                            {
-                                ss << SAVEGAME_SKIRMISH_PREFIX;
-                                ss << fileLevel.substr(indexSk + SAVEGAME_SKIRMISH_PREFIX.length());
-                            }
-                            else
-                            {
-                                ss << SAVEGAME_MULTIPLAYER_PREFIX;
-                                ss << fileLevel.substr(indexMp + SAVEGAME_MULTIPLAYER_PREFIX.length());
-                            }
-                        }
-                        else
-                        {
-                            // We couldn't find any prefix. That's not normal
-                            OD_LOG_ERR("fileLevel=" + fileLevel);
-                            ss << fileLevel;
-                        }
-                        break;
-                    }
-                    default:
-                        OD_LOG_ERR("mode=" + Helper::toString(static_cast<int>(mServerMode)));
-                        ss << fileLevel;
-                        break;
-                }
-                std::string savePath = ResourceManager::getSingleton().getSaveGamePath() + ss.str();
-                levelSave = boost::filesystem::path(savePath);
+        case ClientNotificationType::askHandDrop:
+        {
+            Tile* tile = gameMap->tileFromPacket(packetReceived);
+            if(tile == nullptr)
+            {
+                OD_LOG_ERR("player seatId=" + Helper::toString(player->getSeat()->getId())
+                    + " send wrong tile");
+                break;
             }
-
-            // If the file exists, we make a backup
-            if (boost::filesystem::exists(levelSave))
-                boost::filesystem::rename(levelSave, levelSave.string() + ".bak");
-
-            std::string msg = "Map saved successfully as: " + levelSave.string();
-            if (!MapHandler::writeGameMapToFile(levelSave.string(), *gameMap))
+            if(!player->isDropHandPossible(tile, 0))
             {
-                msg = "Couldn't not save map file as: " + levelSave.string() + "\nPlease check logs.";
+                OD_LOG_ERR("player seatId=" + Helper::toString(player->getSeat()->getId())
+                    + " could not drop entity in hand on tile "
+                    + Tile::displayAsString(tile));
+                break;
             }
-            // We notify all the players that the game was saved successfully
-            ServerNotification notif(ServerNotificationType::chatServer, nullptr);
-            notif.mPacket << msg << EventShortNoticeType::genericGameInfo;
-            sendAsyncMsg(notif);
+            player->dropHand(tile, 0);
             break;
         }
 
-        case ClientNotificationType::editorAskChangeTiles:
+        case ClientNotificationType::askPickupWorker:
         {
-            if(mServerMode != ServerMode::ModeEditor)
-            {
-                OD_LOG_ERR("Received editor command while wrong mode mode" + Helper::toString(static_cast<int>(mServerMode)));
+            Creature* creature = gameMap->getWorkerToPickupBySeat(player->getSeat());
+            if(creature == nullptr)
                 break;
-            }
-            int x1, y1, x2, y2;
-            TileType tileType;
-            double tileFullness;
-            int seatId;
-
-            OD_ASSERT_TRUE(packetReceived >> x1 >> y1 >> x2 >> y2 >> tileType >> tileFullness >> seatId);
-            std::vector<Tile*> selectedTiles = gameMap->rectangularRegion(x1, y1, x2, y2);
-            std::vector<Tile*> affectedTiles;
-            Seat* seat = nullptr;
-            if(seatId != -1)
-                seat = gameMap->getSeatById(seatId);
-
-            for(Tile* tile : selectedTiles)
-            {
-                // We do not change tiles where there is something
-                if((tile->numEntitiesInTile() > 0) &&
-                   ((tileFullness > 0.0) || (tileType == TileType::lava) || (tileType == TileType::water)))
-                    continue;
-                if(tile->getCoveringBuilding() != nullptr)
-                    continue;
 
-                affectedTiles.push_back(tile);
-                tile->setType(tileType);
-                tile->setFullness(tileFullness);
-                if(seat != nullptr)
-                    tile->claimTile(seat);
-                else
-                    tile->unclaimTile();
+            player->pickUpEntity(creature);
+            break;
+        }
 
-                tile->computeTileVisual();
-            }
-            if(!affectedTiles.empty())
-            {
-                uint32_t nbTiles = affectedTiles.size();
-                const std::vector<Seat*>& seats = gameMap->getSeats();
-                for(Seat* seat : seats)
-                {
-                    if(seat->getPlayer() == nullptr)
-                        continue;
-                    if(!seat->getPlayer()->getIsHuman())
-                        continue;
+        case ClientNotificationType::askPickupFighter:
+        {
+            Creature* creature = gameMap->getFighterToPickupBySeat(player->getSeat());
+            if(creature == nullptr)
+                break;
 
-                    ServerNotification notif(ServerNotificationType::refreshTiles, seat->getPlayer());
-                    notif.mPacket << nbTiles;
-                    for(Tile* tile : affectedTiles)
-                    {
-                        gameMap->tileToPacket(notif.mPacket, tile);
-                        seat->updateTileStateForSeat(tile, false);
-                        tile->exportToPacketForUpdate(notif.mPacket, seat);
+            player->pickUpEntity(creature);
+            break;
+        }
+
+        case ClientNotificationType::askMarkTiles:
+        {
+            int x1, y1, x2, y2;
+            bool isDigSet;
+
+            OD_ASSERT_TRUE(packetReceived >> x1 >> y1 >> x2 >> y2 >> isDigSet);
+            std::vector<Tile*> tiles = gameMap->rectangularRegion(x1, y1, x2, y2);
+            player->markTilesForDigging(isDigSet, tiles, true);
 
-                    }
-                    sendAsyncMsg(notif);
-                }
-            }
             break;
         }
 
-        case ClientNotificationType::editorAskBuildRoom:
+        case ClientNotificationType::askSlapEntity:
         {
-            if(mServerMode != ServerMode::ModeEditor)
+            GameEntityType entityType;
+            std::string entityName;
+            OD_ASSERT_TRUE(packetReceived >> entityType >> entityName);
+            GameEntity* entity = gameMap->getEntityFromTypeAndName(entityType, entityName);
+            if(entity == nullptr)
             {
-                OD_LOG_ERR("Received editor command while wrong mode mode"
-                    + Helper::toString(static_cast<int>(mServerMode)));
+                OD_LOG_WRN("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", entityName=" + entityName);
                 break;
             }
-            RoomType type;
-
-            OD_ASSERT_TRUE(packetReceived >> type);
 
-            Player* player = clientSocket->getPlayer();
-            if(!RoomManager::buildRoomEditor(gameMap, type, packetReceived))
+            if(!entity->canSlap(player->getSeat()))
             {
-                OD_LOG_INF("WARNING: player seatId=" + Helper::toString(player->getSeat()->getId())
-                    + " couldn't build room: " + RoomManager::getRoomNameFromRoomType(type));
+                OD_LOG_INF("player seatId=" + Helper::toString(player->getSeat()->getId())
+                    + " could not slap entity entityType="
+                    + Helper::toString(static_cast<int32_t>(entityType))
+                    + ", entityName=" + entityName);
                 break;
             }
+
+            OD_LOG_INF("player seatId=" + Helper::toString(player->getSeat()->getId()) + " slapped entity " + entity->getName());
+            entity->slap();
+
+            ServerNotification notif(ServerNotificationType::entitySlapped, player);
+            sendAsyncMsg(notif);
             break;
         }
 
-        case ClientNotificationType::editorAskBuildTrap:
+        case ClientNotificationType::askBuildRoom:
         {
-            if(mServerMode != ServerMode::ModeEditor)
+            RoomType type;
+
+            OD_ASSERT_TRUE(packetReceived >> type);
+
+            // We check if the room is available. It is not normal to receive a message
+            // asking to build an unbuildable room since the client should only display
+            // available rooms
+            if(!SkillManager::isRoomAvailable(type, player->getSeat()))
             {
-                OD_LOG_ERR("Received editor command while wrong mode mode"
-                    + Helper::toString(static_cast<int>(mServerMode)));
+                OD_LOG_INF("WARNING: player seatId=" + Helper::toString(player->getSeat()->getId())
+                    + " asked to build a room not available: " + RoomManager::getRoomNameFromRoomType(type));
                 break;
             }
-            TrapType type;
 
-            OD_ASSERT_TRUE(packetReceived >> type);
-
-            Player* player = clientSocket->getPlayer();
-            if(!TrapManager::buildTrapEditor(gameMap, type, packetReceived))
+            if(!RoomManager::buildRoom(gameMap, type, player, packetReceived))
             {
                 OD_LOG_INF("WARNING: player seatId=" + Helper::toString(player->getSeat()->getId())
-                    + " couldn't build trap: " + TrapManager::getTrapNameFromTrapType(type));
+                    + " couldn't build room: " + RoomManager::getRoomNameFromRoomType(type));
                 break;
             }
             break;
         }
 
-        case ClientNotificationType::editorCreateWorker:
+        case ClientNotificationType::askSellRoomTiles:
         {
-            if(mServerMode != ServerMode::ModeEditor)
+            RoomManager::sellRoomTiles(gameMap, player, packetReceived);
+            break;
+        }
+
+        case ClientNotificationType::askBuildTrap:
+        {
+            TrapType type;
+
+            OD_ASSERT_TRUE(packetReceived >> type);
+
+            // We check if the trap is available. It is not normal to receive a message
+            // asking to build an unbuildable trap since the client should only display
+            // available rooms
+            if(!SkillManager::isTrapAvailable(type, player->getSeat()))
             {
-                OD_LOG_ERR("Received editor command while wrong mode mode" + Helper::toString(static_cast<int>(mServerMode)));
+                OD_LOG_INF("WARNING: player seatId=" + Helper::toString(player->getSeat()->getId())
+                    + " asked to build a trap not available: " + TrapManager::getTrapNameFromTrapType(type));
                 break;
             }
-            Player* player = clientSocket->getPlayer();
-            int seatId;
-            OD_ASSERT_TRUE(packetReceived >> seatId);
-            Seat* seatCreature = gameMap->getSeatById(seatId);
-            if(seatCreature == nullptr)
+
+            if(!TrapManager::buildTrap(gameMap, type, player, packetReceived))
             {
-                OD_LOG_ERR("seatId=" + Helper::toString(seatId));
+                OD_LOG_INF("WARNING: player seatId=" + Helper::toString(player->getSeat()->getId())
+                    + " couldn't build trap: " + TrapManager::getTrapNameFromTrapType(type));
                 break;
             }
 
-            const CreatureDefinition *classToSpawn = ConfigManager::getSingleton().getCreatureDefinitionDefaultWorker();
-            if(classToSpawn == nullptr)
-            {
-                OD_LOG_ERR("unexpected null classToSpawn for getCreatureDefinitionDefaultWorker");
+            // If the player is human and do not own a workshop, we warn him
+            if(!player->getIsHuman())
+                break;
+            if(player->getHasLost())
                 break;
-            }
-            Creature* newCreature = new Creature(gameMap, classToSpawn, seatCreature);
-            newCreature->addToGameMap();
-            newCreature->setPosition(Ogre::Vector3(0.0, 0.0, 0.0));
-            // In editor mode, every player has vision
-            for(Seat* seat : gameMap->getSeats())
-            {
-                if(seat->getPlayer() == nullptr)
-                    continue;
-                if(!seat->getPlayer()->getIsHuman())
-                    continue;
 
-                newCreature->addSeatWithVision(seat, true);
-            }
+            std::vector<Room*> rooms = gameMap->getRoomsByTypeAndSeat(RoomType::workshop, player->getSeat());
+            if(!rooms.empty())
+                break;
 
-            player->pickUpEntity(newCreature);
+            ServerNotification *serverNotification = new ServerNotification(
+                ServerNotificationType::chatServer, player);
+
+            std::string msg = "You need a workshop to craft the trap!";
+            serverNotification->mPacket << msg << EventShortNoticeType::genericGameInfo;
+            ODServer::getSingleton().queueServerNotification(serverNotification);
             break;
         }
 
-        case ClientNotificationType::editorCreateFighter:
+        case ClientNotificationType::askCastSpell:
         {
-            if(mServerMode != ServerMode::ModeEditor)
+            SpellType spellType;
+
+            OD_ASSERT_TRUE(packetReceived >> spellType);
+
+            // We check if the spell is available. It is not normal to receive a message
+            // asking to cast an uncastable spell since the client should only display
+            // available spells
+            if(!SkillManager::isSpellAvailable(spellType, player->getSeat()))
             {
-                OD_LOG_ERR("Received editor command while wrong mode=" + Helper::toString(static_cast<int>(mServerMode)));
+                OD_LOG_WRN("player " + player->getNick()
+                    + " asked to cast a spell not available: " + SpellManager::getSpellNameFromSpellType(spellType));
                 break;
             }
-            Player* player = clientSocket->getPlayer();
-            int seatId;
-            std::string className;
-            OD_ASSERT_TRUE(packetReceived >> seatId >> className);
-            Seat* seatCreature = gameMap->getSeatById(seatId);
-            if(seatCreature == nullptr)
+
+            uint32_t cooldown = player->getSpellCooldownTurns(spellType);
+            if(cooldown > 0)
             {
-                OD_LOG_ERR("seatId=" + Helper::toString(seatId));
+                OD_LOG_WRN("player " + player->getNick()
+                    + " asked to cast a spell " + SpellManager::getSpellNameFromSpellType(spellType) + " before end of cooldown: "
+                    + Helper::toString(cooldown));
                 break;
             }
-            const CreatureDefinition *classToSpawn = gameMap->getClassDescription(className);
-            if(classToSpawn == nullptr)
-            {
-                OD_LOG_ERR("Couldn't spawn creature class=" + className);
+
+            OD_LOG_INF("Player id: " + Helper::toString(player->getSeat()->getId()) + " casts spell " + SpellManager::getSpellNameFromSpellType(spellType));
+
+            if(!SpellManager::castSpell(gameMap, spellType, player, packetReceived))
                 break;
-            }
-            Creature* newCreature = new Creature(gameMap, classToSpawn, seatCreature);
-            newCreature->addToGameMap();
-            newCreature->setPosition(Ogre::Vector3(0.0, 0.0, 0.0));
-            // In editor mode, every player has vision
-            for(Seat* seat : gameMap->getSeats())
-            {
-                if(seat->getPlayer() == nullptr)
-                    continue;
-                if(!seat->getPlayer()->getIsHuman())
-                    continue;
 
-                newCreature->addSeatWithVision(seat, true);
-            }
+            uint32_t newCooldown = SpellManager::getSpellCooldown(spellType);
+            player->setSpellCooldownTurns(spellType, newCooldown);
+            break;
+        }
 
-            player->pickUpEntity(newCreature);
+        case ClientNotificationType::askSellTrapTiles:
+        {
+            TrapManager::sellTrapTiles(gameMap, player->getSeat(), packetReceived);
+            break;
+        }
+
+        case ClientNotificationType::askSetPlayerSettings:
+        {
+            Seat* playerSeat = player->getSeat();
+            bool koCreatures;
+            OD_ASSERT_TRUE(packetReceived >> koCreatures);
+            playerSeat->setPlayerSettings(koCreatures);
             break;
         }
 
         case ClientNotificationType::askSetSkillTree:
         {
-            Player* player = clientSocket->getPlayer();
             uint32_t nbItems;
             OD_ASSERT_TRUE(packetReceived >> nbItems);
             std::vector<SkillType> skills;
@@ -1788,40 +2333,44 @@ bool ODServer::processClientNotifications(ODSocketClient* clientSocket)
                 OD_ASSERT_TRUE(packetReceived >> str);
                 args.push_back(str);
             }
-            Player* player = clientSocket->getPlayer();
             handleConsoleCommand(player, gameMap, args);
             break;
         }
 
-        case ClientNotificationType::editorAskCreateMapLight:
+        default:
         {
-            Player* player = clientSocket->getPlayer();
-            MapLight* mapLight = new MapLight(gameMap, true);
-            mapLight->setName(gameMap->nextUniqueNameMapLight());
-            mapLight->addToGameMap();
-            mapLight->setPosition(Ogre::Vector3(0.0, 0.0, 3.75));
-            // In editor mode, every player has vision
-            for(Seat* seat : gameMap->getSeats())
-            {
-                if(seat->getPlayer() == nullptr)
-                    continue;
-                if(!seat->getPlayer()->getIsHuman())
-                    continue;
-
-                mapLight->addSeatWithVision(seat, true);
-            }
-            player->pickUpEntity(mapLight);
+            OD_LOG_ERR("Unhandled game command:" + Helper::toString(static_cast<int>(type)));
             break;
         }
+    }
+}
 
-        default:
+void ODServer::applyQueuedGameCommands(int64_t turn)
+{
+    // The commands are applied by seat so that their order does not depend on when they were received. The commands
+    // of a seat are applied in the order they were sent
+    std::stable_sort(mQueuedGameCommands.begin(), mQueuedGameCommands.end(),
+        [](const CommandLog::Command& a, const CommandLog::Command& b)
         {
-            OD_LOG_ERR("Unhandled command received from client:"
-                + Helper::toString(static_cast<int>(clientCommand)));
+            return a.mSeatId < b.mSeatId;
+        });
+
+    for(CommandLog::Command& command : mQueuedGameCommands)
+    {
+        mCommandLog.recordCommand(turn, command.mSeatId, command.mPacket);
+
+        Seat* seat = mGameMap->getSeatById(command.mSeatId);
+        if((seat == nullptr) || (seat->getPlayer() == nullptr))
+        {
+            OD_LOG_ERR("Game command for unknown seatId=" + Helper::toString(command.mSeatId));
+            continue;
         }
-    }
 
-    return true;
+        ClientNotificationType type;
+        OD_ASSERT_TRUE(command.mPacket >> type);
+        processGameCommand(seat->getPlayer(), type, command.mPacket);
+    }
+    mQueuedGameCommands.clear();
 }
 
 ODSocketClient* ODServer::notifyNewConnection(sf::TcpListener& sockListener)
@@ -1869,40 +2418,49 @@ bool ODServer::notifyClientMessage(ODSocketClient *clientSocket)
 {
     bool ret = processClientNotifications(clientSocket);
     if(!ret)
-    {
-        std::string nick = clientSocket->getPlayer() ? clientSocket->getPlayer()->getNick() : std::string();
-        std::string message = nick.empty() ?
-                              "Client disconnected state=" + clientSocket->getState() :
-                              "Client (" + nick + ") disconnected state=" + clientSocket->getState();
-        OD_LOG_INF(message);
-        if(std::string("ready").compare(clientSocket->getState()) == 0)
-        {
-            for(Player* player : mGameMap->getPlayers())
-            {
-                if(!player->getIsHuman())
-                    continue;
+        clientDisconnected(clientSocket);
 
-                ServerNotification *serverNotification = new ServerNotification(
-                    ServerNotificationType::chatServer, player);
-                std::string msg = nick.empty() ?
-                                  "A client disconnected." :
-                                  nick + " disconnected.";
-                serverNotification->mPacket << msg << EventShortNoticeType::genericGameInfo;
-                queueServerNotification(serverNotification);
-            }
-        }
+    return ret;
+}
 
-        if(mSeatsConfigured)
+void ODServer::clientDisconnected(ODSocketClient* clientSocket)
+{
+    std::string nick = clientSocket->getPlayer() ? clientSocket->getPlayer()->getNick() : std::string();
+    std::string message = nick.empty() ?
+                          "Client disconnected state=" + clientSocket->getState() :
+                          "Client (" + nick + ") disconnected state=" + clientSocket->getState();
+    OD_LOG_INF(message);
+    if(std::string("ready").compare(clientSocket->getState()) == 0)
+    {
+        for(Player* player : mGameMap->getPlayers())
         {
-            mDisconnectedPlayers.push_back(clientSocket->getPlayer());
+            if(!player->getIsHuman())
+                continue;
+
+            ServerNotification *serverNotification = new ServerNotification(
+                ServerNotificationType::chatServer, player);
+            std::string msg = nick.empty() ?
+                              "A client disconnected." :
+                              nick + " disconnected.";
+            serverNotification->mPacket << msg << EventShortNoticeType::genericGameInfo;
+            queueServerNotification(serverNotification);
         }
-        // TODO : wait at least 1 minute if the client reconnects if deconnexion happens during game
     }
-    return ret;
+
+    if(mSeatsConfigured)
+    {
+        mDisconnectedPlayers.push_back(clientSocket->getPlayer());
+    }
+    // TODO : wait at least 1 minute if the client reconnects if deconnexion happens during game
 }
 
 void ODServer::stopServer()
 {
+    // A save being written is finished before the game is cleared. The players are not notified
+    // because the chat message would be dropped when the clients are disconnected
+    if(mPendingSave.valid() && !mPendingSave.get())
+        OD_LOG_ERR("Couldn't save map file as: " + mPendingSaveFilename);
+
     // We start by stopping server to make sure no new message comes
     ODSocketServer::stopServer();
 
@@ -1910,6 +2468,9 @@ void ODServer::stopServer()
     mSeatsConfigured = false;
     mDisconnectedPlayers.clear();
     mPlayerConfig = nullptr;
+    mCommandLog.stopRecording();
+    mQueuedGameCommands.clear();
+    mUseCommandLog = false;
 
     // Now that the server is stopped, we can remove all pending messages
     while(!mServerNotificationQueue.empty())
@@ -2016,6 +2577,9 @@ void ODServer::fireSeatConfigurationRefresh()
 
 int32_t ODServer::getNetworkPort() const
 {
+    if(mHostedPort != -1)
+        return mHostedPort;
+
     int32_t port = ResourceManager::getSingleton().getForcedNetworkPort();
     if(port != -1)
         return port;
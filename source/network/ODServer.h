@@ -20,12 +20,20 @@
 
 #include "ODSocketServer.h"
 #include "modes/ConsoleInterface.h"
+#include "network/CommandLog.h"
 
-#include <OgreSingleton.h>
+#include <SFML/System.hpp>
+
+#include <atomic>
+#include <future>
 
 class ServerNotification;
 class GameMap;
+class PathfindingBenchmark;
+class Player;
+class Seat;
 
+enum class ClientNotificationType;
 enum class ServerMode;
 
 //! \brief An enum used to know what kind of game event it is.
@@ -41,6 +49,18 @@ enum class EventShortNoticeType : int32_t
 ODPacket& operator<<(ODPacket& os, const EventShortNoticeType& type);
 ODPacket& operator>>(ODPacket& is, EventShortNoticeType& type);
 
+//! \brief Measures of the turns played by a game without network (see ODServer::runHeadless)
+struct HeadlessTurnStats
+{
+    std::vector<double> mTurnDurationsMs;
+    //! \brief Game state checksum at the end of each turn
+    std::vector<uint64_t> mTurnChecksums;
+    //! \brief Number of creatures on the map at the end of each turn
+    std::vector<uint32_t> mTurnNbCreatures;
+    //! \brief Time spent in each phase of the turns, indexed by TurnPhase then by turn
+    std::vector<std::vector<double>> mPhaseTimesMs;
+};
+
 /**
  * When playing single player or multiplayer, there is always one reference gamemap. It is
  * the one on ODServer. There is also a client gamemap in ODFrameListener which is supposed to be
@@ -57,9 +77,12 @@ ODPacket& operator>>(ODPacket& is, EventShortNoticeType& type);
  * queueServerNotification should be called with the message.
  * Note that this rule is not followed when dealing with client connexions or chat because there
  * is no need to synchronize such messages with the gamemap.
+ * Many servers can run in the same process (see MultiGameServer). The game code reaches its server with
+ * getSingleton, which returns the server bound to the calling thread. If the thread is not bound to any, the
+ * first server created is returned in processes with a single server. When many servers are hosted, there is
+ * no server for unbound threads.
  */
-class ODServer: public Ogre::Singleton<ODServer>,
-    public ODSocketServer
+class ODServer: public ODSocketServer
 {
  public:
      enum ServerState
@@ -71,10 +94,57 @@ class ODServer: public Ogre::Singleton<ODServer>,
     ODServer();
     virtual ~ODServer();
 
+    static ODServer& getSingleton();
+    static ODServer* getSingletonPtr();
+
+    //! \brief Binds the given server to the calling thread: getSingleton will return it when called from
+    //! this thread. nullptr unbinds the thread
+    static void setThreadServer(ODServer* server);
+
+    //! \brief Tells that many servers are hosted in the process. While it is the case, getSingletonPtr returns
+    //! nullptr to the threads not bound to any server instead of falling back to the first server created
+    static void setHostsManyServers(bool hostsManyServers);
+
     inline ServerMode getServerMode() const
     { return mServerMode; }
 
     bool startServer(const std::string& creator, const std::string& levelFilename, ServerMode mode, bool useMasterServer);
+
+    /*! \brief Plays the given level without any client nor network: every seat is played by a Keeper AI and the turns
+     * are chained as fast as possible (each one simulating the time of a normal turn). The duration, the phases times
+     * and the game state checksum of each turn are added to stats. The random numbers come from the given seed so that
+     * 2 runs with the same seed give the same checksums.
+     * Returns false if the level could not be loaded.
+     */
+    bool runHeadless(const std::string& levelFilename, int64_t nbTurns, uint64_t seed, HeadlessTurnStats& stats);
+
+    /*! \brief Plays again without any client nor network the game saved in the given command log (see CommandLog): the
+     * seats are configured like in the saved game and the players commands are applied at the turns they were. The
+     * turns are played until the last saved checksum. If a turn does not give the saved checksum, desyncTurn is set to
+     * this turn and the game stops (otherwise, it is set to -1). The turns measures are added to stats like
+     * runHeadless does. Returns false if the log or its level could not be loaded.
+     */
+    bool runCommandLog(const std::string& logFilename, HeadlessTurnStats& stats, int64_t& desyncTurn);
+
+    /*! \brief Loads the given level without network like runHeadless does, with the seed of the benchmark. Then, runs
+     * the pathfinding benchmark on the game map under the given level name before any turn is played, so that the
+     * map does not depend on the pathfinding. Returns false if the level could not be loaded.
+     */
+    bool runPathfindingBenchmark(const std::string& levelFilename, const std::string& levelName,
+        PathfindingBenchmark& benchmark);
+
+    /*! \brief Prepares the server to be hosted by a MultiGameServer: it will listen on the given port and its sockets will be
+     * watched by the given reactor (onSocketReady is called from the reactor thread when there is something to process).
+     * The packets are sent by the given sender. Instead of having its own thread, the server is processed by calling
+     * processHostedTick. Should be called before startServer
+     */
+    void setHosted(SocketReactor* reactor, NetworkSender* sender, int32_t port, const std::function<void()>& onSocketReady);
+
+    /*! \brief Processes the messages received since the last call and, if isTurnDue is true, plays a turn. Should
+     * be called from a thread bound to this server. Returns false if the game is over
+     */
+    bool processHostedTick(bool isTurnDue);
+
     void stopServer();
 
     //! \brief Adds a server notification to the server notification queue. The message will be sent to the concerned player
@@ -119,6 +189,37 @@ private:
     std::string mMasterServerGameId;
     double mMasterServerGameStatusUpdateTime;
 
+    //! \brief Port used when hosted by a MultiGameServer. -1 otherwise
+    int32_t mHostedPort;
+    //! \brief Time since the last turn when hosted by a MultiGameServer
+    sf::Clock mHostedTurnClock;
+
+    //! \brief Time since the current turn started. Used to drop the clients not acknowledging it
+    sf::Clock mTurnAckClock;
+
+    //! \brief Result of the save being written by another thread (if any)
+    std::future<bool> mPendingSave;
+    std::string mPendingSaveFilename;
+
+    /*! \brief When a command log is saved, the game commands received during a turn are applied at the start of the
+     * next one and saved in mCommandLog with the game configuration. Every turn simulates the same time. Thus, the game
+     * can be played again to check it is deterministic (see runCommandLog). The clients do not simulate the game and
+     * still receive the full game state. It is only enabled on dedicated servers
+     */
+    bool mUseCommandLog;
+    std::string mCommandLogLevelFilename;
+    //! \brief Seed of the game map generator when the level was loaded
+    uint64_t mCommandLogSeed;
+    CommandLog mCommandLog;
+    //! \brief Game commands to apply at the start of the next turn
+    std::vector<CommandLog::Command> mQueuedGameCommands;
+
+    //! \brief First server created. Returned by getSingleton to the threads not bound to any server if there
+    //! is only one server in the process
+    static ODServer* msMainServer;
+    static std::atomic<bool> msHostsManyServers;
+    static thread_local ODServer* msThreadServer;
+
     void printConsoleMsg(const std::string& text);
 
     ODSocketClient* getClientFromPlayer(Player* player);
@@ -127,6 +228,59 @@ private:
     //! \brief Called when a new turn started.
     void startNewTurn(double timeSinceLastTurn);
 
+    //! \brief Once the seats are configured, initializes the map and the seats and starts turn 0
+    void launchGame();
+
+    //! \brief Creates the player of a seat played by an AI or inactive, depending on the given configured player id
+    void createAIPlayer(Seat* seat, int32_t configPlayerId);
+
+    //! \brief Once every seat has its player, initializes the seats
+    void initSeats();
+
+    //! \brief Loads the level of a game without network, gives every seat to a Keeper AI and launches the game
+    bool startHeadlessGame(const std::string& levelFilename, uint64_t seed);
+
+    //! \brief Loads the level of a game without network (see runHeadless) using the given random seed
+    bool loadHeadlessLevel(const std::string& levelFilename, uint64_t seed);
+
+    //! \brief Plays a turn of a game without network and adds its measures to stats
+    void playHeadlessTurn(HeadlessTurnStats& stats);
+
+    //! \brief Starts saving the game in a command log. Called when the game is launched
+    void startCommandLog();
+
+    //! \brief Returns true for the commands changing the game (the ones applied at the start of a turn when a command log is saved)
+    static bool isGameCommand(ClientNotificationType type);
+
+    //! \brief Applies the given command sent by the given player
+    void processGameCommand(Player* player, ClientNotificationType type, ODPacket& packetReceived);
+
+    //! \brief Applies the commands queued when a command log is saved. turn is the turn being started
+    void applyQueuedGameCommands(int64_t turn);
+
+    /*! \brief Plays a turn if the game is launched (launches it if the seats are configured). turnClock is
+     * the clock measuring the time since the last turn. Returns false if the game is over
+     */
+    bool processTurn(sf::Clock& turnClock);
+
+    //! \brief Tells the master server that the game is over (if it is registered)
+    void notifyGameFinished();
+
+    //! \brief Takes a snapshot of the game map and writes it to the given file from another thread. The players
+    //! are notified once the file is written (see checkPendingSave)
+    void saveGameMap(const std::string& fileName);
+
+    //! \brief If the pending save is written (or if wait is true), notifies the players about its result
+    void checkPendingSave(bool wait);
+
+    //! \brief Notifies the other players and saves the player of the given client as disconnected. Called when
+    //! the client is about to be removed
+    void clientDisconnected(ODSocketClient* clientSocket);
+
+    //! \brief During a game, removes the clients that cannot keep up: the ones whose packets could not be sent and
+    //! the ones that did not acknowledge the current turn in time
+    void dropLaggingClients();
+
     /*! \brief Monitors mServerNotificationQueue for new events and informs the clients about them.
      *
      * This function is used in server mode and acts as a "consumer" on
@@ -148,6 +302,14 @@ private:
     //! \brief Sends the packet to the given player. If player is nullptr, the packet is sent to every connected player
     void sendMsg(Player* player, ODPacket& packet);
 
+    //! \brief Same as sendMsg but the packet is only queued in the client batch. It will be sent when the
+    //! client is flushed (at the end of processServerNotifications)
+    void queueMsg(Player* player, ODPacket& packet);
+
+    //! \brief Returns the client of the given player to send the given packet. Logs an error if the player
+    //! is not connected and has not been disconnected
+    ODSocketClient* getMsgClient(Player* player, ODPacket& packet);
+
     void fireSeatConfigurationRefresh();
 
     //! \brief Handles console command. player is the player that launched the command
@@ -43,7 +43,9 @@ bool ODSocketClient::connect(const std::string& host, const int port, uint32_t t
 
     mOutputReplayFilename = outputReplayFilename;
 
-    mReplayOutputStream.open(mOutputReplayFilename, std::ios::out | std::ios::binary);
+    if(!mReplayRecorder.start(mOutputReplayFilename))
+        OD_LOG_ERR("Could not create replay file " + mOutputReplayFilename);
+
     mGameClock.restart();
     mSource = ODSource::network;
     return true;
@@ -52,8 +54,15 @@ bool ODSocketClient::connect(const std::string& host, const int port, uint32_t t
 bool ODSocketClient::replay(const std::string& filename)
 {
     OD_LOG_INF("Reading replay from file " + filename);
-    mReplayInputStream.open(filename, std::ios::in | std::ios::binary);
+    if(!mReplayReader.open(filename))
+    {
+        OD_LOG_ERR("Could not read replay file " + filename);
+        return false;
+    }
     mGameClock.restart();
+    mReplayClock.restart();
+    mReplayTime = 0;
+    mReplaySpeed = 1.0;
     mSource = ODSource::file;
     return true;
 }
@@ -61,6 +70,11 @@ bool ODSocketClient::replay(const std::string& filename)
 void ODSocketClient::disconnect(bool keepReplay)
 {
     mPendingTimestamp = -1;
+    mNbBatchedPackets = 0;
+    mBatchPacket.clear();
+    mReceivedPackets.clear();
+    mUseCompression = false;
+    mReplayTurn = -1;
     ODSource src = mSource;
     mSource = ODSource::none;
     switch(src)
@@ -75,12 +89,14 @@ void ODSocketClient::disconnect(bool keepReplay)
             // Remove any remaining client sockets from the socket selector,
             // if there is any left.
             mSockSelector.clear();
+            // The sender should not use the socket anymore before we close it
+            detachSender();
             mSockClient.disconnect();
             break;
         }
         case ODSource::file:
         {
-            mReplayInputStream.close();
+            mReplayReader.close();
             return;
         }
         default:
@@ -88,7 +104,7 @@ void ODSocketClient::disconnect(bool keepReplay)
             break;
     }
 
-    mReplayOutputStream.close();
+    mReplayRecorder.stop();
     // Delete the replay newly created if asked to.
     if (!keepReplay)
         boost::filesystem::remove(mOutputReplayFilename);
@@ -113,16 +129,13 @@ bool ODSocketClient::isDataAvailable()
         }
         case ODSource::file:
         {
-            if(mReplayInputStream.eof())
-                return false;
-
             if(mPendingTimestamp == -1)
-                mPendingTimestamp = mPendingPacket.readPacket(mReplayInputStream);
+                mPendingTimestamp = mReplayReader.readPacket(mPendingPacket);
 
             if(mPendingTimestamp < 0)
                 return false;
 
-            if(mPendingTimestamp < mGameClock.getElapsedTime().asMilliseconds())
+            if(mPendingTimestamp < getReplayTime())
                 return true;
 
             return false;
@@ -140,7 +153,45 @@ ODSocketClient::ODComStatus ODSocketClient::send(ODPacket& s)
     if(mSource != ODSource::network)
         return ODComStatus::OK;
 
-    sf::Socket::Status status = mSockClient.send(s.mPacket);
+    // Queued packets were sent before this one
+    if(flush() != ODComStatus::OK)
+        return ODComStatus::Error;
+
+    sf::Socket::Status status = sendFrame(s);
+    if (status == sf::Socket::Done)
+        return ODComStatus::OK;
+
+    OD_LOG_ERR("Could not send data from client status="
+        + Helper::toString(status));
+    return ODComStatus::Error;
+}
+
+void ODSocketClient::queue(ODPacket& s)
+{
+    if(mSource != ODSource::network)
+        return;
+
+    if(mNbBatchedPackets == 0)
+    {
+        mBatchPacket.clear();
+        mBatchPacket << ServerNotificationType::messageBatch;
+    }
+
+    mBatchPacket.appendPacket(s);
+    ++mNbBatchedPackets;
+}
+
+ODSocketClient::ODComStatus ODSocketClient::flush()
+{
+    if(mNbBatchedPackets == 0)
+        return ODComStatus::OK;
+
+    mNbBatchedPackets = 0;
+    if(mSource != ODSource::network)
+        return ODComStatus::OK;
+
+    sf::Socket::Status status = sendFrame(mBatchPacket);
+    mBatchPacket.clear();
     if (status == sf::Socket::Done)
         return ODComStatus::OK;
 
@@ -149,6 +200,52 @@ ODSocketClient::ODComStatus ODSocketClient::send(ODPacket& s)
     return ODComStatus::Error;
 }
 
+sf::Socket::Status ODSocketClient::sendFrame(const ODPacket& s)
+{
+    ODPacket frame;
+    ODPacket::encodeFrame(s, mUseCompression, frame);
+    if(mOutbound == nullptr)
+        return mSockClient.send(frame.mPacket);
+
+    if(mSender->push(*mOutbound, frame.mPacket))
+        return sf::Socket::Done;
+
+    mHasSendFailed = true;
+    return sf::Socket::Error;
+}
+
+void ODSocketClient::setSender(NetworkSender* sender)
+{
+    detachSender();
+    mHasSendFailed = false;
+    mSender = sender;
+    if(mSender != nullptr)
+        mOutbound = mSender->attach(mSockClient);
+}
+
+bool ODSocketClient::flushSender(const std::chrono::steady_clock::time_point& deadline)
+{
+    if(mOutbound == nullptr)
+        return true;
+
+    return mSender->flush(*mOutbound, deadline);
+}
+
+void ODSocketClient::detachSender()
+{
+    if(mOutbound == nullptr)
+        return;
+
+    mSender->detach(mOutbound);
+    mOutbound.reset();
+    mSender = nullptr;
+}
+
+bool ODSocketClient::isRemoteLoopback()
+{
+    return mSockClient.getRemoteAddress() == sf::IpAddress::LocalHost;
+}
+
 ODSocketClient::ODComStatus ODSocketClient::recv(ODPacket& s)
 {
     switch(mSource)
@@ -161,11 +258,17 @@ ODSocketClient::ODComStatus ODSocketClient::recv(ODPacket& s)
         }
         case ODSource::network:
         {
-            sf::Socket::Status status = mSockClient.receive(s.mPacket);
+            ODPacket frame;
+            sf::Socket::Status status = mSockClient.receive(frame.mPacket);
             if (status == sf::Socket::Done)
             {
-                s.writePacket(mGameClock.getElapsedTime().asMilliseconds(),
-                    mReplayOutputStream);
+                // The replay contains the uncompressed packets
+                if(!ODPacket::decodeFrame(frame, s))
+                {
+                    OD_LOG_ERR("Could not decode frame size=" + Helper::toString(frame.mPacket.getDataSize()));
+                    return ODComStatus::Error;
+                }
+                mReplayRecorder.record(mGameClock.getElapsedTime().asMilliseconds(), mReplayTurn, s);
                 return ODComStatus::OK;
             }
 
@@ -196,6 +299,40 @@ ODSocketClient::ODComStatus ODSocketClient::recv(ODPacket& s)
     return ODComStatus::Error;
 }
 
+bool ODSocketClient::setReplaySpeed(double speed)
+{
+    if((mSource != ODSource::file) || (speed <= 0))
+        return false;
+
+    // The time elapsed until now is counted with the previous speed
+    getReplayTime();
+    mReplaySpeed = speed;
+    return true;
+}
+
+bool ODSocketClient::seekReplayTurn(int64_t turn)
+{
+    if(mSource != ODSource::file)
+        return false;
+
+    // The packets before the turn are needed to rebuild the game. We only move the replay time so that
+    // they are all processed as fast as possible
+    int32_t timestamp = mReplayReader.getTurnTimestamp(turn);
+    if(timestamp < 0)
+        return false;
+
+    if(timestamp > getReplayTime())
+        mReplayTime = timestamp;
+
+    return true;
+}
+
+double ODSocketClient::getReplayTime()
+{
+    mReplayTime += mReplayClock.restart().asMicroseconds() * mReplaySpeed / 1000.0;
+    return mReplayTime;
+}
+
 bool ODSocketClient::isConnected()
 {
     return mSource != ODSource::none;
@@ -211,21 +348,40 @@ void ODSocketClient::processClientSocketMessages()
 
 bool ODSocketClient::processOneClientSocketMessage()
 {
-    if(!isDataAvailable())
-        return false;
-
     ODPacket packetReceived;
 
-    // Check if data available
-    ODComStatus comStatus = recv(packetReceived);
-    if(comStatus != ODComStatus::OK)
+    // We process the messages received in a batch before reading the socket
+    if(!mReceivedPackets.empty())
     {
-        playerDisconnected();
-        return false;
+        packetReceived = mReceivedPackets.front();
+        mReceivedPackets.pop_front();
+    }
+    else
+    {
+        if(!isDataAvailable())
+            return false;
+
+        // Check if data available
+        ODComStatus comStatus = recv(packetReceived);
+        if(comStatus != ODComStatus::OK)
+        {
+            playerDisconnected();
+            return false;
+        }
     }
 
     ServerNotificationType serverCommand;
     OD_ASSERT_TRUE(packetReceived >> serverCommand);
 
+    if(serverCommand == ServerNotificationType::messageBatch)
+    {
+        mReceivedPackets.emplace_back();
+        while(packetReceived.extractPacket(mReceivedPackets.back()))
+            mReceivedPackets.emplace_back();
+
+        mReceivedPackets.pop_back();
+        return true;
+    }
+
     return processMessage(serverCommand, packetReceived);
 }
@@ -18,13 +18,18 @@
 #ifndef ODSOCKETCLIENT_H
 #define ODSOCKETCLIENT_H
 
+#include "network/NetworkSender.h"
 #include "network/ODPacket.h"
+#include "network/ReplayReader.h"
+#include "network/ReplayRecorder.h"
 
 #include <SFML/Network.hpp>
 
+#include <chrono>
 #include <string>
 #include <cstdint>
-#include <fstream>
+#include <deque>
+#include <memory>
 
 class Player;
 
@@ -49,16 +54,24 @@ class ODSocketClient
             mSource(ODSource::none),
             mPlayer(nullptr),
             mLastTurnAck(-1),
-            mPendingTimestamp(-1)
+            mUseCompression(false),
+            mNbBatchedPackets(0),
+            mReplayTurn(-1),
+            mReplayTime(0),
+            mReplaySpeed(1.0),
+            mPendingTimestamp(-1),
+            mSender(nullptr),
+            mHasSendFailed(false)
         {}
 
         virtual ~ODSocketClient()
-        {}
+        { detachSender(); }
 
         // Client initialization
         bool isConnected();
 
-        //! \brief Disconnect the client and tell whether to keep the replay file.
+        //! \brief Disconnect the client and tell whether to keep the replay file. The packets still queued in
+        //! the sender are dropped (see flushSender)
         virtual void disconnect(bool keepReplay = false);
 
         /*! \brief This function should be called periodically. It will
@@ -76,12 +89,35 @@ class ODSocketClient
 
         void setState(const std::string& state) {mState = state;}
 
+        //! \brief If true, the big packets sent are compressed. The received packets are uncompressed
+        //! whatever this value (each frame tells if it is compressed)
+        bool getUseCompression() const { return mUseCompression; }
+        void setUseCompression(bool useCompression) { mUseCompression = useCompression; }
+
+        //! \brief Returns true if the socket is connected to the local computer. In this case,
+        //! compressing the packets would only cost CPU
+        bool isRemoteLoopback();
+
         sf::TcpSocket& getSockClient()
         { return mSockClient; }
 
         void setSource(ODSource source)
         { mSource = source; }
 
+        /*! \brief Sends the packets through the given sender instead of writing the socket from the calling
+         * thread. The sender should be started and should not be stopped while the client is connected
+         */
+        void setSender(NetworkSender* sender);
+
+        //! \brief Waits until the packets queued in the sender (if any) are sent or until the deadline. Returns
+        //! true if every packet was sent. Should be called before disconnect if the last packets matter
+        bool flushSender(const std::chrono::steady_clock::time_point& deadline);
+
+        //! \brief Returns true if a packet could not be sent. It happens when the client does not read
+        //! fast enough (and the sender queue is full) or if the connection is broken
+        bool hasSendFailed() const
+        { return mHasSendFailed; }
+
         // Data Transimission
         /*! \brief Sends a packet through the network
          * ODPacket should preserve integrity. That means that if an ODSocketClient
@@ -90,6 +126,15 @@ class ODSocketClient
          */
         ODComStatus send(ODPacket& s);
 
+        /*! \brief Appends the packet to the batch that will be sent by flush. Sending many
+         * messages this way only needs 1 write on the socket. The receiver gets them one by one
+         * in processMessage. Note that send flushes the batch first so that the order is kept
+         */
+        void queue(ODPacket& s);
+
+        //! \brief Sends the queued packets (if any)
+        ODComStatus flush();
+
         /*! \brief Receives a packet through the network
          * ODPacket should preserve integrity. That means that if an ODSocketClient
          * sends an ODPacket, the server should receive exactly 1 similar ODPacket (same data,
@@ -97,6 +142,16 @@ class ODSocketClient
          */
         ODComStatus recv(ODPacket& s);
 
+        //! \brief When playing a replay, sets how many times faster than real time it is played.
+        //! Returns false if no replay is played
+        bool setReplaySpeed(double speed);
+
+        /*! \brief When playing a replay, plays as fast as possible until the given turn. The replay index tells
+         * where the turn is. Returns false if no replay is played or if the turn is unknown. Note that it is
+         * not possible to go back.
+         */
+        bool seekReplayTurn(int64_t turn);
+
     protected:
         virtual bool connect(const std::string& host, const int port, uint32_t timeout, const std::string& outputReplayFilename);
         virtual bool replay(const std::string& filename);
@@ -108,25 +163,59 @@ class ODSocketClient
         virtual void playerDisconnected()
         {}
 
+        //! \brief Tells the turn received from the server so that it is saved in the replay index
+        void setReplayTurn(int64_t turn)
+        { mReplayTurn = turn; }
+
     private :
         bool processOneClientSocketMessage();
 
+        //! \brief Sends the given packet through the socket (compressed if mUseCompression is set)
+        sf::Socket::Status sendFrame(const ODPacket& s);
+
+        //! \brief Returns the time (in milliseconds) reached in the replay
+        double getReplayTime();
+
+        //! \brief Drops the packets not sent yet by the sender (if any). They are lost: flushSender should be
+        //! called before if they should reach the client
+        void detachSender();
+
         ODSource mSource;
         sf::SocketSelector mSockSelector;
         sf::TcpSocket mSockClient;
         Player* mPlayer;
         int64_t mLastTurnAck;
         std::string mState;
+        bool mUseCompression;
+
+        //! \brief Packets queued to be sent by flush (the first data is ServerNotificationType::messageBatch)
+        ODPacket mBatchPacket;
+        uint32_t mNbBatchedPackets;
+
+        //! \brief Packets received in a batch and not processed yet
+        std::deque<ODPacket> mReceivedPackets;
 
         sf::Clock mGameClock;
-        std::ifstream mReplayInputStream;
-        std::ofstream mReplayOutputStream;
+        ReplayReader mReplayReader;
+        //! \brief Writes the received packets to the replay file from another thread
+        ReplayRecorder mReplayRecorder;
+        int64_t mReplayTurn;
+
+        //! \brief When playing a replay, the packets with a timestamp lower than mReplayTime are processed.
+        //! It increases with the real time multiplied by mReplaySpeed
+        sf::Clock mReplayClock;
+        double mReplayTime;
+        double mReplaySpeed;
         ODPacket mPendingPacket;
         int32_t mPendingTimestamp;
 
         //! \brief the replay filename being written. Used to later optionally delete it
         //! if asked to.
         std::string mOutputReplayFilename;
+
+        NetworkSender* mSender;
+        std::shared_ptr<NetworkSender::Outbound> mOutbound;
+        bool mHasSendFailed;
 };
 
 #endif // ODSOCKETCLIENT_H
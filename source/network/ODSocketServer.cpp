@@ -17,6 +17,7 @@
 
 #include "ODSocketServer.h"
 #include "network/ODPacket.h"
+#include "network/SocketReactor.h"
 #include "game/Player.h"
 
 #include "utils/Helper.h"
@@ -24,9 +25,18 @@
 
 #include <SFML/System.hpp>
 
+#include <algorithm>
+#include <chrono>
+
+//! \brief Maximum time given to the clients to receive the packets queued for them when the server stops
+static const int STOP_FLUSH_MS = 1000;
+
 ODSocketServer::ODSocketServer():
     mThread(nullptr),
-    mIsConnected(false)
+    mIsConnected(false),
+    mReactor(nullptr),
+    mSharedSender(nullptr),
+    mSender(nullptr)
 {
 }
 
@@ -49,9 +59,27 @@ bool ODSocketServer::createServer(int listeningPort)
         return false;
     }
 
-    mSockSelector.add(mSockListener);
+    // The packets are sent from another thread so that a slow client does not slow the game down
+    mSender = mSharedSender;
+    if(mSender == nullptr)
+    {
+        if(mOwnSender.start())
+            mSender = &mOwnSender;
+        else
+            OD_LOG_ERR("Could not start the network sender. The packets will be sent from the server thread");
+    }
+
     mIsConnected = true;
     OD_LOG_INF("Server connected and listening");
+    if(mReactor != nullptr)
+    {
+        // The owner of the reactor processes the sockets from its own threads
+        sf::Socket* socket = &mSockListener;
+        mReactor->add(mSockListener, [this, socket]() { notifySocketReady(socket); });
+        return true;
+    }
+
+    mSockSelector.add(mSockListener);
     mThread = new sf::Thread(&ODSocketServer::serverThread, this);
     mThread->launch();
 
@@ -96,6 +124,7 @@ void ODSocketServer::doTask(int timeoutMs)
                 OD_LOG_INF("New client connected.");
                 // The server wants to keep the client
                 newClient->setSource(ODSocketClient::ODSource::network);
+                newClient->setSender(mSender);
                 mSockSelector.add(newClient->getSockClient());
                 mSockClients.push_back(newClient);
             }
@@ -124,14 +153,125 @@ void ODSocketServer::doTask(int timeoutMs)
     }
 }
 
+void ODSocketServer::setReactor(SocketReactor* reactor, const std::function<void()>& onSocketReady)
+{
+    mReactor = reactor;
+    mOnSocketReady = onSocketReady;
+}
+
+void ODSocketServer::setSender(NetworkSender* sender)
+{
+    mSharedSender = sender;
+}
+
+void ODSocketServer::notifySocketReady(sf::Socket* socket)
+{
+    {
+        std::lock_guard<std::mutex> lock(mReadySocketsMutex);
+        mReadySockets.push_back(socket);
+    }
+    if(mOnSocketReady)
+        mOnSocketReady();
+}
+
+void ODSocketServer::processReadySockets()
+{
+    std::vector<sf::Socket*> readySockets;
+    {
+        std::lock_guard<std::mutex> lock(mReadySocketsMutex);
+        readySockets.swap(mReadySockets);
+    }
+
+    for(sf::Socket* socket : readySockets)
+    {
+        // A message can stop the server
+        if(!mIsConnected)
+            return;
+
+        if(socket == &mSockListener)
+        {
+            ODSocketClient* newClient = notifyNewConnection(mSockListener);
+            if (newClient != nullptr)
+            {
+                OD_LOG_INF("New client connected.");
+                newClient->setSource(ODSocketClient::ODSource::network);
+                newClient->setSender(mSender);
+                mSockClients.push_back(newClient);
+                sf::Socket* clientSocket = &newClient->getSockClient();
+                mReactor->add(*clientSocket, [this, clientSocket]() { notifySocketReady(clientSocket); });
+            }
+            mReactor->rearm(mSockListener);
+            continue;
+        }
+
+        std::vector<ODSocketClient*>::iterator it = mSockClients.begin();
+        while((it != mSockClients.end()) && (&(*it)->getSockClient() != socket))
+            ++it;
+
+        // The client may have been removed since the socket was notified
+        if(it == mSockClients.end())
+            continue;
+
+        ODSocketClient* client = *it;
+        if(notifyClientMessage(client))
+        {
+            if(mIsConnected)
+                mReactor->rearm(*socket);
+            continue;
+        }
+
+        if(!mIsConnected)
+            return;
+
+        // The server wants to remove the client
+        removeClient(client);
+    }
+}
+
+void ODSocketServer::removeClient(ODSocketClient* client)
+{
+    std::vector<ODSocketClient*>::iterator it = std::find(mSockClients.begin(), mSockClients.end(), client);
+    if(it == mSockClients.end())
+        return;
+
+    mSockClients.erase(it);
+    if(mReactor != nullptr)
+        mReactor->remove(client->getSockClient());
+    else
+        mSockSelector.remove(client->getSockClient());
+
+    client->disconnect();
+    delete client;
+}
+
 void ODSocketServer::stopServer()
 {
     mIsConnected = false;
     if(mThread != nullptr)
         delete mThread; // Delete waits for the thread to finish
     mThread = nullptr;
+    if(mReactor != nullptr)
+    {
+        mReactor->remove(mSockListener);
+        for(ODSocketClient* client : mSockClients)
+            mReactor->remove(client->getSockClient());
+
+        std::lock_guard<std::mutex> lock(mReadySocketsMutex);
+        mReadySockets.clear();
+    }
     mSockSelector.clear();
     mSockListener.close();
+
+    // Disconnecting a client drops the packets not sent yet (like the last chat messages). We give them some
+    // time to be sent. A client that does not read them cannot delay the shutdown more than STOP_FLUSH_MS
+    std::chrono::steady_clock::time_point flushDeadline = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(STOP_FLUSH_MS);
+    for(ODSocketClient* client : mSockClients)
+    {
+        if(!client->flushSender(flushDeadline))
+            OD_LOG_WRN("Some packets could not be sent to a client before stopping the server");
+    }
+
     for (std::vector<ODSocketClient*>::iterator it = mSockClients.begin(); it != mSockClients.end(); ++it)
     {
         ODSocketClient* client = *it;
@@ -140,4 +280,8 @@ void ODSocketServer::stopServer()
     }
 
     mSockClients.clear();
+
+    // The clients are disconnected so the sender does not have anything to send anymore
+    mOwnSender.stop();
+    mSender = nullptr;
 }
@@ -19,10 +19,16 @@
 #define ODSOCKETSERVER_H
 
 #include "ODSocketClient.h"
+#include "network/NetworkSender.h"
 
 #include <SFML/Network.hpp>
 
+#include <functional>
+#include <mutex>
+#include <vector>
+
 class ODPacket;
+class SocketReactor;
 
 class ODSocketServer
 {
@@ -36,6 +42,17 @@ class ODSocketServer
         virtual bool createServer(int listeningPort);
         virtual void stopServer();
 
+        /*! \brief If a reactor is set before creating the server, the sockets are watched by the reactor instead
+         * of a server thread. onSocketReady is then called from the reactor thread when a socket can be read and
+         * the owner should call processReadySockets from its own thread
+         */
+        void setReactor(SocketReactor* reactor, const std::function<void()>& onSocketReady);
+
+        /*! \brief If a sender is set before creating the server, the packets are sent to the clients by this sender
+         * (that can be shared by many servers). Otherwise, the server starts its own sender
+         */
+        void setSender(NetworkSender* sender);
+
     protected:
         /*! \brief Function called when a new client connects. If the server returns an ODSocketClient,
          *! it will be added to the client list
@@ -62,6 +79,14 @@ class ODSocketServer
          * timeoutMs milliseconds, even if new clients connected or clients are sending messages.
          */
         void doTask(int timeoutMs);
+
+        //! \brief Equivalent of doTask when a reactor is used: accepts the new clients and calls notifyClientMessage
+        //! for the clients that sent a message since the last call. Returns immediately
+        void processReadySockets();
+
+        //! \brief Disconnects the given client and removes it from the client list
+        void removeClient(ODSocketClient* client);
+
         std::vector<ODSocketClient*> mSockClients;
         virtual void serverThread() = 0;
         sf::Thread* mThread;
@@ -71,6 +96,24 @@ class ODSocketServer
         sf::SocketSelector mSockSelector;
         sf::Clock mClockMainTask;
         bool mIsConnected;
+
+        SocketReactor* mReactor;
+        std::function<void()> mOnSocketReady;
+
+        //! \brief Sender given by setSender (if any)
+        NetworkSender* mSharedSender;
+        //! \brief Sender used when no sender is shared
+        NetworkSender mOwnSender;
+        //! \brief Sender used by the connected clients. nullptr if the server could not start its own sender. In
+        //! this case, the packets are sent from the server thread
+        NetworkSender* mSender;
+
+        //! \brief Sockets notified by the reactor and not processed yet
+        std::mutex mReadySocketsMutex;
+        std::vector<sf::Socket*> mReadySockets;
+
+        //! \brief Called by the reactor thread when the given socket can be read
+        void notifySocketReady(sf::Socket* socket);
 };
 
 #endif // ODSOCKETSERVER_H
@@ -0,0 +1,238 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "network/ReplayReader.h"
+
+#include "network/ODPacket.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+
+// "ODRP" and "ODRI" written as native integers
+const uint32_t ReplayReader::MAGIC = 0x5052444F;
+const uint32_t ReplayReader::INDEX_MAGIC = 0x4952444F;
+const uint32_t ReplayReader::VERSION = 2;
+
+// deflate cannot compress more than about 1032:1
+static const uint64_t MAX_COMPRESSION_RATIO = 1032;
+
+ReplayReader::ReplayReader() :
+    mVersion(0),
+    mIndexOffset(0),
+    mChunkPos(0)
+{
+}
+
+bool ReplayReader::open(const std::string& filename)
+{
+    close();
+    mStream.open(filename, std::ios::in | std::ios::binary);
+    if(!mStream.is_open())
+        return false;
+
+    uint32_t magic = 0;
+    mStream.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    if(!mStream || (magic != MAGIC))
+    {
+        // Version 1 replays have no header
+        mStream.clear();
+        mStream.seekg(0);
+        mVersion = 1;
+        return true;
+    }
+
+    mStream.read(reinterpret_cast<char*>(&mVersion), sizeof(mVersion));
+    if(!mStream || (mVersion != VERSION))
+    {
+        close();
+        return false;
+    }
+    std::streamoff dataBegin = mStream.tellg();
+
+    // The index is written when the replay is closed. If it is missing, we can still play the chunks
+    if(!readIndex())
+    {
+        mIndex.clear();
+        mStream.clear();
+        mStream.seekg(dataBegin);
+        scanChunks();
+    }
+
+    mStream.clear();
+    mStream.seekg(dataBegin);
+    return true;
+}
+
+bool ReplayReader::readIndex()
+{
+    // We read the index from the end of the file
+    uint32_t indexMagic = 0;
+    mStream.seekg(0, std::ios::end);
+    std::streamoff fileSize = mStream.tellg();
+    if(fileSize < static_cast<std::streamoff>(sizeof(mIndexOffset) + sizeof(indexMagic)))
+        return false;
+
+    mStream.seekg(-static_cast<std::streamoff>(sizeof(mIndexOffset) + sizeof(indexMagic)), std::ios::end);
+    mStream.read(reinterpret_cast<char*>(&mIndexOffset), sizeof(mIndexOffset));
+    mStream.read(reinterpret_cast<char*>(&indexMagic), sizeof(indexMagic));
+    if(!mStream || (indexMagic != INDEX_MAGIC) || (mIndexOffset >= static_cast<uint64_t>(fileSize)))
+        return false;
+
+    uint32_t nbEntries = 0;
+    mStream.seekg(static_cast<std::streamoff>(mIndexOffset));
+    mStream.read(reinterpret_cast<char*>(&nbEntries), sizeof(nbEntries));
+    for(uint32_t i = 0; mStream && (i < nbEntries); ++i)
+    {
+        IndexEntry entry;
+        mStream.read(reinterpret_cast<char*>(&entry.mTimestamp), sizeof(entry.mTimestamp));
+        mStream.read(reinterpret_cast<char*>(&entry.mTurn), sizeof(entry.mTurn));
+        mStream.read(reinterpret_cast<char*>(&entry.mOffset), sizeof(entry.mOffset));
+        mIndex.push_back(entry);
+    }
+
+    return static_cast<bool>(mStream);
+}
+
+void ReplayReader::scanChunks()
+{
+    uint64_t offset = static_cast<uint64_t>(mStream.tellg());
+    mStream.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(mStream.tellg());
+    mStream.seekg(static_cast<std::streamoff>(offset));
+    while(true)
+    {
+        uint32_t size = 0;
+        uint32_t compressedSize = 0;
+        mStream.read(reinterpret_cast<char*>(&size), sizeof(size));
+        mStream.read(reinterpret_cast<char*>(&compressedSize), sizeof(compressedSize));
+        if(!mStream)
+            break;
+
+        uint64_t chunkEnd = offset + sizeof(size) + sizeof(compressedSize) + compressedSize;
+        if(chunkEnd > fileSize)
+            break;
+
+        offset = chunkEnd;
+        mStream.seekg(static_cast<std::streamoff>(offset));
+    }
+
+    mIndexOffset = offset;
+}
+
+void ReplayReader::close()
+{
+    mStream.close();
+    mStream.clear();
+    mVersion = 0;
+    mIndexOffset = 0;
+    mIndex.clear();
+    mChunk.clear();
+    mChunkPos = 0;
+}
+
+int32_t ReplayReader::readPacket(ODPacket& packet)
+{
+    while(true)
+    {
+        if(mChunkPos < mChunk.size())
+        {
+            const char* data = mChunk.data() + mChunkPos;
+            int32_t timestamp = packet.readPacket(data, mChunk.data() + mChunk.size());
+            if(timestamp < 0)
+                return -1;
+
+            mChunkPos = static_cast<std::size_t>(data - mChunk.data());
+            return timestamp;
+        }
+
+        if(!readChunk())
+            return -1;
+    }
+}
+
+int32_t ReplayReader::getTurnTimestamp(int64_t turn) const
+{
+    int32_t index = getTurnIndex(turn);
+    if(index < 0)
+        return -1;
+
+    return mIndex[index].mTimestamp;
+}
+
+bool ReplayReader::readChunk()
+{
+    mChunk.clear();
+    mChunkPos = 0;
+    if(!mStream.is_open())
+        return false;
+
+    if(mVersion == 1)
+    {
+        // We read the packet header to know its size
+        int32_t header[2];
+        mStream.read(reinterpret_cast<char*>(header), sizeof(header));
+        if(!mStream || (header[1] < 0))
+            return false;
+
+        mChunk.resize(sizeof(header) + header[1]);
+        std::copy(reinterpret_cast<const char*>(header), reinterpret_cast<const char*>(header) + sizeof(header), mChunk.begin());
+        mStream.read(mChunk.data() + sizeof(header), header[1]);
+        return static_cast<bool>(mStream);
+    }
+
+    if(static_cast<uint64_t>(mStream.tellg()) >= mIndexOffset)
+        return false;
+
+    uint32_t size = 0;
+    uint32_t compressedSize = 0;
+    mStream.read(reinterpret_cast<char*>(&size), sizeof(size));
+    mStream.read(reinterpret_cast<char*>(&compressedSize), sizeof(compressedSize));
+    if(!mStream)
+        return false;
+
+    // The size is checked before allocating the chunk in case the end of the replay is corrupted
+    if(static_cast<uint64_t>(size) > static_cast<uint64_t>(compressedSize) * MAX_COMPRESSION_RATIO)
+        return false;
+
+    mCompressed.resize(compressedSize);
+    mStream.read(mCompressed.data(), compressedSize);
+    if(!mStream)
+        return false;
+
+    mChunk.resize(size);
+    uLongf chunkSize = static_cast<uLongf>(size);
+    if((uncompress(reinterpret_cast<Bytef*>(mChunk.data()), &chunkSize, reinterpret_cast<const Bytef*>(mCompressed.data()),
+        static_cast<uLong>(compressedSize)) != Z_OK) || (chunkSize != size))
+    {
+        mChunk.clear();
+        return false;
+    }
+
+    return true;
+}
+
+int32_t ReplayReader::getTurnIndex(int64_t turn) const
+{
+    // The turns in the index are increasing. We look for the last chunk starting before the turn
+    std::vector<IndexEntry>::const_iterator it = std::upper_bound(mIndex.begin(), mIndex.end(), turn,
+        [](int64_t value, const IndexEntry& entry) { return value < entry.mTurn; });
+    if(it == mIndex.begin())
+        return -1;
+
+    return static_cast<int32_t>(it - mIndex.begin()) - 1;
+}
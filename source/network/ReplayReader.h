@@ -0,0 +1,104 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPLAYREADER_H
+#define REPLAYREADER_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class ODPacket;
+
+/*! \brief Reads the packets of a replay file.
+ *
+ * Two formats are supported:
+ * - Version 1: a flat list of packets as written by ODPacket::writePacket.
+ * - Version 2 (written by ReplayWriter): a header (MAGIC, VERSION) followed by zlib compressed
+ *   chunks (uncompressed size, compressed size, data). Each chunk contains packets written by
+ *   ODPacket::writePacket. After the chunks, an index gives the timestamp and turn at the start
+ *   of each chunk and its offset in the file (number of entries followed by the entries). The file
+ *   ends with the offset of the index and INDEX_MAGIC.
+ * The index allows to know where a given turn is in the replay without reading it. The index is only
+ * written when the replay is closed. If it is missing (for example, if the game crashed), the chunks are
+ * read up to the last complete one and the replay has no index.
+ */
+class ReplayReader
+{
+public:
+    struct IndexEntry
+    {
+        int32_t mTimestamp;
+        int64_t mTurn;
+        uint64_t mOffset;
+    };
+
+    static const uint32_t MAGIC;
+    static const uint32_t INDEX_MAGIC;
+    static const uint32_t VERSION;
+
+    ReplayReader();
+
+    //! \brief Opens the given replay. Returns false if it cannot be read
+    bool open(const std::string& filename);
+    void close();
+
+    //! \brief Reads the next packet. Returns its timestamp or -1 if the end of the replay has been reached
+    int32_t readPacket(ODPacket& packet);
+
+    //! \brief Format version of the opened replay (1 or VERSION)
+    uint32_t getVersion() const
+    { return mVersion; }
+
+    //! \brief Index of the replay. Empty for version 1 replays and replays that were not closed
+    const std::vector<IndexEntry>& getIndex() const
+    { return mIndex; }
+
+    /*! \brief Returns the timestamp from which the given turn has been received (the timestamp of the chunk where
+     * it starts). Returns -1 if it is unknown (replay without index or turn before the first chunk).
+     */
+    int32_t getTurnTimestamp(int64_t turn) const;
+
+private:
+    std::ifstream mStream;
+    uint32_t mVersion;
+
+    //! \brief Offset of the index in the file, or end of the last complete chunk if there is no index (version 2 only)
+    uint64_t mIndexOffset;
+    std::vector<IndexEntry> mIndex;
+
+    //! \brief Current chunk (version 2 only) or current packet (version 1)
+    std::vector<char> mChunk;
+    std::size_t mChunkPos;
+    std::vector<char> mCompressed;
+
+    //! \brief Reads the index at the end of the file. Returns false if there is none
+    bool readIndex();
+
+    //! \brief Reads the chunk headers from the current position to find the end of the last complete chunk. Used
+    //! when the replay has no index
+    void scanChunks();
+
+    //! \brief Reads the next chunk (or packet for version 1 replays) in mChunk. Returns false at the end of the replay
+    bool readChunk();
+
+    //! \brief Returns the index of the chunk where the given turn starts. -1 if there is none
+    int32_t getTurnIndex(int64_t turn) const;
+};
+
+#endif // REPLAYREADER_H
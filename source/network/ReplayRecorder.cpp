@@ -0,0 +1,160 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "network/ReplayRecorder.h"
+
+#include "network/ODPacket.h"
+
+#include <chrono>
+
+const uint32_t ReplayRecorder::RING_SIZE = 1024;
+
+ReplayRecorder::ReplayRecorder() :
+    mRing(RING_SIZE),
+    mNbPushed(0),
+    mNbPopped(0),
+    mIsStopping(false)
+{
+}
+
+ReplayRecorder::~ReplayRecorder()
+{
+    stop();
+}
+
+bool ReplayRecorder::start(const std::string& filename)
+{
+    stop();
+
+    if(!mWriter.open(filename))
+        return false;
+
+    mNbPushed = 0;
+    mNbPopped = 0;
+    mIsStopping = false;
+    mThread = std::thread(&ReplayRecorder::writerThread, this);
+    return true;
+}
+
+void ReplayRecorder::stop()
+{
+    if(!mThread.joinable())
+        return;
+
+    // The packets that did not fit in the ring are written before stopping
+    while(!mOverflow.empty())
+    {
+        if(push(mOverflow.front()))
+            mOverflow.pop_front();
+        else
+            std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mWakeMutex);
+        mIsStopping = true;
+    }
+    mWakeCondition.notify_one();
+    mThread.join();
+    mWriter.close();
+}
+
+void ReplayRecorder::record(int32_t timestamp, int64_t turn, const ODPacket& packet)
+{
+    if(!mThread.joinable())
+        return;
+
+    Record record;
+    record.mTimestamp = timestamp;
+    record.mTurn = turn;
+    if(!mFreeBuffers.empty())
+    {
+        record.mData.swap(mFreeBuffers.back());
+        mFreeBuffers.pop_back();
+        record.mData.clear();
+    }
+    packet.writePacket(timestamp, record.mData);
+
+    // The order of the packets is kept: the overflow is pushed first
+    while(!mOverflow.empty() && push(mOverflow.front()))
+    {
+        recycle(mOverflow.front().mData);
+        mOverflow.pop_front();
+    }
+
+    if(!mOverflow.empty() || !push(record))
+        mOverflow.push_back(std::move(record));
+    else
+        recycle(record.mData);
+
+    mWakeCondition.notify_one();
+}
+
+bool ReplayRecorder::push(Record& record)
+{
+    uint32_t nbPushed = mNbPushed.load(std::memory_order_relaxed);
+    if(nbPushed - mNbPopped.load(std::memory_order_acquire) >= RING_SIZE)
+        return false;
+
+    // The writer thread is done with the slot: we take its buffer back
+    Record& slot = mRing[nbPushed % RING_SIZE];
+    slot.mTimestamp = record.mTimestamp;
+    slot.mTurn = record.mTurn;
+    slot.mData.swap(record.mData);
+    mNbPushed.store(nbPushed + 1, std::memory_order_release);
+    return true;
+}
+
+void ReplayRecorder::recycle(std::vector<char>& buffer)
+{
+    // After a burst, the overflow may give back many buffers. We only keep what the ring can use
+    if((buffer.capacity() == 0) || (mFreeBuffers.size() >= RING_SIZE))
+        return;
+
+    mFreeBuffers.push_back(std::move(buffer));
+}
+
+void ReplayRecorder::writerThread()
+{
+    while(true)
+    {
+        // We read the stop flag before emptying the ring so that nothing pushed before stopping is lost
+        bool isStopping = mIsStopping;
+
+        uint32_t nbPopped = mNbPopped.load(std::memory_order_relaxed);
+        uint32_t nbPushed = mNbPushed.load(std::memory_order_acquire);
+        while(nbPopped != nbPushed)
+        {
+            // The record is written in place so that its buffer stays in the ring for reuse. The slot
+            // is released only after
+            const Record& record = mRing[nbPopped % RING_SIZE];
+            mWriter.write(record.mTimestamp, record.mTurn, record.mData);
+            ++nbPopped;
+            mNbPopped.store(nbPopped, std::memory_order_release);
+        }
+
+        if(isStopping)
+            return;
+
+        // record notifies us when there is something to write. We also wake up regularly in case we missed it
+        std::unique_lock<std::mutex> lock(mWakeMutex);
+        mWakeCondition.wait_for(lock, std::chrono::milliseconds(50), [this]()
+        {
+            return mIsStopping || (mNbPushed.load(std::memory_order_acquire) != mNbPopped.load(std::memory_order_relaxed));
+        });
+    }
+}
@@ -0,0 +1,103 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPLAYRECORDER_H
+#define REPLAYRECORDER_H
+
+#include "network/ReplayWriter.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ODPacket;
+
+/*! \brief Writes the received packets to a replay file from a dedicated thread.
+ *
+ * The thread receiving the packets only serializes them in a buffer and moves it to a
+ * single producer/single consumer ring. The writer thread empties the ring and gives the
+ * packets to a ReplayWriter (that compresses and writes them by chunks). Thus, a slow disk
+ * does not slow down the game. If the ring is full, the buffers are kept by the receiving
+ * thread until there is room.
+ * The buffers are not freed once written: pushing a record to the ring gives back the buffer
+ * of the slot it replaces, which is reused for the next packets.
+ */
+class ReplayRecorder
+{
+public:
+    ReplayRecorder();
+    ~ReplayRecorder();
+
+    //! \brief Creates the given file and starts the writer thread. Returns false if the file
+    //! cannot be created
+    bool start(const std::string& filename);
+
+    //! \brief Writes the remaining packets, closes the file and stops the writer thread
+    void stop();
+
+    //! \brief Records the given packet received during the given turn. Should only be called from one
+    //! thread while recording
+    void record(int32_t timestamp, int64_t turn, const ODPacket& packet);
+
+private:
+    struct Record
+    {
+        int32_t mTimestamp;
+        int64_t mTurn;
+        //! \brief Packet serialized with ODPacket::writePacket
+        std::vector<char> mData;
+    };
+
+    //! \brief Size of the ring. Should be a power of 2
+    static const uint32_t RING_SIZE;
+
+    std::vector<Record> mRing;
+    //! \brief Number of buffers pushed by record and popped by the writer thread since start. The ring
+    //! contains the buffers between them
+    std::atomic<uint32_t> mNbPushed;
+    std::atomic<uint32_t> mNbPopped;
+
+    //! \brief Buffers that could not be pushed because the ring was full. Only used by record
+    std::deque<Record> mOverflow;
+
+    //! \brief Buffers already written by the writer thread that can be reused. Only used by record
+    std::vector<std::vector<char>> mFreeBuffers;
+
+    std::thread mThread;
+    std::mutex mWakeMutex;
+    std::condition_variable mWakeCondition;
+    std::atomic<bool> mIsStopping;
+
+    //! \brief Only used by the writer thread
+    ReplayWriter mWriter;
+
+    //! \brief Moves the record to the ring. Returns false (and does not move it) if the ring is full.
+    //! If it is pushed, record.mData receives the buffer of the replaced slot
+    bool push(Record& record);
+
+    //! \brief Keeps the given buffer for the next records
+    void recycle(std::vector<char>& buffer);
+
+    void writerThread();
+};
+
+#endif // REPLAYRECORDER_H
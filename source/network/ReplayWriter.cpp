@@ -0,0 +1,106 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "network/ReplayWriter.h"
+
+#include <zlib.h>
+
+const uint32_t ReplayWriter::CHUNK_SIZE = 64 * 1024;
+
+ReplayWriter::ReplayWriter()
+{
+}
+
+ReplayWriter::~ReplayWriter()
+{
+    close();
+}
+
+bool ReplayWriter::open(const std::string& filename)
+{
+    close();
+    mStream.open(filename, std::ios::out | std::ios::binary);
+    if(!mStream.is_open())
+        return false;
+
+    mStream.write(reinterpret_cast<const char*>(&ReplayReader::MAGIC), sizeof(ReplayReader::MAGIC));
+    mStream.write(reinterpret_cast<const char*>(&ReplayReader::VERSION), sizeof(ReplayReader::VERSION));
+    return true;
+}
+
+void ReplayWriter::close()
+{
+    if(!mStream.is_open())
+        return;
+
+    writeChunk();
+
+    uint64_t indexOffset = static_cast<uint64_t>(mStream.tellp());
+    uint32_t nbEntries = static_cast<uint32_t>(mIndex.size());
+    mStream.write(reinterpret_cast<const char*>(&nbEntries), sizeof(nbEntries));
+    for(const ReplayReader::IndexEntry& entry : mIndex)
+    {
+        mStream.write(reinterpret_cast<const char*>(&entry.mTimestamp), sizeof(entry.mTimestamp));
+        mStream.write(reinterpret_cast<const char*>(&entry.mTurn), sizeof(entry.mTurn));
+        mStream.write(reinterpret_cast<const char*>(&entry.mOffset), sizeof(entry.mOffset));
+    }
+    mStream.write(reinterpret_cast<const char*>(&indexOffset), sizeof(indexOffset));
+    mStream.write(reinterpret_cast<const char*>(&ReplayReader::INDEX_MAGIC), sizeof(ReplayReader::INDEX_MAGIC));
+    mStream.close();
+
+    mIndex.clear();
+}
+
+void ReplayWriter::write(int32_t timestamp, int64_t turn, const std::vector<char>& packet)
+{
+    if(!mStream.is_open())
+        return;
+
+    // The index entry is created with the first packet of the chunk. Its offset is known now
+    // because the previous chunks have been written
+    if(mChunk.empty())
+    {
+        ReplayReader::IndexEntry entry;
+        entry.mTimestamp = timestamp;
+        entry.mTurn = turn;
+        entry.mOffset = static_cast<uint64_t>(mStream.tellp());
+        mIndex.push_back(entry);
+    }
+
+    mChunk.insert(mChunk.end(), packet.begin(), packet.end());
+    if(mChunk.size() >= CHUNK_SIZE)
+        writeChunk();
+}
+
+void ReplayWriter::writeChunk()
+{
+    if(mChunk.empty())
+        return;
+
+    uLong size = static_cast<uLong>(mChunk.size());
+    mCompressed.resize(compressBound(size));
+    uLongf compressedSize = static_cast<uLongf>(mCompressed.size());
+    compress2(reinterpret_cast<Bytef*>(mCompressed.data()), &compressedSize,
+        reinterpret_cast<const Bytef*>(mChunk.data()), size, Z_DEFAULT_COMPRESSION);
+
+    uint32_t chunkSize = static_cast<uint32_t>(size);
+    uint32_t chunkCompressedSize = static_cast<uint32_t>(compressedSize);
+    mStream.write(reinterpret_cast<const char*>(&chunkSize), sizeof(chunkSize));
+    mStream.write(reinterpret_cast<const char*>(&chunkCompressedSize), sizeof(chunkCompressedSize));
+    mStream.write(mCompressed.data(), chunkCompressedSize);
+    mChunk.clear();
+}
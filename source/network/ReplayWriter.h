@@ -0,0 +1,59 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPLAYWRITER_H
+#define REPLAYWRITER_H
+
+#include "network/ReplayReader.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/*! \brief Writes a version 2 replay (see ReplayReader for the format). The packets are
+ * accumulated in a chunk which is compressed and written when it is big enough.
+ */
+class ReplayWriter
+{
+public:
+    ReplayWriter();
+    ~ReplayWriter();
+
+    //! \brief Creates the given file. Returns false if it cannot be created
+    bool open(const std::string& filename);
+
+    //! \brief Writes the remaining chunk and the index and closes the file
+    void close();
+
+    //! \brief Adds a packet serialized with ODPacket::writePacket. turn is the last turn
+    //! started when the packet has been received
+    void write(int32_t timestamp, int64_t turn, const std::vector<char>& packet);
+
+private:
+    //! \brief When the uncompressed chunk reaches this size, it is written
+    static const uint32_t CHUNK_SIZE;
+
+    std::ofstream mStream;
+    std::vector<char> mChunk;
+    std::vector<char> mCompressed;
+    std::vector<ReplayReader::IndexEntry> mIndex;
+
+    void writeChunk();
+};
+
+#endif // REPLAYWRITER_H
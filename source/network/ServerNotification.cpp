@@ -114,6 +114,8 @@ std::string ServerNotification::typeString(ServerNotificationType type)
             return "setSpellCooldown";
         case ServerNotificationType::playerEvents:
             return "playerEvents";
+        case ServerNotificationType::messageBatch:
+            return "messageBatch";
         case ServerNotificationType::exit:
             return "exit";
         default:
@@ -86,6 +86,8 @@ enum class ServerNotificationType
 
     playerEvents,
 
+    messageBatch, // Several messages sent at once (see ODSocketClient::queue)
+
     exit
 };
 
@@ -0,0 +1,210 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "network/SocketReactor.h"
+
+#include "network/SocketHandle.h"
+
+#include <chrono>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+
+//! \brief Maximum time the reactor thread waits before checking if it should stop
+static const int REACTOR_WAIT_MS = 100;
+#else
+//! \brief The selector is rebuilt each time it is polled so that sockets can be added from other threads
+static const int SELECTOR_POLL_MS = 10;
+#endif
+
+#ifdef __linux__
+static void epollControl(int epollFd, int operation, const sf::Socket& socket, uint64_t watchId)
+{
+    epoll_event event;
+    // Level triggered and one shot: the owner reads one message per event and rearms the socket. If more data is
+    // pending, the socket will be ready again right away. Note that edge triggering would need to read until
+    // the socket blocks, which is not possible with blocking SFML sockets
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = watchId;
+    epoll_ctl(epollFd, operation, SocketHandle::get(socket), &event);
+}
+#endif
+
+SocketReactor::SocketReactor() :
+    mNextWatchId(1),
+    mIsStopping(false)
+#ifdef __linux__
+    ,
+    mEpollFd(-1)
+#endif
+{
+}
+
+SocketReactor::~SocketReactor()
+{
+    stop();
+}
+
+bool SocketReactor::start()
+{
+    stop();
+
+#ifdef __linux__
+    mEpollFd = epoll_create1(0);
+    if(mEpollFd < 0)
+        return false;
+#endif
+
+    mIsStopping = false;
+    mThread = std::thread(&SocketReactor::reactorThread, this);
+    return true;
+}
+
+void SocketReactor::stop()
+{
+    if(!mThread.joinable())
+        return;
+
+    mIsStopping = true;
+    mThread.join();
+
+#ifdef __linux__
+    close(mEpollFd);
+    mEpollFd = -1;
+#endif
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mWatches.clear();
+    mWatchIds.clear();
+}
+
+void SocketReactor::add(sf::Socket& socket, const ReadyCallback& callback)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(mWatchIds.count(&socket) > 0)
+        return;
+
+    uint64_t watchId = mNextWatchId++;
+    Watch& watch = mWatches[watchId];
+    watch.mSocket = &socket;
+    watch.mCallback = callback;
+    watch.mIsArmed = true;
+    mWatchIds[&socket] = watchId;
+
+#ifdef __linux__
+    epollControl(mEpollFd, EPOLL_CTL_ADD, socket, watchId);
+#endif
+}
+
+void SocketReactor::rearm(sf::Socket& socket)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::map<sf::Socket*, uint64_t>::iterator it = mWatchIds.find(&socket);
+    if(it == mWatchIds.end())
+        return;
+
+    mWatches[it->second].mIsArmed = true;
+
+#ifdef __linux__
+    epollControl(mEpollFd, EPOLL_CTL_MOD, socket, it->second);
+#endif
+}
+
+void SocketReactor::remove(sf::Socket& socket)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::map<sf::Socket*, uint64_t>::iterator it = mWatchIds.find(&socket);
+    if(it == mWatchIds.end())
+        return;
+
+#ifdef __linux__
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, SocketHandle::get(socket), nullptr);
+#endif
+
+    mWatches.erase(it->second);
+    mWatchIds.erase(it);
+}
+
+void SocketReactor::notifyReady(uint64_t watchId)
+{
+    std::map<uint64_t, Watch>::iterator it = mWatches.find(watchId);
+    if((it == mWatches.end()) || !it->second.mIsArmed)
+        return;
+
+    it->second.mIsArmed = false;
+    it->second.mCallback();
+}
+
+#ifdef __linux__
+void SocketReactor::reactorThread()
+{
+    std::vector<epoll_event> events(256);
+    while(!mIsStopping)
+    {
+        int nbEvents = epoll_wait(mEpollFd, events.data(), static_cast<int>(events.size()), REACTOR_WAIT_MS);
+        if(nbEvents <= 0)
+            continue;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        for(int i = 0; i < nbEvents; ++i)
+            notifyReady(events[i].data.u64);
+    }
+}
+#else
+void SocketReactor::reactorThread()
+{
+    std::vector<uint64_t> watchIds;
+    while(!mIsStopping)
+    {
+        watchIds.clear();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mSelector.clear();
+            for(std::pair<const uint64_t, Watch>& watch : mWatches)
+            {
+                if(!watch.second.mIsArmed)
+                    continue;
+
+                mSelector.add(*watch.second.mSocket);
+                watchIds.push_back(watch.first);
+            }
+        }
+
+        if(watchIds.empty())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(SELECTOR_POLL_MS));
+            continue;
+        }
+
+        if(!mSelector.wait(sf::milliseconds(SELECTOR_POLL_MS)))
+            continue;
+
+        // The sockets removed while waiting are not watched anymore. We do not check them
+        std::lock_guard<std::mutex> lock(mMutex);
+        for(uint64_t watchId : watchIds)
+        {
+            std::map<uint64_t, Watch>::iterator it = mWatches.find(watchId);
+            if((it == mWatches.end()) || !mSelector.isReady(*it->second.mSocket))
+                continue;
+
+            notifyReady(watchId);
+        }
+    }
+}
+#endif
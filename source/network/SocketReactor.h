@@ -0,0 +1,92 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SOCKETREACTOR_H
+#define SOCKETREACTOR_H
+
+#include <SFML/Network.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+/*! \brief Watches the sockets of many servers from a single thread.
+ *
+ * When a watched socket can be read, its callback is called from the reactor thread and the socket is
+ * not watched anymore until rearm is called. Thus, a socket is only handled by one thread at a time and its
+ * owner can read it from its own thread. On Linux, epoll is used so that waking up does not cost more
+ * when many sockets are watched. On the other platforms, the sockets are polled with a sf::SocketSelector.
+ * Note that the callbacks are called with the reactor locked: they should return quickly and
+ * not call the reactor.
+ */
+class SocketReactor
+{
+public:
+    typedef std::function<void()> ReadyCallback;
+
+    SocketReactor();
+    ~SocketReactor();
+
+    //! \brief Launches the reactor thread. Returns false if the reactor could not be created
+    bool start();
+    void stop();
+
+    //! \brief Watches the given socket. callback will be called when it can be read
+    void add(sf::Socket& socket, const ReadyCallback& callback);
+
+    //! \brief Watches again the given socket after its callback has been called
+    void rearm(sf::Socket& socket);
+
+    //! \brief Stops watching the given socket. Once this returns, its callback will not be called anymore
+    //! so the socket can be closed and deleted
+    void remove(sf::Socket& socket);
+
+private:
+    struct Watch
+    {
+        sf::Socket* mSocket;
+        ReadyCallback mCallback;
+        bool mIsArmed;
+    };
+
+    //! \brief Protects the members below
+    std::mutex mMutex;
+    //! \brief Watched sockets by id. Events are matched with their watch by id so that an event received
+    //! for a removed socket is not given to another socket allocated at the same address
+    std::map<uint64_t, Watch> mWatches;
+    std::map<sf::Socket*, uint64_t> mWatchIds;
+    uint64_t mNextWatchId;
+
+    std::thread mThread;
+    std::atomic<bool> mIsStopping;
+
+#ifdef __linux__
+    int mEpollFd;
+#else
+    sf::SocketSelector mSelector;
+#endif
+
+    void reactorThread();
+
+    //! \brief Calls the callback of the given watch if it is still watched. mMutex should be locked
+    void notifyReady(uint64_t watchId);
+};
+
+#endif // SOCKETREACTOR_H
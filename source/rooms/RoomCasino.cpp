@@ -509,7 +509,7 @@ bool RoomCasino::useRoom(Creature& creature, bool forced)
     if(Pathfinding::squaredDistance(creature.getPosition().x, wantedX, creature.getPosition().y, wantedY) > 0.4)
     {
         // We go there
-        std::list<Tile*> pathToSpot = getGameMap()->path(&creature, tileSpot);
+        std::vector<Tile*> pathToSpot = getGameMap()->path(&creature, tileSpot);
         std::vector<Ogre::Vector3> path;
         Creature::tileToVector3(pathToSpot, path, true, 0.0);
         // We add the last step to take account of the offset
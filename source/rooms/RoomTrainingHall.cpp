@@ -247,7 +247,7 @@ void RoomTrainingHall::refreshCreaturesDummies()
            creaturePosition.y != wantedY)
         {
             // We move to the good tile
-            std::list<Tile*> pathToDummy = getGameMap()->path(creature, tileDummy);
+            std::vector<Tile*> pathToDummy = getGameMap()->path(creature, tileDummy);
             if(pathToDummy.empty())
             {
                 OD_LOG_ERR("unexpected empty pathToDummy");
@@ -290,7 +290,7 @@ bool RoomTrainingHall::addCreatureUsingRoom(Creature* creature)
        creaturePosition.y != wantedY)
     {
         // We move to the good tile
-        std::list<Tile*> pathToDummy = getGameMap()->path(creature, tileDummy);
+        std::vector<Tile*> pathToDummy = getGameMap()->path(creature, tileDummy);
         if(pathToDummy.empty())
         {
             OD_LOG_ERR("unexpected empty pathToDummy");
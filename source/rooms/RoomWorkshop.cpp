@@ -248,7 +248,7 @@ bool RoomWorkshop::addCreatureUsingRoom(Creature* creature)
        creaturePosition.y != wantedY)
     {
         // We move to the good tile
-        std::list<Tile*> pathToSpot = getGameMap()->path(creature, tileSpot);
+        std::vector<Tile*> pathToSpot = getGameMap()->path(creature, tileSpot);
         if(pathToSpot.empty())
         {
             OD_LOG_ERR("unexpected empty pathToSpot");
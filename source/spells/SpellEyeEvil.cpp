@@ -90,9 +90,11 @@ void SpellEyeEvil::computeVisibleTiles()
         return;
     }
 
+    if(!getGameMap()->needVisionUpdate(this, getSeat(), posTile, radius))
+        return;
+
     std::vector<Tile*> tiles = getGameMap()->circularRegion(posTile->getX(), posTile->getY(), radius);
-    for(Tile* tile : tiles)
-        tile->notifyVision(getSeat());
+    getGameMap()->setVisionTiles(this, tiles);
 }
 
 void SpellEyeEvil::checkSpellCast(GameMap* gameMap, const InputManager& inputManager, InputCommand& inputCommand)
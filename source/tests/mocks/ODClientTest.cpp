@@ -69,7 +69,7 @@ bool ODClientTest::connect(const std::string& host, const int port, uint32_t tim
     // Send a hello request to start the conversation with the server
     ODPacket packSend;
     packSend << ClientNotificationType::hello
-        << std::string("OpenDungeons V ") + OD_VERSION_STR;
+        << ClientNotification::getProtocolVersion(OD_VERSION_STR);
     send(packSend);
 
     return true;
@@ -0,0 +1,182 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE ClaimedTiles
+#include "BoostTestTargetConfig.h"
+
+#include "gamemap/ClaimedTiles.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+const int MAP_SIZE_X = 30;
+const int MAP_SIZE_Y = 20;
+const uint32_t NB_SEATS = 3;
+
+//! \brief Claimed tiles of a map and the vision they give (like VisionManager: a claimed tile sees itself and its
+//! neighbors)
+struct ClaimMap
+{
+    ClaimMap() :
+        mClaims(MAP_SIZE_X * MAP_SIZE_Y, ClaimedTiles::NO_SEAT),
+        mCounts(MAP_SIZE_X * MAP_SIZE_Y * NB_SEATS, 0),
+        mNbChecked(0)
+    {
+    }
+
+    uint32_t getClaim(int x, int y)
+    {
+        ++mNbChecked;
+        return mClaims[x * MAP_SIZE_Y + y];
+    }
+
+    void changeVision(int x, int y, uint32_t seatIndex, int value)
+    {
+        for(int xxx = x - 1; xxx <= x + 1; ++xxx)
+        {
+            for(int yyy = y - 1; yyy <= y + 1; ++yyy)
+            {
+                if((xxx < 0) || (yyy < 0) || (xxx >= MAP_SIZE_X) || (yyy >= MAP_SIZE_Y))
+                    continue;
+
+                mCounts[(xxx * MAP_SIZE_Y + yyy) * NB_SEATS + seatIndex] += value;
+            }
+        }
+    }
+
+    void process(ClaimedTiles& claimedTiles)
+    {
+        claimedTiles.process([this](int x, int y) { return getClaim(x, y); },
+            [this](int x, int y, uint32_t oldSeatIndex, uint32_t newSeatIndex)
+        {
+            if(newSeatIndex != ClaimedTiles::NO_SEAT)
+                changeVision(x, y, newSeatIndex, 1);
+            if(oldSeatIndex != ClaimedTiles::NO_SEAT)
+                changeVision(x, y, oldSeatIndex, -1);
+        });
+    }
+
+    //! \brief Vision counts computed from scratch
+    std::vector<int> computeCounts() const
+    {
+        ClaimMap fullMap;
+        fullMap.mClaims = mClaims;
+        for(int x = 0; x < MAP_SIZE_X; ++x)
+        {
+            for(int y = 0; y < MAP_SIZE_Y; ++y)
+            {
+                uint32_t seatIndex = mClaims[x * MAP_SIZE_Y + y];
+                if(seatIndex != ClaimedTiles::NO_SEAT)
+                    fullMap.changeVision(x, y, seatIndex, 1);
+            }
+        }
+        return fullMap.mCounts;
+    }
+
+    std::vector<uint32_t> mClaims;
+    std::vector<int> mCounts;
+    uint32_t mNbChecked;
+};
+}
+
+BOOST_AUTO_TEST_CASE(test_ResetChecksEveryTile)
+{
+    ClaimMap map;
+    map.mClaims[5 * MAP_SIZE_Y + 7] = 1;
+    map.mClaims[0] = 2;
+
+    ClaimedTiles claimedTiles;
+    // Changes before the first reset are ignored: the reset checks every tile anyway
+    claimedTiles.tileChanged(1, 1);
+    BOOST_CHECK_EQUAL(claimedTiles.getNbQueuedTiles(), 0);
+
+    claimedTiles.reset(MAP_SIZE_X, MAP_SIZE_Y);
+    BOOST_CHECK_EQUAL(claimedTiles.getNbQueuedTiles(), static_cast<uint32_t>(MAP_SIZE_X * MAP_SIZE_Y));
+    map.process(claimedTiles);
+    BOOST_CHECK_EQUAL(map.mNbChecked, static_cast<uint32_t>(MAP_SIZE_X * MAP_SIZE_Y));
+    BOOST_CHECK_EQUAL(claimedTiles.getNbQueuedTiles(), 0);
+    BOOST_CHECK_EQUAL(claimedTiles.getSeatIndex(5, 7), 1);
+    BOOST_CHECK_EQUAL(claimedTiles.getSeatIndex(0, 0), 2);
+    BOOST_CHECK(map.mCounts == map.computeCounts());
+
+    // Nothing changed: nothing is checked
+    map.mNbChecked = 0;
+    map.process(claimedTiles);
+    BOOST_CHECK_EQUAL(map.mNbChecked, 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_QueuedOnce)
+{
+    ClaimedTiles claimedTiles;
+    claimedTiles.reset(MAP_SIZE_X, MAP_SIZE_Y);
+    ClaimMap map;
+    map.process(claimedTiles);
+
+    // A tile changed several times is checked once. The tiles outside the map are ignored
+    claimedTiles.tileChanged(3, 4);
+    claimedTiles.tileChanged(3, 4);
+    claimedTiles.tileChanged(4, 3);
+    claimedTiles.tileChanged(-1, 0);
+    claimedTiles.tileChanged(MAP_SIZE_X, 0);
+    claimedTiles.tileChanged(0, MAP_SIZE_Y);
+    BOOST_CHECK_EQUAL(claimedTiles.getNbQueuedTiles(), 2);
+
+    map.mNbChecked = 0;
+    map.process(claimedTiles);
+    BOOST_CHECK_EQUAL(map.mNbChecked, 2);
+
+    // Once processed, the tile can be queued again
+    claimedTiles.tileChanged(3, 4);
+    BOOST_CHECK_EQUAL(claimedTiles.getNbQueuedTiles(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_IncrementalCounts)
+{
+    std::srand(7);
+    ClaimedTiles claimedTiles;
+    claimedTiles.reset(MAP_SIZE_X, MAP_SIZE_Y);
+    ClaimMap map;
+    map.process(claimedTiles);
+
+    // Each turn, some tiles are claimed, lost or claimed by another seat. Some are changed back to their
+    // previous seat within the turn. The vision counts should always be the same as if every tile was checked
+    bool isSame = true;
+    bool isQueueSmall = true;
+    for(uint32_t turn = 0; turn < 200; ++turn)
+    {
+        uint32_t nbChanges = static_cast<uint32_t>(std::rand() % 20);
+        for(uint32_t i = 0; i < nbChanges; ++i)
+        {
+            int x = std::rand() % MAP_SIZE_X;
+            int y = std::rand() % MAP_SIZE_Y;
+            uint32_t seatIndex = static_cast<uint32_t>(std::rand() % (NB_SEATS + 1));
+            map.mClaims[x * MAP_SIZE_Y + y] = (seatIndex == NB_SEATS) ? ClaimedTiles::NO_SEAT : seatIndex;
+            claimedTiles.tileChanged(x, y);
+        }
+
+        isQueueSmall = isQueueSmall && (claimedTiles.getNbQueuedTiles() <= nbChanges);
+        map.mNbChecked = 0;
+        map.process(claimedTiles);
+        isQueueSmall = isQueueSmall && (map.mNbChecked <= nbChanges);
+        isSame = isSame && (map.mCounts == map.computeCounts());
+    }
+    BOOST_CHECK(isSame);
+    BOOST_CHECK(isQueueSmall);
+}
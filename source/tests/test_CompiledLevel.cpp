@@ -0,0 +1,272 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE CompiledLevel
+#include "BoostTestTargetConfig.h"
+
+#include "gamemap/CompiledLevel.h"
+#include "utils/Helper.h"
+#include "utils/LogManager.h"
+#include "utils/LogSinkConsole.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+//! \brief Tiles of a level read like MapHandler does
+struct LevelTiles
+{
+    LevelTiles() :
+        mMapSizeX(0),
+        mMapSizeY(0)
+    {
+    }
+
+    int mMapSizeX;
+    int mMapSizeY;
+    //! \brief Lines read after the compiled tiles (if any). Invalid lines are kept with empty values
+    std::vector<bool> mValid;
+    std::vector<CompiledLevel::TileRecord> mTiles;
+
+    void addTile(bool valid, const CompiledLevel::TileRecord& record)
+    {
+        mValid.push_back(valid);
+        mTiles.push_back(valid ? record : CompiledLevel::TileRecord());
+    }
+};
+
+//! \brief Reads the map size and the tile lines left in the given stream (after [Tiles])
+bool readTextTiles(std::stringstream& levelFile, LevelTiles& levelTiles)
+{
+    std::string nextParam;
+    while(true)
+    {
+        if(!(levelFile >> nextParam))
+            return false;
+        if(nextParam == "[Tiles]")
+            break;
+    }
+
+    levelFile >> levelTiles.mMapSizeX;
+    levelFile >> levelTiles.mMapSizeY;
+    return true;
+}
+
+bool readTextTileLines(std::stringstream& levelFile, LevelTiles& levelTiles)
+{
+    std::string nextParam;
+    while(true)
+    {
+        if(!(levelFile >> nextParam))
+            return false;
+        if(nextParam == "[/Tiles]")
+            return true;
+
+        std::string entireLine = nextParam;
+        std::getline(levelFile, nextParam);
+        entireLine += nextParam;
+        CompiledLevel::TileRecord record;
+        bool valid = CompiledLevel::readTileLine(entireLine, record);
+        levelTiles.addTile(valid, record);
+    }
+}
+
+//! \brief The former way: the whole level is read as text
+LevelTiles readLevelAsText(const std::string& fileName)
+{
+    LevelTiles levelTiles;
+    std::stringstream levelFile;
+    BOOST_REQUIRE(Helper::readFileWithoutComments(fileName, levelFile));
+    BOOST_REQUIRE(readTextTiles(levelFile, levelTiles));
+    BOOST_REQUIRE(readTextTileLines(levelFile, levelTiles));
+    return levelTiles;
+}
+
+LevelTiles readCompiledLevel(const CompiledLevel& compiledLevel)
+{
+    LevelTiles levelTiles;
+    std::stringstream levelFile(std::string(compiledLevel.getText(), compiledLevel.getTextSize()));
+    BOOST_REQUIRE(readTextTiles(levelFile, levelTiles));
+    for(uint32_t i = 0; i < compiledLevel.getNbTiles(); ++i)
+        levelTiles.addTile(true, compiledLevel.getTiles()[i]);
+    BOOST_REQUIRE(readTextTileLines(levelFile, levelTiles));
+    return levelTiles;
+}
+
+void checkSameTiles(const LevelTiles& result, const LevelTiles& expected)
+{
+    BOOST_CHECK_EQUAL(result.mMapSizeX, expected.mMapSizeX);
+    BOOST_CHECK_EQUAL(result.mMapSizeY, expected.mMapSizeY);
+    BOOST_REQUIRE_EQUAL(result.mTiles.size(), expected.mTiles.size());
+    for(uint32_t i = 0; i < expected.mTiles.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(result.mValid[i], expected.mValid[i]);
+        if(!expected.mValid[i])
+            continue;
+
+        BOOST_CHECK_EQUAL(result.mTiles[i].mX, expected.mTiles[i].mX);
+        BOOST_CHECK_EQUAL(result.mTiles[i].mY, expected.mTiles[i].mY);
+        BOOST_CHECK_EQUAL(result.mTiles[i].mType, expected.mTiles[i].mType);
+        BOOST_CHECK_EQUAL(result.mTiles[i].mSeatId, expected.mTiles[i].mSeatId);
+        BOOST_CHECK_EQUAL(result.mTiles[i].mFullness, expected.mTiles[i].mFullness);
+    }
+}
+
+void writeFile(const boost::filesystem::path& path, const std::string& content)
+{
+    std::ofstream file(path.string().c_str(), std::ios::out | std::ios::binary);
+    file << content;
+}
+
+uint32_t countCachedFiles(const boost::filesystem::path& cachePath)
+{
+    uint32_t nbFiles = 0;
+    for(boost::filesystem::directory_iterator it(cachePath); it != boost::filesystem::directory_iterator(); ++it)
+    {
+        if(it->path().extension() == ".clevel")
+            ++nbFiles;
+    }
+    return nbFiles;
+}
+
+//! \brief Temporary folder removed at the end of the test
+struct TmpFolder
+{
+    TmpFolder() :
+        mPath(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("odtest-%%%%-%%%%"))
+    {
+        boost::filesystem::create_directories(mPath / "levelCache");
+    }
+
+    ~TmpFolder()
+    {
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(mPath, ec);
+    }
+
+    std::string getCachePath() const
+    { return (mPath / "levelCache").string() + "/"; }
+
+    boost::filesystem::path mPath;
+};
+
+// The map size is on the [Tiles] line and the tile lines have comments, blank lines, indentation and
+// water/lava tiles without fullness
+const std::string LEVEL_SIZE_ON_TILES_LINE =
+    "0.7.1\n"
+    "[Info]\n"
+    "Name\tTest level # the name\n"
+    "[/Info]\n"
+    "# Tiles of the level\n"
+    "[Tiles]\t5\t4 # size\n"
+    "0\t0\t1\t100.0\t1\n"
+    "0\t1\t3 # water\n"
+    "\n"
+    "  1\t0\t1\t0.0\t2\n"
+    "1\t1\t2\t50.5 # gold\n"
+    "2\t3\t4\n"
+    "# a comment in the tiles\n"
+    "4\t3\t1\t25.0\t-1\n"
+    "[/Tiles]\n"
+    "[Seats]\n"
+    "[/Seats]\n";
+
+// The map size is on the next lines and an invalid tile line is in the middle
+const std::string LEVEL_WITH_BAD_LINE =
+    "0.7.1\n"
+    "[Info]\n"
+    "[/Info]\n"
+    "[Tiles]\n"
+    "6\n"
+    "7\n"
+    "0\t0\t1\t100.0\n"
+    "0\t1\t1\t0.0\t1\n"
+    "1\t2\n"
+    "1\t3\t1\t0.0\t1\n"
+    "5\t6\t3\n"
+    "[/Tiles]\n";
+}
+
+BOOST_AUTO_TEST_CASE(test_SameTilesAsText)
+{
+    LogManager logMgr;
+    logMgr.addSink(std::unique_ptr<LogSink>(new LogSinkConsole()));
+
+    TmpFolder folder;
+    boost::filesystem::path levelPath = folder.mPath / "level.level";
+    for(const std::string& level : { LEVEL_SIZE_ON_TILES_LINE, LEVEL_WITH_BAD_LINE })
+    {
+        writeFile(levelPath, level);
+        LevelTiles expected = readLevelAsText(levelPath.string());
+
+        // Compiled without cache, compiled and saved in the cache, then read from the cache
+        for(const std::string& cachePath : { std::string(), folder.getCachePath(), folder.getCachePath() })
+        {
+            CompiledLevel compiledLevel;
+            BOOST_REQUIRE(compiledLevel.load(levelPath.string(), cachePath));
+            checkSameTiles(readCompiledLevel(compiledLevel), expected);
+        }
+    }
+
+    // The tile lines are compiled up to the bad one. The next ones are read as text
+    CompiledLevel compiledLevel;
+    BOOST_REQUIRE(compiledLevel.load(levelPath.string(), ""));
+    BOOST_CHECK_EQUAL(compiledLevel.getNbTiles(), 2);
+    BOOST_CHECK_EQUAL(readLevelAsText(levelPath.string()).mValid.size(), 5);
+}
+
+BOOST_AUTO_TEST_CASE(test_OutdatedFilesRemoved)
+{
+    LogManager logMgr;
+    logMgr.addSink(std::unique_ptr<LogSink>(new LogSinkConsole()));
+
+    TmpFolder folder;
+    boost::filesystem::path levelPath = folder.mPath / "level.level";
+    boost::filesystem::path otherLevelPath = folder.mPath / "other.level";
+    writeFile(levelPath, LEVEL_SIZE_ON_TILES_LINE);
+    writeFile(otherLevelPath, LEVEL_SIZE_ON_TILES_LINE);
+    {
+        CompiledLevel compiledLevel;
+        BOOST_REQUIRE(compiledLevel.load(levelPath.string(), folder.getCachePath()));
+        CompiledLevel otherCompiledLevel;
+        BOOST_REQUIRE(otherCompiledLevel.load(otherLevelPath.string(), folder.getCachePath()));
+    }
+    BOOST_CHECK_EQUAL(countCachedFiles(folder.getCachePath()), 2);
+
+    // Compiling the modified level removes its former compiled file but not the one of the other level
+    writeFile(levelPath, LEVEL_WITH_BAD_LINE);
+    {
+        CompiledLevel compiledLevel;
+        BOOST_REQUIRE(compiledLevel.load(levelPath.string(), folder.getCachePath()));
+        BOOST_CHECK_EQUAL(compiledLevel.getNbTiles(), 2);
+    }
+    BOOST_CHECK_EQUAL(countCachedFiles(folder.getCachePath()), 2);
+
+    // Going back to the former content compiles it again
+    writeFile(levelPath, LEVEL_SIZE_ON_TILES_LINE);
+    {
+        CompiledLevel compiledLevel;
+        BOOST_REQUIRE(compiledLevel.load(levelPath.string(), folder.getCachePath()));
+        checkSameTiles(readCompiledLevel(compiledLevel), readLevelAsText(levelPath.string()));
+    }
+    BOOST_CHECK_EQUAL(countCachedFiles(folder.getCachePath()), 2);
+}
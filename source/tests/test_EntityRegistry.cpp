@@ -0,0 +1,123 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE EntityRegistry
+#include "BoostTestTargetConfig.h"
+
+#include "entities/GameEntityType.h"
+#include "gamemap/EntityRegistry.h"
+
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+//! \brief The registry never accesses the entities. We only need distinct addresses
+std::vector<char> gEntityStorage(1000);
+
+GameEntity* getFakeEntity(uint32_t index)
+{
+    return reinterpret_cast<GameEntity*>(&gEntityStorage[index]);
+}
+}
+
+BOOST_AUTO_TEST_CASE(test_AddFindRemove)
+{
+    EntityRegistry registry;
+    BOOST_CHECK(registry.find(GameEntityType::creature, "Creature1") == nullptr);
+    BOOST_CHECK(!registry.remove(GameEntityType::creature, "Creature1", getFakeEntity(0)));
+
+    uint32_t id1 = registry.add(GameEntityType::creature, "Creature1", getFakeEntity(1));
+    uint32_t id2 = registry.add(GameEntityType::room, "Creature1", getFakeEntity(2));
+    BOOST_CHECK(id1 != id2);
+    BOOST_CHECK(registry.find(GameEntityType::creature, "Creature1") == getFakeEntity(1));
+    BOOST_CHECK(registry.find(GameEntityType::room, "Creature1") == getFakeEntity(2));
+    BOOST_CHECK(registry.find(GameEntityType::trap, "Creature1") == nullptr);
+    BOOST_CHECK_EQUAL(registry.getId(GameEntityType::creature, "Creature1"), id1);
+    BOOST_CHECK(registry.getEntity(id2) == getFakeEntity(2));
+
+    // An entity is only removed with the type and name it was added with
+    BOOST_CHECK(!registry.remove(GameEntityType::room, "Creature1", getFakeEntity(1)));
+    BOOST_CHECK(!registry.remove(GameEntityType::creature, "Creature2", getFakeEntity(1)));
+    BOOST_CHECK(registry.remove(GameEntityType::creature, "Creature1", getFakeEntity(1)));
+    BOOST_CHECK(registry.find(GameEntityType::creature, "Creature1") == nullptr);
+    BOOST_CHECK(registry.getEntity(id1) == nullptr);
+    BOOST_CHECK_EQUAL(registry.getId(GameEntityType::creature, "Creature1"), EntityRegistry::NO_ID);
+    BOOST_CHECK(registry.find(GameEntityType::room, "Creature1") == getFakeEntity(2));
+
+    // The ids of removed entities are reused
+    uint32_t id3 = registry.add(GameEntityType::trap, "Trap1", getFakeEntity(3));
+    BOOST_CHECK_EQUAL(id3, id1);
+
+    registry.clear();
+    BOOST_CHECK(registry.find(GameEntityType::room, "Creature1") == nullptr);
+    BOOST_CHECK(registry.getEntity(id2) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(test_SameAsMap)
+{
+    // Many entities are added and removed so that the tables are rebuilt and contain removed slots
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<uint32_t> distEntity(0, static_cast<uint32_t>(gEntityStorage.size()) - 1);
+    std::uniform_int_distribution<int> distType(static_cast<int>(GameEntityType::creature),
+        static_cast<int>(GameEntityType::spell));
+    EntityRegistry registry;
+    std::map<std::pair<int, std::string>, uint32_t> expected;
+    for(int i = 0; i < 20000; ++i)
+    {
+        uint32_t index = distEntity(gen);
+        GameEntityType type = static_cast<GameEntityType>(distType(gen));
+        std::pair<int, std::string> key(static_cast<int>(type), "Entity" + std::to_string(index));
+        auto it = expected.find(key);
+        if(it == expected.end())
+        {
+            uint32_t id = registry.add(type, key.second, getFakeEntity(index));
+            BOOST_REQUIRE(registry.getEntity(id) == getFakeEntity(index));
+            expected[key] = index;
+        }
+        else
+        {
+            BOOST_REQUIRE(registry.remove(type, key.second, getFakeEntity(it->second)));
+            expected.erase(it);
+        }
+
+        // We check a few random names after each change
+        for(int k = 0; k < 4; ++k)
+        {
+            uint32_t checkedIndex = distEntity(gen);
+            GameEntityType checkedType = static_cast<GameEntityType>(distType(gen));
+            std::pair<int, std::string> checkedKey(static_cast<int>(checkedType), "Entity" + std::to_string(checkedIndex));
+            auto itChecked = expected.find(checkedKey);
+            GameEntity* entity = registry.find(checkedType, checkedKey.second);
+            if(itChecked == expected.end())
+                BOOST_REQUIRE(entity == nullptr);
+            else
+                BOOST_REQUIRE(entity == getFakeEntity(itChecked->second));
+        }
+    }
+
+    for(const auto& entry : expected)
+    {
+        GameEntityType type = static_cast<GameEntityType>(entry.first.first);
+        uint32_t id = registry.getId(type, entry.first.second);
+        BOOST_REQUIRE(id != EntityRegistry::NO_ID);
+        BOOST_CHECK(registry.getEntity(id) == getFakeEntity(entry.second));
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE FloodFillIndex
+#include "BoostTestTargetConfig.h"
+
+#include "gamemap/FloodFillIndex.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(test_FloodFillIndexMerge)
+{
+    FloodFillIndex index;
+    // Colors never merged are their own representative, whatever the team
+    BOOST_CHECK_EQUAL(index.find(0, 5), 5);
+    BOOST_CHECK_EQUAL(index.find(3, 12), 12);
+
+    uint32_t root = index.merge(0, 1, 2);
+    BOOST_CHECK((root == 1) || (root == 2));
+    BOOST_CHECK_EQUAL(index.find(0, 1), root);
+    BOOST_CHECK_EQUAL(index.find(0, 2), root);
+
+    // Merging is transitive
+    index.merge(0, 3, 4);
+    index.merge(0, 4, 2);
+    uint32_t root1 = index.find(0, 1);
+    BOOST_CHECK_EQUAL(index.find(0, 2), root1);
+    BOOST_CHECK_EQUAL(index.find(0, 3), root1);
+    BOOST_CHECK_EQUAL(index.find(0, 4), root1);
+
+    // Merging colors already connected changes nothing
+    BOOST_CHECK_EQUAL(index.merge(0, 3, 1), root1);
+
+    // The teams do not share their merges
+    BOOST_CHECK_EQUAL(index.find(1, 2), 2);
+    BOOST_CHECK(index.find(1, 1) != index.find(1, 4));
+
+    index.clear();
+    BOOST_CHECK_EQUAL(index.find(0, 4), 4);
+}
+
+BOOST_AUTO_TEST_CASE(test_FloodFillIndexSplit)
+{
+    // Areas are split (a door is locked) by giving a new color to the tiles of one side. Their old
+    // color stays merged with the other area but the new one is not connected to anything
+    FloodFillIndex index;
+    index.merge(0, 10, 11);
+    index.merge(0, 11, 12);
+    const uint32_t newColor = 13;
+    BOOST_CHECK_EQUAL(index.find(0, newColor), newColor);
+    BOOST_CHECK(index.find(0, newColor) != index.find(0, 10));
+
+    // Both sides can be connected again later (the door is unlocked)
+    index.merge(0, newColor, 12);
+    BOOST_CHECK_EQUAL(index.find(0, newColor), index.find(0, 10));
+}
+
+BOOST_AUTO_TEST_CASE(test_FloodFillIndexConstFind)
+{
+    // Random merges compared with a naive relabeling of every color
+    std::srand(3);
+    const uint32_t nbColors = 500;
+    FloodFillIndex index;
+    std::vector<uint32_t> labels(nbColors);
+    for(uint32_t color = 0; color < nbColors; ++color)
+        labels[color] = color;
+
+    for(uint32_t i = 0; i < 400; ++i)
+    {
+        uint32_t color1 = static_cast<uint32_t>(std::rand()) % nbColors;
+        uint32_t color2 = static_cast<uint32_t>(std::rand()) % nbColors;
+        index.merge(0, color1, color2);
+        uint32_t oldLabel = labels[color2];
+        for(uint32_t& label : labels)
+        {
+            if(label == oldLabel)
+                label = labels[color1];
+        }
+    }
+
+    // find can be called on a const index and gives the same result as the relabeling
+    const FloodFillIndex& constIndex = index;
+    bool isSame = true;
+    for(uint32_t color1 = 0; color1 < nbColors; ++color1)
+    {
+        for(uint32_t color2 = color1 + 1; color2 < nbColors; color2 += 7)
+        {
+            bool isConnected = (constIndex.find(0, color1) == constIndex.find(0, color2));
+            isSame = isSame && (isConnected == (labels[color1] == labels[color2]));
+        }
+    }
+    BOOST_CHECK(isSame);
+}
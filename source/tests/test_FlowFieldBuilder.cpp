@@ -0,0 +1,207 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE FlowFieldBuilder
+#include "BoostTestTargetConfig.h"
+
+#include "gamemap/FlowFieldBuilder.h"
+#include "gamemap/Pathfinding.h"
+#include "gamemap/PathfindingContext.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+const int MAP_SIZE_X = 50;
+const int MAP_SIZE_Y = 40;
+
+//! \brief Map where each tile is a wall or is walked at some speed (like ground, water and lava)
+struct SpeedMap
+{
+    explicit SpeedMap(std::mt19937& gen) :
+        mSpeeds(MAP_SIZE_X * MAP_SIZE_Y, 0.0)
+    {
+        std::uniform_int_distribution<int> distPercent(0, 99);
+        for(double& speed : mSpeeds)
+        {
+            int value = distPercent(gen);
+            if(value < 25)
+                speed = 0.0;
+            else if(value < 35)
+                speed = 0.5;
+            else if(value < 40)
+                speed = 0.3;
+            else
+                speed = 1.0;
+        }
+    }
+
+    bool isPassable(int x, int y) const
+    {
+        if((x < 0) || (y < 0) || (x >= MAP_SIZE_X) || (y >= MAP_SIZE_Y))
+            return false;
+
+        return mSpeeds[x * MAP_SIZE_Y + y] > 0.0;
+    }
+
+    //! \brief Same weight as in GameMap::path: the distance divided by the speed on the tile the step starts from
+    float getStepCost(int x, int y, int nbSteps) const
+    {
+        return static_cast<float>(static_cast<double>(nbSteps) / mSpeeds[x * MAP_SIZE_Y + y]);
+    }
+
+    //! \brief Port of the search done by GameMap::path. Returns the cost of the path found (-1 if there is none)
+    double computePathCost(int x1, int y1, int x2, int y2)
+    {
+        mContext.resize(MAP_SIZE_X, MAP_SIZE_Y);
+        mContext.start(mContext.toNode(x1, y1), Pathfinding::manhattanDistance(x1, y1, x2, y2));
+        const int diffs[8][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {-1, 1}, {1, -1}, {1, 1} };
+        while(true)
+        {
+            int32_t currentNode = mContext.popBest();
+            if(currentNode == PathfindingContext::NO_NODE)
+                return -1.0;
+
+            int x = mContext.toX(currentNode);
+            int y = mContext.toY(currentNode);
+            if((x == x2) && (y == y2))
+                return mContext.getG(currentNode);
+
+            bool areTilesPassable[4] = {false, false, false, false};
+            for(int i = 0; i < 8; ++i)
+            {
+                if((i >= 4) && (!areTilesPassable[diffs[i][0] < 0 ? 0 : 1] || !areTilesPassable[diffs[i][1] < 0 ? 2 : 3]))
+                    continue;
+
+                int xx = x + diffs[i][0];
+                int yy = y + diffs[i][1];
+                if(!isPassable(xx, yy))
+                    continue;
+
+                if(i < 4)
+                    areTilesPassable[i] = true;
+
+                int32_t node = mContext.toNode(xx, yy);
+                if(mContext.isProcessed(node))
+                    continue;
+
+                double weightToParent = Pathfinding::manhattanDistance(xx, yy, x, y) / mSpeeds[x * MAP_SIZE_Y + y];
+                double g = mContext.getG(currentNode) + weightToParent;
+                if(!mContext.isVisited(node))
+                    mContext.open(node, currentNode, g, Pathfinding::manhattanDistance(xx, yy, x2, y2));
+                else if(g < mContext.getG(node))
+                    mContext.relax(node, currentNode, g);
+            }
+        }
+    }
+
+    std::vector<double> mSpeeds;
+    PathfindingContext mContext;
+};
+
+bool isClose(double value, double expected)
+{
+    return std::fabs(value - expected) <= 1e-4 * expected + 1e-4;
+}
+}
+
+BOOST_AUTO_TEST_CASE(test_SameCostAsPath)
+{
+    std::mt19937 gen(3);
+    SpeedMap map(gen);
+    FlowFieldBuilder builder;
+    std::vector<float> distances;
+    std::vector<int32_t> path;
+    std::uniform_int_distribution<int> distX(0, MAP_SIZE_X - 1);
+    std::uniform_int_distribution<int> distY(0, MAP_SIZE_Y - 1);
+    auto isPassable = [&map](int x, int y) { return map.isPassable(x, y); };
+    auto stepCost = [&map](int x, int y, int nbSteps) { return map.getStepCost(x, y, nbSteps); };
+
+    uint32_t nbDestinations = 0;
+    while(nbDestinations < 10)
+    {
+        int destinationX = distX(gen);
+        int destinationY = distY(gen);
+        if(!map.isPassable(destinationX, destinationY))
+            continue;
+
+        ++nbDestinations;
+        std::vector<uint32_t> nbPassableCalls(MAP_SIZE_X * MAP_SIZE_Y, 0);
+        builder.build(MAP_SIZE_X, MAP_SIZE_Y, destinationX, destinationY,
+            [&](int x, int y) { ++nbPassableCalls[x * MAP_SIZE_Y + y]; return map.isPassable(x, y); },
+            stepCost, distances);
+        for(uint32_t nbCalls : nbPassableCalls)
+            BOOST_REQUIRE(nbCalls <= 1);
+
+        for(int x = 0; x < MAP_SIZE_X; ++x)
+        {
+            for(int y = 0; y < MAP_SIZE_Y; ++y)
+            {
+                if(!map.isPassable(x, y))
+                    continue;
+
+                double expectedCost = map.computePathCost(x, y, destinationX, destinationY);
+                float distance = distances[x * MAP_SIZE_Y + y];
+                if(expectedCost < 0.0)
+                {
+                    BOOST_CHECK(distance == FlowFieldBuilder::NO_DISTANCE);
+                    BOOST_CHECK(!FlowFieldBuilder::readPath(MAP_SIZE_X, MAP_SIZE_Y, distances, x, y, destinationX,
+                        destinationY, isPassable, stepCost, 0, path));
+                    continue;
+                }
+
+                BOOST_REQUIRE(isClose(distance, expectedCost));
+
+                // The path read from the field is as cheap as the one found by GameMap::path and its steps
+                // are allowed by GameMap::path
+                BOOST_REQUIRE(FlowFieldBuilder::readPath(MAP_SIZE_X, MAP_SIZE_Y, distances, x, y, destinationX,
+                    destinationY, isPassable, stepCost, 0, path));
+                BOOST_REQUIRE(path.front() == x * MAP_SIZE_Y + y);
+                BOOST_REQUIRE(path.back() == destinationX * MAP_SIZE_Y + destinationY);
+                double pathCost = 0.0;
+                for(uint32_t i = 1; i < path.size(); ++i)
+                {
+                    int fromX = path[i - 1] / MAP_SIZE_Y;
+                    int fromY = path[i - 1] % MAP_SIZE_Y;
+                    int toX = path[i] / MAP_SIZE_Y;
+                    int toY = path[i] % MAP_SIZE_Y;
+                    BOOST_REQUIRE(map.isPassable(toX, toY));
+                    BOOST_REQUIRE((std::abs(toX - fromX) <= 1) && (std::abs(toY - fromY) <= 1));
+                    if((toX != fromX) && (toY != fromY))
+                        BOOST_REQUIRE(map.isPassable(toX, fromY) && map.isPassable(fromX, toY));
+
+                    pathCost += Pathfinding::manhattanDistance(fromX, fromY, toX, toY) / map.mSpeeds[path[i - 1]];
+                }
+                BOOST_REQUIRE(isClose(pathCost, expectedCost));
+
+                // The path can be cut
+                if(path.size() > 3)
+                {
+                    std::vector<int32_t> fullPath = path;
+                    BOOST_REQUIRE(FlowFieldBuilder::readPath(MAP_SIZE_X, MAP_SIZE_Y, distances, x, y, destinationX,
+                        destinationY, isPassable, stepCost, 3, path));
+                    BOOST_REQUIRE_EQUAL(path.size(), 3);
+                    BOOST_CHECK_EQUAL_COLLECTIONS(path.begin(), path.end(), fullPath.begin(), fullPath.begin() + 3);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,87 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE LevelSnapshot
+#include "BoostTestTargetConfig.h"
+
+#include "gamemap/LevelSnapshot.h"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+//! \brief Tile line as written by Tile::exportToStream followed by std::endl in the former writeGameMapToFile
+void writeReferenceTile(std::ostream& os, const CompiledLevel::TileRecord& record)
+{
+    os << record.mX << "\t" << record.mY << "\t";
+    os << static_cast<uint32_t>(record.mType) << "\t" << record.mFullness;
+    if(record.mSeatId != -1)
+        os << "\t" << record.mSeatId;
+
+    os << std::endl;
+}
+
+CompiledLevel::TileRecord makeRecord(int32_t x, int32_t y, int32_t type, int32_t seatId, double fullness)
+{
+    CompiledLevel::TileRecord record;
+    record.mX = x;
+    record.mY = y;
+    record.mType = type;
+    record.mSeatId = seatId;
+    record.mFullness = fullness;
+    return record;
+}
+}
+
+BOOST_AUTO_TEST_CASE(test_SnapshotBytesMatchFormerSave)
+{
+    LevelSnapshot snapshot;
+    snapshot.mBeforeTiles = "[Info]\nName\tTest\n[/Info]\n[Tiles]\n";
+    snapshot.mAfterTiles = "[/Tiles]\n[Rooms]\n[/Rooms]\n";
+    // Tiles without seat, claimed ones and fullness values that are not integers
+    snapshot.mTiles.push_back(makeRecord(0, 0, 4, -1, 100.0));
+    snapshot.mTiles.push_back(makeRecord(1, 0, 2, 1, 0.0));
+    snapshot.mTiles.push_back(makeRecord(2, 0, 3, -1, 37.5));
+    snapshot.mTiles.push_back(makeRecord(0, 1, 1, 2, 12.345678));
+    snapshot.mTiles.push_back(makeRecord(63, 127, 5, 0, 1.0 / 3.0));
+
+    std::ostringstream reference;
+    reference << snapshot.mBeforeTiles;
+    for(const CompiledLevel::TileRecord& record : snapshot.mTiles)
+        writeReferenceTile(reference, record);
+    reference << snapshot.mAfterTiles;
+
+    std::ostringstream written;
+    snapshot.writeToStream(written);
+
+    BOOST_CHECK_EQUAL(written.str(), reference.str());
+}
+
+BOOST_AUTO_TEST_CASE(test_EmptySnapshot)
+{
+    LevelSnapshot snapshot;
+    snapshot.mBeforeTiles = "[Tiles]\n";
+    snapshot.mAfterTiles = "[/Tiles]\n";
+
+    std::ostringstream written;
+    snapshot.writeToStream(written);
+
+    BOOST_CHECK_EQUAL(written.str(), "[Tiles]\n[/Tiles]\n");
+}
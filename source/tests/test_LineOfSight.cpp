@@ -0,0 +1,479 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE LineOfSight
+#include "BoostTestTargetConfig.h"
+
+#include "gamemap/LineOfSight.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+struct Grid
+{
+    int sizeX;
+    int sizeY;
+    std::vector<bool> opaque;
+
+    LineOfSight::CellState getState(int x, int y) const
+    {
+        if((x < 0) || (y < 0) || (x >= sizeX) || (y >= sizeY))
+            return LineOfSight::CellState::outside;
+        if(opaque[x * sizeY + y])
+            return LineOfSight::CellState::opaque;
+
+        return LineOfSight::CellState::transparent;
+    }
+};
+
+// The classes below are the per tile algorithm used before LineOfSight (from TileContainer::visibleTiles). They
+// only differ in working on a Grid. They check that LineOfSight sees the same tiles, in the same order
+class ReferenceTileDistance
+{
+public:
+    enum TileDistanceType
+    {
+        Horizontal,
+        Diagonal,
+        Other
+    };
+
+    ReferenceTileDistance(int diffX, int diffY, TileDistanceType type, int distSquared):
+        mDiffX(diffX),
+        mDiffY(diffY),
+        mType(type),
+        mDistSquared(distSquared)
+    {
+    }
+
+    inline int getDiffX() const
+    { return mDiffX; }
+
+    inline int getDiffY() const
+    { return mDiffY; }
+
+    inline TileDistanceType getType() const
+    { return mType; }
+
+    inline int getDistSquared() const
+    { return mDistSquared; }
+
+    void computeTileDistances(double coefNorth, double coefSouth, const ReferenceTileDistance& tileDistance,
+        uint32_t indexTileDistance)
+    {
+        if(tileDistance.getDiffX() < getDiffX())
+            return;
+        if(tileDistance.getDiffY() < getDiffY())
+            return;
+
+        if((tileDistance.getDiffX() == getDiffX()) &&
+           (tileDistance.getDiffY() == getDiffY()))
+        {
+            return;
+        }
+
+        if(getType() == TileDistanceType::Horizontal)
+        {
+            if(tileDistance.getType() == TileDistanceType::Horizontal)
+            {
+                addHiddenTileSouth(indexTileDistance, 1.0);
+                return;
+            }
+
+            double xTileDeb = static_cast<double>(tileDistance.getDiffX()) - 0.5;
+            double xTileEnd = xTileDeb + 1.0;
+            double yTileDeb = static_cast<double>(tileDistance.getDiffY()) - 0.5;
+            double yTileEnd = yTileDeb + 1.0;
+            double yHideDebNorth = coefNorth * xTileDeb;
+            double yHideEndNorth = coefNorth * xTileEnd;
+
+            if(yHideEndNorth <= yTileDeb)
+                return;
+
+            if((yHideDebNorth >= yTileDeb) &&
+               (yHideEndNorth <= yTileEnd))
+            {
+                double hiddenArea = (yHideEndNorth - yHideDebNorth) / 2.0;
+                hiddenArea += yHideDebNorth - yTileDeb;
+                addHiddenTileSouth(indexTileDistance, hiddenArea);
+            }
+            else if((yHideDebNorth < yTileDeb) &&
+                    (yHideEndNorth > yTileDeb))
+            {
+                double xHit = yTileDeb / coefNorth;
+                double hiddenArea = (yHideEndNorth - yTileDeb) * (xTileEnd - xHit) / 2.0;
+                addHiddenTileSouth(indexTileDistance, hiddenArea);
+            }
+            else if((yHideDebNorth < yTileEnd) &&
+                    (yHideEndNorth > yTileEnd))
+            {
+                double xHit = yTileEnd / coefNorth;
+                double visibleArea = (yTileEnd - yHideDebNorth) * (xHit - xTileDeb) / 2.0;
+                addHiddenTileSouth(indexTileDistance, 1.0 - visibleArea);
+            }
+            else
+            {
+                addHiddenTileSouth(indexTileDistance, 1.0);
+            }
+
+            return;
+        }
+
+        double xTileDeb = static_cast<double>(tileDistance.getDiffX()) - 0.5;
+        double xTileEnd = xTileDeb + 1.0;
+        double yTileDeb = static_cast<double>(tileDistance.getDiffY()) - 0.5;
+        double yTileEnd = yTileDeb + 1.0;
+
+        double yHideDebSouth = coefSouth * xTileDeb;
+        double yHideEndSouth = coefSouth * xTileEnd;
+        double yHideDebNorth = coefNorth * xTileDeb;
+        double yHideEndNorth = coefNorth * xTileEnd;
+        if((yHideDebSouth < yTileEnd) &&
+           (yHideEndNorth > yTileDeb))
+        {
+            if((yHideDebSouth >= yTileDeb) &&
+               (yHideEndSouth <= yTileEnd))
+            {
+                double visibleArea = (yHideEndSouth - yHideDebSouth) / 2.0;
+                visibleArea += yHideDebSouth - yTileDeb;
+                addHiddenTileNorth(indexTileDistance, 1.0 - visibleArea);
+            }
+            else if((yHideDebSouth < yTileDeb) &&
+                    (yHideEndSouth > yTileDeb))
+            {
+                double xHit = yTileDeb / coefSouth;
+                double visibleArea = (yHideEndSouth - yTileDeb) * (xTileEnd - xHit) / 2.0;
+                addHiddenTileNorth(indexTileDistance, 1.0 - visibleArea);
+            }
+            else if((yHideDebSouth < yTileEnd) &&
+                    (yHideEndSouth > yTileEnd))
+            {
+                double xHit = yTileEnd / coefSouth;
+                double hiddenArea = (yTileEnd - yHideDebSouth) * (xHit - xTileDeb) / 2.0;
+                addHiddenTileNorth(indexTileDistance, hiddenArea);
+            }
+            else if((yHideDebNorth >= yTileDeb) &&
+               (yHideEndNorth <= yTileEnd))
+            {
+                double hiddenArea = (yHideEndNorth - yHideDebNorth) / 2.0;
+                hiddenArea += yHideDebNorth - yTileDeb;
+                addHiddenTileSouth(indexTileDistance, hiddenArea);
+            }
+            else if((yHideDebNorth < yTileDeb) &&
+                    (yHideEndNorth > yTileDeb))
+            {
+                double xHit = yTileDeb / coefNorth;
+                double hiddenArea = (yHideEndNorth - yTileDeb) * (xTileEnd - xHit) / 2.0;
+                addHiddenTileSouth(indexTileDistance, hiddenArea);
+            }
+            else if((yHideDebNorth < yTileEnd) &&
+                    (yHideEndNorth > yTileEnd))
+            {
+                double xHit = yTileEnd / coefNorth;
+                double visibleArea = (yTileEnd - yHideDebNorth) * (xHit - xTileDeb) / 2.0;
+                addHiddenTileSouth(indexTileDistance, 1.0 - visibleArea);
+            }
+            else
+            {
+                addHiddenTileSouth(indexTileDistance, 1.0);
+            }
+        }
+    }
+
+    const std::vector<std::pair<uint32_t, double>>& getHiddenTilesNorth() const
+    { return mHiddenTilesNorth; }
+
+    const std::vector<std::pair<uint32_t, double>>& getHiddenTilesSouth() const
+    { return mHiddenTilesSouth; }
+
+private:
+    void addHiddenTileNorth(uint32_t indexTile, double hiddenPercent)
+    { mHiddenTilesNorth.push_back(std::pair<uint32_t, double>(indexTile, hiddenPercent)); }
+
+    void addHiddenTileSouth(uint32_t indexTile, double hiddenPercent)
+    { mHiddenTilesSouth.push_back(std::pair<uint32_t, double>(indexTile, hiddenPercent)); }
+
+    int mDiffX;
+    int mDiffY;
+    TileDistanceType mType;
+    int mDistSquared;
+    std::vector<std::pair<uint32_t, double>> mHiddenTilesNorth;
+    std::vector<std::pair<uint32_t, double>> mHiddenTilesSouth;
+};
+
+class ReferenceTileDistanceProcess
+{
+public:
+    ReferenceTileDistanceProcess(const ReferenceTileDistance& tileDistance, LineOfSight::CellState state):
+        mTileDistance(tileDistance),
+        mState(state),
+        mHiddenValueNorth(0.0),
+        mHiddenValueSouth(0.0)
+    {
+    }
+
+    inline const ReferenceTileDistance& getTileDistance() const
+    { return mTileDistance; }
+
+    void addHiddenValueNorth(double val)
+    {
+        if(val <= mHiddenValueNorth)
+            return;
+
+        mHiddenValueNorth = val;
+    }
+
+    void addHiddenValueSouth(double val)
+    {
+        if(val <= mHiddenValueSouth)
+            return;
+
+        mHiddenValueSouth = val;
+    }
+
+    inline bool isTileVisible() const
+    { return (mHiddenValueNorth + mHiddenValueSouth) <= 0.5; }
+
+    inline double getHiddenValueNorth() const
+    { return mHiddenValueNorth; }
+
+    inline double getHiddenValueSouth() const
+    { return mHiddenValueSouth; }
+
+    inline LineOfSight::CellState getState() const
+    { return mState; }
+
+private:
+    const ReferenceTileDistance& mTileDistance;
+    LineOfSight::CellState mState;
+    double mHiddenValueNorth;
+    double mHiddenValueSouth;
+};
+
+static bool sortReferenceByDistSquared(const ReferenceTileDistance& tileDist1, const ReferenceTileDistance& tileDist2)
+{
+    return tileDist1.getDistSquared() < tileDist2.getDistSquared();
+}
+
+//! \brief TileContainer::buildTileDistance before LineOfSight
+static std::vector<ReferenceTileDistance> referenceBuildTileDistance(int distance)
+{
+    std::vector<ReferenceTileDistance> tileDistances;
+    for(int y = 0; y <= distance; ++y)
+    {
+        for(int x = y; x <= distance; ++x)
+        {
+            ReferenceTileDistance::TileDistanceType type;
+            if(y == 0)
+                type = ReferenceTileDistance::TileDistanceType::Horizontal;
+            else if(x == y)
+                type = ReferenceTileDistance::TileDistanceType::Diagonal;
+            else
+                type = ReferenceTileDistance::TileDistanceType::Other;
+
+            tileDistances.push_back(ReferenceTileDistance(x, y, type, x * x + y * y));
+        }
+    }
+
+    std::sort(tileDistances.begin(), tileDistances.end(), sortReferenceByDistSquared);
+
+    for(ReferenceTileDistance& tileDistance : tileDistances)
+    {
+        if(tileDistance.getDiffX() == 0 && tileDistance.getDiffY() == 0)
+            continue;
+
+        double coefNorth = (static_cast<double>(tileDistance.getDiffY()) + 0.5) / (static_cast<double>(tileDistance.getDiffX()) - 0.5);
+        double coefSouth = (static_cast<double>(tileDistance.getDiffY()) - 0.5) / (static_cast<double>(tileDistance.getDiffX()) + 0.5);
+        for(uint32_t index = 0; index < tileDistances.size(); ++index)
+            tileDistance.computeTileDistances(coefNorth, coefSouth, tileDistances[index], index);
+    }
+
+    return tileDistances;
+}
+
+//! \brief TileContainer::visibleTiles before LineOfSight: the tiles outside the map were null tiles and the
+//! opaque ones did not permit vision
+static std::vector<std::pair<int, int>> referenceVisibleCells(const std::vector<ReferenceTileDistance>& tileDistances,
+    const Grid& grid, int x, int y, int radius)
+{
+    std::vector<std::pair<int, int>> returnList;
+    int radiusSquared = radius * radius;
+
+    // Same octant order as before: 514 / 2c0 / 637
+    const int octantOffsets[8][4] = {
+        { 1, 0, 0, 1 }, { 0, 1, -1, 0 }, { -1, 0, 0, -1 }, { 0, -1, 1, 0 },
+        { 0, 1, 1, 0 }, { 1, 0, 0, -1 }, { 0, -1, -1, 0 }, { -1, 0, 0, 1 } };
+    std::vector<ReferenceTileDistanceProcess> tilesProcess[8];
+    std::vector<std::pair<int, int>> positions[8];
+    for(uint32_t k = 0; k < 8; ++k)
+    {
+        for(const ReferenceTileDistance& tileDist : tileDistances)
+        {
+            if(tileDist.getDistSquared() > radiusSquared)
+                break;
+
+            const int* o = octantOffsets[k];
+            int tileX = x + o[0] * tileDist.getDiffX() + o[1] * tileDist.getDiffY();
+            int tileY = y + o[2] * tileDist.getDiffX() + o[3] * tileDist.getDiffY();
+            tilesProcess[k].push_back(ReferenceTileDistanceProcess(tileDist, grid.getState(tileX, tileY)));
+            positions[k].push_back(std::pair<int, int>(tileX, tileY));
+        }
+    }
+
+    for(uint32_t k = 0; k < 8; ++k)
+    {
+        for(ReferenceTileDistanceProcess& tileDistanceProcess : tilesProcess[k])
+        {
+            if(tileDistanceProcess.getState() != LineOfSight::CellState::opaque)
+                continue;
+
+            for(const std::pair<uint32_t, double>& p : tileDistanceProcess.getTileDistance().getHiddenTilesNorth())
+            {
+                if(p.first >= tilesProcess[k].size())
+                    continue;
+
+                tilesProcess[k][p.first].addHiddenValueNorth(p.second);
+            }
+            for(const std::pair<uint32_t, double>& p : tileDistanceProcess.getTileDistance().getHiddenTilesSouth())
+            {
+                if(p.first >= tilesProcess[k].size())
+                    continue;
+
+                tilesProcess[k][p.first].addHiddenValueSouth(p.second);
+            }
+        }
+    }
+
+    for(uint32_t i = 0; i < tilesProcess[0].size(); ++i)
+    {
+        for(uint32_t k = 0; k < 8; ++k)
+        {
+            ReferenceTileDistanceProcess& tileDistanceProcess = tilesProcess[k][i];
+            if(tileDistanceProcess.getState() == LineOfSight::CellState::outside)
+                continue;
+
+            if((k > 0) && (tileDistanceProcess.getTileDistance().getDistSquared() == 0))
+                continue;
+
+            if((tileDistanceProcess.getTileDistance().getType() != ReferenceTileDistance::TileDistanceType::Other) &&
+               (k > 3))
+            {
+                continue;
+            }
+
+            if(tileDistanceProcess.getTileDistance().getType() == ReferenceTileDistance::TileDistanceType::Diagonal)
+            {
+                ReferenceTileDistanceProcess& tileDistanceProcess2 = tilesProcess[k + 4][i];
+                tileDistanceProcess.addHiddenValueNorth(tileDistanceProcess2.getHiddenValueSouth());
+                tileDistanceProcess.addHiddenValueSouth(tileDistanceProcess2.getHiddenValueNorth());
+            }
+
+            if(!tileDistanceProcess.isTileVisible())
+                continue;
+
+            returnList.push_back(positions[k][i]);
+        }
+    }
+    return returnList;
+}
+
+BOOST_AUTO_TEST_CASE(test_LineOfSightEmptyMap)
+{
+    // Without any opaque cell, every cell within the radius is visible once
+    Grid grid = { 40, 40, std::vector<bool>(40 * 40, false) };
+    LineOfSight lineOfSight;
+    std::vector<std::pair<int, int>> cells;
+    lineOfSight.compute(10, [&grid](int diffX, int diffY) { return grid.getState(20 + diffX, 20 + diffY); },
+        [&cells](int diffX, int diffY) { cells.push_back(std::pair<int, int>(diffX, diffY)); });
+
+    uint32_t nbCells = 0;
+    for(int x = -10; x <= 10; ++x)
+    {
+        for(int y = -10; y <= 10; ++y)
+        {
+            if(x * x + y * y <= 100)
+                ++nbCells;
+        }
+    }
+    BOOST_CHECK(cells.size() == nbCells);
+    BOOST_CHECK((cells.front().first == 0) && (cells.front().second == 0));
+}
+
+BOOST_AUTO_TEST_CASE(test_LineOfSightReference)
+{
+    // We compare with the reference implementation on a random map with 300 creatures
+    std::srand(42);
+    Grid grid = { 100, 100, std::vector<bool>(100 * 100, false) };
+    for(uint32_t i = 0; i < grid.opaque.size(); ++i)
+        grid.opaque[i] = (std::rand() % 4 == 0);
+
+    std::vector<std::pair<int, int>> positions;
+    std::vector<int> radius;
+    for(uint32_t i = 0; i < 300; ++i)
+    {
+        positions.push_back(std::pair<int, int>(std::rand() % grid.sizeX, std::rand() % grid.sizeY));
+        radius.push_back(10 + std::rand() % 6);
+    }
+
+    LineOfSight lineOfSight;
+    lineOfSight.build(15);
+    const std::vector<ReferenceTileDistance> tileDistances = referenceBuildTileDistance(15);
+
+    std::vector<std::pair<int, int>> cells;
+    for(uint32_t i = 0; i < positions.size(); ++i)
+    {
+        int x = positions[i].first;
+        int y = positions[i].second;
+        cells.clear();
+        lineOfSight.compute(radius[i], [&grid, x, y](int diffX, int diffY) { return grid.getState(x + diffX, y + diffY); },
+            [&cells, x, y](int diffX, int diffY) { cells.push_back(std::pair<int, int>(x + diffX, y + diffY)); });
+        BOOST_CHECK(cells == referenceVisibleCells(tileDistances, grid, x, y, radius[i]));
+    }
+
+    // Timings are only given for information
+    const uint32_t nbTurns = 10;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(uint32_t turn = 0; turn < nbTurns; ++turn)
+    {
+        for(uint32_t i = 0; i < positions.size(); ++i)
+        {
+            int x = positions[i].first;
+            int y = positions[i].second;
+            cells.clear();
+            lineOfSight.compute(radius[i], [&grid, x, y](int diffX, int diffY) { return grid.getState(x + diffX, y + diffY); },
+                [&cells, x, y](int diffX, int diffY) { cells.push_back(std::pair<int, int>(x + diffX, y + diffY)); });
+        }
+    }
+    std::chrono::steady_clock::duration durationCompute = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for(uint32_t turn = 0; turn < nbTurns; ++turn)
+    {
+        for(uint32_t i = 0; i < positions.size(); ++i)
+            cells = referenceVisibleCells(tileDistances, grid, positions[i].first, positions[i].second, radius[i]);
+    }
+    std::chrono::steady_clock::duration durationReference = std::chrono::steady_clock::now() - start;
+
+    BOOST_TEST_MESSAGE("Line of sight for 300 creatures: compute="
+        << std::chrono::duration_cast<std::chrono::microseconds>(durationCompute).count() / nbTurns
+        << "us/turn, reference="
+        << std::chrono::duration_cast<std::chrono::microseconds>(durationReference).count() / nbTurns
+        << "us/turn");
+}
@@ -0,0 +1,180 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE NetworkSender
+#include "BoostTestTargetConfig.h"
+
+#include "network/NetworkSender.h"
+
+#include <SFML/Network.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace
+{
+//! \brief Two connected sockets on the local computer. Packets sent through mSending are received by mReceiving
+struct SocketPair
+{
+    SocketPair()
+    {
+        sf::TcpListener listener;
+        BOOST_REQUIRE(listener.listen(sf::Socket::AnyPort, sf::IpAddress::LocalHost) == sf::Socket::Done);
+        BOOST_REQUIRE(mSending.connect(sf::IpAddress::LocalHost, listener.getLocalPort()) == sf::Socket::Done);
+        BOOST_REQUIRE(listener.accept(mReceiving) == sf::Socket::Done);
+    }
+
+    sf::TcpSocket mSending;
+    sf::TcpSocket mReceiving;
+};
+
+//! \brief Pushes big packets without reading them until pushing fails or until the given number of bytes stays
+//! queued (0 to push until failure). Returns the number of bytes pushed
+uint64_t pushUnread(NetworkSender& sender, NetworkSender::Outbound& outbound, uint32_t queuedBytes)
+{
+    // The kernel buffers can hold a few MB before the frames stay in the queue
+    const uint64_t maxPushedBytes = 64 * static_cast<uint64_t>(NetworkSender::MAX_QUEUED_BYTES);
+    sf::Packet packet;
+    std::string data(64 * 1024, 'a');
+    packet << data;
+    uint64_t pushedBytes = 0;
+    while(pushedBytes < maxPushedBytes)
+    {
+        if((queuedBytes > 0) && (sender.getQueuedBytes(outbound) >= queuedBytes))
+        {
+            // The sending thread may not have filled the kernel buffers yet
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            if(sender.getQueuedBytes(outbound) >= queuedBytes)
+                break;
+        }
+
+        if(!sender.push(outbound, packet))
+            break;
+
+        pushedBytes += packet.getDataSize();
+    }
+    return pushedBytes;
+}
+}
+
+BOOST_AUTO_TEST_CASE(test_OrderedDelivery)
+{
+    SocketPair sockets;
+    NetworkSender sender;
+    BOOST_REQUIRE(sender.start());
+    std::shared_ptr<NetworkSender::Outbound> outbound = sender.attach(sockets.mSending);
+
+    // More data than the kernel buffers usually hold so that the frames are sent while they are read
+    const int32_t nbPackets = 2000;
+    for(int32_t i = 0; i < nbPackets; ++i)
+    {
+        sf::Packet packet;
+        packet << i << std::string(i % 1000, 'b');
+        BOOST_REQUIRE(sender.push(*outbound, packet));
+    }
+
+    bool isSame = true;
+    int32_t nbReceived = 0;
+    std::thread reader([&sockets, &isSame, &nbReceived, nbPackets]()
+    {
+        while(nbReceived < nbPackets)
+        {
+            sf::Packet packet;
+            if(sockets.mReceiving.receive(packet) != sf::Socket::Done)
+                break;
+
+            int32_t value = -1;
+            std::string str;
+            packet >> value >> str;
+            isSame = isSame && (value == nbReceived) && (str == std::string(nbReceived % 1000, 'b'));
+            ++nbReceived;
+        }
+    });
+
+    BOOST_CHECK(sender.flush(*outbound, std::chrono::steady_clock::now() + std::chrono::seconds(10)));
+    BOOST_CHECK_EQUAL(sender.getQueuedBytes(*outbound), 0);
+    reader.join();
+    BOOST_CHECK_EQUAL(nbReceived, nbPackets);
+    BOOST_CHECK(isSame);
+
+    sender.detach(outbound);
+    sender.stop();
+}
+
+BOOST_AUTO_TEST_CASE(test_QueueCap)
+{
+    SocketPair sockets;
+    NetworkSender sender;
+    BOOST_REQUIRE(sender.start());
+    std::shared_ptr<NetworkSender::Outbound> outbound = sender.attach(sockets.mSending);
+
+    // The client never reads. Once MAX_QUEUED_BYTES are waiting, pushing fails
+    uint64_t pushedBytes = pushUnread(sender, *outbound, 0);
+    BOOST_CHECK_GE(pushedBytes, NetworkSender::MAX_QUEUED_BYTES - 64 * 1024);
+    BOOST_CHECK_LT(pushedBytes, 64 * static_cast<uint64_t>(NetworkSender::MAX_QUEUED_BYTES));
+
+    // The queue has failed: its frames are dropped and nothing can be pushed anymore
+    BOOST_CHECK_EQUAL(sender.getQueuedBytes(*outbound), 0);
+    sf::Packet packet;
+    packet << static_cast<int32_t>(1);
+    BOOST_CHECK(!sender.push(*outbound, packet));
+    BOOST_CHECK(!sender.flush(*outbound, std::chrono::steady_clock::now()));
+
+    sender.detach(outbound);
+    sender.stop();
+}
+
+BOOST_AUTO_TEST_CASE(test_DetachWithPendingFrames)
+{
+    SocketPair sockets;
+    NetworkSender sender;
+    BOOST_REQUIRE(sender.start());
+    std::shared_ptr<NetworkSender::Outbound> outbound = sender.attach(sockets.mSending);
+
+    const uint32_t queuedBytes = NetworkSender::MAX_QUEUED_BYTES / 4;
+    pushUnread(sender, *outbound, queuedBytes);
+    BOOST_REQUIRE_GE(sender.getQueuedBytes(*outbound), queuedBytes);
+
+    // The client cannot read fast enough: flushing gives up at the deadline
+    BOOST_CHECK(!sender.flush(*outbound, std::chrono::steady_clock::now() + std::chrono::milliseconds(50)));
+
+    // Detaching drops the pending frames. The socket is not used anymore so it can be closed
+    sender.detach(outbound);
+    BOOST_CHECK_EQUAL(sender.getQueuedBytes(*outbound), 0);
+    sockets.mSending.disconnect();
+
+    sf::Packet packet;
+    packet << static_cast<int32_t>(1);
+    BOOST_CHECK(!sender.push(*outbound, packet));
+    BOOST_CHECK(!sender.flush(*outbound, std::chrono::steady_clock::now()));
+
+    // The other queues are still served
+    SocketPair otherSockets;
+    std::shared_ptr<NetworkSender::Outbound> otherOutbound = sender.attach(otherSockets.mSending);
+    BOOST_CHECK(sender.push(*otherOutbound, packet));
+    BOOST_CHECK(sender.flush(*otherOutbound, std::chrono::steady_clock::now() + std::chrono::seconds(10)));
+    sf::Packet received;
+    BOOST_REQUIRE(otherSockets.mReceiving.receive(received) == sf::Socket::Done);
+    int32_t value = 0;
+    received >> value;
+    BOOST_CHECK_EQUAL(value, 1);
+
+    sender.detach(otherOutbound);
+    sender.stop();
+}
@@ -53,4 +53,81 @@ BOOST_AUTO_TEST_CASE(test_ODPacket)
         BOOST_CHECK(inInt == outInt);
 
     }
+    //Test packets appended in another one
+    {
+        ODPacket packet1;
+        ODPacket packet2;
+        const int32_t inInt = 12;
+        const std::string inString("test");
+        packet1 << inInt;
+        packet2 << inString;
+
+        ODPacket batch;
+        batch.appendPacket(packet1);
+        batch.appendPacket(packet2);
+
+        ODPacket outPacket;
+        int32_t outInt = 0;
+        std::string outString;
+        BOOST_CHECK(batch.extractPacket(outPacket));
+        outPacket >> outInt;
+        BOOST_CHECK(outInt == inInt);
+        BOOST_CHECK(outPacket.isEndOfPacket());
+        BOOST_CHECK(batch.extractPacket(outPacket));
+        outPacket >> outString;
+        BOOST_CHECK(inString.compare(outString) == 0);
+        BOOST_CHECK(!batch.extractPacket(outPacket));
+    }
+    //Test network frames (compressed or not)
+    for(bool compress : { false, true })
+    {
+        ODPacket packet;
+        for(int32_t i = 0; i < 1000; ++i)
+            packet << i % 10;
+
+        ODPacket frame;
+        ODPacket::encodeFrame(packet, compress, frame);
+
+        ODPacket outPacket;
+        BOOST_CHECK(ODPacket::decodeFrame(frame, outPacket));
+        bool isSame = true;
+        for(int32_t i = 0; i < 1000; ++i)
+        {
+            int32_t outInt = -1;
+            outPacket >> outInt;
+            isSame = isSame && (outInt == i % 10);
+        }
+        BOOST_CHECK(isSame);
+        BOOST_CHECK(outPacket.isEndOfPacket());
+    }
+    //Test corrupted network frames
+    {
+        const uint8_t compressedFlag = 1;
+        ODPacket outPacket;
+
+        // Uncompressed size bigger than any frame
+        ODPacket oversized;
+        oversized << compressedFlag << static_cast<uint32_t>(0xFFFFFFFF);
+        for(int32_t i = 0; i < 1000; ++i)
+            oversized << i;
+        BOOST_CHECK(!ODPacket::decodeFrame(oversized, outPacket));
+
+        // Uncompressed size that cannot come from so few compressed bytes
+        ODPacket tooSmall;
+        tooSmall << compressedFlag << static_cast<uint32_t>(1024 * 1024);
+        tooSmall << static_cast<int32_t>(0);
+        BOOST_CHECK(!ODPacket::decodeFrame(tooSmall, outPacket));
+
+        // Plausible size but the data cannot be uncompressed
+        ODPacket garbage;
+        garbage << compressedFlag << static_cast<uint32_t>(1000);
+        for(int32_t i = 0; i < 10; ++i)
+            garbage << static_cast<int32_t>(-1);
+        BOOST_CHECK(!ODPacket::decodeFrame(garbage, outPacket));
+
+        // Truncated header
+        ODPacket truncated;
+        truncated << compressedFlag << static_cast<uint16_t>(12);
+        BOOST_CHECK(!ODPacket::decodeFrame(truncated, outPacket));
+    }
 }
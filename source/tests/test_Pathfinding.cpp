@@ -19,6 +19,7 @@
 #include "BoostTestTargetConfig.h"
 
 #include "gamemap/Pathfinding.h"
+#include "gamemap/PathfindingContext.h"
 
 struct Point
 {
@@ -39,3 +40,33 @@ BOOST_AUTO_TEST_CASE(test_Pathfinding)
     BOOST_CHECK((Pathfinding::distanceTile(a, b) - std::sqrt(128.0f)) < 0.0001f);
     BOOST_CHECK(Pathfinding::squaredDistance(9,1,1,9) == 128);
 }
+
+BOOST_AUTO_TEST_CASE(test_PathfindingContext)
+{
+    PathfindingContext context;
+    context.resize(4, 4);
+
+    // Nodes with the same cost are processed in insertion order
+    context.start(context.toNode(0, 0), 2.0);
+    BOOST_CHECK(context.popBest() == context.toNode(0, 0));
+    BOOST_CHECK(context.isProcessed(context.toNode(0, 0)));
+    context.open(context.toNode(1, 0), context.toNode(0, 0), 1.0, 1.0);
+    context.open(context.toNode(0, 1), context.toNode(0, 0), 1.0, 1.0);
+    context.open(context.toNode(2, 2), context.toNode(0, 0), 1.0, 1.5);
+    BOOST_CHECK(context.isVisited(context.toNode(2, 2)));
+    BOOST_CHECK(!context.isProcessed(context.toNode(2, 2)));
+
+    // A node whose cost is lowered below the others is processed first
+    context.relax(context.toNode(2, 2), context.toNode(1, 0), 0.25);
+    BOOST_CHECK(context.getParent(context.toNode(2, 2)) == context.toNode(1, 0));
+    BOOST_CHECK(context.popBest() == context.toNode(2, 2));
+    BOOST_CHECK(context.popBest() == context.toNode(1, 0));
+    BOOST_CHECK(context.popBest() == context.toNode(0, 1));
+    BOOST_CHECK(context.popBest() == PathfindingContext::NO_NODE);
+
+    // Starting a new search forgets the previous one
+    context.start(context.toNode(3, 3), 0.0);
+    BOOST_CHECK(!context.isVisited(context.toNode(2, 2)));
+    BOOST_CHECK(context.toX(context.toNode(3, 1)) == 3);
+    BOOST_CHECK(context.toY(context.toNode(3, 1)) == 1);
+}
@@ -0,0 +1,300 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE PathfindingHierarchy
+#include "BoostTestTargetConfig.h"
+
+#include "entities/Tile.h"
+#include "gamemap/Pathfinding.h"
+#include "gamemap/PathfindingContext.h"
+#include "gamemap/PathfindingHierarchy.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace
+{
+const int MAP_SIZE_X = 96;
+const int MAP_SIZE_Y = 80;
+//! \brief Same value as Tile::NO_FLOODFILL (Tile.cpp is not linked)
+const uint32_t NO_FLOODFILL = 0;
+
+//! \brief Map with walls. The floodfill value of a walkable tile is its connected area (starting from 1)
+class TestMap : public PathfindingHierarchy::FloodFillSource
+{
+public:
+    explicit TestMap(std::mt19937& gen) :
+        mWalls(MAP_SIZE_X * MAP_SIZE_Y, false)
+    {
+        std::uniform_int_distribution<int> distPercent(0, 99);
+        std::uniform_int_distribution<int> distX(0, MAP_SIZE_X - 1);
+        std::uniform_int_distribution<int> distY(0, MAP_SIZE_Y - 1);
+        for(int i = 0; i < MAP_SIZE_X * MAP_SIZE_Y; ++i)
+            mWalls[i] = (distPercent(gen) < 25);
+
+        // Long walls with a few holes make the routes go around
+        for(int k = 0; k < 10; ++k)
+        {
+            int x = distX(gen);
+            int y = distY(gen);
+            bool horizontal = (distPercent(gen) < 50);
+            for(int i = 0; i < 40; ++i)
+            {
+                int xx = horizontal ? x + i : x;
+                int yy = horizontal ? y : y + i;
+                if((xx >= MAP_SIZE_X) || (yy >= MAP_SIZE_Y))
+                    break;
+                mWalls[xx * MAP_SIZE_Y + yy] = (distPercent(gen) < 95);
+            }
+        }
+        computeFloodFill();
+    }
+
+    //! \brief computeFloodFill should be called once the walls are set
+    void setWall(int x, int y, bool isWall)
+    {
+        mWalls[x * MAP_SIZE_Y + y] = isWall;
+    }
+
+    void computeFloodFill()
+    {
+        mFloodFill.assign(MAP_SIZE_X * MAP_SIZE_Y, NO_FLOODFILL);
+        uint32_t nextValue = 1;
+        std::vector<int32_t> queue;
+        for(int32_t i = 0; i < MAP_SIZE_X * MAP_SIZE_Y; ++i)
+        {
+            if(mWalls[i] || (mFloodFill[i] != NO_FLOODFILL))
+                continue;
+
+            mFloodFill[i] = nextValue;
+            queue.assign(1, i);
+            for(uint32_t k = 0; k < queue.size(); ++k)
+            {
+                int x = queue[k] / MAP_SIZE_Y;
+                int y = queue[k] % MAP_SIZE_Y;
+                const int diffs[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+                for(const int* diff : diffs)
+                {
+                    int xx = x + diff[0];
+                    int yy = y + diff[1];
+                    if((xx < 0) || (yy < 0) || (xx >= MAP_SIZE_X) || (yy >= MAP_SIZE_Y))
+                        continue;
+
+                    int32_t index = xx * MAP_SIZE_Y + yy;
+                    if(mWalls[index] || (mFloodFill[index] != NO_FLOODFILL))
+                        continue;
+
+                    mFloodFill[index] = nextValue;
+                    queue.push_back(index);
+                }
+            }
+            ++nextValue;
+        }
+    }
+
+    uint32_t getFloodFillValue(int x, int y, Seat*, FloodFillType) const override
+    {
+        if((x < 0) || (y < 0) || (x >= MAP_SIZE_X) || (y >= MAP_SIZE_Y))
+            return NO_FLOODFILL;
+
+        return mFloodFill[x * MAP_SIZE_Y + y];
+    }
+
+    bool isWalkable(int x, int y) const
+    {
+        return getFloodFillValue(x, y, nullptr, FloodFillType::ground) != NO_FLOODFILL;
+    }
+
+    //! \brief Cost of the path GameMap::path finds for a creature walking at speed 1. -1 if there is none
+    double computePathCost(int x1, int y1, int x2, int y2)
+    {
+        mContext.resize(MAP_SIZE_X, MAP_SIZE_Y);
+        mContext.start(mContext.toNode(x1, y1), Pathfinding::manhattanDistance(x1, y1, x2, y2));
+        const int diffs[8][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {-1, 1}, {1, -1}, {1, 1} };
+        while(true)
+        {
+            int32_t currentNode = mContext.popBest();
+            if(currentNode == PathfindingContext::NO_NODE)
+                return -1.0;
+
+            int x = mContext.toX(currentNode);
+            int y = mContext.toY(currentNode);
+            if((x == x2) && (y == y2))
+                return mContext.getG(currentNode);
+
+            bool areTilesPassable[4] = {false, false, false, false};
+            for(int i = 0; i < 8; ++i)
+            {
+                if((i >= 4) && (!areTilesPassable[diffs[i][0] < 0 ? 0 : 1] || !areTilesPassable[diffs[i][1] < 0 ? 2 : 3]))
+                    continue;
+
+                int xx = x + diffs[i][0];
+                int yy = y + diffs[i][1];
+                if(!isWalkable(xx, yy))
+                    continue;
+
+                if(i < 4)
+                    areTilesPassable[i] = true;
+
+                int32_t node = mContext.toNode(xx, yy);
+                if(mContext.isProcessed(node))
+                    continue;
+
+                double g = mContext.getG(currentNode) + Pathfinding::manhattanDistance(x, y, xx, yy);
+                if(!mContext.isVisited(node))
+                    mContext.open(node, currentNode, g, Pathfinding::manhattanDistance(xx, yy, x2, y2));
+                else if(g < mContext.getG(node))
+                    mContext.relax(node, currentNode, g);
+            }
+        }
+    }
+
+private:
+    std::vector<bool> mWalls;
+    std::vector<uint32_t> mFloodFill;
+    PathfindingContext mContext;
+
+};
+
+//! \brief Walks from start to destination by following the legs given by the hierarchy (like GameMap::path does
+//! for long routes). Returns the cost of the route or -1 if the hierarchy did not find any
+double followRoute(PathfindingHierarchy& hierarchy, TestMap& map, int x, int y, int destinationX, int destinationY)
+{
+    double cost = 0.0;
+    for(int nbLegs = 0; nbLegs < MAP_SIZE_X * MAP_SIZE_Y; ++nbLegs)
+    {
+        int legX;
+        int legY;
+        if(!hierarchy.findFirstLegTile(nullptr, 0, FloodFillType::ground, x, y, destinationX, destinationY, legX, legY) ||
+           ((legX == destinationX) && (legY == destinationY)))
+        {
+            break;
+        }
+
+        // The leg tile is reachable and the route goes on from there
+        double legCost = map.computePathCost(x, y, legX, legY);
+        BOOST_REQUIRE(legCost > 0.0);
+        cost += legCost;
+        x = legX;
+        y = legY;
+    }
+
+    double lastCost = map.computePathCost(x, y, destinationX, destinationY);
+    BOOST_REQUIRE(lastCost >= 0.0);
+    return cost + lastCost;
+}
+}
+
+BOOST_AUTO_TEST_CASE(test_RouteCost)
+{
+    std::mt19937 gen(11);
+    TestMap map(gen);
+    PathfindingHierarchy hierarchy(map);
+    hierarchy.resize(MAP_SIZE_X, MAP_SIZE_Y);
+
+    std::uniform_int_distribution<int> distX(0, MAP_SIZE_X - 1);
+    std::uniform_int_distribution<int> distY(0, MAP_SIZE_Y - 1);
+    uint32_t nbRoutes = 0;
+    uint32_t nbFallbacks = 0;
+    double totalCost = 0.0;
+    double totalOptimalCost = 0.0;
+    while(nbRoutes < 200)
+    {
+        int x1 = distX(gen);
+        int y1 = distY(gen);
+        int x2 = distX(gen);
+        int y2 = distY(gen);
+        if(!map.isWalkable(x1, y1) || !map.isWalkable(x2, y2))
+            continue;
+
+        if(Pathfinding::manhattanDistance(x1, y1, x2, y2) < PathfindingHierarchy::MIN_DISTANCE)
+            continue;
+
+        int legX;
+        int legY;
+        bool isFound = hierarchy.findFirstLegTile(nullptr, 0, FloodFillType::ground, x1, y1, x2, y2, legX, legY);
+        double optimalCost = map.computePathCost(x1, y1, x2, y2);
+        if(optimalCost < 0.0)
+        {
+            // No route is found between unconnected tiles
+            BOOST_CHECK(!isFound);
+            continue;
+        }
+
+        ++nbRoutes;
+        if(!isFound)
+        {
+            // GameMap::path uses the plain A* in this case
+            ++nbFallbacks;
+            continue;
+        }
+
+        // The leg is on the way: the route through it cannot be shorter than the optimal one
+        double costToLeg = map.computePathCost(x1, y1, legX, legY);
+        double costFromLeg = map.computePathCost(legX, legY, x2, y2);
+        BOOST_REQUIRE((costToLeg >= 0.0) && (costFromLeg >= 0.0));
+        BOOST_CHECK(costToLeg + costFromLeg >= optimalCost);
+
+        double cost = followRoute(hierarchy, map, x1, y1, x2, y2);
+        BOOST_CHECK(cost >= optimalCost);
+        // Each route can be longer than the optimal one because the entrances are in the middle of the borders
+        BOOST_CHECK(cost <= optimalCost * 1.5 + 2 * PathfindingHierarchy::SECTOR_SIZE);
+        totalCost += cost;
+        totalOptimalCost += optimalCost;
+    }
+
+    BOOST_TEST_MESSAGE("Routes=" << nbRoutes << ", fallbacks=" << nbFallbacks << ", cost ratio="
+        << (totalCost / totalOptimalCost));
+    // The hierarchy finds most of the routes and they are close to the optimal ones overall
+    BOOST_CHECK(nbFallbacks * 10 <= nbRoutes);
+    BOOST_CHECK(totalCost <= totalOptimalCost * 1.15);
+}
+
+BOOST_AUTO_TEST_CASE(test_InvalidateTile)
+{
+    std::mt19937 gen(5);
+    TestMap map(gen);
+    // We build an empty map split in 2 by a wall with one hole
+    for(int x = 0; x < MAP_SIZE_X; ++x)
+    {
+        for(int y = 0; y < MAP_SIZE_Y; ++y)
+            map.setWall(x, y, (x == 40) && (y != 20));
+    }
+    map.computeFloodFill();
+
+    PathfindingHierarchy hierarchy(map);
+    hierarchy.resize(MAP_SIZE_X, MAP_SIZE_Y);
+    int legX;
+    int legY;
+    BOOST_REQUIRE(hierarchy.findFirstLegTile(nullptr, 0, FloodFillType::ground, 5, 70, 90, 70, legX, legY));
+    BOOST_CHECK_EQUAL(followRoute(hierarchy, map, 5, 70, 90, 70), map.computePathCost(5, 70, 90, 70));
+
+    // Once the hole is closed, the sectors around are rebuilt and no route is found
+    map.setWall(40, 20, true);
+    map.computeFloodFill();
+    hierarchy.invalidateTile(40, 20);
+    BOOST_CHECK(!hierarchy.findFirstLegTile(nullptr, 0, FloodFillType::ground, 5, 70, 90, 70, legX, legY));
+
+    // Another hole
+    map.setWall(40, 75, false);
+    map.computeFloodFill();
+    hierarchy.invalidateTile(40, 75);
+    BOOST_REQUIRE(hierarchy.findFirstLegTile(nullptr, 0, FloodFillType::ground, 5, 70, 90, 70, legX, legY));
+    BOOST_CHECK(legX <= 40);
+    BOOST_CHECK_EQUAL(followRoute(hierarchy, map, 5, 70, 90, 70), map.computePathCost(5, 70, 90, 70));
+}
@@ -16,6 +16,7 @@
  */
 
 #include "utils/Random.h"
+#include "utils/RandomGenerator.h"
 
 #define BOOST_TEST_MODULE Random
 #include "BoostTestTargetConfig.h"
@@ -25,3 +26,33 @@ BOOST_AUTO_TEST_CASE(test_Random)
     Random::initialize();
     BOOST_CHECK (Random::Int(1, 2 ) <= 2);
 }
+
+BOOST_AUTO_TEST_CASE(test_RandomGenerator)
+{
+    // The same seed gives the same sequence
+    RandomGenerator generator1(42);
+    RandomGenerator generator2(42);
+    for(int i = 0; i < 100; ++i)
+        BOOST_CHECK(generator1.next() == generator2.next());
+
+    // A derived substream does not depend on what was drawn from its parent
+    RandomGenerator derived1 = generator1.derive(10, 3);
+    RandomGenerator derived2 = RandomGenerator(42).derive(10, 3);
+    BOOST_CHECK(derived1.next() == derived2.next());
+    BOOST_CHECK(generator1.derive(10, 4).next() != derived1.next());
+
+    // The Random functions draw from the generator bound to the thread
+    RandomGenerator bound(7);
+    RandomGenerator reference(7);
+    {
+        Random::ScopedThreadGenerator scopedRandom(bound);
+        BOOST_CHECK(Random::Int(0, 1000000) == reference.Int(0, 1000000));
+    }
+    BOOST_CHECK(Random::getThreadGenerator() == nullptr);
+
+    for(int i = 0; i < 1000; ++i)
+    {
+        int value = bound.Int(-3, 5);
+        BOOST_CHECK(value >= -3 && value <= 5);
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE ReplayRecorder
+#include "BoostTestTargetConfig.h"
+
+#include "network/ODPacket.h"
+#include "network/ReplayReader.h"
+#include "network/ReplayRecorder.h"
+
+#include <boost/filesystem.hpp>
+
+BOOST_AUTO_TEST_CASE(test_ReplayRecorder)
+{
+    const std::string filename = (boost::filesystem::temp_directory_path() / "test_ReplayRecorder.odr").string();
+
+    // We record more packets than the ring can contain to check none is lost
+    const int32_t nbPackets = 5000;
+    ReplayRecorder recorder;
+    BOOST_REQUIRE(recorder.start(filename));
+    for(int32_t i = 0; i < nbPackets; ++i)
+    {
+        ODPacket packet;
+        packet << i << std::string(i % 100, 'a');
+        recorder.record(i * 10, i / 10, packet);
+    }
+    recorder.stop();
+
+    ReplayReader reader;
+    BOOST_REQUIRE(reader.open(filename));
+    bool isSame = true;
+    int32_t nbRead = 0;
+    ODPacket packet;
+    while(true)
+    {
+        int32_t timestamp = reader.readPacket(packet);
+        if(timestamp < 0)
+            break;
+
+        int32_t value = -1;
+        std::string str;
+        packet >> value >> str;
+        isSame = isSame && (timestamp == nbRead * 10) && (value == nbRead) && (str == std::string(nbRead % 100, 'a'));
+        ++nbRead;
+    }
+    BOOST_CHECK(isSame);
+    BOOST_CHECK(nbRead == nbPackets);
+
+    // The replay is big enough to have several chunks. A turn should be found at the beginning of the chunk
+    // containing it
+    BOOST_REQUIRE(reader.getIndex().size() > 1);
+    const ReplayReader::IndexEntry entry = reader.getIndex().back();
+    const uint32_t nbChunks = static_cast<uint32_t>(reader.getIndex().size());
+    BOOST_CHECK(reader.getTurnTimestamp(entry.mTurn + 1) == entry.mTimestamp);
+    BOOST_CHECK(reader.getTurnTimestamp(-5) == -1);
+    reader.close();
+
+    // If the game stops before the replay is closed, there is no index. The packets should still be read
+    // (index: number of entries, entries, index offset and magic)
+    const uintmax_t indexSize = sizeof(uint32_t) + nbChunks * (sizeof(int32_t) + sizeof(int64_t) + sizeof(uint64_t))
+        + sizeof(uint64_t) + sizeof(uint32_t);
+    boost::filesystem::resize_file(filename, boost::filesystem::file_size(filename) - indexSize);
+    BOOST_REQUIRE(reader.open(filename));
+    // This is the replay --reindexreplay can index
+    BOOST_CHECK(reader.getVersion() == ReplayReader::VERSION);
+    BOOST_CHECK(reader.getIndex().empty());
+    BOOST_CHECK(reader.getTurnTimestamp(entry.mTurn + 1) == -1);
+    nbRead = 0;
+    while(reader.readPacket(packet) >= 0)
+        ++nbRead;
+    BOOST_CHECK(nbRead == nbPackets);
+    reader.close();
+
+    // If the last chunk is incomplete, the packets of the previous chunks should be read
+    boost::filesystem::resize_file(filename, boost::filesystem::file_size(filename) - 10);
+    BOOST_REQUIRE(reader.open(filename));
+    isSame = true;
+    nbRead = 0;
+    while(true)
+    {
+        int32_t timestamp = reader.readPacket(packet);
+        if(timestamp < 0)
+            break;
+
+        int32_t value = -1;
+        packet >> value;
+        isSame = isSame && (value == nbRead);
+        ++nbRead;
+    }
+    BOOST_CHECK(isSame);
+    BOOST_CHECK(nbRead * 10 == entry.mTimestamp);
+    reader.close();
+
+    boost::filesystem::remove(filename);
+}
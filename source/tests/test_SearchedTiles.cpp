@@ -0,0 +1,236 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE SearchedTiles
+#include "BoostTestTargetConfig.h"
+
+#include "gamemap/SearchedTiles.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace
+{
+const int MAP_SIZE_X = 40;
+const int MAP_SIZE_Y = 25;
+const int CELL_SIZE = 8;
+const int NB_TEAMS = 3;
+const int NO_BUILDING = -1;
+
+//! \brief Simplified entity: creatures are on one tile, buildings cover several tiles
+struct TestEntity
+{
+    int mId;
+    int mTeam;
+    bool mIsAlive;
+    bool mIsAttackable;
+};
+
+//! \brief Map where each tile has a list of creatures and may be covered by a building. The entities
+//! are also sorted in cells by team like EntityGrid does (in an order unrelated to the tiles)
+struct EntityMap
+{
+    explicit EntityMap(std::mt19937& gen) :
+        mTileCreatures(MAP_SIZE_X * MAP_SIZE_Y),
+        mTileBuilding(MAP_SIZE_X * MAP_SIZE_Y, NO_BUILDING),
+        mCellTiles(((MAP_SIZE_X + CELL_SIZE - 1) / CELL_SIZE) * ((MAP_SIZE_Y + CELL_SIZE - 1) / CELL_SIZE) * NB_TEAMS)
+    {
+        std::uniform_int_distribution<int> distX(0, MAP_SIZE_X - 1);
+        std::uniform_int_distribution<int> distY(0, MAP_SIZE_Y - 1);
+        std::uniform_int_distribution<int> distTeam(0, NB_TEAMS - 1);
+        std::uniform_int_distribution<int> distPercent(0, 99);
+        int nextId = 0;
+        for(int i = 0; i < 150; ++i)
+        {
+            TestEntity creature = { nextId++, distTeam(gen), distPercent(gen) < 80, distPercent(gen) < 80 };
+            mEntities.push_back(creature);
+            int x = distX(gen);
+            int y = distY(gen);
+            mTileCreatures[x * MAP_SIZE_Y + y].push_back(creature.mId);
+            addToCell(x, y, creature.mTeam);
+        }
+        for(int i = 0; i < 12; ++i)
+        {
+            TestEntity building = { nextId++, distTeam(gen), true, distPercent(gen) < 80 };
+            mEntities.push_back(building);
+            int x = distX(gen);
+            int y = distY(gen);
+            for(int xxx = x; xxx < std::min(x + 3, MAP_SIZE_X); ++xxx)
+            {
+                for(int yyy = y; yyy < std::min(y + 3, MAP_SIZE_Y); ++yyy)
+                {
+                    if(mTileBuilding[xxx * MAP_SIZE_Y + yyy] != NO_BUILDING)
+                        continue;
+
+                    mTileBuilding[xxx * MAP_SIZE_Y + yyy] = building.mId;
+                    addToCell(xxx, yyy, building.mTeam);
+                }
+            }
+        }
+        for(std::vector<int>& tiles : mCellTiles)
+            std::shuffle(tiles.begin(), tiles.end(), gen);
+    }
+
+    void addToCell(int x, int y, int team)
+    {
+        int nbCellsY = (MAP_SIZE_Y + CELL_SIZE - 1) / CELL_SIZE;
+        mCellTiles[((x / CELL_SIZE) * nbCellsY + (y / CELL_SIZE)) * NB_TEAMS + team].push_back(x * MAP_SIZE_Y + y);
+    }
+
+    //! \brief Appends the wanted entities of the given tile, in the order of the former per tile scan
+    void fillFromTile(int tileIndex, int team, bool enemies, std::vector<int>& entities) const
+    {
+        for(int id : mTileCreatures[tileIndex])
+        {
+            const TestEntity& creature = mEntities[id];
+            if((creature.mTeam == team) == enemies)
+                continue;
+            if(!creature.mIsAlive)
+                continue;
+            if(enemies && !creature.mIsAttackable)
+                continue;
+            entities.push_back(id);
+        }
+        int buildingId = mTileBuilding[tileIndex];
+        if(buildingId == NO_BUILDING)
+            return;
+        const TestEntity& building = mEntities[buildingId];
+        if((building.mTeam == team) == enemies)
+            return;
+        if(enemies && !building.mIsAttackable)
+            return;
+        if(std::find(entities.begin(), entities.end(), buildingId) != entities.end())
+            return;
+        entities.push_back(buildingId);
+    }
+
+    //! \brief Former tile scan: each tile is checked in the given order
+    std::vector<int> scanTiles(const std::vector<int>& tiles, int team, bool enemies) const
+    {
+        std::vector<int> entities;
+        for(int tileIndex : tiles)
+        {
+            // The same tile can be given twice. It is read once
+            std::vector<int> tileEntities;
+            fillFromTile(tileIndex, team, enemies, tileEntities);
+            for(int id : tileEntities)
+            {
+                if(std::find(entities.begin(), entities.end(), id) == entities.end())
+                    entities.push_back(id);
+            }
+        }
+        return entities;
+    }
+
+    //! \brief Search like EntityGrid::getEntities: the cells are used to find the tiles with wanted entities
+    std::vector<int> searchCells(SearchedTiles& searchedTiles, const std::vector<int>& tiles, int team,
+        bool enemies) const
+    {
+        searchedTiles.start(MAP_SIZE_X, MAP_SIZE_Y);
+        for(uint32_t order = 0; order < tiles.size(); ++order)
+            searchedTiles.add(tiles[order] / MAP_SIZE_Y, tiles[order] % MAP_SIZE_Y, order);
+
+        for(uint32_t cell = 0; cell < mCellTiles.size(); ++cell)
+        {
+            int cellTeam = static_cast<int>(cell % NB_TEAMS);
+            if((cellTeam == team) == enemies)
+                continue;
+
+            for(int tileIndex : mCellTiles[cell])
+            {
+                int x = tileIndex / MAP_SIZE_Y;
+                int y = tileIndex % MAP_SIZE_Y;
+                if(searchedTiles.isSearched(x, y))
+                    searchedTiles.found(x, y);
+            }
+        }
+
+        std::vector<int> entities;
+        for(uint32_t order : searchedTiles.getFoundOrders())
+            fillFromTile(tiles[order], team, enemies, entities);
+
+        return entities;
+    }
+
+    std::vector<TestEntity> mEntities;
+    std::vector<std::vector<int>> mTileCreatures;
+    std::vector<int> mTileBuilding;
+    //! \brief Tiles having entities of a team in a cell ((cellX * nbCellsY + cellY) * NB_TEAMS + team)
+    std::vector<std::vector<int>> mCellTiles;
+};
+}
+
+BOOST_AUTO_TEST_CASE(test_FoundOrders)
+{
+    SearchedTiles searchedTiles;
+    searchedTiles.start(10, 10);
+    BOOST_CHECK(searchedTiles.add(5, 5, 0));
+    BOOST_CHECK(searchedTiles.add(1, 2, 1));
+    BOOST_CHECK(searchedTiles.add(7, 3, 2));
+    // A tile added twice keeps its first order
+    BOOST_CHECK(!searchedTiles.add(5, 5, 3));
+    BOOST_CHECK(searchedTiles.isSearched(1, 2));
+    BOOST_CHECK(!searchedTiles.isSearched(2, 1));
+
+    searchedTiles.found(7, 3);
+    searchedTiles.found(5, 5);
+    searchedTiles.found(7, 3);
+    std::vector<uint32_t> expected = { 0, 2 };
+    const std::vector<uint32_t>& orders = searchedTiles.getFoundOrders();
+    BOOST_CHECK_EQUAL_COLLECTIONS(orders.begin(), orders.end(), expected.begin(), expected.end());
+
+    // A new search forgets the marks of the previous one
+    searchedTiles.start(10, 10);
+    BOOST_CHECK(!searchedTiles.isSearched(5, 5));
+    BOOST_CHECK(searchedTiles.getFoundOrders().empty());
+    BOOST_CHECK(searchedTiles.add(5, 5, 4));
+
+    // As well as a map resize
+    searchedTiles.start(4, 6);
+    BOOST_CHECK(!searchedTiles.isSearched(3, 5));
+    BOOST_CHECK(searchedTiles.add(3, 5, 0));
+    BOOST_CHECK(searchedTiles.isSearched(3, 5));
+}
+
+BOOST_AUTO_TEST_CASE(test_SameAsTileScan)
+{
+    std::mt19937 gen(42);
+    EntityMap entityMap(gen);
+    SearchedTiles searchedTiles;
+
+    std::uniform_int_distribution<int> distTile(0, MAP_SIZE_X * MAP_SIZE_Y - 1);
+    std::uniform_int_distribution<int> distNbTiles(1, 300);
+    std::uniform_int_distribution<int> distTeam(0, NB_TEAMS - 1);
+    for(int i = 0; i < 200; ++i)
+    {
+        // The tiles are given in any order, some of them several times
+        std::vector<int> tiles;
+        int nbTiles = distNbTiles(gen);
+        for(int k = 0; k < nbTiles; ++k)
+            tiles.push_back(distTile(gen));
+
+        int team = distTeam(gen);
+        for(bool enemies : { true, false })
+        {
+            std::vector<int> expected = entityMap.scanTiles(tiles, team, enemies);
+            std::vector<int> result = entityMap.searchCells(searchedTiles, tiles, team, enemies);
+            BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+        }
+    }
+}
@@ -0,0 +1,54 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE ThreadPool
+#include "BoostTestTargetConfig.h"
+
+#include "utils/ThreadPool.h"
+
+#include <atomic>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(test_ThreadPool)
+{
+    for(uint32_t nbThreads = 0; nbThreads < 4; ++nbThreads)
+    {
+        ThreadPool pool(nbThreads);
+        BOOST_CHECK(pool.getNbWorkers() == nbThreads + 1);
+
+        // Each index is processed once, whatever the number of jobs
+        for(uint32_t count : {0u, 1u, 3u, 1000u})
+        {
+            std::vector<std::atomic<uint32_t>> nbCalls(count);
+            for(std::atomic<uint32_t>& nb : nbCalls)
+                nb = 0;
+
+            std::atomic<bool> isWorkerValid(true);
+            pool.parallelFor(count, [&](uint32_t workerIndex, uint32_t index)
+            {
+                if(workerIndex >= pool.getNbWorkers())
+                    isWorkerValid = false;
+
+                ++nbCalls[index];
+            });
+
+            BOOST_CHECK(isWorkerValid);
+            for(std::atomic<uint32_t>& nb : nbCalls)
+                BOOST_CHECK(nb == 1);
+        }
+    }
+}
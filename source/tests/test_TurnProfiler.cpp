@@ -0,0 +1,157 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE TurnProfiler
+#include "BoostTestTargetConfig.h"
+
+#include "gamemap/TurnProfiler.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace
+{
+void sleepMs(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+//! \brief Profiles a turn lasting about the given time
+void runTurn(TurnProfiler& profiler, int64_t turn, int durationMs)
+{
+    profiler.startTurn(turn);
+    profiler.startPhase(TurnPhase::entities);
+    sleepMs(durationMs);
+    profiler.endTurn();
+}
+}
+
+BOOST_AUTO_TEST_CASE(test_PhaseAccounting)
+{
+    TurnProfiler profiler;
+
+    // Turns are only profiled when the profiler was enabled at their start
+    runTurn(profiler, 0, 0);
+    BOOST_CHECK_EQUAL(profiler.getNbProfiles(), 0);
+
+    profiler.setEnabled(true);
+    profiler.startTurn(1);
+    sleepMs(5);
+    profiler.startPhase(TurnPhase::ai);
+    sleepMs(30);
+    profiler.startPhase(TurnPhase::goals);
+    {
+        TurnProfiler::ScopedEntityUpkeep upkeep(profiler, GameEntityType::creature);
+        sleepMs(10);
+    }
+    // A phase entered again is added to its time but keeps its first start
+    profiler.startPhase(TurnPhase::ai);
+    sleepMs(10);
+    profiler.endPhase();
+    sleepMs(5);
+    profiler.endTurn();
+
+    BOOST_REQUIRE_EQUAL(profiler.getNbProfiles(), 1);
+    const TurnProfile& profile = profiler.getProfile(0);
+    uint32_t ai = static_cast<uint32_t>(TurnPhase::ai);
+    uint32_t goals = static_cast<uint32_t>(TurnPhase::goals);
+    uint32_t creature = static_cast<uint32_t>(GameEntityType::creature);
+    BOOST_CHECK_EQUAL(profile.mTurn, 1);
+    BOOST_CHECK(profile.mPhaseTimesMs[ai] >= 40.0);
+    BOOST_CHECK(profile.mPhaseTimesMs[goals] >= 10.0);
+    BOOST_CHECK(profile.mPhaseTimesMs[goals] < profile.mPhaseTimesMs[ai]);
+    BOOST_CHECK(profile.mPhaseStartsMs[ai] >= 5.0);
+    BOOST_CHECK(profile.mPhaseStartsMs[goals] >= profile.mPhaseStartsMs[ai] + 30.0);
+    BOOST_CHECK(profile.mEntityTimesMs[creature] >= 10.0);
+    BOOST_CHECK(profile.mEntityTimesMs[creature] <= profile.mPhaseTimesMs[goals]);
+
+    // The time outside the phases counts in the turn only
+    BOOST_CHECK(profile.mDurationMs >= profile.mPhaseTimesMs[ai] + profile.mPhaseTimesMs[goals] + 10.0);
+    for(uint32_t phase = 0; phase < TurnProfile::NB_PHASES; ++phase)
+    {
+        if((phase == ai) || (phase == goals))
+            continue;
+
+        BOOST_CHECK_EQUAL(profile.mPhaseTimesMs[phase], 0.0);
+        BOOST_CHECK(profile.mPhaseStartsMs[phase] < 0.0);
+    }
+
+    // The upkeep of entities outside a profiled turn is not measured
+    {
+        TurnProfiler::ScopedEntityUpkeep upkeep(profiler, GameEntityType::creature);
+        sleepMs(1);
+    }
+    BOOST_CHECK_EQUAL(profiler.getProfile(0).mEntityTimesMs[creature], profile.mEntityTimesMs[creature]);
+
+    // Disabling the profiler during a turn drops it
+    profiler.startTurn(2);
+    profiler.startPhase(TurnPhase::ai);
+    profiler.setEnabled(false);
+    profiler.endTurn();
+    BOOST_CHECK_EQUAL(profiler.getNbProfiles(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_HistoryWrap)
+{
+    TurnProfiler profiler;
+    profiler.setEnabled(true);
+    uint32_t nbTurns = TurnProfiler::HISTORY_SIZE + 10;
+    for(uint32_t turn = 0; turn < nbTurns; ++turn)
+        runTurn(profiler, turn, 0);
+
+    // The oldest turns are replaced and the history stays ordered from the oldest turn
+    BOOST_REQUIRE_EQUAL(profiler.getNbProfiles(), TurnProfiler::HISTORY_SIZE);
+    for(uint32_t i = 0; i < TurnProfiler::HISTORY_SIZE; ++i)
+        BOOST_REQUIRE_EQUAL(profiler.getProfile(i).mTurn, static_cast<int64_t>(i + 10));
+
+    std::string summary = profiler.getSummary(0);
+    BOOST_CHECK(summary.find("Turns profiled: " + std::to_string(TurnProfiler::HISTORY_SIZE) + " (from turn 10)") == 0);
+
+    profiler.clearHistory();
+    BOOST_CHECK_EQUAL(profiler.getNbProfiles(), 0);
+    BOOST_CHECK_EQUAL(profiler.getSummary(3), "No turn profiled");
+    runTurn(profiler, 5000, 0);
+    BOOST_REQUIRE_EQUAL(profiler.getNbProfiles(), 1);
+    BOOST_CHECK_EQUAL(profiler.getProfile(0).mTurn, 5000);
+}
+
+BOOST_AUTO_TEST_CASE(test_SummarySlowestTurns)
+{
+    TurnProfiler profiler;
+    profiler.setEnabled(true);
+    runTurn(profiler, 10, 1);
+    runTurn(profiler, 11, 40);
+    runTurn(profiler, 12, 1);
+    runTurn(profiler, 13, 80);
+    runTurn(profiler, 14, 1);
+
+    // The slowest turns are given from the slowest one with their main phase
+    std::string summary = profiler.getSummary(2);
+    size_t posTurn13 = summary.find("\nTurn 13: ");
+    size_t posTurn11 = summary.find("\nTurn 11: ");
+    BOOST_REQUIRE(posTurn13 != std::string::npos);
+    BOOST_REQUIRE(posTurn11 != std::string::npos);
+    BOOST_CHECK(posTurn13 < posTurn11);
+    BOOST_CHECK(summary.find("\nTurn 10: ") == std::string::npos);
+    BOOST_CHECK(summary.find("(entities=", posTurn13) != std::string::npos);
+
+    // Asking for more turns than profiled gives all of them
+    summary = profiler.getSummary(100);
+    for(int turn = 10; turn <= 14; ++turn)
+        BOOST_CHECK(summary.find("\nTurn " + std::to_string(turn) + ": ") != std::string::npos);
+}
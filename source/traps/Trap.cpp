@@ -253,6 +253,7 @@ void Trap::activate(Tile* tile)
     trapTileData->setActivated(true);
     trapTileData->setNbShootsBeforeDeactivation(mNbShootsBeforeDeactivation);
     trapTileData->setReloadTime(0);
+    getGameMap()->tileVisionChanged(tile);
 
     BuildingObject* entity = getBuildingObjectFromTile(tile);
     if (entity == nullptr)
@@ -268,6 +269,7 @@ void Trap::deactivate(Tile* tile)
 
     TrapTileData* trapTileData = static_cast<TrapTileData*>(mTileData[tile]);
     trapTileData->setActivated(false);
+    getGameMap()->tileVisionChanged(tile);
 
     BuildingObject* entity = getBuildingObjectFromTile(tile);
     if (entity == nullptr)
@@ -21,90 +21,75 @@
  */
 
 #include "utils/Random.h"
-#include "utils/Helper.h"
 
-#include <algorithm>
-#include <cmath>
+#include "utils/RandomGenerator.h"
+
+#include <atomic>
 #include <ctime>
 
-unsigned long myRandomSeed;
-const unsigned long MAX = 32768;
+//! \brief Process wide generator. Atomic because many servers can run in the same process (each one in its
+//! own thread). Since the generator is counter based, reserving a counter value is enough to draw a number
+static std::atomic<uint64_t> myRandomSeed(0);
+static std::atomic<uint64_t> myRandomCounter(0);
+
+//! \brief Generator bound to the calling thread (nullptr to use the process wide one)
+static thread_local RandomGenerator* myThreadGenerator = nullptr;
 
-static unsigned long randgen()
+//! \brief Calls the given function on the generator to use
+template<typename Func>
+static auto draw(Func func) -> decltype(func(*myThreadGenerator))
 {
-    myRandomSeed = myRandomSeed * 1103515245 + 12345;
-    //TODO: What is the purpose of the cast?
-    unsigned long returnVal = static_cast<unsigned int>(myRandomSeed / 65536) % MAX;
+    if(myThreadGenerator != nullptr)
+        return func(*myThreadGenerator);
 
-    return returnVal;
+    // We reserve as many values as the gaussian needs so that a draw never shares a value with another
+    uint64_t counter = myRandomCounter.fetch_add(2, std::memory_order_relaxed);
+    RandomGenerator generator(myRandomSeed.load(std::memory_order_relaxed), counter);
+    return func(generator);
 }
 
-//! \brief uniformly distributed number [0;1)
-static double uniform()
+namespace Random
 {
-    return randgen() * 1.0 / static_cast<double>(MAX);
-}
 
-//! \brief uniformly distributed number [lo;hi)
-static double uniform(double lo, double hi)
+void initialize()
 {
-    return uniform() * (hi - lo) + lo;
+    initialize(static_cast<unsigned long>(std::time(0)));
 }
 
-//! \brief random integer [lo;hi]
-static int randint(int lo, int hi)
+void initialize(unsigned long seed)
 {
-    return static_cast<int>(uniform() * (hi - lo + 1) + lo);
+    myRandomSeed = static_cast<uint64_t>(seed);
+    myRandomCounter = 0;
 }
 
-//! \brief random unsigned integer [lo;hi]
-static unsigned int randuint(unsigned int lo, unsigned int hi)
+void setThreadGenerator(RandomGenerator* generator)
 {
-    return static_cast<unsigned int>(uniform() * (hi - lo + 1) + lo);
+    myThreadGenerator = generator;
 }
 
-
-namespace Random
+RandomGenerator* getThreadGenerator()
 {
-
-void initialize()
-{
-    myRandomSeed = static_cast<unsigned long>(std::time(0));
+    return myThreadGenerator;
 }
 
 double Double(double min, double max)
 {
-    if (min > max)
-    {
-        std::swap(min, max);
-    }
-
-    return uniform(min, max);
+    return draw([min, max](RandomGenerator& generator) { return generator.Double(min, max); });
 }
 
 int Int(int min, int max)
 {
-    if (min > max)
-    {
-        std::swap(min, max);
-    }
-
-    return randint(min, max);
+    return draw([min, max](RandomGenerator& generator) { return generator.Int(min, max); });
 }
 
 unsigned int Uint(unsigned int min, unsigned int max)
 {
-    if (min > max)
-    {
-        std::swap(min, max);
-    }
-
-    return randuint(min, max);
+    return draw([min, max](RandomGenerator& generator) { return generator.Uint(min, max); });
 }
 
 double gaussianRandomDouble()
 {
-    return std::sqrt(-2.0 * log(Double(0.0, 1.0))) * cos(2.0 * PI * Double(0.0, 1.0));
+    return draw([](RandomGenerator& generator) { return generator.gaussianRandomDouble(); });
 }
 
 } // namespace Random
@@ -23,11 +23,48 @@
 #ifndef RANDOM_H_
 #define RANDOM_H_
 
+class RandomGenerator;
+
+/*! \brief The random functions draw from the generator bound to the calling thread (usually the one of the
+ * GameMap processed by the thread, see ODServer::setThreadServer). If no generator is bound, they draw from
+ * a process wide generator.
+ */
 namespace Random
 {
-    //! \brief initializes the semaphore and seeds the generator
+    //! \brief seeds the process wide generator
     void initialize();
 
+    //! \brief seeds the process wide generator with the given seed so that the same numbers are generated on each run
+    void initialize(unsigned long seed);
+
+    //! \brief Binds the given generator to the calling thread. nullptr restores the process wide generator
+    void setThreadGenerator(RandomGenerator* generator);
+
+    RandomGenerator* getThreadGenerator();
+
+    //! \brief Binds a generator to the calling thread for the lifetime of the object and restores the
+    //! previous one when destroyed
+    class ScopedThreadGenerator
+    {
+    public:
+        ScopedThreadGenerator(RandomGenerator& generator) :
+            mPrevious(getThreadGenerator())
+        {
+            setThreadGenerator(&generator);
+        }
+
+        ~ScopedThreadGenerator()
+        {
+            setThreadGenerator(mPrevious);
+        }
+
+    private:
+        RandomGenerator* mPrevious;
+
+        ScopedThreadGenerator(const ScopedThreadGenerator&) = delete;
+        ScopedThreadGenerator& operator=(const ScopedThreadGenerator&) = delete;
+    };
+
     /*! \brief generate a random double
      *
      *  \param min, max One or both can be negative
@@ -0,0 +1,84 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/RandomGenerator.h"
+#include "utils/Helper.h"
+
+#include <algorithm>
+#include <cmath>
+
+//! \brief Increment of SplitMix64 (2^64 divided by the golden ratio)
+static const uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ULL;
+
+//! \brief SplitMix64 output function
+static uint64_t mix(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+uint64_t RandomGenerator::generate(uint64_t seed, uint64_t counter)
+{
+    return mix(seed + counter * GOLDEN_GAMMA);
+}
+
+double RandomGenerator::toUniform(uint64_t value)
+{
+    // The 53 upper bits fill the mantissa
+    return static_cast<double>(value >> 11) * (1.0 / 9007199254740992.0);
+}
+
+RandomGenerator RandomGenerator::derive(int64_t turn, uint64_t id) const
+{
+    // Each value is mixed in turn so that close turns or ids give unrelated seeds
+    uint64_t seed = mix(mSeed + GOLDEN_GAMMA);
+    seed = mix(seed ^ static_cast<uint64_t>(turn));
+    seed = mix(seed ^ id);
+    return RandomGenerator(seed);
+}
+
+double RandomGenerator::Double(double min, double max)
+{
+    if (min > max)
+        std::swap(min, max);
+
+    return toUniform(next()) * (max - min) + min;
+}
+
+int RandomGenerator::Int(int min, int max)
+{
+    if (min > max)
+        std::swap(min, max);
+
+    return static_cast<int>(toUniform(next()) * (max - min + 1) + min);
+}
+
+unsigned int RandomGenerator::Uint(unsigned int min, unsigned int max)
+{
+    if (min > max)
+        std::swap(min, max);
+
+    return static_cast<unsigned int>(toUniform(next()) * (max - min + 1) + min);
+}
+
+double RandomGenerator::gaussianRandomDouble()
+{
+    double u1 = Double(0.0, 1.0);
+    double u2 = Double(0.0, 1.0);
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * PI * u2);
+}
@@ -0,0 +1,77 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RANDOMGENERATOR_H
+#define RANDOMGENERATOR_H
+
+#include <cstdint>
+
+/*! \brief Counter based random number generator.
+ *
+ * The nth number generated only depends on the seed and on n (it is the SplitMix64 hash of seed + n * constant).
+ * Thus, a generator is only 2 integers, it can be copied to replay a sequence and independent substreams can be
+ * derived from a key (for example, the turn and the handle of an entity) without drawing from the parent stream.
+ * Each GameMap owns a generator (see Random::setThreadGenerator to make the Random functions use it).
+ */
+class RandomGenerator
+{
+public:
+    explicit RandomGenerator(uint64_t seed = 0, uint64_t counter = 0) :
+        mSeed(seed),
+        mCounter(counter)
+    {}
+
+    //! \brief Restarts the sequence of the given seed
+    void setSeed(uint64_t seed)
+    {
+        mSeed = seed;
+        mCounter = 0;
+    }
+
+    uint64_t getSeed() const
+    { return mSeed; }
+
+    //! \brief Number of values drawn since the seed was set
+    uint64_t getCounter() const
+    { return mCounter; }
+
+    //! \brief Returns the generator of the substream identified by the given turn and id. The parent
+    //! stream is not modified
+    RandomGenerator derive(int64_t turn, uint64_t id) const;
+
+    //! \brief Returns a uniformly distributed 64 bits value
+    uint64_t next()
+    { return generate(mSeed, ++mCounter); }
+
+    //! \brief Same semantics as the Random functions
+    double Double(double min, double max);
+    int Int(int min, int max);
+    unsigned int Uint(unsigned int min, unsigned int max);
+    double gaussianRandomDouble();
+
+    //! \brief Returns the value number counter of the stream of the given seed
+    static uint64_t generate(uint64_t seed, uint64_t counter);
+
+    //! \brief Converts a generated value to a double in [0;1)
+    static double toUniform(uint64_t value);
+
+private:
+    uint64_t mSeed;
+    uint64_t mCounter;
+};
+
+#endif // RANDOMGENERATOR_H
@@ -84,8 +84,13 @@ const std::string ResourceManager::RESOURCEGROUPSOUND = "Sound";
  */
 ResourceManager::ResourceManager(boost::program_options::variables_map& options) :
         mServerMode(false),
+        mServerModeNbGames(1),
+        mServerModeNbThreads(0),
         mForcedNetworkPort(-1),
+        mSaveCommandLog(false),
         mLogLevel(LogMessageLevel::NORMAL),
+        mHeadlessNbTurns(1000),
+        mHeadlessSeed(0),
         mGameDataPath("./"),
         mUserDataPath("./"),
         mUserConfigPath("./")
@@ -321,6 +326,30 @@ void ResourceManager::setupUserDataFolders(boost::program_options::variables_map
         exit(1);
     }
 
+    // The levels can still be loaded without the cache
+    mLevelCachePath = mUserDataPath + "levelCache/";
+    try
+    {
+      boost::filesystem::create_directories(mLevelCachePath);
+    }
+    catch (const boost::filesystem::filesystem_error& e)
+    {
+        std::cerr << "Error creating level cache folder: " << e.what() <<  std::endl;
+        mLevelCachePath.clear();
+    }
+
+    // Only used by the turn profiler
+    mTurnProfilePath = mUserDataPath + "profiles/";
+    try
+    {
+      boost::filesystem::create_directories(mTurnProfilePath);
+    }
+    catch (const boost::filesystem::filesystem_error& e)
+    {
+        std::cerr << "Error creating turn profile folder: " << e.what() <<  std::endl;
+        mTurnProfilePath.clear();
+    }
+
     mUserSkirmishLevelsPath = mUserDataPath + "levels/skirmish/";
     try
     {
@@ -425,14 +454,83 @@ void ResourceManager::setupUserDataFolders(boost::program_options::variables_map
         }
     }
 
+    if(mServerMode)
+    {
+        itOption = options.find("servergames");
+        if(itOption != options.end())
+            mServerModeNbGames = itOption->second.as<uint32_t>();
+
+        itOption = options.find("serverthreads");
+        if(itOption != options.end())
+            mServerModeNbThreads = itOption->second.as<uint32_t>();
+    }
+
     itOption = options.find("port");
     if(itOption != options.end())
         mForcedNetworkPort = itOption->second.as<int32_t>();
 
+    itOption = options.find("commandlog");
+    if(itOption != options.end())
+        mSaveCommandLog = true;
+
+    itOption = options.find("commandlogverify");
+    if(itOption != options.end())
+        mCommandLogVerifyFile = itOption->second.as<std::string>();
+
     itOption = options.find("loglevel");
     if(itOption != options.end())
         mLogLevel = static_cast<LogMessageLevel>(itOption->second.as<int32_t>());
 
+    itOption = options.find("reindexreplay");
+    if(itOption != options.end())
+        mReplayToReindex = itOption->second.as<std::string>();
+
+    itOption = options.find("benchmark");
+    if(itOption != options.end())
+        mBenchmarkFile = itOption->second.as<std::string>();
+
+    itOption = options.find("pathbenchmark");
+    if(itOption != options.end())
+        mPathBenchmarkFile = itOption->second.as<std::string>();
+
+    itOption = options.find("pathgolden");
+    if(itOption != options.end())
+        mPathGoldenFile = itOption->second.as<std::string>();
+
+    itOption = options.find("pathgoldensave");
+    if(itOption != options.end())
+        mPathGoldenSaveFile = itOption->second.as<std::string>();
+
+    // The number of turns and the seed are shared by the headless game and the benchmark
+    itOption = options.find("headlessturns");
+    if(itOption != options.end())
+        mHeadlessNbTurns = itOption->second.as<int32_t>();
+
+    itOption = options.find("headlessseed");
+    if(itOption != options.end())
+        mHeadlessSeed = itOption->second.as<uint32_t>();
+
+    itOption = options.find("headless");
+    if(itOption != options.end())
+    {
+        std::string filePath = getGameLevelPathMultiplayer() + itOption->second.as<std::string>();
+        boost::filesystem::path level(filePath);
+        if(!boost::filesystem::exists(level))
+        {
+            std::cerr << "Wanted level not found: " << filePath <<  std::endl;
+            exit(1);
+        }
+        mHeadlessLevel = level.string();
+
+        auto it2 = options.find("headlesschecksums");
+        if(it2 != options.end())
+            mHeadlessChecksumsFile = it2->second.as<std::string>();
+
+        it2 = options.find("headlessverify");
+        if(it2 != options.end())
+            mHeadlessVerifyFile = it2->second.as<std::string>();
+    }
+
     mUserConfigFile = mUserConfigPath + USERCFGFILENAME;
     mCeguiLogFile = mUserDataPath + CEGUILOGFILENAME;
     mShaderCachePath = mUserDataPath + SHADERCACHESUBPATH;
@@ -567,6 +665,15 @@ std::string ResourceManager::buildReplayFilename()
     return ss.str();
 }
 
+std::string ResourceManager::buildCommandLogFilename(int32_t port)
+{
+    static std::locale loc(std::wcout.getloc(), new boost::posix_time::time_facet("%Y%m%d_%H%M%S"));
+    std::ostringstream ss;
+    ss.imbue(loc);
+    ss << "commandlog_" << boost::posix_time::second_clock::local_time() << "_" << port << ".odl";
+    return ss.str();
+}
+
 void ResourceManager::buildCommandOptions(boost::program_options::options_description& desc)
 {
     desc.add_options()
@@ -576,8 +683,22 @@ void ResourceManager::buildCommandOptions(boost::program_options::options_descri
         ("serversave", boost::program_options::value<std::string>(), "Launches the game on server mode and opens the given saved game")
         ("appData", boost::program_options::value<std::string>(), "Sets appData to the given path (where logs, replays, ... are saved)")
         ("mscreator", boost::program_options::value<std::string>(), "Sets the creator for this map to connect to the master server. server/servercustom/serversave option needs to be on")
+        ("servergames", boost::program_options::value<uint32_t>(), "Sets how many games of the level are hosted by the server (on consecutive ports). server/servercustom/serversave option needs to be on")
+        ("serverthreads", boost::program_options::value<uint32_t>(), "Sets how many threads process the games when hosting many games (default is the number of cores). server/servercustom/serversave option needs to be on")
         ("port", boost::program_options::value<int32_t>(), "Sets the port used. Note that the port is used for both single and multi player")
+        ("commandlog", "Saves a deterministic command log of the hosted games (in the replay folder) to check for desyncs: the players commands are applied at the start of the next turn. The clients still receive the full game state. server/servercustom/serversave option needs to be on")
+        ("commandlogverify", boost::program_options::value<std::string>(), "Plays again without gui nor network the game saved in the given command log, checks it gives the same checksums and exits")
         ("loglevel", boost::program_options::value<int32_t>(), "Sets the log level (between 0=Trivial and 3=Critical)")
+        ("reindexreplay", boost::program_options::value<std::string>(), "Writes the index of the given replay if it was not closed (for example, if the game crashed) and exits. Replays recorded before the indexed format cannot be converted")
+        ("headless", boost::program_options::value<std::string>(), "Plays the given level from official levels path without gui nor network (every seat is played by an AI) and exits")
+        ("headlessturns", boost::program_options::value<int32_t>(), "Sets the number of turns played by the headless game or by each level of the benchmark. headless or benchmark option needs to be on")
+        ("headlessseed", boost::program_options::value<uint32_t>(), "Sets the random seed used by the headless game or by the benchmarks (the pathfinding benchmark uses it to draw its queries). headless, benchmark or pathbenchmark option needs to be on")
+        ("headlesschecksums", boost::program_options::value<std::string>(), "Saves the game state checksum of each turn of the headless game in the given file. headless option needs to be on")
+        ("headlessverify", boost::program_options::value<std::string>(), "Checks that the headless game gives the checksums saved in the given file. headless option needs to be on")
+        ("benchmark", boost::program_options::value<std::string>(), "Plays the benchmark levels without gui nor network, saves the turn and phases durations in the given json file and exits")
+        ("pathbenchmark", boost::program_options::value<std::string>(), "Loads the benchmark levels without gui nor network, then times pathfinding queries on them, saves their durations in the given json file and exits")
+        ("pathgolden", boost::program_options::value<std::string>(), "Replays the pathfinding queries of the given golden file and compares their results with the recorded ones. Without it, the queries are drawn from the creatures of the levels. pathbenchmark option needs to be on")
+        ("pathgoldensave", boost::program_options::value<std::string>(), "Saves the pathfinding queries and their results in the given golden file. pathbenchmark option needs to be on")
     ;
 }
 
@@ -84,6 +84,9 @@ public:
 
     std::string buildReplayFilename();
 
+    //! \brief Name of the command log of the game hosted on the given port
+    std::string buildCommandLogFilename(int32_t port);
+
     inline const std::string& getGameDataPath() const
     { return mGameDataPath; }
 
@@ -96,6 +99,14 @@ public:
     inline const std::string& getSaveGamePath() const
     { return mSaveGamePath; }
 
+    //! \brief Folder where the compiled levels are cached (see CompiledLevel). Empty if it could not be created
+    inline const std::string& getLevelCachePath() const
+    { return mLevelCachePath; }
+
+    //! \brief Folder where the turn profiles are saved. Empty if it could not be created
+    inline const std::string& getTurnProfilePath() const
+    { return mTurnProfilePath; }
+
     inline const std::string& getUserConfigPath() const
     { return mUserConfigPath; }
 
@@ -145,24 +156,94 @@ public:
     inline const std::string& getServerModeCreator() const
     { return mServerModeCreator; }
 
+    inline uint32_t getServerModeNbGames() const
+    { return mServerModeNbGames; }
+
+    inline uint32_t getServerModeNbThreads() const
+    { return mServerModeNbThreads; }
+
     inline int32_t getForcedNetworkPort() const
     { return mForcedNetworkPort; }
 
+    inline bool isSavingCommandLog() const
+    { return mSaveCommandLog; }
+
+    inline const std::string& getCommandLogVerifyFile() const
+    { return mCommandLogVerifyFile; }
+
     inline LogMessageLevel getLogLevel() const
     { return mLogLevel; }
 
+    inline const std::string& getReplayToReindex() const
+    { return mReplayToReindex; }
+
+    inline const std::string& getHeadlessLevel() const
+    { return mHeadlessLevel; }
+
+    inline int32_t getHeadlessNbTurns() const
+    { return mHeadlessNbTurns; }
+
+    inline uint32_t getHeadlessSeed() const
+    { return mHeadlessSeed; }
+
+    inline const std::string& getHeadlessChecksumsFile() const
+    { return mHeadlessChecksumsFile; }
+
+    inline const std::string& getHeadlessVerifyFile() const
+    { return mHeadlessVerifyFile; }
+
+    inline const std::string& getBenchmarkFile() const
+    { return mBenchmarkFile; }
+
+    inline const std::string& getPathBenchmarkFile() const
+    { return mPathBenchmarkFile; }
+
+    inline const std::string& getPathGoldenFile() const
+    { return mPathGoldenFile; }
+
+    inline const std::string& getPathGoldenSaveFile() const
+    { return mPathGoldenSaveFile; }
+
 private:
     //! \brief used when the executable is launched in server mode
     bool mServerMode;
     std::string mServerModeLevel;
     std::string mServerModeCreator;
+    uint32_t mServerModeNbGames;
+    //! \brief Number of simulation threads when hosting many games. 0 means one per core
+    uint32_t mServerModeNbThreads;
 
     //! \brief used when the network port is forced
     int32_t mForcedNetworkPort;
 
+    //! \brief True if the games hosted by a dedicated server should save a deterministic command log (see ODServer)
+    bool mSaveCommandLog;
+
+    //! \brief Command log to play again if the executable is launched to check it for desyncs
+    std::string mCommandLogVerifyFile;
+
     //! \brief The log level
     LogMessageLevel mLogLevel;
 
+    //! \brief Replay to index if the executable is launched to index a replay that was not closed
+    std::string mReplayToReindex;
+
+    //! \brief used when the executable is launched to play a headless game
+    std::string mHeadlessLevel;
+    int32_t mHeadlessNbTurns;
+    uint32_t mHeadlessSeed;
+    std::string mHeadlessChecksumsFile;
+    std::string mHeadlessVerifyFile;
+
+    //! \brief Json file where the benchmark results are saved if the executable is launched to run the benchmark
+    std::string mBenchmarkFile;
+
+    //! \brief Json file where the pathfinding benchmark results are saved, golden file whose queries are replayed
+    //! and golden file where the queries and results are saved
+    std::string mPathBenchmarkFile;
+    std::string mPathGoldenFile;
+    std::string mPathGoldenSaveFile;
+
     //! \brief The application data path
     //! \example "/usr/share/game/opendungeons" on linux
     //! \example "C:/opendungeons" on windows
@@ -196,6 +277,8 @@ private:
     std::string mLanguagePath;
     std::string mReplayPath;
     std::string mSaveGamePath;
+    std::string mLevelCachePath;
+    std::string mTurnProfilePath;
     std::string mUserSkirmishLevelsPath;
     std::string mUserMultiplayerLevelsPath;
 
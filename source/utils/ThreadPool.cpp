@@ -0,0 +1,198 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t nbThreads) :
+    mGeneration(0),
+    mNbWorkersRunning(0),
+    mJob(nullptr),
+    mIsStopping(false)
+{
+    for(uint32_t i = 0; i <= nbThreads; ++i)
+    {
+        mRanges.emplace_back(new Range());
+        mRanges.back()->mBegin = 0;
+        mRanges.back()->mEnd = 0;
+    }
+
+    // Worker 0 is the thread calling parallelFor
+    for(uint32_t i = 1; i <= nbThreads; ++i)
+        mThreads.emplace_back(&ThreadPool::workerThread, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsStopping = true;
+    }
+    mStartCondition.notify_all();
+
+    for(std::thread& thread : mThreads)
+        thread.join();
+}
+
+void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)>& job)
+{
+    if(count == 0)
+        return;
+
+    // If there is no worker thread or too few jobs, it is not worth waking up the workers
+    uint32_t nbWorkers = getNbWorkers();
+    if((nbWorkers == 1) || (count == 1))
+    {
+        for(uint32_t index = 0; index < count; ++index)
+            job(0, index);
+
+        return;
+    }
+
+    // We split the indexes evenly. Workers that finish early will steal from the others
+    for(uint32_t workerIndex = 0; workerIndex < nbWorkers; ++workerIndex)
+    {
+        Range& range = *mRanges[workerIndex];
+        std::lock_guard<std::mutex> lock(range.mMutex);
+        range.mBegin = static_cast<uint32_t>(static_cast<uint64_t>(count) * workerIndex / nbWorkers);
+        range.mEnd = static_cast<uint32_t>(static_cast<uint64_t>(count) * (workerIndex + 1) / nbWorkers);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJob = &job;
+        mNbWorkersRunning = nbWorkers - 1;
+        ++mGeneration;
+    }
+    mStartCondition.notify_all();
+
+    work(0, job);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCondition.wait(lock, [this]() { return mNbWorkersRunning == 0; });
+    mJob = nullptr;
+}
+
+uint32_t ThreadPool::getDefaultNbThreads()
+{
+    uint32_t nbCores = std::thread::hardware_concurrency();
+    if(nbCores <= 1)
+        return 0;
+
+    return nbCores - 1;
+}
+
+void ThreadPool::workerThread(uint32_t workerIndex)
+{
+    uint64_t generation = 0;
+    while(true)
+    {
+        const std::function<void(uint32_t, uint32_t)>* job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mStartCondition.wait(lock, [this, generation]() { return mIsStopping || (mGeneration != generation); });
+            if(mIsStopping)
+                return;
+
+            generation = mGeneration;
+            job = mJob;
+        }
+
+        work(workerIndex, *job);
+
+        bool isLast;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            --mNbWorkersRunning;
+            isLast = (mNbWorkersRunning == 0);
+        }
+        if(isLast)
+            mDoneCondition.notify_one();
+    }
+}
+
+void ThreadPool::work(uint32_t workerIndex, const std::function<void(uint32_t, uint32_t)>& job)
+{
+    while(true)
+    {
+        uint32_t index;
+        while(popIndex(workerIndex, index))
+            job(workerIndex, index);
+
+        if(!steal(workerIndex))
+            return;
+    }
+}
+
+bool ThreadPool::popIndex(uint32_t workerIndex, uint32_t& index)
+{
+    Range& range = *mRanges[workerIndex];
+    std::lock_guard<std::mutex> lock(range.mMutex);
+    if(range.mBegin >= range.mEnd)
+        return false;
+
+    index = range.mBegin;
+    ++range.mBegin;
+    return true;
+}
+
+bool ThreadPool::steal(uint32_t workerIndex)
+{
+    while(true)
+    {
+        // We look for the worker with the most work left
+        uint32_t victimIndex = workerIndex;
+        uint32_t victimSize = 0;
+        for(uint32_t otherIndex = 0; otherIndex < mRanges.size(); ++otherIndex)
+        {
+            if(otherIndex == workerIndex)
+                continue;
+
+            Range& range = *mRanges[otherIndex];
+            std::lock_guard<std::mutex> lock(range.mMutex);
+            uint32_t size = (range.mEnd > range.mBegin) ? range.mEnd - range.mBegin : 0;
+            if(size <= victimSize)
+                continue;
+
+            victimIndex = otherIndex;
+            victimSize = size;
+        }
+
+        if(victimSize == 0)
+            return false;
+
+        // We take the second half of its range. Its size may have changed since we checked
+        uint32_t begin;
+        uint32_t end;
+        {
+            Range& victim = *mRanges[victimIndex];
+            std::lock_guard<std::mutex> lock(victim.mMutex);
+            if(victim.mEnd <= victim.mBegin)
+                continue;
+
+            uint32_t size = victim.mEnd - victim.mBegin;
+            end = victim.mEnd;
+            begin = victim.mEnd - (size + 1) / 2;
+            victim.mEnd = begin;
+        }
+
+        Range& range = *mRanges[workerIndex];
+        std::lock_guard<std::mutex> lock(range.mMutex);
+        range.mBegin = begin;
+        range.mEnd = end;
+        return true;
+    }
+}
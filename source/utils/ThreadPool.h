@@ -0,0 +1,91 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*! \brief Pool of worker threads used to process independent jobs in parallel.
+ *
+ * parallelFor splits the indexes between the workers (the calling thread is worker 0). Each worker
+ * processes its own range and, when it is done, steals half of the biggest remaining range of another
+ * worker. The order in which the indexes are processed is not defined. Thus, the jobs should not depend
+ * on each other and should only write data owned by their index (or by their worker).
+ */
+class ThreadPool
+{
+public:
+    //! \brief Creates nbThreads worker threads. The calling thread also works so, if nbThreads is 0,
+    //! parallelFor processes every index in the calling thread
+    ThreadPool(uint32_t nbThreads);
+    ~ThreadPool();
+
+    //! \brief Number of workers including the calling thread. The worker index given to the jobs is
+    //! lower than this value
+    uint32_t getNbWorkers() const
+    { return static_cast<uint32_t>(mRanges.size()); }
+
+    //! \brief Calls job(workerIndex, index) for each index in [0, count[ and returns when they are all processed.
+    //! Should only be called from one thread at a time
+    void parallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)>& job);
+
+    //! \brief Returns the number of threads a pool should use to use every core
+    static uint32_t getDefaultNbThreads();
+
+private:
+    //! \brief Indexes [mBegin, mEnd[ left to a worker
+    struct Range
+    {
+        std::mutex mMutex;
+        uint32_t mBegin;
+        uint32_t mEnd;
+    };
+
+    std::vector<std::thread> mThreads;
+    std::vector<std::unique_ptr<Range>> mRanges;
+
+    //! \brief Protects the members below
+    std::mutex mMutex;
+    std::condition_variable mStartCondition;
+    std::condition_variable mDoneCondition;
+    //! \brief Incremented each time parallelFor is called so that workers know they have work
+    uint64_t mGeneration;
+    uint32_t mNbWorkersRunning;
+    const std::function<void(uint32_t, uint32_t)>* mJob;
+    bool mIsStopping;
+
+    void workerThread(uint32_t workerIndex);
+
+    //! \brief Processes the indexes of the given worker and steals from the others until there is nothing left
+    void work(uint32_t workerIndex, const std::function<void(uint32_t, uint32_t)>& job);
+
+    //! \brief Gets the next index of the given worker. Returns false if it has none left
+    bool popIndex(uint32_t workerIndex, uint32_t& index);
+
+    //! \brief Moves half of the biggest range of the other workers to the given worker. Returns false if there is
+    //! nothing left to steal
+    bool steal(uint32_t workerIndex);
+};
+
+#endif // THREADPOOL_H